@@ -0,0 +1,204 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <string.h>
+
+#include "pk-backend-alpm.h"
+#include "pk-alpm-files.h"
+
+/* the keys point into the file lists owned by libalpm, so every index has
+ * to be dropped before a database is reloaded, updated or unregistered */
+typedef struct {
+	const gchar	*key;
+	alpm_pkg_t	*pkg;
+} PkAlpmFileEntry;
+
+typedef struct {
+	GArray		*basenames;	/* of PkAlpmFileEntry, sorted by key */
+	GArray		*paths;		/* of PkAlpmFileEntry, sorted by key */
+} PkAlpmFileIndex;
+
+static void
+pk_alpm_file_index_free (PkAlpmFileIndex *file_index)
+{
+	g_array_unref (file_index->basenames);
+	g_array_unref (file_index->paths);
+	g_free (file_index);
+}
+
+static gint
+pk_alpm_file_entry_compare (gconstpointer a, gconstpointer b)
+{
+	const PkAlpmFileEntry *entry_a = a;
+	const PkAlpmFileEntry *entry_b = b;
+	return strcmp (entry_a->key, entry_b->key);
+}
+
+static void
+pk_alpm_file_index_sort_cb (gpointer data, gpointer user_data)
+{
+	GArray *entries = data;
+	g_array_sort (entries, pk_alpm_file_entry_compare);
+}
+
+static PkAlpmFileIndex *
+pk_alpm_file_index_new (alpm_db_t *db)
+{
+	PkAlpmFileIndex *file_index = g_new0 (PkAlpmFileIndex, 1);
+	const alpm_list_t *i;
+
+	file_index->basenames = g_array_new (FALSE, FALSE, sizeof (PkAlpmFileEntry));
+	file_index->paths = g_array_new (FALSE, FALSE, sizeof (PkAlpmFileEntry));
+
+	/* libalpm is not thread safe, so the file lists are read here */
+	for (i = alpm_db_get_pkgcache (db); i != NULL; i = i->next) {
+		alpm_filelist_t *files = alpm_pkg_get_files (i->data);
+		gsize j;
+
+		for (j = 0; j < files->count; ++j) {
+			const gchar *file = files->files[j].name;
+			const gchar *name = strrchr (file, G_DIR_SEPARATOR);
+			PkAlpmFileEntry entry = { file, i->data };
+
+			g_array_append_val (file_index->paths, entry);
+
+			/* directories have no basename to match */
+			entry.key = (name == NULL) ? file : name + 1;
+			if (*entry.key != '\0')
+				g_array_append_val (file_index->basenames, entry);
+		}
+	}
+
+	return file_index;
+}
+
+static GHashTable *
+pk_alpm_files_get_indexes (PkBackend *self)
+{
+	PkBackendAlpmPrivate *priv = pk_backend_get_user_data (self);
+
+	if (priv->file_indexes == NULL) {
+		priv->file_indexes = g_hash_table_new_full (NULL, NULL, NULL,
+							    (GDestroyNotify) pk_alpm_file_index_free);
+	}
+	return priv->file_indexes;
+}
+
+void
+pk_alpm_files_build (PkBackend *self, const alpm_list_t *dbs)
+{
+	GHashTable *indexes = pk_alpm_files_get_indexes (self);
+	GThreadPool *pool;
+	const alpm_list_t *i;
+
+	/* sorting millions of paths is the slow part, so use every core */
+	pool = g_thread_pool_new (pk_alpm_file_index_sort_cb, NULL,
+				  (gint) g_get_num_processors (), FALSE, NULL);
+
+	for (i = dbs; i != NULL; i = i->next) {
+		PkAlpmFileIndex *file_index;
+
+		if (g_hash_table_contains (indexes, i->data))
+			continue;
+
+		g_debug ("building file index for %s", alpm_db_get_name (i->data));
+		file_index = pk_alpm_file_index_new (i->data);
+		g_thread_pool_push (pool, file_index->basenames, NULL);
+		g_thread_pool_push (pool, file_index->paths, NULL);
+		g_hash_table_insert (indexes, i->data, file_index);
+	}
+
+	/* wait for all the sorts to finish */
+	g_thread_pool_free (pool, FALSE, TRUE);
+}
+
+static void
+pk_alpm_file_index_lookup (GArray *entries, const gchar *key, GHashTable *found)
+{
+	guint lower = 0, upper = entries->len;
+
+	/* find the first entry that is not less than the key */
+	while (lower < upper) {
+		guint middle = lower + (upper - lower) / 2;
+		const PkAlpmFileEntry *entry = &g_array_index (entries, PkAlpmFileEntry, middle);
+
+		if (strcmp (entry->key, key) < 0)
+			lower = middle + 1;
+		else
+			upper = middle;
+	}
+
+	for (; lower < entries->len; ++lower) {
+		const PkAlpmFileEntry *entry = &g_array_index (entries, PkAlpmFileEntry, lower);
+		if (strcmp (entry->key, key) != 0)
+			break;
+		g_hash_table_add (found, entry->pkg);
+	}
+}
+
+/**
+ * pk_alpm_files_lookup:
+ *
+ * Finds the packages in @db owning a file, matching the full path if
+ * @needle starts with a separator and the basename otherwise.
+ *
+ * Return value: (transfer full): a set of alpm_pkg_t
+ **/
+GHashTable *
+pk_alpm_files_lookup (PkBackend *self, alpm_db_t *db, const gchar *needle)
+{
+	GHashTable *indexes = pk_alpm_files_get_indexes (self);
+	PkAlpmFileIndex *file_index;
+	GHashTable *found;
+
+	g_return_val_if_fail (db != NULL, NULL);
+	g_return_val_if_fail (needle != NULL, NULL);
+
+	file_index = g_hash_table_lookup (indexes, db);
+	if (file_index == NULL) {
+		alpm_list_t *dbs = alpm_list_add (NULL, db);
+		pk_alpm_files_build (self, dbs);
+		alpm_list_free (dbs);
+		file_index = g_hash_table_lookup (indexes, db);
+	}
+
+	found = g_hash_table_new (NULL, NULL);
+	if (G_IS_DIR_SEPARATOR (*needle))
+		pk_alpm_file_index_lookup (file_index->paths, needle + 1, found);
+	else
+		pk_alpm_file_index_lookup (file_index->basenames, needle, found);
+	return found;
+}
+
+void
+pk_alpm_files_invalidate (PkBackend *self)
+{
+	PkBackendAlpmPrivate *priv = pk_backend_get_user_data (self);
+
+	if (priv->file_indexes != NULL)
+		g_hash_table_remove_all (priv->file_indexes);
+}
+
+void
+pk_alpm_files_destroy (PkBackend *self)
+{
+	PkBackendAlpmPrivate *priv = pk_backend_get_user_data (self);
+
+	g_clear_pointer (&priv->file_indexes, g_hash_table_unref);
+}
@@ -26,6 +26,7 @@
 #include <string.h>
 
 #include "pk-backend-alpm.h"
+#include "pk-alpm-files.h"
 #include "pk-alpm-groups.h"
 #include "pk-alpm-packages.h"
 
@@ -283,11 +284,31 @@ pk_alpm_search_is_application (alpm_pkg_t *pkg) {
 }
 
 static void
-pk_backend_search_db (PkBackendJob *job, alpm_db_t *db, MatchFunc match,
-		      const alpm_list_t *patterns, PkBitfield filters)
+pk_backend_search_emit (PkBackendJob *job, alpm_db_t *db, alpm_pkg_t *pkg,
+			PkBitfield filters)
 {
 	PkBackend *backend = pk_backend_job_get_backend (job);
 	PkBackendAlpmPrivate *priv = pk_backend_get_user_data (backend);
+
+	/* want applications */
+	if (pk_bitfield_contain (filters, PK_FILTER_ENUM_APPLICATION) && !pk_alpm_search_is_application (pkg))
+		return;
+
+	/* don't want applications */
+	if (pk_bitfield_contain (filters, PK_FILTER_ENUM_NOT_APPLICATION) && pk_alpm_search_is_application (pkg))
+		return;
+
+	if (db == priv->localdb) {
+		pk_alpm_pkg_emit (job, pkg, PK_INFO_ENUM_INSTALLED);
+	} else if (!pk_alpm_pkg_is_local (job, pkg)) {
+		pk_alpm_pkg_emit (job, pkg, PK_INFO_ENUM_AVAILABLE);
+	}
+}
+
+static void
+pk_backend_search_db (PkBackendJob *job, alpm_db_t *db, MatchFunc match,
+		      const alpm_list_t *patterns, PkBitfield filters)
+{
 	const alpm_list_t *i, *j;
 
 	g_return_if_fail (db != NULL);
@@ -307,19 +328,50 @@ pk_backend_search_db (PkBackendJob *job, alpm_db_t *db, MatchFunc match,
 		if (j != NULL)
 			continue;
 
-		/* want applications */
-		if (pk_bitfield_contain (filters, PK_FILTER_ENUM_APPLICATION) && !pk_alpm_search_is_application (i->data))
-			continue;
+		pk_backend_search_emit (job, db, i->data, filters);
+	}
+}
 
-		/* don't want applications */
-		if (pk_bitfield_contain (filters, PK_FILTER_ENUM_NOT_APPLICATION) && pk_alpm_search_is_application (i->data))
+static void
+pk_backend_search_db_files (PkBackendJob *job, alpm_db_t *db,
+			    const alpm_list_t *patterns, PkBitfield filters)
+{
+	PkBackend *backend = pk_backend_job_get_backend (job);
+	g_autoptr(GHashTable) matches = NULL;
+	const alpm_list_t *i;
+
+	g_return_if_fail (db != NULL);
+	g_return_if_fail (patterns != NULL);
+
+	/* find packages that own a file for all search terms */
+	for (i = patterns; i != NULL; i = i->next) {
+		GHashTable *found = pk_alpm_files_lookup (backend, db, i->data);
+		GHashTableIter iter;
+		gpointer pkg;
+
+		if (matches == NULL) {
+			matches = found;
 			continue;
+		}
 
-		if (db == priv->localdb) {
-			pk_alpm_pkg_emit (job, i->data, PK_INFO_ENUM_INSTALLED);
-		} else if (!pk_alpm_pkg_is_local (job, i->data)) {
-			pk_alpm_pkg_emit (job, i->data, PK_INFO_ENUM_AVAILABLE);
+		g_hash_table_iter_init (&iter, matches);
+		while (g_hash_table_iter_next (&iter, &pkg, NULL)) {
+			if (!g_hash_table_contains (found, pkg))
+				g_hash_table_iter_remove (&iter);
 		}
+		g_hash_table_unref (found);
+	}
+
+	/* emit in database order, like every other search */
+	for (i = alpm_db_get_pkgcache (db); i != NULL; i = i->next) {
+		if (g_hash_table_size (matches) == 0)
+			break;
+		if (pk_backend_job_is_cancelled (job))
+			break;
+		if (!g_hash_table_remove (matches, i->data))
+			continue;
+
+		pk_backend_search_emit (job, db, i->data, filters);
 	}
 }
 
@@ -341,6 +393,7 @@ pk_backend_search_thread (PkBackendJob *job, GVariant* params, gpointer p)
 
 	const alpm_list_t *i;
 	alpm_list_t *patterns = NULL;
+	alpm_list_t *syncdbs;
 	g_autoptr(GError) error = NULL;
 
 	g_return_if_fail (p == NULL);
@@ -407,18 +460,40 @@ pk_backend_search_thread (PkBackendJob *job, GVariant* params, gpointer p)
 		}
 	}
 
+	syncdbs = alpm_get_syncdbs (priv->alpm_check ? priv->alpm_check : priv->alpm);
+
+	/* look files up in the index rather than scanning every file list */
+	if (type == SEARCH_TYPE_FILES && patterns != NULL) {
+		alpm_list_t *dbs = NULL;
+
+		if (!skip_local)
+			dbs = alpm_list_add (dbs, priv->localdb);
+		if (!skip_remote)
+			dbs = alpm_list_join (dbs, alpm_list_copy (syncdbs));
+		pk_alpm_files_build (backend, dbs);
+		alpm_list_free (dbs);
+		match_func = NULL;
+	}
+
 	/* find installed packages first */
-	if (!skip_local)
-		pk_backend_search_db (job, priv->localdb, match_func, patterns, filters);
+	if (!skip_local) {
+		if (match_func == NULL)
+			pk_backend_search_db_files (job, priv->localdb, patterns, filters);
+		else
+			pk_backend_search_db (job, priv->localdb, match_func, patterns, filters);
+	}
 
 	if (skip_remote)
 		goto out;
 
-	for (i = alpm_get_syncdbs (priv->alpm_check ? priv->alpm_check : priv->alpm); i != NULL; i = i->next) {
+	for (i = syncdbs; i != NULL; i = i->next) {
 		if (pk_backend_job_is_cancelled (job))
 			break;
 
-		pk_backend_search_db (job, i->data, match_func, patterns, filters);
+		if (match_func == NULL)
+			pk_backend_search_db_files (job, i->data, patterns, filters);
+		else
+			pk_backend_search_db (job, i->data, match_func, patterns, filters);
 	}
 out:
 	if (pattern_free != NULL)
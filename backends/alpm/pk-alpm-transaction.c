@@ -23,6 +23,7 @@
 
 #include "pk-backend-alpm.h"
 #include "pk-alpm-error.h"
+#include "pk-alpm-files.h"
 #include "pk-alpm-packages.h"
 #include "pk-alpm-transaction.h"
 
@@ -1115,6 +1116,9 @@ pk_alpm_transaction_end (PkBackendJob *job, GError **error)
 	g_assert (pkalpm_current_job);
 	pkalpm_current_job = NULL;
 
+	/* the packages may have changed under the file index */
+	pk_alpm_files_invalidate (backend);
+
 	if (alpm_trans_release (priv->alpm) < 0) {
 		alpm_errno_t alpm_err = alpm_errno (priv->alpm);
 		g_set_error_literal (error, PK_ALPM_ERROR, alpm_err,
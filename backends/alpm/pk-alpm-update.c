@@ -35,6 +35,7 @@
 #include "pk-backend-alpm.h"
 #include "pk-alpm-config.h"
 #include "pk-alpm-error.h"
+#include "pk-alpm-files.h"
 #include "pk-alpm-packages.h"
 #include "pk-alpm-transaction.h"
 #include "pk-alpm-update.h"
@@ -259,6 +260,8 @@ pk_alpm_refresh_databases (PkBackendJob *job, gint force, alpm_list_t *dbs, GErr
 	if (!force)
 		return TRUE;
 
+	/* the file index points into the databases we are about to reload */
+	pk_alpm_files_invalidate (backend);
 	if (priv->alpm != priv->alpm_check) {
 		// We can now discard the check db as the main db is more up to date again
 		alpm_release(priv->alpm_check);
@@ -506,7 +509,10 @@ pk_backend_get_updates (PkBackend *self,
 static void
 pk_backend_refresh_cache_thread (PkBackendJob *job, GVariant* params, gpointer p)
 {
+	PkBackend *backend = pk_backend_job_get_backend (job);
+	PkBackendAlpmPrivate *priv = pk_backend_get_user_data (backend);
 	gint force;
+	alpm_list_t *dbs;
 	g_autoptr(GError) error = NULL;
 
 	g_assert (job != NULL);
@@ -514,7 +520,18 @@ pk_backend_refresh_cache_thread (PkBackendJob *job, GVariant* params, gpointer p
 	/* download databases even if they are older than current */
 	g_variant_get (params, "(b)", &force);
 
-	pk_alpm_update_databases (job, force, &error);
+	if (!pk_alpm_update_databases (job, force, &error)) {
+		pk_alpm_finish (job, error);
+		return;
+	}
+
+	/* build the file index now so SearchFiles does not have to */
+	pk_backend_job_set_status (job, PK_STATUS_ENUM_GENERATE_PACKAGE_LIST);
+	dbs = alpm_list_copy (alpm_get_syncdbs (priv->alpm));
+	dbs = alpm_list_add (dbs, priv->localdb);
+	pk_alpm_files_build (backend, dbs);
+	alpm_list_free (dbs);
+
 	pk_alpm_finish (job, error);
 }
 
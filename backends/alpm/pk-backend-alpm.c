@@ -32,6 +32,7 @@
 #include "pk-alpm-config.h"
 #include "pk-alpm-databases.h"
 #include "pk-alpm-error.h"
+#include "pk-alpm-files.h"
 #include "pk-alpm-groups.h"
 #include "pk-alpm-transaction.h"
 #include "pk-alpm-environment.h"
@@ -167,6 +168,7 @@ pk_backend_destroy (PkBackend *backend)
 	pk_alpm_groups_destroy (backend);
 	pk_alpm_destroy_databases (backend);
 	pk_alpm_destroy_monitor (backend);
+	pk_alpm_files_destroy (backend);
 
 	if (priv->alpm != NULL) {
 		if (alpm_trans_get_flags (priv->alpm) < 0)
@@ -33,6 +33,7 @@ typedef struct {
 	alpm_handle_t	*alpm_check;
 	GFileMonitor    *monitor;
 	alpm_list_t     *configured_repos; /* list of configured repos */
+	GHashTable	*file_indexes; /* alpm_db_t to file index */
 	gboolean	localdb_changed;
 } PkBackendAlpmPrivate;
 
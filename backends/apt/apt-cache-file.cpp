@@ -32,28 +32,38 @@
 
 using namespace APT;
 
+// Jobs may open caches from several threads at once, but (re)building
+// the binary caches on disk must only happen in one of them
+G_LOCK_DEFINE_STATIC(cache_build);
+
 AptCacheFile::AptCacheFile(PkBackendJob *job) :
-    m_packageRecords(0),
     m_job(job)
 {
+    g_mutex_init(&m_recordsLock);
 }
 
 AptCacheFile::~AptCacheFile()
 {
     Close();
+    g_mutex_clear(&m_recordsLock);
 }
 
 bool AptCacheFile::Open(bool withLock)
 {
+    G_LOCK(cache_build);
     OpPackageKitProgress progress(m_job);
-    return pkgCacheFile::Open(&progress, withLock);
+    bool ret = pkgCacheFile::Open(&progress, withLock);
+    G_UNLOCK(cache_build);
+    return ret;
 }
 
 void AptCacheFile::Close()
 {
-    delete m_packageRecords;
-
-    m_packageRecords = 0;
+    g_mutex_lock(&m_recordsLock);
+    for (const auto &entry : m_packageRecords)
+        delete entry.second;
+    m_packageRecords.clear();
+    g_mutex_unlock(&m_recordsLock);
 
     pkgCacheFile::Close();
 
@@ -64,8 +74,15 @@ void AptCacheFile::Close()
 
 bool AptCacheFile::BuildCaches(bool withLock)
 {
+    // nothing to do if the caches were built already
+    if (Cache != nullptr)
+        return true;
+
+    G_LOCK(cache_build);
     OpPackageKitProgress progress(m_job);
-    return pkgCacheFile::BuildCaches(&progress, withLock);
+    bool ret = pkgCacheFile::BuildCaches(&progress, withLock);
+    G_UNLOCK(cache_build);
+    return ret;
 }
 
 bool AptCacheFile::CheckDeps(bool AllowBroken)
@@ -251,14 +268,27 @@ void AptCacheFile::ShowBroken(bool Now, PkErrorEnum error)
                               toUtf8(out.str().c_str()));
 }
 
-void AptCacheFile::buildPkgRecords()
+pkgRecords* AptCacheFile::GetPkgRecords()
 {
-    if (m_packageRecords) {
-        return;
+    g_autoptr(GMutexLocker) locker = g_mutex_locker_new(&m_recordsLock);
+
+    pkgRecords *&records = m_packageRecords[g_thread_self()];
+    if (records == nullptr) {
+        // Create the text record parser
+        records = new pkgRecords(*this);
     }
+    return records;
+}
 
-    // Create the text record parser
-    m_packageRecords = new pkgRecords(*this);
+void AptCacheFile::releasePkgRecords()
+{
+    g_autoptr(GMutexLocker) locker = g_mutex_locker_new(&m_recordsLock);
+
+    auto it = m_packageRecords.find(g_thread_self());
+    if (it == m_packageRecords.end())
+        return;
+    delete it->second;
+    m_packageRecords.erase(it);
 }
 
 bool AptCacheFile::isGarbage(const pkgCache::PkgIterator &pkg)
@@ -391,6 +421,14 @@ PkgInfo AptCacheFile::resolvePkgID(const gchar *packageId)
 }
 
 gchar *AptCacheFile::buildPackageId(const pkgCache::VerIterator &ver)
+{
+    return pk_package_id_build(ver.ParentPkg().Name(),
+                               ver.VerStr(),
+                               ver.Arch(),
+                               buildPackageIdData(ver).c_str());
+}
+
+std::string AptCacheFile::buildPackageIdData(const pkgCache::VerIterator &ver)
 {
     pkgCache::VerFileIterator vf = ver.FileList();
     const pkgCache::PkgIterator &pkg = ver.ParentPkg();
@@ -412,10 +450,7 @@ gchar *AptCacheFile::buildPackageId(const pkgCache::VerIterator &ver)
     }
     data += utilBuildPackageOriginId(vf);
 
-    return pk_package_id_build(ver.ParentPkg().Name(),
-                               ver.VerStr(),
-                               ver.Arch(),
-                               data.c_str());
+    return data;
 }
 
 pkgCache::VerIterator AptCacheFile::findVer(const pkgCache::PkgIterator &pkg)
@@ -456,7 +491,7 @@ std::string AptCacheFile::getShortDescription(const pkgCache::VerIterator &ver)
     if (df.end()) {
         return string();
     } else {
-        return m_packageRecords->Lookup(df).ShortDesc();
+        return GetPkgRecords()->Lookup(df).ShortDesc();
     }
 }
 
@@ -475,7 +510,7 @@ std::string AptCacheFile::getLongDescription(const pkgCache::VerIterator &ver)
     if (df.end()) {
         return string();
     } else {
-        return m_packageRecords->Lookup(df).LongDesc();
+        return GetPkgRecords()->Lookup(df).LongDesc();
     }
 }
 
@@ -27,6 +27,8 @@
 #include <apt-pkg/progress.h>
 #include <pk-backend.h>
 
+#include <map>
+
 #include "pkg-list.h"
 
 class pkgProblemResolver;
@@ -71,7 +73,23 @@ public:
      */
     void ShowBroken(bool Now, PkErrorEnum error = PK_ERROR_ENUM_DEP_RESOLUTION_FAILED);
 
-    inline pkgRecords* GetPkgRecords() { buildPkgRecords(); return m_packageRecords; }
+    /**
+      * Returns the package records parser of the calling thread
+      * @note pkgRecords can not be used by several threads at once, so each
+      * job thread borrowing a shared cache gets its own instance
+      */
+    pkgRecords* GetPkgRecords();
+
+    /**
+      * Frees the package records of the calling thread
+      */
+    void releasePkgRecords();
+
+    /**
+      * Sets the job progress and errors of this cache are reported to,
+      * a cache shared between several jobs is detached once it is open
+      */
+    inline void setJob(PkBackendJob *job) { m_job = job; }
 
     /**
       * GetPolicy will build the policy object if needed and return it
@@ -114,6 +132,11 @@ public:
       */
     gchar* buildPackageId(const pkgCache::VerIterator &ver);
 
+    /**
+      * Build only the data part of the package id of the given version
+      */
+    std::string buildPackageIdData(const pkgCache::VerIterator &ver);
+
     /**
      * Tries to find the candidate version of a package
      * @returns pkgCache::VerIterator, if .end() is true the version could not be found
@@ -153,10 +176,10 @@ public:
                      const PkgInfo &pki);
 
 private:
-    void buildPkgRecords();
     static std::string debParser(std::string descr);
 
-    pkgRecords *m_packageRecords;
+    GMutex m_recordsLock;
+    std::map<GThread*, pkgRecords*> m_packageRecords;
     PkBackendJob *m_job;
 };
 
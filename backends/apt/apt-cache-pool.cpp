@@ -0,0 +1,250 @@
+/* apt-cache-pool.cpp - Backend-wide shared APT cache
+ *
+ * Copyright (c) 2026 The PackageKit Authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include "apt-cache-pool.h"
+
+#include <apt-pkg/configuration.h>
+#include <apt-pkg/error.h>
+
+#include "apt-cache-file.h"
+#include "apt-messages.h"
+
+static struct timespec fileMtime(const std::string &path)
+{
+    struct stat st;
+    struct timespec none = {0, 0};
+
+    if (path.empty() || stat(path.c_str(), &st) != 0)
+        return none;
+    return st.st_mtim;
+}
+
+static bool mtimeEqual(const struct timespec &a, const struct timespec &b)
+{
+    return a.tv_sec == b.tv_sec && a.tv_nsec == b.tv_nsec;
+}
+
+AptCachePool::AptCachePool() :
+    m_readers(0),
+    m_writersWaiting(0),
+    m_writer(false),
+    m_current({nullptr, 0}),
+    m_invalid(false),
+    m_statusMtime({0, 0}),
+    m_listsMtime({0, 0}),
+    m_pkgCacheMtime({0, 0})
+{
+    g_mutex_init(&m_mutex);
+    g_cond_init(&m_jobCond);
+}
+
+AptCachePool::~AptCachePool()
+{
+    if (m_current.users > 0)
+        g_warning("Destroying shared APT cache which is still in use");
+    delete m_current.cache;
+
+    for (const Entry &entry : m_retired)
+        delete entry.cache;
+
+    g_cond_clear(&m_jobCond);
+    g_mutex_clear(&m_mutex);
+}
+
+bool AptCachePool::canShare(PkBackendJob *job)
+{
+    switch (pk_backend_job_get_role(job)) {
+    case PK_ROLE_ENUM_DEPENDS_ON:
+    case PK_ROLE_ENUM_REQUIRED_BY:
+    case PK_ROLE_ENUM_GET_DETAILS:
+    case PK_ROLE_ENUM_GET_UPDATE_DETAIL:
+    case PK_ROLE_ENUM_GET_FILES:
+    case PK_ROLE_ENUM_GET_PACKAGES:
+    case PK_ROLE_ENUM_RESOLVE:
+    case PK_ROLE_ENUM_SEARCH_DETAILS:
+    case PK_ROLE_ENUM_SEARCH_FILE:
+    case PK_ROLE_ENUM_SEARCH_GROUP:
+    case PK_ROLE_ENUM_SEARCH_NAME:
+    case PK_ROLE_ENUM_WHAT_PROVIDES:
+        break;
+    default:
+        return false;
+    }
+
+    // The "downloaded" filter marks packages for installation to find
+    // their archives, which must never happen on the shared cache
+    GVariant *params = pk_backend_job_get_parameters(job);
+    if (params != nullptr && g_variant_n_children(params) > 0) {
+        g_autoptr(GVariant) filters = g_variant_get_child_value(params, 0);
+        if (g_variant_is_of_type(filters, G_VARIANT_TYPE_UINT64) &&
+                pk_bitfield_contain(g_variant_get_uint64(filters), PK_FILTER_ENUM_DOWNLOADED)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool AptCachePool::isReadOnly(PkRoleEnum role)
+{
+    switch (role) {
+    case PK_ROLE_ENUM_DEPENDS_ON:
+    case PK_ROLE_ENUM_REQUIRED_BY:
+    case PK_ROLE_ENUM_GET_DETAILS:
+    case PK_ROLE_ENUM_GET_DETAILS_LOCAL:
+    case PK_ROLE_ENUM_GET_FILES:
+    case PK_ROLE_ENUM_GET_FILES_LOCAL:
+    case PK_ROLE_ENUM_GET_PACKAGES:
+    case PK_ROLE_ENUM_GET_REPO_LIST:
+    case PK_ROLE_ENUM_GET_UPDATES:
+    case PK_ROLE_ENUM_RESOLVE:
+    case PK_ROLE_ENUM_SEARCH_DETAILS:
+    case PK_ROLE_ENUM_SEARCH_FILE:
+    case PK_ROLE_ENUM_SEARCH_GROUP:
+    case PK_ROLE_ENUM_SEARCH_NAME:
+    case PK_ROLE_ENUM_WHAT_PROVIDES:
+        return true;
+    default:
+        // GetUpdateDetail is not in the list as it needs the proxy
+        // environment of the job to download changelogs
+        return false;
+    }
+}
+
+void AptCachePool::beginJob(PkBackendJob *job, bool readOnly)
+{
+    g_autoptr(GMutexLocker) locker = g_mutex_locker_new(&m_mutex);
+
+    if (readOnly) {
+        // waiting writers take precedence, so they can not be starved
+        if (m_writer || m_writersWaiting > 0)
+            pk_backend_job_set_status(job, PK_STATUS_ENUM_WAITING_FOR_LOCK);
+        while (m_writer || m_writersWaiting > 0)
+            g_cond_wait(&m_jobCond, &m_mutex);
+        m_readers++;
+        return;
+    }
+
+    if (m_writer || m_readers > 0)
+        pk_backend_job_set_status(job, PK_STATUS_ENUM_WAITING_FOR_LOCK);
+    m_writersWaiting++;
+    while (m_writer || m_readers > 0)
+        g_cond_wait(&m_jobCond, &m_mutex);
+    m_writersWaiting--;
+    m_writer = true;
+}
+
+void AptCachePool::endJob(bool readOnly)
+{
+    g_autoptr(GMutexLocker) locker = g_mutex_locker_new(&m_mutex);
+
+    if (readOnly)
+        m_readers--;
+    else
+        m_writer = false;
+    g_cond_broadcast(&m_jobCond);
+}
+
+bool AptCachePool::isOutdated() const
+{
+    return !mtimeEqual(m_statusMtime, fileMtime(_config->FindFile("Dir::State::status"))) ||
+           !mtimeEqual(m_listsMtime, fileMtime(_config->FindDir("Dir::State::lists"))) ||
+           !mtimeEqual(m_pkgCacheMtime, fileMtime(_config->FindFile("Dir::Cache::pkgcache")));
+}
+
+void AptCachePool::updateStamps()
+{
+    m_statusMtime = fileMtime(_config->FindFile("Dir::State::status"));
+    m_listsMtime = fileMtime(_config->FindDir("Dir::State::lists"));
+    m_pkgCacheMtime = fileMtime(_config->FindFile("Dir::Cache::pkgcache"));
+}
+
+AptCacheFile *AptCachePool::acquire(PkBackendJob *job)
+{
+    g_autoptr(GMutexLocker) locker = g_mutex_locker_new(&m_mutex);
+
+    if (m_current.cache != nullptr && (m_invalid || isOutdated())) {
+        g_debug("Shared APT cache is outdated, reopening it");
+        if (m_current.users == 0)
+            delete m_current.cache;
+        else
+            m_retired.push_back(m_current);
+        m_current = {nullptr, 0};
+    }
+
+    if (m_current.cache == nullptr) {
+        // Take the stamps first, so changes made while we open the
+        // cache get noticed on the next acquire()
+        updateStamps();
+        m_invalid = false;
+
+        auto cache = new AptCacheFile(job);
+        if (!cache->Open(false)) {
+            show_errors(job, PK_ERROR_ENUM_CANNOT_GET_LOCK);
+            delete cache;
+            return nullptr;
+        }
+
+        // Check if there are half-installed packages and if we can fix them
+        if (!cache->CheckDeps(false)) {
+            delete cache;
+            return nullptr;
+        }
+
+        // Only the job opening the cache hears about its progress and
+        // errors, later borrowers never report through it
+        cache->setJob(nullptr);
+        m_current.cache = cache;
+    }
+
+    m_current.users++;
+    return m_current.cache;
+}
+
+void AptCachePool::release(AptCacheFile *cache)
+{
+    g_autoptr(GMutexLocker) locker = g_mutex_locker_new(&m_mutex);
+
+    if (cache == nullptr)
+        return;
+
+    if (cache == m_current.cache) {
+        m_current.users--;
+        return;
+    }
+
+    for (auto it = m_retired.begin(); it != m_retired.end(); ++it) {
+        if (it->cache != cache)
+            continue;
+        if (--it->users == 0) {
+            delete it->cache;
+            m_retired.erase(it);
+        }
+        return;
+    }
+
+    g_warning("Released an APT cache which is not owned by the pool");
+}
+
+void AptCachePool::invalidate()
+{
+    g_autoptr(GMutexLocker) locker = g_mutex_locker_new(&m_mutex);
+    m_invalid = true;
+}
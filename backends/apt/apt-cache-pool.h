@@ -0,0 +1,107 @@
+/* apt-cache-pool.h - Backend-wide shared APT cache
+ *
+ * Copyright (c) 2026 The PackageKit Authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#pragma once
+
+#include <glib.h>
+#include <sys/stat.h>
+
+#include <vector>
+
+#include <pk-backend.h>
+
+class AptCacheFile;
+
+/**
+ * Keeps one unlocked AptCacheFile open for the lifetime of the backend,
+ * so read-only jobs can borrow it instead of opening the package cache,
+ * policy and dependency cache over and over again.
+ *
+ * The cache is reference-counted: every acquire() must be balanced by a
+ * release(). Once invalidated (or once the dpkg status file or the
+ * package lists changed on disk) the next acquire() opens a fresh cache,
+ * while the old one is kept alive until its last borrower releases it.
+ */
+class AptCachePool
+{
+public:
+    AptCachePool();
+    ~AptCachePool();
+
+    /**
+     * Returns the shared read-only cache, opening it if needed.
+     * Errors are reported on @job.
+     * @returns nullptr if the cache could not be opened
+     */
+    AptCacheFile *acquire(PkBackendJob *job);
+
+    /**
+     * Drops a reference obtained with acquire()
+     */
+    void release(AptCacheFile *cache);
+
+    /**
+     * Marks the shared cache as outdated, can be called from any thread
+     */
+    void invalidate();
+
+    /**
+     * Returns true if jobs of this kind may use the shared cache, i.e.
+     * they never modify the dependency cache state
+     */
+    static bool canShare(PkBackendJob *job);
+
+    /**
+     * Returns true if jobs with this role only query the package
+     * database and can run in parallel to other read-only jobs
+     */
+    static bool isReadOnly(PkRoleEnum role);
+
+    /**
+     * Blocks until the job is allowed to run: read-only jobs run
+     * alongside each other, any other job runs on its own.
+     * Must be balanced with endJob().
+     */
+    void beginJob(PkBackendJob *job, bool readOnly);
+    void endJob(bool readOnly);
+
+private:
+    struct Entry {
+        AptCacheFile *cache;
+        guint users;
+    };
+
+    bool isOutdated() const;
+    void updateStamps();
+
+    GMutex m_mutex;
+    GCond m_jobCond;
+    guint m_readers;
+    guint m_writersWaiting;
+    bool m_writer;
+
+    Entry m_current;
+    std::vector<Entry> m_retired;
+    bool m_invalid;
+
+    struct timespec m_statusMtime;
+    struct timespec m_listsMtime;
+    struct timespec m_pkgCacheMtime;
+};
@@ -0,0 +1,441 @@
+/* apt-file-index.cpp - Index of the files installed by dpkg
+ *
+ * Copyright (c) 2026 The PackageKit Authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include "apt-file-index.h"
+
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <unordered_map>
+
+#include <apt-pkg/configuration.h>
+
+/*
+ * File layout, all integers in host byte order:
+ *
+ *   IndexHeader
+ *   IndexPackage[n_packages]     sorted by name
+ *   IndexFile[n_files]           the file list of each package, in dpkg order
+ *   guint32[n_files]             file numbers sorted by path
+ *   guint32[n_buckets + 1]       start of each bucket in the following array
+ *   guint32[n_files]             file numbers grouped by the hash of the file name
+ *   strings                      NUL-terminated package names and paths
+ */
+#define INDEX_MAGIC   "PKAPTFI"
+#define INDEX_VERSION 1
+
+struct IndexStamp {
+    gint64 sec;
+    gint64 nsec;
+    guint64 size;
+};
+
+struct IndexHeader {
+    char magic[8];
+    guint32 version;
+    guint32 n_packages;
+    guint32 n_files;
+    guint32 n_buckets;
+    IndexStamp status;
+    IndexStamp info_dir;
+    guint64 packages_offset;
+    guint64 files_offset;
+    guint64 sorted_offset;
+    guint64 buckets_offset;
+    guint64 hashed_offset;
+    guint64 strings_offset;
+    guint64 file_size;
+};
+
+struct IndexPackage {
+    guint32 name;
+    guint32 files_begin;
+    guint32 files_count;
+    guint32 reserved;
+    IndexStamp list;
+};
+
+struct IndexFile {
+    guint32 path;
+    guint32 package;
+};
+
+G_LOCK_DEFINE_STATIC(file_index);
+
+static IndexStamp fileStamp(const std::string &path)
+{
+    struct stat st;
+    IndexStamp stamp = {0, 0, 0};
+
+    if (stat(path.c_str(), &st) == 0) {
+        stamp.sec = st.st_mtim.tv_sec;
+        stamp.nsec = st.st_mtim.tv_nsec;
+        stamp.size = st.st_size;
+    }
+    return stamp;
+}
+
+static bool stampEqual(const IndexStamp &a, const IndexStamp &b)
+{
+    return a.sec == b.sec && a.nsec == b.nsec && a.size == b.size;
+}
+
+static guint32 basenameHash(const gchar *path, gsize len)
+{
+    guint32 hash = 2166136261U;
+    for (gsize i = 0; i < len; i++) {
+        hash ^= (guchar) path[i];
+        hash *= 16777619U;
+    }
+    return hash;
+}
+
+static const gchar *basenameOf(const gchar *path)
+{
+    const gchar *slash = strrchr(path, '/');
+    return slash == nullptr ? path : slash + 1;
+}
+
+AptFileIndex::AptFileIndex() :
+    m_file(nullptr),
+    m_data(nullptr),
+    m_size(0)
+{
+}
+
+AptFileIndex::~AptFileIndex()
+{
+    unmap();
+}
+
+std::string AptFileIndex::defaultPath()
+{
+    return _config->FindDir("Dir::Cache") + "packagekit-files.idx";
+}
+
+void AptFileIndex::unmap()
+{
+    if (m_file != nullptr)
+        g_mapped_file_unref(m_file);
+    m_file = nullptr;
+    m_data = nullptr;
+    m_size = 0;
+}
+
+bool AptFileIndex::map(const std::string &path)
+{
+    unmap();
+
+    GMappedFile *file = g_mapped_file_new(path.c_str(), FALSE, nullptr);
+    if (file == nullptr)
+        return false;
+
+    const gchar *data = g_mapped_file_get_contents(file);
+    const gsize size = g_mapped_file_get_length(file);
+    const IndexHeader *header = reinterpret_cast<const IndexHeader *>(data);
+    if (size < sizeof(IndexHeader) ||
+            memcmp(header->magic, INDEX_MAGIC, sizeof(INDEX_MAGIC)) != 0 ||
+            header->version != INDEX_VERSION ||
+            header->file_size != size ||
+            header->n_buckets == 0 ||
+            header->packages_offset + (guint64) header->n_packages * sizeof(IndexPackage) > header->files_offset ||
+            header->files_offset + (guint64) header->n_files * sizeof(IndexFile) > header->sorted_offset ||
+            header->sorted_offset + (guint64) header->n_files * sizeof(guint32) > header->buckets_offset ||
+            header->buckets_offset + ((guint64) header->n_buckets + 1) * sizeof(guint32) > header->hashed_offset ||
+            header->hashed_offset + (guint64) header->n_files * sizeof(guint32) > header->strings_offset ||
+            header->strings_offset > size ||
+            (size > header->strings_offset && data[size - 1] != '\0')) {
+        g_debug("Ignoring damaged file index %s", path.c_str());
+        g_mapped_file_unref(file);
+        return false;
+    }
+
+    m_file = file;
+    m_data = data;
+    m_size = size;
+    return true;
+}
+
+bool AptFileIndex::isCurrent(const std::string &dpkgDir) const
+{
+    const IndexHeader *header = reinterpret_cast<const IndexHeader *>(m_data);
+
+    // dpkg writes the status file after changing any file list
+    return stampEqual(header->status, fileStamp(dpkgDir + "status")) &&
+           stampEqual(header->info_dir, fileStamp(dpkgDir + "info"));
+}
+
+bool AptFileIndex::update(const std::string &path, const std::string &dpkgDir) const
+{
+    const std::string infoDir = dpkgDir + "info/";
+    struct Package {
+        std::string name;
+        IndexStamp stamp;
+        std::vector<guint32> paths;
+    };
+
+    IndexHeader header;
+    memset(&header, 0, sizeof(header));
+    // Take the stamps first, so changes made while we read the file
+    // lists get noticed next time
+    header.status = fileStamp(dpkgDir + "status");
+    header.info_dir = fileStamp(dpkgDir + "info");
+
+    DIR *dp = opendir(infoDir.c_str());
+    if (dp == nullptr) {
+        g_debug("Error opening %s", infoDir.c_str());
+        return false;
+    }
+
+    // file lists we know already, the index still mapped is the old one
+    std::unordered_map<std::string, const IndexPackage *> known;
+    const IndexHeader *oldHeader = reinterpret_cast<const IndexHeader *>(m_data);
+    if (m_data != nullptr) {
+        const IndexPackage *packages =
+            reinterpret_cast<const IndexPackage *>(m_data + oldHeader->packages_offset);
+        for (guint32 i = 0; i < oldHeader->n_packages; i++)
+            known.emplace(m_data + oldHeader->strings_offset + packages[i].name, &packages[i]);
+    }
+
+    std::string strings;
+    std::unordered_map<std::string, guint32> stringOffsets;
+    auto intern = [&strings, &stringOffsets](const std::string &s) -> guint32 {
+        auto it = stringOffsets.find(s);
+        if (it != stringOffsets.end())
+            return it->second;
+        const guint32 offset = strings.size();
+        strings.append(s);
+        strings.push_back('\0');
+        stringOffsets.emplace(s, offset);
+        return offset;
+    };
+
+    std::vector<Package> packages;
+    guint reread = 0;
+    struct dirent *dirp;
+    std::string line;
+    while ((dirp = readdir(dp)) != nullptr) {
+        const size_t len = strlen(dirp->d_name);
+        if (len <= 5 || strcmp(dirp->d_name + len - 5, ".list") != 0)
+            continue;
+
+        Package package;
+        package.name = std::string(dirp->d_name, len - 5);
+        package.stamp = fileStamp(infoDir + dirp->d_name);
+
+        auto it = known.find(package.name);
+        if (it != known.end() && stampEqual(it->second->list, package.stamp)) {
+            const IndexFile *files =
+                reinterpret_cast<const IndexFile *>(m_data + oldHeader->files_offset);
+            for (guint32 i = 0; i < it->second->files_count; i++) {
+                const IndexFile &file = files[it->second->files_begin + i];
+                package.paths.push_back(intern(m_data + oldHeader->strings_offset + file.path));
+            }
+        } else {
+            std::ifstream in(infoDir + dirp->d_name);
+            if (!in)
+                continue;
+            while (std::getline(in, line)) {
+                if (!line.empty())
+                    package.paths.push_back(intern(line));
+            }
+            reread++;
+        }
+
+        packages.push_back(std::move(package));
+    }
+    closedir(dp);
+
+    std::sort(packages.begin(), packages.end(), [](const Package &a, const Package &b) {
+        return a.name < b.name;
+    });
+
+    std::vector<IndexPackage> packageTable;
+    std::vector<IndexFile> fileTable;
+    packageTable.reserve(packages.size());
+    for (const Package &package : packages) {
+        IndexPackage entry = {};
+        entry.name = intern(package.name);
+        entry.files_begin = fileTable.size();
+        entry.files_count = package.paths.size();
+        entry.list = package.stamp;
+        for (guint32 pathOffset : package.paths)
+            fileTable.push_back({pathOffset, (guint32) packageTable.size()});
+        packageTable.push_back(entry);
+    }
+
+    const guint32 nFiles = fileTable.size();
+    std::vector<guint32> sorted(nFiles);
+    for (guint32 i = 0; i < nFiles; i++)
+        sorted[i] = i;
+    std::sort(sorted.begin(), sorted.end(), [&](guint32 a, guint32 b) {
+        return strcmp(strings.c_str() + fileTable[a].path, strings.c_str() + fileTable[b].path) < 0;
+    });
+
+    const guint32 nBuckets = MAX(nFiles / 2, 1);
+    std::vector<guint32> bucketOf(nFiles);
+    std::vector<guint32> buckets(nBuckets + 1, 0);
+    for (guint32 i = 0; i < nFiles; i++) {
+        const gchar *name = basenameOf(strings.c_str() + fileTable[i].path);
+        bucketOf[i] = basenameHash(name, strlen(name)) % nBuckets;
+        buckets[bucketOf[i] + 1]++;
+    }
+    for (guint32 i = 0; i < nBuckets; i++)
+        buckets[i + 1] += buckets[i];
+    std::vector<guint32> hashed(nFiles);
+    std::vector<guint32> fill(buckets.begin(), buckets.end() - 1);
+    for (guint32 i = 0; i < nFiles; i++)
+        hashed[fill[bucketOf[i]]++] = i;
+
+    memcpy(header.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC));
+    header.version = INDEX_VERSION;
+    header.n_packages = packageTable.size();
+    header.n_files = nFiles;
+    header.n_buckets = nBuckets;
+    header.packages_offset = sizeof(IndexHeader);
+    header.files_offset = header.packages_offset + packageTable.size() * sizeof(IndexPackage);
+    header.sorted_offset = header.files_offset + fileTable.size() * sizeof(IndexFile);
+    header.buckets_offset = header.sorted_offset + sorted.size() * sizeof(guint32);
+    header.hashed_offset = header.buckets_offset + buckets.size() * sizeof(guint32);
+    header.strings_offset = header.hashed_offset + hashed.size() * sizeof(guint32);
+    header.file_size = header.strings_offset + strings.size();
+
+    std::string data;
+    data.reserve(header.file_size);
+    data.append(reinterpret_cast<const char *>(&header), sizeof(header));
+    data.append(reinterpret_cast<const char *>(packageTable.data()), packageTable.size() * sizeof(IndexPackage));
+    data.append(reinterpret_cast<const char *>(fileTable.data()), fileTable.size() * sizeof(IndexFile));
+    data.append(reinterpret_cast<const char *>(sorted.data()), sorted.size() * sizeof(guint32));
+    data.append(reinterpret_cast<const char *>(buckets.data()), buckets.size() * sizeof(guint32));
+    data.append(reinterpret_cast<const char *>(hashed.data()), hashed.size() * sizeof(guint32));
+    data.append(strings);
+
+    g_autoptr(GError) error = nullptr;
+    if (!g_file_set_contents(path.c_str(), data.data(), data.size(), &error)) {
+        g_warning("Failed to write file index %s: %s", path.c_str(), error->message);
+        return false;
+    }
+
+    g_debug("Updated file index %s: %u packages, %u file lists read",
+            path.c_str(), header.n_packages, reread);
+    return true;
+}
+
+bool AptFileIndex::open(const std::string &path, const std::string &dpkgDir)
+{
+    std::string dir = dpkgDir;
+    if (!dir.empty() && dir.back() != '/')
+        dir.push_back('/');
+
+    G_LOCK(file_index);
+    bool ret = map(path) && isCurrent(dir);
+    if (!ret)
+        ret = update(path, dir) && map(path);
+    G_UNLOCK(file_index);
+
+    if (!ret)
+        unmap();
+    return ret;
+}
+
+bool AptFileIndex::isOpen() const
+{
+    return m_file != nullptr;
+}
+
+std::vector<std::string> AptFileIndex::searchFile(const std::string &value) const
+{
+    std::vector<std::string> result;
+    if (m_file == nullptr || value.empty())
+        return result;
+
+    const IndexHeader *header = reinterpret_cast<const IndexHeader *>(m_data);
+    const IndexPackage *packages = reinterpret_cast<const IndexPackage *>(m_data + header->packages_offset);
+    const IndexFile *files = reinterpret_cast<const IndexFile *>(m_data + header->files_offset);
+    const gchar *strings = m_data + header->strings_offset;
+    std::vector<guint32> owners;
+
+    if (value[0] == '/') {
+        const guint32 *sorted = reinterpret_cast<const guint32 *>(m_data + header->sorted_offset);
+        const guint32 *end = sorted + header->n_files;
+        auto fileLess = [&](guint32 file, const gchar *path) {
+            return strcmp(strings + files[file].path, path) < 0;
+        };
+        auto pathLess = [&](const gchar *path, guint32 file) {
+            return strcmp(path, strings + files[file].path) < 0;
+        };
+        const guint32 *first = std::lower_bound(sorted, end, value.c_str(), fileLess);
+        const guint32 *last = std::upper_bound(first, end, value.c_str(), pathLess);
+        for (const guint32 *it = first; it != last; ++it)
+            owners.push_back(files[*it].package);
+    } else {
+        const gchar *name = basenameOf(value.c_str());
+        const guint32 bucket = basenameHash(name, strlen(name)) % header->n_buckets;
+        const guint32 *buckets = reinterpret_cast<const guint32 *>(m_data + header->buckets_offset);
+        const guint32 *hashed = reinterpret_cast<const guint32 *>(m_data + header->hashed_offset);
+
+        for (guint32 i = buckets[bucket]; i < buckets[bucket + 1] && i < header->n_files; i++) {
+            const gchar *path = strings + files[hashed[i]].path;
+            const size_t len = strlen(path);
+
+            // match whole trailing path components only
+            if (len < value.size() ||
+                    memcmp(path + len - value.size(), value.c_str(), value.size()) != 0 ||
+                    (len > value.size() && path[len - value.size() - 1] != '/'))
+                continue;
+            owners.push_back(files[hashed[i]].package);
+        }
+    }
+
+    std::sort(owners.begin(), owners.end());
+    owners.erase(std::unique(owners.begin(), owners.end()), owners.end());
+    for (guint32 owner : owners) {
+        if (owner < header->n_packages)
+            result.push_back(strings + packages[owner].name);
+    }
+
+    return result;
+}
+
+bool AptFileIndex::packageFiles(const std::string &package, std::vector<const gchar *> &files) const
+{
+    if (m_file == nullptr)
+        return false;
+
+    const IndexHeader *header = reinterpret_cast<const IndexHeader *>(m_data);
+    const IndexPackage *packages = reinterpret_cast<const IndexPackage *>(m_data + header->packages_offset);
+    const IndexFile *fileTable = reinterpret_cast<const IndexFile *>(m_data + header->files_offset);
+    const gchar *strings = m_data + header->strings_offset;
+
+    const IndexPackage *end = packages + header->n_packages;
+    const IndexPackage *it = std::lower_bound(packages, end, package,
+                                              [strings](const IndexPackage &p, const std::string &name) {
+                                                  return name.compare(strings + p.name) > 0;
+                                              });
+    if (it == end || package.compare(strings + it->name) != 0)
+        return false;
+
+    for (guint32 i = 0; i < it->files_count && it->files_begin + i < header->n_files; i++)
+        files.push_back(strings + fileTable[it->files_begin + i].path);
+    return true;
+}
@@ -0,0 +1,81 @@
+/* apt-file-index.h - Index of the files installed by dpkg
+ *
+ * Copyright (c) 2026 The PackageKit Authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#pragma once
+
+#include <glib.h>
+
+#include <string>
+#include <vector>
+
+/**
+ * An on-disk copy of all dpkg file lists (<dpkg dir>/info/*.list), with a
+ * table of all paths sorted for binary search and a hash table keyed by
+ * the file name, so looking up the owner of a file doesn't need to read
+ * every file list.
+ *
+ * The index remembers the modification time of the dpkg status file and
+ * of every file list. When dpkg changed anything only the file lists that
+ * changed are read again.
+ */
+class AptFileIndex
+{
+public:
+    AptFileIndex();
+    ~AptFileIndex();
+
+    /**
+     * The location of the index if none is set explicitly
+     */
+    static std::string defaultPath();
+
+    /**
+     * Brings the index at @path up to date with the dpkg database in
+     * @dpkgDir (usually /var/lib/dpkg/) and maps it
+     */
+    bool open(const std::string &path, const std::string &dpkgDir);
+
+    bool isOpen() const;
+
+    /**
+     * Finds the packages owning @value: an absolute path must match
+     * exactly, anything else matches the trailing path components.
+     * @returns the names used by dpkg for the file lists, i.e.
+     *          "name:arch" for Multi-Arch: same packages
+     */
+    std::vector<std::string> searchFile(const std::string &value) const;
+
+    /**
+     * Looks up the files of the package with the dpkg name @package
+     * The strings point into the index and live as long as it is open.
+     * @returns false if no file list is known for @package
+     */
+    bool packageFiles(const std::string &package, std::vector<const gchar *> &files) const;
+
+private:
+    bool map(const std::string &path);
+    void unmap();
+    bool isCurrent(const std::string &dpkgDir) const;
+    bool update(const std::string &path, const std::string &dpkgDir) const;
+
+    GMappedFile *m_file;
+    const gchar *m_data;
+    gsize m_size;
+};
@@ -0,0 +1,225 @@
+/* apt-gst-index.cpp - Index of the GStreamer capabilities of packages
+ *
+ * Copyright (c) 2026 The PackageKit Authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include "apt-gst-index.h"
+
+#include <cstring>
+#include <vector>
+
+#include <apt-pkg/configuration.h>
+#include <apt-pkg/depcache.h>
+#include <apt-pkg/pkgrecords.h>
+
+#include "apt-search-index.h"
+#include "apt-utils.h"
+
+/*
+ * File layout, all integers in host byte order:
+ *
+ *   IndexHeader
+ *   IndexEntry[n_entries]        packages with GStreamer metadata
+ *   strings                      the Gstreamer-* fields of each package
+ */
+#define INDEX_MAGIC   "PKAPTGI"
+#define INDEX_VERSION 1
+
+struct IndexHeader {
+    char magic[8];
+    guint32 version;
+    guint32 n_entries;
+    guint64 generation;
+    guint64 entries_offset;
+    guint64 strings_offset;
+    guint64 file_size;
+};
+
+struct IndexEntry {
+    guint32 package;
+    guint32 record;
+    guint32 record_len;
+    guint32 reserved;
+};
+
+AptGstIndex::AptGstIndex() :
+    m_file(nullptr),
+    m_data(nullptr),
+    m_size(0)
+{
+}
+
+AptGstIndex::~AptGstIndex()
+{
+    if (m_file != nullptr)
+        g_mapped_file_unref(m_file);
+}
+
+std::string AptGstIndex::defaultPath()
+{
+    return _config->FindDir("Dir::Cache") + "packagekit-gstreamer.idx";
+}
+
+bool AptGstIndex::build(pkgCacheFile &cache, const std::string &path)
+{
+    pkgCache *pkgs = cache.GetPkgCache();
+    pkgDepCache *depCache = cache.GetDepCache();
+    if (pkgs == nullptr || depCache == nullptr)
+        return false;
+
+    // own records parser, the one of the cache belongs to the calling job
+    pkgRecords records(*pkgs);
+
+    std::vector<IndexEntry> entries;
+    std::string strings;
+    static const char fieldPrefix[] = "\nGstreamer-";
+
+    for (pkgCache::PkgIterator pkg = pkgs->PkgBegin(); !pkg.end(); ++pkg) {
+        // Ignore packages that exist only due to dependencies.
+        if (pkg.VersionList().end() && pkg.ProvidesList().end())
+            continue;
+
+        // Ignore debug packages - these aren't interesting as codec providers,
+        // but they do have apt GStreamer-* metadata.
+        if (ends_with(pkg.Name(), "-dbg") || ends_with(pkg.Name(), "-dbgsym"))
+            continue;
+
+        // same version AptCacheFile::findVer() picks
+        pkgCache::VerIterator ver = pkg.CurrentVer();
+        if (ver.end())
+            ver = (*depCache)[pkg].CandidateVerIter(*depCache);
+        if (ver.end())
+            ver = pkg.VersionList();
+        if (ver.end() || ver.FileList().end())
+            continue;
+
+        const char *start, *stop;
+        records.Lookup(ver.FileList()).GetRec(start, stop);
+        const char *field = static_cast<const char *>(
+            memmem(start, stop - start, fieldPrefix, strlen(fieldPrefix)));
+        if (field == nullptr)
+            continue;
+
+        // keep a leading newline, GstMatcher looks for "\nGstreamer-Version: "
+        IndexEntry entry = {};
+        entry.package = pkg.operator->() - pkgs->PkgP;
+        entry.record = strings.size();
+        while (field != nullptr) {
+            const char *end = static_cast<const char *>(memchr(field + 1, '\n', stop - field - 1));
+            if (end == nullptr)
+                end = stop;
+            strings.append(field, end - field);
+            field = static_cast<const char *>(
+                memmem(end, stop - end, fieldPrefix, strlen(fieldPrefix)));
+        }
+        strings.push_back('\n');
+        entry.record_len = strings.size() - entry.record;
+        entries.push_back(entry);
+    }
+
+    IndexHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC));
+    header.version = INDEX_VERSION;
+    header.n_entries = entries.size();
+    header.generation = AptSearchIndex::cacheGeneration(pkgs);
+    header.entries_offset = sizeof(IndexHeader);
+    header.strings_offset = header.entries_offset + entries.size() * sizeof(IndexEntry);
+    header.file_size = header.strings_offset + strings.size();
+
+    std::string data;
+    data.reserve(header.file_size);
+    data.append(reinterpret_cast<const char *>(&header), sizeof(header));
+    data.append(reinterpret_cast<const char *>(entries.data()), entries.size() * sizeof(IndexEntry));
+    data.append(strings);
+
+    g_autoptr(GError) error = nullptr;
+    if (!g_file_set_contents(path.c_str(), data.data(), data.size(), &error)) {
+        g_warning("Failed to write GStreamer index %s: %s", path.c_str(), error->message);
+        return false;
+    }
+
+    g_debug("Wrote GStreamer index for %u packages to %s", header.n_entries, path.c_str());
+    return true;
+}
+
+bool AptGstIndex::open(pkgCacheFile &cache, const std::string &path)
+{
+    if (m_file != nullptr) {
+        g_mapped_file_unref(m_file);
+        m_file = nullptr;
+        m_data = nullptr;
+        m_size = 0;
+    }
+
+    pkgCache *pkgs = cache.GetPkgCache();
+    if (pkgs == nullptr)
+        return false;
+
+    GMappedFile *file = g_mapped_file_new(path.c_str(), FALSE, nullptr);
+    if (file == nullptr)
+        return false;
+
+    const gchar *data = g_mapped_file_get_contents(file);
+    const gsize size = g_mapped_file_get_length(file);
+    const IndexHeader *header = reinterpret_cast<const IndexHeader *>(data);
+    if (size < sizeof(IndexHeader) ||
+            memcmp(header->magic, INDEX_MAGIC, sizeof(INDEX_MAGIC)) != 0 ||
+            header->version != INDEX_VERSION ||
+            header->file_size != size ||
+            header->entries_offset + (guint64) header->n_entries * sizeof(IndexEntry) > header->strings_offset ||
+            header->strings_offset > size) {
+        g_debug("Ignoring damaged GStreamer index %s", path.c_str());
+        g_mapped_file_unref(file);
+        return false;
+    }
+
+    if (header->generation != AptSearchIndex::cacheGeneration(pkgs)) {
+        g_debug("GStreamer index %s is outdated", path.c_str());
+        g_mapped_file_unref(file);
+        return false;
+    }
+
+    m_file = file;
+    m_data = data;
+    m_size = size;
+    return true;
+}
+
+guint32 AptGstIndex::size() const
+{
+    if (m_file == nullptr)
+        return 0;
+    return reinterpret_cast<const IndexHeader *>(m_data)->n_entries;
+}
+
+guint32 AptGstIndex::package(guint32 i) const
+{
+    const IndexHeader *header = reinterpret_cast<const IndexHeader *>(m_data);
+    return reinterpret_cast<const IndexEntry *>(m_data + header->entries_offset)[i].package;
+}
+
+std::string AptGstIndex::record(guint32 i) const
+{
+    const IndexHeader *header = reinterpret_cast<const IndexHeader *>(m_data);
+    const IndexEntry &entry = reinterpret_cast<const IndexEntry *>(m_data + header->entries_offset)[i];
+
+    if (header->strings_offset + entry.record + entry.record_len > m_size)
+        return std::string();
+    return std::string(m_data + header->strings_offset + entry.record, entry.record_len);
+}
@@ -0,0 +1,80 @@
+/* apt-gst-index.h - Index of the GStreamer capabilities of packages
+ *
+ * Copyright (c) 2026 The PackageKit Authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#pragma once
+
+#include <glib.h>
+
+#include <string>
+
+#include <apt-pkg/cachefile.h>
+
+/**
+ * An on-disk list of the few packages which carry GStreamer metadata,
+ * holding only their Gstreamer-* fields (version, elements, encoders,
+ * decoders, URI sources and sinks).
+ *
+ * Codec requests are matched against these instead of reading the record
+ * of every package. Like AptSearchIndex the index belongs to one cache
+ * generation and is ignored once the package lists changed.
+ */
+class AptGstIndex
+{
+public:
+    AptGstIndex();
+    ~AptGstIndex();
+
+    /**
+     * The location of the index if none is set explicitly
+     */
+    static std::string defaultPath();
+
+    /**
+     * Builds the index for @cache and atomically replaces the file at @path
+     */
+    static bool build(pkgCacheFile &cache, const std::string &path);
+
+    /**
+     * Maps the index at @path
+     * @returns false if it is missing, damaged or was built for a different cache
+     */
+    bool open(pkgCacheFile &cache, const std::string &path);
+
+    /**
+     * The number of packages with GStreamer metadata
+     */
+    guint32 size() const;
+
+    /**
+     * The position of the @i-th package in pkgCache::PkgP
+     */
+    guint32 package(guint32 i) const;
+
+    /**
+     * The Gstreamer-* fields of the @i-th package in control file
+     * format, as understood by GstMatcher::matches()
+     */
+    std::string record(guint32 i) const;
+
+private:
+    GMappedFile *m_file;
+    const gchar *m_data;
+    gsize m_size;
+};
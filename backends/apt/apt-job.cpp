@@ -24,6 +24,7 @@
 
 #include "apt-job.h"
 
+#include <apt-pkg/acquire-item.h>
 #include <apt-pkg/aptconfiguration.h>
 #include <apt-pkg/init.h>
 #include <apt-pkg/error.h>
@@ -44,18 +45,25 @@
 #include <sys/fcntl.h>
 #include <pty.h>
 
+#include <locale.h>
 #include <iostream>
 #include <sstream>
 #include <memory>
 #include <fstream>
+#include <unordered_set>
 #include <dirent.h>
 
 #include "apt-cache-file.h"
+#include "apt-cache-pool.h"
+#include "apt-file-index.h"
+#include "apt-gst-index.h"
+#include "apt-search-index.h"
 #include "apt-utils.h"
 #include "gst-matcher.h"
 #include "apt-messages.h"
 #include "acqpkitstatus.h"
 #include "deb-file.h"
+#include "pk-backend-apt.h"
 
 using namespace APT;
 
@@ -63,38 +71,29 @@ using namespace APT;
 
 AptJob::AptJob(PkBackendJob *job) :
     m_cache(nullptr),
+    m_cachePool(nullptr),
+    m_sharedCache(false),
     m_job(job),
     m_cancel(false),
     m_lastSubProgress(0),
-    m_terminalTimeout(120)
+    m_terminalTimeout(120),
+    m_threadLocale((locale_t) 0)
 {
-    const gchar *http_proxy;
-    const gchar *ftp_proxy;
-
-    // set locale
-    setEnvLocaleFromJob();
-
-    // set http proxy
-    http_proxy = pk_backend_job_get_proxy_http(m_job);
-    if (http_proxy != NULL) {
-        g_autofree gchar *uri = pk_backend_convert_uri(http_proxy);
-        g_setenv("http_proxy", uri, TRUE);
-    }
-
-    // set ftp proxy
-    ftp_proxy = pk_backend_job_get_proxy_ftp(m_job);
-    if (ftp_proxy != NULL) {
-        g_autofree gchar *uri = pk_backend_convert_uri(ftp_proxy);
-        g_setenv("ftp_proxy", uri, TRUE);
+    // the backend-wide cache read-only jobs can borrow
+    PkBackend *backend = PK_BACKEND(pk_backend_job_get_backend(m_job));
+    if (backend != NULL) {
+        auto priv = static_cast<PkBackendAptPrivate*>(pk_backend_get_user_data(backend));
+        if (priv != NULL)
+            m_cachePool = priv->cachePool;
     }
-
-    // default settings
-    _config->CndSet("APT::Get::AutomaticRemove::Kernels", _config->FindB("APT::Get::AutomaticRemove", true));
 }
 
 AptJob::~AptJob()
 {
-    delete m_cache;
+    if (m_sharedCache)
+        m_cachePool->release(m_cache);
+    else
+        delete m_cache;
 }
 
 bool AptJob::init(gchar **localDebs)
@@ -119,6 +118,16 @@ bool AptJob::init(gchar **localDebs)
         withLock = false;
     }
 
+    // Read-only jobs borrow the shared cache instead of opening their own
+    if (localDebs == nullptr && m_cachePool != nullptr && AptCachePool::canShare(m_job)) {
+        m_cache = m_cachePool->acquire(m_job);
+        if (m_cache == nullptr)
+            return false;
+        m_sharedCache = true;
+        m_interactive = pk_backend_job_get_interactive(m_job);
+        return true;
+    }
+
     bool simulate = false;
     if (withLock) {
         // Get the simulate value to see if the lock is valid
@@ -164,7 +173,52 @@ bool AptJob::init(gchar **localDebs)
     }
 
     m_interactive = pk_backend_job_get_interactive(m_job);
-    if (!m_interactive) {
+
+    // Check if there are half-installed packages and if we can fix them
+    return m_cache->CheckDeps(AllowBroken);
+}
+
+void AptJob::enterThread(bool readOnly)
+{
+    // APT keeps one error stack per thread, make sure we do not inherit
+    // leftovers from a previous job
+    _error->Discard();
+
+    if (readOnly) {
+        // Read-only jobs run in parallel, so they must not touch the process
+        // environment and only switch the locale of their own thread
+        const gchar *locale = pk_backend_job_get_locale(m_job);
+        if (locale != NULL) {
+            m_threadLocale = newlocale(LC_ALL_MASK, locale, (locale_t) 0);
+            if (m_threadLocale != (locale_t) 0)
+                uselocale(m_threadLocale);
+        }
+        return;
+    }
+
+    const gchar *http_proxy;
+    const gchar *ftp_proxy;
+
+    // set locale
+    setEnvLocaleFromJob();
+
+    // set http proxy
+    http_proxy = pk_backend_job_get_proxy_http(m_job);
+    if (http_proxy != NULL) {
+        g_autofree gchar *uri = pk_backend_convert_uri(http_proxy);
+        g_setenv("http_proxy", uri, TRUE);
+    }
+
+    // set ftp proxy
+    ftp_proxy = pk_backend_job_get_proxy_ftp(m_job);
+    if (ftp_proxy != NULL) {
+        g_autofree gchar *uri = pk_backend_convert_uri(ftp_proxy);
+        g_setenv("ftp_proxy", uri, TRUE);
+    }
+
+    // This job runs alone, so it may change the global APT configuration
+    // and the environment dpkg inherits
+    if (!pk_backend_job_get_interactive(m_job)) {
         // Do not ask about config updates if we are not interactive
         if (!dpkgHasForceConfFileSet()) {
             _config->Set("Dpkg::Options::", "--force-confdef");
@@ -177,9 +231,19 @@ bool AptJob::init(gchar **localDebs)
         g_setenv("APT_LISTCHANGES_FRONTEND", "none", TRUE);
         g_setenv("APT_LISTBUGS_FRONTEND", "none", TRUE);
     }
+}
 
-    // Check if there are half-installed packages and if we can fix them
-    return m_cache->CheckDeps(AllowBroken);
+void AptJob::leaveThread()
+{
+    // the record parsers belong to this thread
+    if (m_cache != nullptr)
+        m_cache->releasePkgRecords();
+
+    if (m_threadLocale != (locale_t) 0) {
+        uselocale(LC_GLOBAL_LOCALE);
+        freelocale(m_threadLocale);
+        m_threadLocale = (locale_t) 0;
+    }
 }
 
 void AptJob::setEnvLocaleFromJob()
@@ -467,12 +531,17 @@ void AptJob::emitPackageProgress(const pkgCache::VerIterator &ver, PkStatusEnum
 void AptJob::stagePackageForEmit(GPtrArray *array, const pkgCache::VerIterator &ver, PkInfoEnum state, PkInfoEnum updateSeverity) const
 {
     g_autoptr(PkPackage) pk_package = pk_package_new ();
-    g_autofree gchar *package_id = m_cache->buildPackageId(ver);
     g_autoptr(GError) local_error = NULL;
 
-    if (!pk_package_set_id (pk_package, package_id, &local_error)) {
-        g_warning ("package_id %s invalid and cannot be processed: %s",
-               package_id, local_error->message);
+    // set the sections directly, no need to join and split the id again
+    if (!pk_package_set_id_parts (pk_package,
+                                  ver.ParentPkg().Name(),
+                                  ver.VerStr(),
+                                  ver.Arch(),
+                                  m_cache->buildPackageIdData(ver).c_str(),
+                                  &local_error)) {
+        g_warning ("package %s invalid and cannot be processed: %s",
+               ver.ParentPkg().Name(), local_error->message);
         return;
     }
 
@@ -591,6 +660,8 @@ void AptJob::emitUpdates(PkgList &output, PkBitfield filters)
 }
 
 // search packages which provide a codec (specified in "values")
+G_LOCK_DEFINE_STATIC(gst_index);
+
 void AptJob::providesCodec(PkgList &output, gchar **values)
 {
     string arch;
@@ -599,6 +670,31 @@ void AptJob::providesCodec(PkgList &output, gchar **values)
         return;
     }
 
+    // Only a handful of packages have GStreamer metadata, the index saves
+    // reading the records of all the others
+    const string indexPath = AptGstIndex::defaultPath();
+    AptGstIndex index;
+    G_LOCK(gst_index);
+    bool haveIndex = index.open(*m_cache, indexPath) ||
+                     (AptGstIndex::build(*m_cache, indexPath) && index.open(*m_cache, indexPath));
+    G_UNLOCK(gst_index);
+
+    if (haveIndex) {
+        pkgCache *cache = m_cache->GetPkgCache();
+        for (guint32 i = 0; i < index.size(); i++) {
+            if (m_cancel) {
+                break;
+            }
+
+            pkgCache::PkgIterator pkg(*cache, cache->PkgP + index.package(i));
+            const pkgCache::VerIterator &ver = m_cache->findVer(pkg);
+            if (ver.end() == false && matcher.matches(index.record(i), ver.Arch())) {
+                output.append(ver);
+            }
+        }
+        return;
+    }
+
     for (pkgCache::PkgIterator pkg = m_cache->GetPkgCache()->PkgBegin(); !pkg.end(); ++pkg) {
         if (m_cancel) {
             break;
@@ -641,71 +737,49 @@ void AptJob::providesCodec(PkgList &output, gchar **values)
 // search packages which provide the libraries specified in "values"
 void AptJob::providesLibrary(PkgList &output, gchar **values)
 {
-    bool ret = false;
-    // Quick-check for library names
-    for (uint i = 0; i < g_strv_length(values); i++) {
-        if (g_str_has_prefix(values[i], "lib")) {
-            ret = true;
+    pkgCache *cache = m_cache->GetPkgCache();
+    std::unordered_set<string> seen;
+
+    for (uint i = 0; values[i] != NULL; i++) {
+        if (m_cancel) {
             break;
         }
-    }
 
-    if (!ret) {
-        return;
-    }
+        const string libPkgName = utilLibraryPackageName(values[i]);
+        if (libPkgName.empty()) {
+            g_debug("libmatcher: Did not match: %s", values[i]);
+            continue;
+        }
 
-    const char *libreg_str = "^\\(lib.*\\)\\.so\\.[0-9]*";
-    g_debug("RegStr: %s", libreg_str);
-    regex_t libreg;
-    if(regcomp(&libreg, libreg_str, 0) != 0) {
-        g_debug("Error compiling regular expression to match libraries.");
-        return;
-    }
+        // several sonames may map to the same package
+        if (!seen.insert(libPkgName).second) {
+            continue;
+        }
 
-    gchar *value;
-    for (uint i = 0; i < g_strv_length(values); i++) {
-        value = values[i];
-        regmatch_t matches[2];
-        if (regexec(&libreg, value, 2, matches, 0) != REG_NOMATCH) {
-            string libPkgName = string(value, matches[1].rm_so, matches[1].rm_eo - matches[1].rm_so);
+        g_debug ("pkg-name: %s", libPkgName.c_str ());
 
-            string strvalue = string(value);
-            ssize_t pos = strvalue.find (".so.");
-            if ((pos > 0) && ((size_t) pos != string::npos)) {
-                // If last char is a number, add a "-" (to be policy-compliant)
-                if (g_ascii_isdigit (libPkgName.at (libPkgName.length () - 1))) {
-                    libPkgName.append ("-");
-                }
+        // the group holds the package of that name for every architecture
+        pkgCache::GrpIterator grp = cache->FindGrp(libPkgName);
+        if (grp.end()) {
+            continue;
+        }
 
-                libPkgName.append (strvalue.substr (pos + 4));
+        for (pkgCache::PkgIterator pkg = grp.PackageList(); !pkg.end(); pkg = grp.NextPkg(pkg)) {
+            // Ignore packages that exist only due to dependencies.
+            if (pkg.VersionList().end() && pkg.ProvidesList().end()) {
+                continue;
             }
 
-            g_debug ("pkg-name: %s", libPkgName.c_str ());
-
-            for (pkgCache::PkgIterator pkg = m_cache->GetPkgCache()->PkgBegin(); !pkg.end(); ++pkg) {
-                // Ignore packages that exist only due to dependencies.
-                if (pkg.VersionList().end() && pkg.ProvidesList().end()) {
-                    continue;
-                }
-
-                // TODO: Ignore virtual packages
-                pkgCache::VerIterator ver = m_cache->findVer(pkg);
+            // TODO: Ignore virtual packages
+            pkgCache::VerIterator ver = m_cache->findVer(pkg);
+            if (ver.end()) {
+                ver = m_cache->findCandidateVer(pkg);
                 if (ver.end()) {
-                    ver = m_cache->findCandidateVer(pkg);
-                    if (ver.end()) {
-                        continue;
-                    }
-                }
-
-                // Make everything lower-case
-                std::transform(libPkgName.begin(), libPkgName.end(), libPkgName.begin(), ::tolower);
-
-                if (g_strcmp0 (pkg.Name (), libPkgName.c_str ()) == 0) {
-                    output.append(ver);
+                    continue;
                 }
             }
-        } else {
-            g_debug("libmatcher: Did not match: %s", value);
+
+            output.append(ver);
         }
     }
 }
@@ -844,7 +918,9 @@ void AptJob::emitDetails(PkgList &pkgs)
 }
 
 // helper for emitUpdateDetails() to create update items and add them to the final array for emission
-void AptJob::stageUpdateDetail(GPtrArray *updateArray, const pkgCache::VerIterator &candver)
+void AptJob::stageUpdateDetail(GPtrArray *updateArray,
+                               const pkgCache::VerIterator &candver,
+                               const string &changelogFile)
 {
     // Verify if our update version is valid
     if (candver.end()) {
@@ -876,23 +952,15 @@ void AptJob::stageUpdateDetail(GPtrArray *updateArray, const pkgCache::VerIterat
     }
 
     PkBackend *backend = PK_BACKEND(pk_backend_job_get_backend(m_job));
-    if (pk_backend_is_online(backend)) {
-        // Create the download object
-        AcqPackageKitStatus Stat(this);
-
-        // get a fetcher
-        pkgAcquire fetcher;
-        fetcher.SetLog(&Stat);
-
-        // fetch the changelog
-        pk_backend_job_set_status(m_job, PK_STATUS_ENUM_DOWNLOAD_CHANGELOG);
-        changelog = fetchChangelogData(*m_cache,
-                                       fetcher,
-                                       candver,
+    if (!changelogFile.empty()) {
+        changelog = parseChangelogFile(changelogFile,
+                                       srcpkg,
                                        currver,
                                        &update_text,
                                        &updated,
                                        &issued);
+    } else if (pk_backend_is_online(backend)) {
+        changelog = "Changelog for this version is not yet available";
     }
 
     // Check if the update was updates since it was issued
@@ -957,14 +1025,106 @@ void AptJob::stageUpdateDetail(GPtrArray *updateArray, const pkgCache::VerIterat
     g_ptr_array_add(updateArray, item);
 }
 
+static string changelogCacheDir()
+{
+    return _config->FindDir("Dir::Cache") + "packagekit-changelogs/";
+}
+
+// keeps only the latest changelog of each source package
+static void storeChangelog(const string &srcpkg, const string &cacheFile, const string &downloadedFile)
+{
+    const string dir = changelogCacheDir();
+    g_autofree gchar *contents = NULL;
+    gsize length;
+
+    if (g_mkdir_with_parents(dir.c_str(), 0755) != 0 ||
+            !g_file_get_contents(downloadedFile.c_str(), &contents, &length, NULL) ||
+            !g_file_set_contents(cacheFile.c_str(), contents, length, NULL)) {
+        return;
+    }
+
+    g_autoptr(GDir) cache = g_dir_open(dir.c_str(), 0, NULL);
+    if (cache == NULL) {
+        return;
+    }
+
+    const string prefix = srcpkg + "_";
+    const gchar *name;
+    while ((name = g_dir_read_name(cache)) != NULL) {
+        const string path = dir + name;
+        if (g_str_has_prefix(name, prefix.c_str()) && path != cacheFile) {
+            g_unlink(path.c_str());
+        }
+    }
+}
+
 void AptJob::emitUpdateDetails(const PkgList &pkgs)
 {
     g_autoptr(GPtrArray) updateDetailsArray = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+    vector<string> changelogFiles(pkgs.size());
+
+    // Changelogs are cached per source package version, and the ones we
+    // don't have yet are downloaded together by a single fetcher
+    struct PendingChangelog {
+        vector<size_t> indexes;
+        string srcpkg;
+        string cacheFile;
+        pkgAcqChangelog *item;
+    };
+    vector<PendingChangelog> pending;
+    map<string, size_t> pendingByFile;
+
+    // the changelogs all live on the same server, which the default
+    // "host" queue mode still fetches from over several connections,
+    // up to Acquire::QueueHost::Limit
+    AcqPackageKitStatus Stat(this);
+    pkgAcquire fetcher;
+    fetcher.SetLog(&Stat);
+
+    PkBackend *backend = PK_BACKEND(pk_backend_job_get_backend(m_job));
+    const bool online = pk_backend_is_online(backend);
+    for (size_t i = 0; i < pkgs.size(); ++i) {
+        const pkgCache::VerIterator &candver = pkgs[i].ver;
+        if (candver.end() || candver.FileList().end()) {
+            continue;
+        }
 
-    for (const PkgInfo &pi : pkgs) {
+        pkgRecords::Parser &rec = m_cache->GetPkgRecords()->Lookup(candver.FileList());
+        const string srcpkg = rec.SourcePkg().empty() ? candver.ParentPkg().Name() : rec.SourcePkg();
+        const string cacheFile = changelogCacheDir() + srcpkg + "_" + candver.SourceVerStr();
+        if (FileExists(cacheFile)) {
+            changelogFiles[i] = cacheFile;
+        } else if (pendingByFile.count(cacheFile) > 0) {
+            // another binary package built from the same source
+            pending[pendingByFile[cacheFile]].indexes.push_back(i);
+        } else if (online) {
+            pendingByFile[cacheFile] = pending.size();
+            pending.push_back({{i}, srcpkg, cacheFile, new pkgAcqChangelog(&fetcher, candver)});
+        }
+    }
+
+    if (!pending.empty() && !m_cancel) {
+        pk_backend_job_set_status(m_job, PK_STATUS_ENUM_DOWNLOAD_CHANGELOG);
+        fetcher.Run();
+
+        for (const PendingChangelog &changelog : pending) {
+            if (changelog.item->Status != pkgAcquire::Item::StatDone ||
+                    !FileExists(changelog.item->DestFile)) {
+                continue;
+            }
+
+            storeChangelog(changelog.srcpkg, changelog.cacheFile, changelog.item->DestFile);
+            for (size_t index : changelog.indexes) {
+                changelogFiles[index] = FileExists(changelog.cacheFile) ?
+                            changelog.cacheFile : changelog.item->DestFile;
+            }
+        }
+    }
+
+    for (size_t i = 0; i < pkgs.size(); ++i) {
         if (m_cancel)
             break;
-        stageUpdateDetail(updateDetailsArray, pi.ver);
+        stageUpdateDetail(updateDetailsArray, pkgs[i].ver, changelogFiles[i]);
     }
 
     // emit all data that we've just collected
@@ -1177,11 +1337,66 @@ bool AptJob::matchesQueries(const vector<string> &queries, string s) {
     return false;
 }
 
+G_LOCK_DEFINE_STATIC(search_index);
+
+bool AptJob::openSearchIndex(AptSearchIndex &index, bool rebuild)
+{
+    const string path = AptSearchIndex::defaultPath();
+
+    if (index.open(*m_cache, path))
+        return true;
+    if (!rebuild)
+        return false;
+
+    // Reading all package records once is as expensive as a single
+    // search without the index, so it pays off from the next search on
+    G_LOCK(search_index);
+    bool ret = index.open(*m_cache, path) ||
+               (AptSearchIndex::build(*m_cache, path) && index.open(*m_cache, path));
+    G_UNLOCK(search_index);
+
+    return ret;
+}
+
+void AptJob::appendSearchMatch(PkgList &output, const pkgCache::PkgIterator &pkg)
+{
+    // Don't insert virtual packages instead add what it provides
+    const pkgCache::VerIterator &ver = m_cache->findVer(pkg);
+    if (ver.end() == false) {
+        output.append(ver);
+        return;
+    }
+
+    // iterate over the provides list
+    for (pkgCache::PrvIterator Prv = pkg.ProvidesList(); Prv.end() == false; ++Prv) {
+        const pkgCache::VerIterator &ownerVer = m_cache->findVer(Prv.OwnerPkg());
+
+        // check to see if the provided package isn't virtual too
+        if (ownerVer.end() == false) {
+            // we add the package now because we will need to
+            // remove duplicates later anyway
+            output.append(ownerVer);
+        }
+    }
+}
+
 PkgList AptJob::searchPackageName(const vector<string> &queries)
 {
     PkgList output;
+    pkgCache *cache = m_cache->GetPkgCache();
 
-    for (pkgCache::PkgIterator pkg = m_cache->GetPkgCache()->PkgBegin(); !pkg.end(); ++pkg) {
+    // Names are cheap to scan, so don't build the index just for this
+    AptSearchIndex index;
+    if (openSearchIndex(index, false)) {
+        for (guint32 package : index.search(queries, false)) {
+            if (m_cancel)
+                break;
+            appendSearchMatch(output, pkgCache::PkgIterator(*cache, cache->PkgP + package));
+        }
+        return output;
+    }
+
+    for (pkgCache::PkgIterator pkg = cache->PkgBegin(); !pkg.end(); ++pkg) {
         if (m_cancel) {
             break;
         }
@@ -1191,23 +1406,7 @@ PkgList AptJob::searchPackageName(const vector<string> &queries)
         }
 
         if (matchesQueries(queries, pkg.Name())) {
-            // Don't insert virtual packages instead add what it provides
-            const pkgCache::VerIterator &ver = m_cache->findVer(pkg);
-            if (ver.end() == false) {
-                output.append(ver);
-            } else {
-                // iterate over the provides list
-                for (pkgCache::PrvIterator Prv = pkg.ProvidesList(); Prv.end() == false; ++Prv) {
-                    const pkgCache::VerIterator &ownerVer = m_cache->findVer(Prv.OwnerPkg());
-
-                    // check to see if the provided package isn't virtual too
-                    if (ownerVer.end() == false) {
-                        // we add the package now because we will need to
-                        // remove duplicates later anyway
-                        output.append(ownerVer);
-                    }
-                }
-            }
+            appendSearchMatch(output, pkg);
         }
     }
     return output;
@@ -1216,8 +1415,19 @@ PkgList AptJob::searchPackageName(const vector<string> &queries)
 PkgList AptJob::searchPackageDetails(const vector<string> &queries)
 {
     PkgList output;
+    pkgCache *cache = m_cache->GetPkgCache();
 
-    for (pkgCache::PkgIterator pkg = m_cache->GetPkgCache()->PkgBegin(); !pkg.end(); ++pkg) {
+    AptSearchIndex index;
+    if (openSearchIndex(index, true)) {
+        for (guint32 package : index.search(queries, true)) {
+            if (m_cancel)
+                break;
+            appendSearchMatch(output, pkgCache::PkgIterator(*cache, cache->PkgP + package));
+        }
+        return output;
+    }
+
+    for (pkgCache::PkgIterator pkg = cache->PkgBegin(); !pkg.end(); ++pkg) {
         if (m_cancel) {
             break;
         }
@@ -1235,29 +1445,15 @@ PkgList AptJob::searchPackageDetails(const vector<string> &queries)
             }
         } else if (matchesQueries(queries, pkg.Name())) {
             // The package is virtual and MATCHED the name
-            // Don't insert virtual packages instead add what it provides
-
-            // iterate over the provides list
-            for (pkgCache::PrvIterator Prv = pkg.ProvidesList(); Prv.end() == false; ++Prv) {
-                const pkgCache::VerIterator &ownerVer = m_cache->findVer(Prv.OwnerPkg());
-
-                // check to see if the provided package isn't virtual too
-                if (ownerVer.end() == false) {
-                    // we add the package now because we will need to
-                    // remove duplicates later anyway
-                    output.append(ownerVer);
-                }
-            }
+            appendSearchMatch(output, pkg);
         }
     }
     return output;
 }
 
 // used to return files it reads, using the info from the files in /var/lib/dpkg/info/
-PkgList AptJob::searchPackageFiles(gchar **values)
+bool AptJob::scanFileLists(gchar **values, vector<string> &packages)
 {
-    PkgList output;
-    vector<string> packages;
     string search;
     regex_t re;
 
@@ -1283,7 +1479,7 @@ PkgList AptJob::searchPackageFiles(gchar **values)
 
     if(regcomp(&re, search.c_str(), REG_NOSUB) != 0) {
         g_debug("Regex compilation error");
-        return output;
+        return false;
     }
 
     DIR *dp;
@@ -1291,7 +1487,7 @@ PkgList AptJob::searchPackageFiles(gchar **values)
     if (!(dp = opendir("/var/lib/dpkg/info/"))) {
         g_debug ("Error opening /var/lib/dpkg/info/\n");
         regfree(&re);
-        return output;
+        return false;
     }
 
     string line;
@@ -1320,6 +1516,31 @@ PkgList AptJob::searchPackageFiles(gchar **values)
     closedir(dp);
     regfree(&re);
 
+    return true;
+}
+
+PkgList AptJob::searchPackageFiles(gchar **values)
+{
+    PkgList output;
+    vector<string> packages;
+
+    AptFileIndex index;
+    if (index.open(AptFileIndex::defaultPath(), flNotFile(_config->FindFile("Dir::State::status")))) {
+        for (uint i = 0; i < g_strv_length(values); ++i) {
+            if (values[i][0] == '\0') {
+                continue;
+            }
+
+            for (const string &name : index.searchFile(values[i])) {
+                packages.push_back(name);
+            }
+        }
+        std::sort(packages.begin(), packages.end());
+        packages.erase(std::unique(packages.begin(), packages.end()), packages.end());
+    } else if (!scanFileLists(values, packages)) {
+        return output;
+    }
+
     // Resolve the package names now
     for (const string &name : packages) {
         if (m_cancel) {
@@ -1539,6 +1760,22 @@ void AptJob::emitPackageFiles(const gchar *pi)
     string line;
 
     g_auto(GStrv) parts = pk_package_id_split(pi);
+
+    // dpkg only puts the architecture into the name of Multi-Arch: same packages
+    AptFileIndex index;
+    if (index.open(AptFileIndex::defaultPath(), flNotFile(_config->FindFile("Dir::State::status")))) {
+        vector<const gchar *> paths;
+        if (!index.packageFiles(string(parts[PK_PACKAGE_ID_NAME]) + ":" + parts[PK_PACKAGE_ID_ARCH], paths)) {
+            index.packageFiles(parts[PK_PACKAGE_ID_NAME], paths);
+        }
+
+        if (!paths.empty()) {
+            paths.push_back(NULL);
+            pk_backend_job_files(m_job, pi, (gchar **) paths.data());
+        }
+        return;
+    }
+
     string fName;
     fName = "/var/lib/dpkg/info/" +
             string(parts[PK_PACKAGE_ID_NAME]) +
@@ -2210,6 +2447,23 @@ void AptJob::refreshCache()
     if (m_cache->BuildCaches() == false) {
         return;
     }
+
+    // The shared cache still maps the old package lists
+    if (m_cachePool != nullptr)
+        m_cachePool->invalidate();
+
+    // Index the new package lists right away, so the next search
+    // doesn't need to do it. Our own cache was opened before the lists
+    // were downloaded, so a fresh one is needed for this.
+    AptCacheFile cache(m_job);
+    if (!cache.Open(false)) {
+        g_debug("Could not open the new package cache to index it");
+        _error->Discard();
+        return;
+    }
+    G_LOCK(search_index);
+    AptSearchIndex::build(cache, AptSearchIndex::defaultPath());
+    G_UNLOCK(search_index);
 }
 
 void AptJob::markAutoInstalled(const PkgList &pkgs)
@@ -2349,6 +2603,16 @@ bool AptJob::runTransaction(const PkgList &install, const PkgList &remove, const
     // will just calculate the trusted packages
     const auto ret = installPackages(flags);
 
+    // dpkg has most likely changed the status of installed packages
+    if (!pk_bitfield_contain(flags, PK_TRANSACTION_FLAG_ENUM_SIMULATE)) {
+        if (m_cachePool != nullptr)
+            m_cachePool->invalidate();
+
+        // Read the changed file lists now, while no search has to wait for it
+        AptFileIndex fileIndex;
+        fileIndex.open(AptFileIndex::defaultPath(), flNotFile(_config->FindFile("Dir::State::status")));
+    }
+
     if (g_file_test(REBOOT_REQUIRED_FILE, G_FILE_TEST_EXISTS)) {
         struct stat restartStat;
         g_stat(REBOOT_REQUIRED_FILE, &restartStat);
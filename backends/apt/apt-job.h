@@ -25,6 +25,7 @@
 
 #include <glib.h>
 #include <glib/gstdio.h>
+#include <locale.h>
 
 #include <apt-pkg/depcache.h>
 #include <apt-pkg/acquire.h>
@@ -39,6 +40,8 @@
 class pkgProblemResolver;
 class Matcher;
 class AptCacheFile;
+class AptCachePool;
+class AptSearchIndex;
 class AptJob
 {
 public:
@@ -47,6 +50,18 @@ public:
 
     bool init(gchar **localDebs = nullptr);
     void cancel();
+
+    /**
+     * Prepares the job thread before the job runs. Read-only jobs may run
+     * in parallel and only change thread-local state.
+     */
+    void enterThread(bool readOnly);
+
+    /**
+     * Frees the thread-local state of this job, must be called from the
+     * job thread once the job finished
+     */
+    void leaveThread();
     bool cancelled() const;
 
     /**
@@ -247,12 +262,17 @@ private:
     bool packageIsSupported(const pkgCache::VerIterator &verIter, string component);
     bool isApplication(const pkgCache::VerIterator &verIter);
     bool matchesQueries(const vector<string> &queries, string s);
+    bool openSearchIndex(AptSearchIndex &index, bool rebuild);
+    void appendSearchMatch(PkgList &output, const pkgCache::PkgIterator &pkg);
+    bool scanFileLists(gchar **values, vector<string> &packages);
     bool dpkgHasForceConfFileSet();
     PkInfoEnum packageStateFromVer(const pkgCache::VerIterator &ver) const;
     void stagePackageForEmit(GPtrArray *array, const pkgCache::VerIterator &ver,
                              PkInfoEnum state = PK_INFO_ENUM_UNKNOWN,
                              PkInfoEnum updateSeverity = PK_INFO_ENUM_UNKNOWN) const;
-    void stageUpdateDetail(GPtrArray *updateArray, const pkgCache::VerIterator &candver);
+    void stageUpdateDetail(GPtrArray *updateArray,
+                           const pkgCache::VerIterator &candver,
+                           const string &changelogFile);
 
     /**
      *  interprets dpkg status fd
@@ -262,6 +282,8 @@ private:
     pkgCache::VerIterator findTransactionPackage(const std::string &name);
 
     AptCacheFile *m_cache;
+    AptCachePool *m_cachePool;
+    bool m_sharedCache;
     PkBackendJob *m_job;
     bool       m_cancel;
     struct stat m_restartStat;
@@ -279,4 +301,7 @@ private:
     // when the internal terminal timesout after no activity
     int m_terminalTimeout;
     pid_t m_child_pid;
+
+    // locale of the job thread for read-only jobs
+    locale_t m_threadLocale;
 };
@@ -0,0 +1,434 @@
+/* apt-search-index.cpp - Trigram index for package name and description searches
+ *
+ * Copyright (c) 2026 The PackageKit Authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include "apt-search-index.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <unordered_map>
+
+#include <apt-pkg/configuration.h>
+#include <apt-pkg/depcache.h>
+#include <apt-pkg/pkgrecords.h>
+
+/*
+ * File layout, all integers in host byte order:
+ *
+ *   IndexHeader
+ *   IndexEntry[n_entries]        one per package, in cache iteration order
+ *   IndexTrigram[n_trigrams]     sorted by key
+ *   postings                     delta-encoded varints of entry numbers
+ *   strings                      NUL-terminated lower-cased names and descriptions
+ */
+#define INDEX_MAGIC   "PKAPTSI"
+#define INDEX_VERSION 1
+
+struct IndexHeader {
+    char magic[8];
+    guint32 version;
+    guint32 n_entries;
+    guint64 generation;
+    guint32 n_trigrams;
+    guint32 reserved;
+    guint64 entries_offset;
+    guint64 trigrams_offset;
+    guint64 postings_offset;
+    guint64 strings_offset;
+    guint64 file_size;
+};
+
+struct IndexEntry {
+    guint32 package;
+    guint32 name;
+    guint32 name_len;
+    guint32 description;
+    guint32 description_len;
+    guint32 reserved;
+};
+
+struct IndexTrigram {
+    guint32 key;
+    guint32 count;
+    guint64 postings;
+};
+
+static inline guint32 trigramKey(const gchar *s)
+{
+    return ((guint32) (guchar) s[0] << 16) | ((guint32) (guchar) s[1] << 8) | (guchar) s[2];
+}
+
+static std::string asciiLower(const std::string &s)
+{
+    std::string ret(s);
+    for (char &c : ret)
+        c = g_ascii_tolower(c);
+    return ret;
+}
+
+static void collectTrigrams(const std::string &text, std::vector<guint32> &keys)
+{
+    for (size_t i = 0; i + 3 <= text.size(); i++)
+        keys.push_back(trigramKey(text.data() + i));
+}
+
+static void appendVarint(std::string &out, guint32 value)
+{
+    while (value >= 0x80) {
+        out.push_back((char) ((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    out.push_back((char) value);
+}
+
+static void appendBytes(std::string &out, const void *data, size_t len)
+{
+    out.append(static_cast<const char *>(data), len);
+}
+
+AptSearchIndex::AptSearchIndex() :
+    m_file(nullptr),
+    m_data(nullptr),
+    m_size(0)
+{
+}
+
+AptSearchIndex::~AptSearchIndex()
+{
+    if (m_file != nullptr)
+        g_mapped_file_unref(m_file);
+}
+
+std::string AptSearchIndex::defaultPath()
+{
+    return _config->FindDir("Dir::Cache") + "packagekit-search.idx";
+}
+
+guint64 AptSearchIndex::cacheGeneration(pkgCache *cache)
+{
+    // FNV-1a over the package index files, a cache built from the very
+    // same files has all packages at the same positions
+    guint64 hash = 14695981039346656037ULL;
+    auto mix = [&hash](const void *data, size_t len) {
+        const guchar *p = static_cast<const guchar *>(data);
+        for (size_t i = 0; i < len; i++) {
+            hash ^= p[i];
+            hash *= 1099511628211ULL;
+        }
+    };
+
+    const guint32 packageCount = cache->HeaderP->PackageCount;
+    mix(&packageCount, sizeof(packageCount));
+    for (pkgCache::PkgFileIterator file = cache->FileBegin(); !file.end(); ++file) {
+        const char *fileName = file.FileName();
+        const guint64 mtime = file->mtime;
+        const guint64 size = file->Size;
+
+        if (fileName != nullptr)
+            mix(fileName, strlen(fileName) + 1);
+        mix(&mtime, sizeof(mtime));
+        mix(&size, sizeof(size));
+    }
+
+    return hash;
+}
+
+bool AptSearchIndex::build(pkgCacheFile &cache, const std::string &path)
+{
+    pkgCache *pkgs = cache.GetPkgCache();
+    pkgDepCache *depCache = cache.GetDepCache();
+    if (pkgs == nullptr || depCache == nullptr)
+        return false;
+
+    // own records parser, the one of the cache belongs to the calling job
+    pkgRecords records(*pkgs);
+
+    std::vector<IndexEntry> entries;
+    std::string strings;
+    std::unordered_map<guint32, std::vector<guint32>> postings;
+    std::vector<guint32> keys;
+
+    for (pkgCache::PkgIterator pkg = pkgs->PkgBegin(); !pkg.end(); ++pkg) {
+        // Ignore packages that exist only due to dependencies.
+        if (pkg.VersionList().end() && pkg.ProvidesList().end())
+            continue;
+
+        // same version AptCacheFile::findVer() picks
+        pkgCache::VerIterator ver = pkg.CurrentVer();
+        if (ver.end())
+            ver = (*depCache)[pkg].CandidateVerIter(*depCache);
+        if (ver.end())
+            ver = pkg.VersionList();
+
+        const std::string name = asciiLower(pkg.Name());
+        std::string description;
+        if (!ver.end() && !ver.FileList().end()) {
+            pkgCache::DescIterator d = ver.TranslatedDescription();
+            if (!d.end() && !d.FileList().end())
+                description = asciiLower(records.Lookup(d.FileList()).LongDesc());
+        }
+
+        const guint32 entryNumber = entries.size();
+        IndexEntry entry = {};
+        entry.package = pkg.operator->() - pkgs->PkgP;
+        entry.name = strings.size();
+        entry.name_len = name.size();
+        strings.append(name);
+        strings.push_back('\0');
+        entry.description = strings.size();
+        entry.description_len = description.size();
+        strings.append(description);
+        strings.push_back('\0');
+        entries.push_back(entry);
+
+        keys.clear();
+        collectTrigrams(name, keys);
+        collectTrigrams(description, keys);
+        std::sort(keys.begin(), keys.end());
+        keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+        for (guint32 key : keys)
+            postings[key].push_back(entryNumber);
+    }
+
+    std::vector<guint32> sortedKeys;
+    sortedKeys.reserve(postings.size());
+    for (const auto &it : postings)
+        sortedKeys.push_back(it.first);
+    std::sort(sortedKeys.begin(), sortedKeys.end());
+
+    std::vector<IndexTrigram> trigrams;
+    std::string postingData;
+    trigrams.reserve(sortedKeys.size());
+    for (guint32 key : sortedKeys) {
+        const std::vector<guint32> &list = postings[key];
+        IndexTrigram trigram;
+        trigram.key = key;
+        trigram.count = list.size();
+        trigram.postings = postingData.size();
+        guint32 last = 0;
+        for (guint32 entryNumber : list) {
+            appendVarint(postingData, entryNumber - last);
+            last = entryNumber;
+        }
+        trigrams.push_back(trigram);
+    }
+
+    IndexHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC));
+    header.version = INDEX_VERSION;
+    header.n_entries = entries.size();
+    header.generation = cacheGeneration(pkgs);
+    header.n_trigrams = trigrams.size();
+    header.entries_offset = sizeof(IndexHeader);
+    header.trigrams_offset = header.entries_offset + entries.size() * sizeof(IndexEntry);
+    header.postings_offset = header.trigrams_offset + trigrams.size() * sizeof(IndexTrigram);
+    header.strings_offset = header.postings_offset + postingData.size();
+    header.file_size = header.strings_offset + strings.size();
+
+    std::string data;
+    data.reserve(header.file_size);
+    appendBytes(data, &header, sizeof(header));
+    appendBytes(data, entries.data(), entries.size() * sizeof(IndexEntry));
+    appendBytes(data, trigrams.data(), trigrams.size() * sizeof(IndexTrigram));
+    data.append(postingData);
+    data.append(strings);
+
+    g_autoptr(GError) error = nullptr;
+    if (!g_file_set_contents(path.c_str(), data.data(), data.size(), &error)) {
+        g_warning("Failed to write search index %s: %s", path.c_str(), error->message);
+        return false;
+    }
+
+    g_debug("Wrote search index for %u packages to %s", header.n_entries, path.c_str());
+    return true;
+}
+
+bool AptSearchIndex::open(pkgCacheFile &cache, const std::string &path)
+{
+    if (m_file != nullptr) {
+        g_mapped_file_unref(m_file);
+        m_file = nullptr;
+        m_data = nullptr;
+        m_size = 0;
+    }
+
+    pkgCache *pkgs = cache.GetPkgCache();
+    if (pkgs == nullptr)
+        return false;
+
+    GMappedFile *file = g_mapped_file_new(path.c_str(), FALSE, nullptr);
+    if (file == nullptr)
+        return false;
+
+    const gchar *data = g_mapped_file_get_contents(file);
+    const gsize size = g_mapped_file_get_length(file);
+    if (size < sizeof(IndexHeader)) {
+        g_mapped_file_unref(file);
+        return false;
+    }
+
+    const IndexHeader *header = reinterpret_cast<const IndexHeader *>(data);
+    if (memcmp(header->magic, INDEX_MAGIC, sizeof(INDEX_MAGIC)) != 0 ||
+            header->version != INDEX_VERSION ||
+            header->file_size != size ||
+            header->entries_offset + (guint64) header->n_entries * sizeof(IndexEntry) > header->trigrams_offset ||
+            header->trigrams_offset + (guint64) header->n_trigrams * sizeof(IndexTrigram) > header->postings_offset ||
+            header->postings_offset > header->strings_offset ||
+            header->strings_offset > size) {
+        g_debug("Ignoring damaged search index %s", path.c_str());
+        g_mapped_file_unref(file);
+        return false;
+    }
+
+    if (header->generation != cacheGeneration(pkgs)) {
+        g_debug("Search index %s is outdated", path.c_str());
+        g_mapped_file_unref(file);
+        return false;
+    }
+
+    m_file = file;
+    m_data = data;
+    m_size = size;
+    return true;
+}
+
+bool AptSearchIndex::isOpen() const
+{
+    return m_file != nullptr;
+}
+
+bool AptSearchIndex::entryMatches(guint32 entryNumber,
+                                  const std::string &query,
+                                  bool withDescription) const
+{
+    const IndexHeader *header = reinterpret_cast<const IndexHeader *>(m_data);
+    const IndexEntry *entry =
+        reinterpret_cast<const IndexEntry *>(m_data + header->entries_offset) + entryNumber;
+    const gchar *strings = m_data + header->strings_offset;
+
+    if (g_strstr_len(strings + entry->name, entry->name_len, query.c_str()) != nullptr)
+        return true;
+    return withDescription &&
+           g_strstr_len(strings + entry->description, entry->description_len, query.c_str()) != nullptr;
+}
+
+void AptSearchIndex::searchOne(const std::string &query,
+                               bool withDescription,
+                               std::vector<guint32> &result) const
+{
+    const IndexHeader *header = reinterpret_cast<const IndexHeader *>(m_data);
+
+    // too short for a trigram, check every entry
+    if (query.size() < 3) {
+        for (guint32 i = 0; i < header->n_entries; i++) {
+            if (entryMatches(i, query, withDescription))
+                result.push_back(i);
+        }
+        return;
+    }
+
+    std::vector<guint32> keys;
+    collectTrigrams(query, keys);
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+    const IndexTrigram *trigramsBegin =
+        reinterpret_cast<const IndexTrigram *>(m_data + header->trigrams_offset);
+    const IndexTrigram *trigramsEnd = trigramsBegin + header->n_trigrams;
+    std::vector<const IndexTrigram *> lists;
+    for (guint32 key : keys) {
+        const IndexTrigram *it = std::lower_bound(trigramsBegin, trigramsEnd, key,
+                                                  [](const IndexTrigram &t, guint32 k) {
+                                                      return t.key < k;
+                                                  });
+        // a trigram nobody has, so nothing can match
+        if (it == trigramsEnd || it->key != key)
+            return;
+        lists.push_back(it);
+    }
+
+    // start with the rarest trigram to keep the candidate set small
+    std::sort(lists.begin(), lists.end(), [](const IndexTrigram *a, const IndexTrigram *b) {
+        return a->count < b->count;
+    });
+
+    const guchar *postingsEnd = reinterpret_cast<const guchar *>(m_data + header->strings_offset);
+    auto decode = [&](const IndexTrigram *trigram, std::vector<guint32> &out) {
+        const guchar *p = reinterpret_cast<const guchar *>(m_data + header->postings_offset + trigram->postings);
+        guint32 value = 0;
+        out.clear();
+        out.reserve(trigram->count);
+        for (guint32 i = 0; i < trigram->count && p < postingsEnd; i++) {
+            guint32 delta = 0;
+            guint shift = 0;
+            while (p < postingsEnd && (*p & 0x80) && shift < 28) {
+                delta |= (guint32) (*p++ & 0x7f) << shift;
+                shift += 7;
+            }
+            if (p < postingsEnd)
+                delta |= (guint32) (*p++ & 0x7f) << shift;
+            value += delta;
+            out.push_back(value);
+        }
+    };
+
+    std::vector<guint32> candidates;
+    std::vector<guint32> list;
+    std::vector<guint32> intersection;
+    decode(lists[0], candidates);
+    for (size_t i = 1; i < lists.size() && !candidates.empty(); i++) {
+        decode(lists[i], list);
+        intersection.clear();
+        std::set_intersection(candidates.begin(), candidates.end(),
+                              list.begin(), list.end(),
+                              std::back_inserter(intersection));
+        candidates.swap(intersection);
+    }
+
+    // the trigrams may come from different strings or positions
+    for (guint32 entryNumber : candidates) {
+        if (entryNumber < header->n_entries && entryMatches(entryNumber, query, withDescription))
+            result.push_back(entryNumber);
+    }
+}
+
+std::vector<guint32> AptSearchIndex::search(const std::vector<std::string> &queries,
+                                            bool withDescription) const
+{
+    std::vector<guint32> entryNumbers;
+    std::vector<guint32> packages;
+
+    if (m_file == nullptr)
+        return packages;
+
+    for (const std::string &query : queries)
+        searchOne(asciiLower(query), withDescription, entryNumbers);
+    std::sort(entryNumbers.begin(), entryNumbers.end());
+    entryNumbers.erase(std::unique(entryNumbers.begin(), entryNumbers.end()), entryNumbers.end());
+
+    const IndexHeader *header = reinterpret_cast<const IndexHeader *>(m_data);
+    const IndexEntry *entries = reinterpret_cast<const IndexEntry *>(m_data + header->entries_offset);
+    packages.reserve(entryNumbers.size());
+    for (guint32 entryNumber : entryNumbers)
+        packages.push_back(entries[entryNumber].package);
+
+    return packages;
+}
@@ -0,0 +1,88 @@
+/* apt-search-index.h - Trigram index for package name and description searches
+ *
+ * Copyright (c) 2026 The PackageKit Authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#pragma once
+
+#include <glib.h>
+
+#include <string>
+#include <vector>
+
+#include <apt-pkg/cachefile.h>
+
+/**
+ * An on-disk index of the lower-cased name and long description of every
+ * package in the APT cache, with a trigram table pointing to the packages
+ * containing each trigram.
+ *
+ * Substring searches look up the trigrams of the query and only verify the
+ * few candidates, instead of reading all package records. The index is tied
+ * to the package lists and status file the cache was built from and is
+ * ignored once any of them changed.
+ */
+class AptSearchIndex
+{
+public:
+    AptSearchIndex();
+    ~AptSearchIndex();
+
+    /**
+     * The location of the index if none is set explicitly
+     */
+    static std::string defaultPath();
+
+    /**
+     * Returns a value identifying the set of package index files (and
+     * their modification times) @cache was built from
+     */
+    static guint64 cacheGeneration(pkgCache *cache);
+
+    /**
+     * Builds the index for @cache and atomically replaces the file at @path
+     */
+    static bool build(pkgCacheFile &cache, const std::string &path);
+
+    /**
+     * Maps the index at @path
+     * @returns false if it is missing, damaged or was built for a different cache
+     */
+    bool open(pkgCacheFile &cache, const std::string &path);
+
+    bool isOpen() const;
+
+    /**
+     * Finds packages whose name (or long description, if @withDescription
+     * is set) contains any of the @queries, ignoring ASCII case
+     * @returns the positions of the matching packages in pkgCache::PkgP,
+     *          in the order the cache iterates over them
+     */
+    std::vector<guint32> search(const std::vector<std::string> &queries,
+                                bool withDescription) const;
+
+private:
+    void searchOne(const std::string &query,
+                   bool withDescription,
+                   std::vector<guint32> &result) const;
+    bool entryMatches(guint32 entry, const std::string &query, bool withDescription) const;
+
+    GMappedFile *m_file;
+    const gchar *m_data;
+    gsize m_size;
+};
@@ -156,9 +156,8 @@ PkGroupEnum get_enum_group(string group)
     }
 }
 
-string fetchChangelogData(AptCacheFile &CacheFile,
-                          pkgAcquire &Fetcher,
-                          pkgCache::VerIterator Ver,
+string parseChangelogFile(const string &fileName,
+                          const string &srcpkg,
                           pkgCache::VerIterator currver,
                           string *update_text,
                           string *updated,
@@ -166,29 +165,11 @@ string fetchChangelogData(AptCacheFile &CacheFile,
 {
     string changelog;
 
-    pkgAcqChangelog *c = new pkgAcqChangelog(&Fetcher, Ver);
-
-    // try downloading it, if that fails, try third-party-changelogs location
-    // FIXME: Fetcher.Run() is "Continue" even if I get a 404?!?
-    Fetcher.Run();
-
-    // error
-    pkgRecords Recs(CacheFile);
-    pkgCache::PkgIterator Pkg = Ver.ParentPkg();
-    pkgRecords::Parser &rec=Recs.Lookup(Ver.FileList());
-    string srcpkg = rec.SourcePkg().empty() ? Pkg.Name() : rec.SourcePkg();
-    changelog = "Changelog for this version is not yet available";
-
-    // return empty string if we don't have a file to read
-    if (!FileExists(c->DestFile)) {
-        return changelog;
-    }
-
-    if (_error->PendingError()) {
-        return changelog;
+    ifstream in(fileName.c_str());
+    if (!in) {
+        return "Changelog for this version is not yet available";
     }
 
-    ifstream in(c->DestFile.c_str());
     string line;
     g_autoptr(GRegex) regexVer = NULL;
     regexVer = g_regex_new("(?'source'.+) \\((?'version'.*)\\) "
@@ -394,6 +375,36 @@ bool utilRestartRequired(const string &packageName)
     return false;
 }
 
+string utilLibraryPackageName(const string &soname)
+{
+    if (!starts_with(soname, "lib")) {
+        return string();
+    }
+
+    // the library name ends at the last ".so.", the version starts after the first
+    const size_t nameEnd = soname.rfind(".so.");
+    if (nameEnd == string::npos || nameEnd < 3) {
+        return string();
+    }
+
+    string pkgName = soname.substr(0, nameEnd);
+    const string version = soname.substr(soname.find(".so.") + 4);
+    if (!version.empty()) {
+        // If last char is a number, add a "-" (to be policy-compliant)
+        if (g_ascii_isdigit(pkgName.back())) {
+            pkgName.append("-");
+        }
+        pkgName.append(version);
+    }
+
+    // Make everything lower-case
+    for (char &c : pkgName) {
+        c = g_ascii_tolower(c);
+    }
+
+    return pkgName;
+}
+
 string utilBuildPackageOriginId(pkgCache::VerFileIterator vf)
 {
     if (vf.File().Origin() == nullptr)
@@ -36,11 +36,11 @@ using namespace std;
 PkGroupEnum get_enum_group(string group);
 
 /**
-  * Return the changelog and extract details about the changes.
+  * Return the changelog in fileName and extract details about the changes
+  * newer than currver.
   */
-string fetchChangelogData(AptCacheFile &CacheFile,
-                          pkgAcquire &Fetcher,
-                          pkgCache::VerIterator Ver,
+string parseChangelogFile(const string &fileName,
+                          const string &srcpkg,
                           pkgCache::VerIterator currver,
                           string *update_text,
                           string *updated,
@@ -71,6 +71,13 @@ bool starts_with(const string &str, const char *end);
   */
 bool utilRestartRequired(const string &packageName);
 
+/**
+  * Return the name of the package shipping the library with the given soname,
+  * following the Debian library packaging policy (libfoo.so.1 -> libfoo1), or
+  * an empty string if soname doesn't look like a library
+  */
+string utilLibraryPackageName(const string &soname);
+
 /**
  * Build a unique repository origin, in the form of
  * {distro}-{suite}-{component}
@@ -24,6 +24,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <gio/gio.h>
 
 #include <config.h>
 #include <pk-backend.h>
@@ -37,9 +38,11 @@
 
 #include "apt-job.h"
 #include "apt-cache-file.h"
+#include "apt-cache-pool.h"
 #include "apt-messages.h"
 #include "acqpkitstatus.h"
 #include "apt-sourceslist.h"
+#include "pk-backend-apt.h"
 
 
 const gchar* pk_backend_get_description(PkBackend *backend)
@@ -56,8 +59,60 @@ const gchar* pk_backend_get_author(PkBackend *backend)
 gboolean
 pk_backend_supports_parallelization (PkBackend *backend)
 {
-    // we need to set this to TRUE as soon as the parallelization work is completed!
-    return FALSE;
+    // read-only jobs run in parallel, everything else is serialized by
+    // the job thread wrapper below
+    return TRUE;
+}
+
+static void backend_invalidate_cache_cb(PkBackend *backend, gpointer user_data)
+{
+    auto pool = static_cast<AptCachePool*>(user_data);
+    pool->invalidate();
+}
+
+static void backend_status_changed_cb(GFileMonitor *monitor,
+                                      GFile *file,
+                                      GFile *other_file,
+                                      GFileMonitorEvent event_type,
+                                      gpointer user_data)
+{
+    if (event_type == G_FILE_MONITOR_EVENT_ATTRIBUTE_CHANGED)
+        return;
+    pk_backend_installed_db_changed(PK_BACKEND(user_data));
+}
+
+static void backend_lists_changed_cb(GFileMonitor *monitor,
+                                     GFile *file,
+                                     GFile *other_file,
+                                     GFileMonitorEvent event_type,
+                                     gpointer user_data)
+{
+    if (event_type == G_FILE_MONITOR_EVENT_ATTRIBUTE_CHANGED)
+        return;
+    // the cached query results are outdated, the shared cache notices
+    // the new lists by itself
+    pk_backend_cache_invalidate(PK_BACKEND(user_data));
+}
+
+static GFileMonitor *backend_monitor_path(PkBackend *backend,
+                                          const std::string &path,
+                                          bool directory,
+                                          GCallback callback)
+{
+    g_autoptr(GError) error = NULL;
+    g_autoptr(GFile) file = g_file_new_for_path(path.c_str());
+    GFileMonitor *monitor;
+
+    if (directory)
+        monitor = g_file_monitor_directory(file, G_FILE_MONITOR_NONE, NULL, &error);
+    else
+        monitor = g_file_monitor_file(file, G_FILE_MONITOR_NONE, NULL, &error);
+    if (monitor == NULL) {
+        g_warning("Failed to watch %s: %s", path.c_str(), error->message);
+        return NULL;
+    }
+    g_signal_connect(monitor, "changed", callback, backend);
+    return monitor;
 }
 
 void pk_backend_initialize(GKeyFile *conf, PkBackend *backend)
@@ -86,11 +141,43 @@ void pk_backend_initialize(GKeyFile *conf, PkBackend *backend)
     if (!pkgInitSystem(*_config, _system)) {
         g_debug("ERROR initializing backend system");
     }
+
+    // default settings
+    _config->CndSet("APT::Get::AutomaticRemove::Kernels", _config->FindB("APT::Get::AutomaticRemove", true));
+
+    // read-only jobs share one cache, which needs to be reopened whenever
+    // the package database or the repositories change
+    auto priv = g_new0(PkBackendAptPrivate, 1);
+    priv->cachePool = new AptCachePool;
+    pk_backend_set_user_data(backend, priv);
+    g_signal_connect(backend, "installed-changed",
+                     G_CALLBACK(backend_invalidate_cache_cb), priv->cachePool);
+    g_signal_connect(backend, "repo-list-changed",
+                     G_CALLBACK(backend_invalidate_cache_cb), priv->cachePool);
+
+    // forget cached query results when dpkg or apt-get changed something
+    priv->statusMonitor = backend_monitor_path(backend,
+                                               _config->FindFile("Dir::State::status"),
+                                               false,
+                                               G_CALLBACK(backend_status_changed_cb));
+    priv->listsMonitor = backend_monitor_path(backend,
+                                              _config->FindDir("Dir::State::lists"),
+                                              true,
+                                              G_CALLBACK(backend_lists_changed_cb));
 }
 
 void pk_backend_destroy(PkBackend *backend)
 {
     g_debug("APT backend being destroyed");
+
+    auto priv = static_cast<PkBackendAptPrivate*>(pk_backend_get_user_data(backend));
+    g_clear_object(&priv->statusMonitor);
+    g_clear_object(&priv->listsMonitor);
+
+    g_signal_handlers_disconnect_by_data(backend, priv->cachePool);
+    pk_backend_set_user_data(backend, NULL);
+    delete priv->cachePool;
+    g_free(priv);
 }
 
 PkBitfield pk_backend_get_groups(PkBackend *backend)
@@ -166,6 +253,30 @@ void pk_backend_stop_job(PkBackend *backend, PkBackendJob *job)
     pk_backend_job_set_user_data (job, NULL);
 }
 
+static void backend_job_thread(PkBackendJob *job, GVariant *params, gpointer user_data)
+{
+    auto func = reinterpret_cast<PkBackendJobThreadFunc>(user_data);
+    auto apt = static_cast<AptJob*>(pk_backend_job_get_user_data(job));
+    auto priv = static_cast<PkBackendAptPrivate*>(pk_backend_get_user_data(PK_BACKEND(pk_backend_job_get_backend(job))));
+    auto pool = priv->cachePool;
+    bool readOnly = AptCachePool::isReadOnly(pk_backend_job_get_role(job));
+
+    // read-only jobs run alongside each other, anything else waits
+    // until it can run alone
+    pool->beginJob(job, readOnly);
+    apt->enterThread(readOnly);
+
+    func(job, params, NULL);
+
+    apt->leaveThread();
+    pool->endJob(readOnly);
+}
+
+static void backend_job_thread_create(PkBackendJob *job, PkBackendJobThreadFunc func)
+{
+    pk_backend_job_thread_create(job, backend_job_thread, reinterpret_cast<gpointer>(func), NULL);
+}
+
 void pk_backend_cancel(PkBackend *backend, PkBackendJob *job)
 {
     auto apt = static_cast<AptJob*>(pk_backend_job_get_user_data(job));
@@ -236,7 +347,7 @@ static void backend_depends_on_or_requires_thread(PkBackendJob *job, GVariant *p
 void pk_backend_depends_on(PkBackend *backend, PkBackendJob *job, PkBitfield filters,
                            gchar **package_ids, gboolean recursive)
 {
-    pk_backend_job_thread_create(job, backend_depends_on_or_requires_thread, NULL, NULL);
+    backend_job_thread_create(job, backend_depends_on_or_requires_thread);
 }
 
 void pk_backend_required_by(PkBackend *backend,
@@ -245,7 +356,7 @@ void pk_backend_required_by(PkBackend *backend,
                             gchar **package_ids,
                             gboolean recursive)
 {
-    pk_backend_job_thread_create(job, backend_depends_on_or_requires_thread, NULL, NULL);
+    backend_job_thread_create(job, backend_depends_on_or_requires_thread);
 }
 
 static void backend_get_files_thread(PkBackendJob *job, GVariant *params, gpointer user_data)
@@ -295,7 +406,7 @@ static void backend_get_files_thread(PkBackendJob *job, GVariant *params, gpoint
 
 void pk_backend_get_files(PkBackend *backend, PkBackendJob *job, gchar **package_ids)
 {
-    pk_backend_job_thread_create(job, backend_get_files_thread, NULL, NULL);
+    backend_job_thread_create(job, backend_get_files_thread);
 }
 
 static void backend_get_details_thread(PkBackendJob *job, GVariant *params, gpointer user_data)
@@ -336,17 +447,17 @@ static void backend_get_details_thread(PkBackendJob *job, GVariant *params, gpoi
 
 void pk_backend_get_update_detail(PkBackend *backend, PkBackendJob *job, gchar **package_ids)
 {
-    pk_backend_job_thread_create(job, backend_get_details_thread, NULL, NULL);
+    backend_job_thread_create(job, backend_get_details_thread);
 }
 
 void pk_backend_get_details(PkBackend *backend, PkBackendJob *job, gchar **package_ids)
 {
-    pk_backend_job_thread_create(job, backend_get_details_thread, NULL, NULL);
+    backend_job_thread_create(job, backend_get_details_thread);
 }
 
 void pk_backend_get_details_local(PkBackend *backend, PkBackendJob *job, gchar **files)
 {
-    pk_backend_job_thread_create(job, backend_get_details_thread, NULL, NULL);
+    backend_job_thread_create(job, backend_get_details_thread);
 }
 
 static void backend_get_files_local_thread(PkBackendJob *job, GVariant *params, gpointer user_data)
@@ -362,7 +473,7 @@ static void backend_get_files_local_thread(PkBackendJob *job, GVariant *params,
 
 void pk_backend_get_files_local(PkBackend *backend, PkBackendJob *job, gchar **files)
 {
-    pk_backend_job_thread_create(job, backend_get_files_local_thread, NULL, NULL);
+    backend_job_thread_create(job, backend_get_files_local_thread);
 }
 
 static void backend_get_updates_thread(PkBackendJob *job, GVariant *params, gpointer user_data)
@@ -398,7 +509,7 @@ static void backend_get_updates_thread(PkBackendJob *job, GVariant *params, gpoi
 
 void pk_backend_get_updates(PkBackend *backend, PkBackendJob *job, PkBitfield filters)
 {
-    pk_backend_job_thread_create(job, backend_get_updates_thread, NULL, NULL);
+    backend_job_thread_create(job, backend_get_updates_thread);
 }
 
 static void backend_what_provides_thread(PkBackendJob *job, GVariant *params, gpointer user_data)
@@ -439,7 +550,7 @@ void pk_backend_what_provides(PkBackend *backend,
                               PkBitfield filters,
                               gchar **values)
 {
-    pk_backend_job_thread_create(job, backend_what_provides_thread, NULL, NULL);
+    backend_job_thread_create(job, backend_what_provides_thread);
 }
 
 /**
@@ -555,7 +666,7 @@ void pk_backend_download_packages(PkBackend *backend,
                                   gchar **package_ids,
                                   const gchar *directory)
 {
-    pk_backend_job_thread_create(job, pk_backend_download_packages_thread, NULL, NULL);
+    backend_job_thread_create(job, pk_backend_download_packages_thread);
 }
 
 static void pk_backend_refresh_cache_thread(PkBackendJob *job, GVariant *params, gpointer user_data)
@@ -584,7 +695,7 @@ static void pk_backend_refresh_cache_thread(PkBackendJob *job, GVariant *params,
 
 void pk_backend_refresh_cache(PkBackend *backend, PkBackendJob *job, gboolean force)
 {
-    pk_backend_job_thread_create(job, pk_backend_refresh_cache_thread, NULL, NULL);
+    backend_job_thread_create(job, pk_backend_refresh_cache_thread);
 }
 
 static void pk_backend_resolve_thread(PkBackendJob *job, GVariant *params, gpointer user_data)
@@ -611,7 +722,7 @@ static void pk_backend_resolve_thread(PkBackendJob *job, GVariant *params, gpoin
 
 void pk_backend_resolve(PkBackend *backend, PkBackendJob *job, PkBitfield filters, gchar **packages)
 {
-    pk_backend_job_thread_create(job, pk_backend_resolve_thread, NULL, NULL);
+    backend_job_thread_create(job, pk_backend_resolve_thread);
 }
 
 static void pk_backend_search_files_thread(PkBackendJob *job, GVariant *params, gpointer user_data)
@@ -644,7 +755,7 @@ static void pk_backend_search_files_thread(PkBackendJob *job, GVariant *params,
 
 void pk_backend_search_files(PkBackend *backend, PkBackendJob *job, PkBitfield filters, gchar **values)
 {
-    pk_backend_job_thread_create(job, pk_backend_search_files_thread, NULL, NULL);
+    backend_job_thread_create(job, pk_backend_search_files_thread);
 }
 
 static void backend_search_groups_thread(PkBackendJob *job, GVariant *params, gpointer user_data)
@@ -672,7 +783,7 @@ static void backend_search_groups_thread(PkBackendJob *job, GVariant *params, gp
 
 void pk_backend_search_groups(PkBackend *backend, PkBackendJob *job, PkBitfield filters, gchar **values)
 {
-    pk_backend_job_thread_create(job, backend_search_groups_thread, NULL, NULL);
+    backend_job_thread_create(job, backend_search_groups_thread);
 }
 
 static void backend_search_package_thread(PkBackendJob *job, GVariant *params, gpointer user_data)
@@ -722,12 +833,12 @@ static void backend_search_package_thread(PkBackendJob *job, GVariant *params, g
 
 void pk_backend_search_names(PkBackend *backend, PkBackendJob *job, PkBitfield filters, gchar **values)
 {
-    pk_backend_job_thread_create(job, backend_search_package_thread, NULL, NULL);
+    backend_job_thread_create(job, backend_search_package_thread);
 }
 
 void pk_backend_search_details(PkBackend *backend, PkBackendJob *job, PkBitfield filters, gchar **values)
 {
-    pk_backend_job_thread_create(job, backend_search_package_thread, NULL, NULL);
+    backend_job_thread_create(job, backend_search_package_thread);
 }
 
 static void backend_manage_packages_thread(PkBackendJob *job, GVariant *params, gpointer user_data)
@@ -823,7 +934,7 @@ void pk_backend_install_packages(PkBackend *backend,
                                  PkBitfield transaction_flags,
                                  gchar **package_ids)
 {
-    pk_backend_job_thread_create(job, backend_manage_packages_thread, NULL, NULL);
+    backend_job_thread_create(job, backend_manage_packages_thread);
 }
 
 void pk_backend_update_packages(PkBackend *backend,
@@ -831,7 +942,7 @@ void pk_backend_update_packages(PkBackend *backend,
                                 PkBitfield transaction_flags,
                                 gchar **package_ids)
 {
-    pk_backend_job_thread_create(job, backend_manage_packages_thread, NULL, NULL);
+    backend_job_thread_create(job, backend_manage_packages_thread);
 }
 
 void pk_backend_install_files(PkBackend *backend,
@@ -839,7 +950,7 @@ void pk_backend_install_files(PkBackend *backend,
                               PkBitfield transaction_flags,
                               gchar **full_paths)
 {
-    pk_backend_job_thread_create(job, backend_manage_packages_thread, NULL, NULL);
+    backend_job_thread_create(job, backend_manage_packages_thread);
 }
 
 void pk_backend_remove_packages(PkBackend *backend,
@@ -849,12 +960,12 @@ void pk_backend_remove_packages(PkBackend *backend,
                                 gboolean allow_deps,
                                 gboolean autoremove)
 {
-    pk_backend_job_thread_create(job, backend_manage_packages_thread, NULL, NULL);
+    backend_job_thread_create(job, backend_manage_packages_thread);
 }
 
 void pk_backend_repair_system(PkBackend *backend, PkBackendJob *job, PkBitfield transaction_flags)
 {
-    pk_backend_job_thread_create(job, backend_manage_packages_thread, NULL, NULL);
+    backend_job_thread_create(job, backend_manage_packages_thread);
 }
 
 static void backend_repo_manager_thread(PkBackendJob *job, GVariant *params, gpointer user_data)
@@ -988,12 +1099,12 @@ static void backend_repo_manager_thread(PkBackendJob *job, GVariant *params, gpo
 
 void pk_backend_get_repo_list(PkBackend *backend, PkBackendJob *job, PkBitfield filters)
 {
-    pk_backend_job_thread_create(job, backend_repo_manager_thread, NULL, NULL);
+    backend_job_thread_create(job, backend_repo_manager_thread);
 }
 
 void pk_backend_repo_enable(PkBackend *backend, PkBackendJob *job, const gchar *repo_id, gboolean enabled)
 {
-    pk_backend_job_thread_create(job, backend_repo_manager_thread, NULL, NULL);
+    backend_job_thread_create(job, backend_repo_manager_thread);
 }
 
 void
@@ -1003,7 +1114,7 @@ pk_backend_repo_remove (PkBackend *backend,
                         const gchar *repo_id,
                         gboolean autoremove)
 {
-    pk_backend_job_thread_create(job, backend_repo_manager_thread, NULL, NULL);
+    backend_job_thread_create(job, backend_repo_manager_thread);
 }
 
 static void backend_get_packages_thread(PkBackendJob *job, GVariant *params, gpointer user_data)
@@ -1028,7 +1139,7 @@ static void backend_get_packages_thread(PkBackendJob *job, GVariant *params, gpo
 
 void pk_backend_get_packages(PkBackend *backend, PkBackendJob *job, PkBitfield filters)
 {
-    pk_backend_job_thread_create(job, backend_get_packages_thread, NULL, NULL);
+    backend_job_thread_create(job, backend_get_packages_thread);
 }
 
 
@@ -1036,7 +1147,7 @@ void pk_backend_get_packages(PkBackend *backend, PkBackendJob *job, PkBitfield f
 void
 pk_backend_get_categories (PkBackend *backend, PkBackendJob *job)
 {
-    pk_backend_job_thread_create (job, pk_backend_get_categories_thread, NULL, NULL);
+    backend_job_thread_create (job, pk_backend_get_categories_thread);
 }
 */
 
@@ -0,0 +1,36 @@
+/* pk-backend-apt.h - State shared by the whole APT backend
+ *
+ * Copyright (c) 2026 The PackageKit Authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+
+class AptCachePool;
+
+/**
+ * Set as the backend user data from pk_backend_initialize() until
+ * pk_backend_destroy()
+ */
+typedef struct {
+    AptCachePool *cachePool;
+    // dpkg and apt run outside of PackageKit too, watch what they write
+    GFileMonitor *statusMonitor;
+    GFileMonitor *listsMonitor;
+} PkBackendAptPrivate;
@@ -0,0 +1,141 @@
+/*
+ * Copyright (c) 2026 The PackageKit Authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Resolves thousands of sonames to library packages, the way dependency
+ * tooling calls WhatProvides, once through the package group hash table
+ * and once with the old scan over all packages per soname.
+ */
+
+#include <glib.h>
+
+#include <string>
+#include <vector>
+
+#include <apt-pkg/cachefile.h>
+#include <apt-pkg/configuration.h>
+#include <apt-pkg/init.h>
+#include <apt-pkg/pkgsystem.h>
+
+#include "apt-utils.h"
+
+#define N_SONAMES       5000
+#define N_LINEAR_SONAMES 50
+
+/* libfoo1 -> libfoo.so.1, libgtk-3-0 -> libgtk-3.so.0 */
+static std::string
+soname_for_package (const std::string &name)
+{
+    size_t version_start = name.find_last_not_of ("0123456789") + 1;
+    if (version_start == 0 || version_start >= name.size ())
+        return std::string ();
+
+    std::string base = name.substr (0, version_start);
+    if (base.back () == '-')
+        base.pop_back ();
+    return base + ".so." + name.substr (version_start);
+}
+
+static guint
+resolve_batch (pkgCache *cache, const std::vector<std::string> &sonames, guint n)
+{
+    guint found = 0;
+
+    for (guint i = 0; i < n; i++) {
+        const std::string name = utilLibraryPackageName (sonames[i]);
+        pkgCache::GrpIterator grp = cache->FindGrp (name);
+        if (grp.end ())
+            continue;
+        for (pkgCache::PkgIterator pkg = grp.PackageList (); !pkg.end (); pkg = grp.NextPkg (pkg)) {
+            if (!pkg.VersionList ().end ())
+                found++;
+        }
+    }
+
+    return found;
+}
+
+/* what AptJob::providesLibrary() used to do */
+static guint
+resolve_linear (pkgCache *cache, const std::vector<std::string> &sonames, guint n)
+{
+    guint found = 0;
+
+    for (guint i = 0; i < n; i++) {
+        const std::string name = utilLibraryPackageName (sonames[i]);
+        for (pkgCache::PkgIterator pkg = cache->PkgBegin (); !pkg.end (); ++pkg) {
+            if (!pkg.VersionList ().end () && name == pkg.Name ())
+                found++;
+        }
+    }
+
+    return found;
+}
+
+int
+main (void)
+{
+    g_autoptr(GTimer) timer = g_timer_new ();
+    std::vector<std::string> sonames;
+    pkgCacheFile cache;
+    pkgCache *pkgs;
+    gdouble batch_ms;
+    gdouble linear_ms;
+    guint found;
+
+    if (!pkgInitConfig (*_config) || !pkgInitSystem (*_config, _system) ||
+            !cache.Open (NULL, false)) {
+        g_print ("No usable APT cache on this system, skipping\n");
+        return 77;
+    }
+    pkgs = cache.GetPkgCache ();
+
+    /* real library packages, mixed with sonames nothing ships */
+    for (pkgCache::GrpIterator grp = pkgs->GrpBegin (); !grp.end () && sonames.size () < N_SONAMES; ++grp) {
+        const std::string soname = soname_for_package (grp.Name ());
+        if (!g_str_has_prefix (grp.Name (), "lib") || soname.empty ())
+            continue;
+        sonames.push_back (soname);
+        sonames.push_back (std::string ("libpk-missing-") + std::to_string (sonames.size ()) + ".so.1");
+    }
+    while (!sonames.empty () && sonames.size () < N_SONAMES)
+        sonames.push_back (sonames[sonames.size () % 97]);
+    if (sonames.size () < N_LINEAR_SONAMES) {
+        g_print ("Too few library packages on this system, skipping\n");
+        return 77;
+    }
+
+    g_timer_start (timer);
+    found = resolve_batch (pkgs, sonames, sonames.size ());
+    batch_ms = g_timer_elapsed (timer, NULL) * 1000;
+    g_print ("hash lookup: %zu sonames in %.3f ms (%.2f us/soname, %u packages)\n",
+             sonames.size (), batch_ms, batch_ms * 1000 / sonames.size (), found);
+
+    g_timer_start (timer);
+    found = resolve_linear (pkgs, sonames, N_LINEAR_SONAMES);
+    linear_ms = g_timer_elapsed (timer, NULL) * 1000;
+    g_print ("linear scan: %d sonames in %.3f ms (%.2f us/soname, %u packages)\n",
+             N_LINEAR_SONAMES, linear_ms, linear_ms * 1000 / N_LINEAR_SONAMES, found);
+
+    if (found != resolve_batch (pkgs, sonames, N_LINEAR_SONAMES)) {
+        g_printerr ("Hash lookup and linear scan disagree\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,155 @@
+/*
+ * Copyright (c) 2026 The PackageKit Authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Compares name and description searches through the search index with
+ * the linear scan over all package records, on the system package cache.
+ */
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <apt-pkg/cachefile.h>
+#include <apt-pkg/configuration.h>
+#include <apt-pkg/depcache.h>
+#include <apt-pkg/init.h>
+#include <apt-pkg/pkgrecords.h>
+#include <apt-pkg/pkgsystem.h>
+
+#include "apt-search-index.h"
+
+static bool
+contains_nocase (const std::string &haystack, const std::string &needle)
+{
+    return std::search (haystack.begin (), haystack.end (),
+                        needle.begin (), needle.end (),
+                        [](unsigned char a, unsigned char b) {
+                            return g_ascii_tolower (a) == g_ascii_tolower (b);
+                        }) != haystack.end ();
+}
+
+/* what AptJob::searchPackageDetails() does without the index */
+static guint
+linear_search (pkgCacheFile &cache, const std::string &query, bool with_description)
+{
+    pkgCache *pkgs = cache.GetPkgCache ();
+    pkgDepCache *dep_cache = cache.GetDepCache ();
+    pkgRecords records (*pkgs);
+    guint matches = 0;
+
+    for (pkgCache::PkgIterator pkg = pkgs->PkgBegin (); !pkg.end (); ++pkg) {
+        if (pkg.VersionList ().end () && pkg.ProvidesList ().end ())
+            continue;
+
+        if (contains_nocase (pkg.Name (), query)) {
+            matches++;
+            continue;
+        }
+        if (!with_description)
+            continue;
+
+        pkgCache::VerIterator ver = pkg.CurrentVer ();
+        if (ver.end ())
+            ver = (*dep_cache)[pkg].CandidateVerIter (*dep_cache);
+        if (ver.end ())
+            ver = pkg.VersionList ();
+        if (ver.end () || ver.FileList ().end ())
+            continue;
+
+        pkgCache::DescIterator d = ver.TranslatedDescription ();
+        if (d.end () || d.FileList ().end ())
+            continue;
+        if (contains_nocase (records.Lookup (d.FileList ()).LongDesc (), query))
+            matches++;
+    }
+
+    return matches;
+}
+
+int
+main (void)
+{
+    const std::vector<std::string> queries = { "xz", "gtk", "python", "editor", "Network Manager" };
+    g_autofree gchar *tmp_dir = NULL;
+    g_autofree gchar *index_path = NULL;
+    g_autoptr(GTimer) timer = g_timer_new ();
+    pkgCacheFile cache;
+    AptSearchIndex index;
+    bool consistent = true;
+
+    if (!pkgInitConfig (*_config) || !pkgInitSystem (*_config, _system) ||
+            !cache.Open (NULL, false)) {
+        g_print ("No usable APT cache on this system, skipping\n");
+        return 77;
+    }
+
+    tmp_dir = g_dir_make_tmp ("pk-apt-search-XXXXXX", NULL);
+    g_assert (tmp_dir != NULL);
+    index_path = g_build_filename (tmp_dir, "search.idx", NULL);
+
+    g_timer_start (timer);
+    if (!AptSearchIndex::build (cache, index_path)) {
+        g_printerr ("Failed to build the search index\n");
+        return 1;
+    }
+    g_print ("index build: %.1f ms\n", g_timer_elapsed (timer, NULL) * 1000);
+
+    g_timer_start (timer);
+    if (!index.open (cache, index_path)) {
+        g_printerr ("Failed to open the search index\n");
+        return 1;
+    }
+    g_print ("index open: %.3f ms\n", g_timer_elapsed (timer, NULL) * 1000);
+
+    for (const std::string &query : queries) {
+        for (bool with_description : { false, true }) {
+            guint linear_matches;
+            size_t index_matches;
+            gdouble linear_ms;
+            gdouble index_ms;
+
+            g_timer_start (timer);
+            linear_matches = linear_search (cache, query, with_description);
+            linear_ms = g_timer_elapsed (timer, NULL) * 1000;
+
+            g_timer_start (timer);
+            index_matches = index.search ({ query }, with_description).size ();
+            index_ms = g_timer_elapsed (timer, NULL) * 1000;
+
+            g_print ("%-8s %-20s linear: %9.3f ms  index: %9.3f ms  (%u/%zu matches)\n",
+                     with_description ? "details" : "name", query.c_str (),
+                     linear_ms, index_ms, linear_matches, index_matches);
+            if (linear_matches != index_matches)
+                consistent = false;
+        }
+    }
+
+    g_unlink (index_path);
+    g_rmdir (tmp_dir);
+
+    if (!consistent) {
+        g_printerr ("Index and linear search disagree\n");
+        return 1;
+    }
+    return 0;
+}
@@ -24,6 +24,7 @@
 
 #include "deb822.h"
 #include "apt-sourceslist.h"
+#include "apt-utils.h"
 #include "gst-matcher.h"
 
 namespace fs = std::filesystem;
@@ -203,6 +204,21 @@ apt_test_gst_matcher_bad_caps (void)
     }
 }
 
+static void
+apt_test_library_package_name (void)
+{
+    g_assert_cmpstr (utilLibraryPackageName ("libz.so.1").c_str (), ==, "libz1");
+    g_assert_cmpstr (utilLibraryPackageName ("libssl.so.3").c_str (), ==, "libssl3");
+    g_assert_cmpstr (utilLibraryPackageName ("libgtk-3.so.0").c_str (), ==, "libgtk-3-0");
+    g_assert_cmpstr (utilLibraryPackageName ("libSDL2-2.0.so.0").c_str (), ==, "libsdl2-2.0-0");
+    g_assert_cmpstr (utilLibraryPackageName ("libfoo.so.").c_str (), ==, "libfoo");
+
+    /* not a library */
+    g_assert_true (utilLibraryPackageName ("bash").empty ());
+    g_assert_true (utilLibraryPackageName ("libfoo.a").empty ());
+    g_assert_true (utilLibraryPackageName ("gstreamer1(decoder-video/x-h265)").empty ());
+}
+
 static void
 apt_test_deb822 (void)
 {
@@ -470,6 +486,7 @@ main (int argc, char **argv)
     g_test_add_func ("/apt/gst-matcher/with-caps", apt_test_gst_matcher_with_caps);
     g_test_add_func ("/apt/gst-matcher/without-caps", apt_test_gst_matcher_without_caps);
     g_test_add_func ("/apt/gst-matcher/bad-caps", apt_test_gst_matcher_bad_caps);
+    g_test_add_func ("/apt/utils/library-package-name", apt_test_library_package_name);
     g_test_add_func ("/apt/deb822/readwrite", apt_test_deb822);
     g_test_add_func ("/apt/sources/read", apt_test_sources_read);
     g_test_add_func ("/apt/sources/write", apt_test_sources_write);
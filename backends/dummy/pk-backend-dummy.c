@@ -891,6 +891,34 @@ pk_backend_search_groups (PkBackend *backend, PkBackendJob *job, PkBitfield filt
 	pk_backend_job_finished (job);
 }
 
+/* emits "stream;<count>" packages one by one, each followed by its files so
+ * that every item is signalled on its own, for the client streaming tests */
+static void
+pk_backend_search_names_stream (PkBackendJob *job, guint count)
+{
+	PkBackendDummyJobData *job_data = pk_backend_job_get_user_data (job);
+
+	for (guint i = 0; i < count; i++) {
+		gchar *files[] = { NULL, NULL };
+		g_autofree gchar *file = NULL;
+		g_autofree gchar *package_id = NULL;
+
+		if (g_cancellable_is_cancelled (job_data->cancellable)) {
+			pk_backend_job_error_code (job,
+						   PK_ERROR_ENUM_TRANSACTION_CANCELLED,
+						   "The task was stopped successfully");
+			return;
+		}
+		package_id = g_strdup_printf ("stream%u;0.1;noarch;fedora", i);
+		pk_backend_job_package (job, PK_INFO_ENUM_AVAILABLE,
+					package_id, "Streamed package");
+		file = g_strdup_printf ("/usr/share/stream/%u", i);
+		files[0] = file;
+		pk_backend_job_files (job, package_id, files);
+		g_usleep (5000);
+	}
+}
+
 static void
 pk_backend_search_names_thread (PkBackendJob *job, GVariant *params, gpointer user_data)
 {
@@ -911,6 +939,12 @@ pk_backend_search_names_thread (PkBackendJob *job, GVariant *params, gpointer us
 			       &search);
 	}
 
+	/* results that arrive over time, as many as asked for */
+	if (search != NULL && g_str_has_prefix (search[0], "stream;")) {
+		pk_backend_search_names_stream (job, atoi (search[0] + 7));
+		return;
+	}
+
 	/* delay, checking cancelled */
 	for (i = 0; i < 1000; i++) {
 		if (g_cancellable_is_cancelled (job_data->cancellable)) {
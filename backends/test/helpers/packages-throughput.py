@@ -0,0 +1,43 @@
+#!/usr/bin/env python3
+#
+# Licensed under the GNU General Public License Version 2
+#
+# This program is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation; either version 2 of the License, or
+# (at your option) any later version.
+#
+# Emits lots of packages so the text and binary spawn protocols can be
+# compared, e.g. packages-throughput.py binary 20000 get-packages none
+
+import os
+import sys
+
+from packagekit.backend import PackageKitBaseBackend, get_package_id
+from packagekit.enums import INFO_AVAILABLE
+
+class PackagesThroughputBackend(PackageKitBaseBackend):
+
+    def __init__(self, args):
+        PackageKitBaseBackend.__init__(self, args)
+        self.count = 0
+
+    def dispatch_command(self, cmd, args):
+        # every command is prefixed with the protocol and package count
+        self.count = int(args[0])
+        PackageKitBaseBackend.dispatch_command(self, args[1], args[2:])
+
+    def get_packages(self, filters):
+        for i in range(self.count):
+            package_id = get_package_id('package%i' % i, '1.0.%i' % i, 'x86_64', 'test')
+            self.package(package_id, INFO_AVAILABLE, 'Test package number %i' % i)
+
+def main():
+    # the daemon always asks for frames, so drop that to measure text
+    if sys.argv[1] == 'text':
+        os.environ.pop('FRAMING', None)
+    backend = PackagesThroughputBackend('')
+    backend.dispatcher(sys.argv[1:])
+
+if __name__ == "__main__":
+    main()
@@ -33,8 +33,10 @@
 
 #include <gio/gio.h>
 #include <glib-object.h>
+#include <gio/gunixfdlist.h>
 #include <locale.h>
 #include <stdlib.h>
+#include <unistd.h>
 
 #include <packagekit-glib2/pk-client.h>
 #include <packagekit-glib2/pk-client-helper.h>
@@ -44,12 +46,21 @@
 #include <packagekit-glib2/pk-enum.h>
 #include <packagekit-glib2/pk-package-id.h>
 #include <packagekit-glib2/pk-package-ids.h>
+#include <packagekit-glib2/pk-packages-fd-private.h>
 #include <packagekit-glib2/pk-progress-private.h>
+#include <packagekit-glib2/pk-results-private.h>
 
 static void     pk_client_finalize	(GObject     *object);
 
 #define PK_CLIENT_DBUS_METHOD_TIMEOUT	G_MAXINT /* ms */
 
+/* shared with every transaction started while it was set */
+typedef struct {
+	PkClientStreamCallback		 callback;
+	gpointer			 user_data;
+	GDestroyNotify			 destroy_func;
+} PkClientStream;
+
 /**
  * PkClientPrivate:
  *
@@ -66,6 +77,7 @@ struct _PkClientPrivate
 	gboolean		 idle;
 	gboolean		 details_with_deps_size;
 	guint			 cache_age;
+	PkClientStream		*stream;
 };
 
 enum {
@@ -173,13 +185,53 @@ struct _PkClientState
 	gint				 remaining_files_to_copy;
 	PkClientHelper			*client_helper;
 	gboolean			 waiting_for_finished;
+	GDBusConnection			*packages_fd_connection;
+	guint				 packages_fd_filter_id;
+	GAsyncQueue			*packages_fds;
+	PkClientStream			*stream;
+	PkResults			*stream_batch;
+	guint				 stream_batch_len;
+	guint				 stream_idle_id;
+	gboolean			 stream_paused;
+	gboolean			 stream_stopped;
 };
 
+/* the file descriptors passed with PackagesFd, which GDBusProxy drops */
+typedef struct {
+	gchar				*object_path;
+	GAsyncQueue			*fds;
+} PkClientPackagesFdFilter;
+
 G_DEFINE_TYPE (PkClientState, pk_client_state, G_TYPE_OBJECT)
 
+static void
+pk_client_stream_clear (PkClientStream *stream)
+{
+	if (stream->destroy_func != NULL)
+		stream->destroy_func (stream->user_data);
+}
+
+static void
+pk_client_stream_release (PkClientStream *stream)
+{
+	g_rc_box_release_full (stream, (GDestroyNotify) pk_client_stream_clear);
+}
+
+static void
+pk_client_state_remove_packages_fd_filter (PkClientState *state)
+{
+	if (state->packages_fd_filter_id == 0)
+		return;
+	g_dbus_connection_remove_filter (state->packages_fd_connection,
+					 state->packages_fd_filter_id);
+	state->packages_fd_filter_id = 0;
+	g_clear_object (&state->packages_fd_connection);
+}
+
 static void
 pk_client_state_unset_proxy (PkClientState *state)
 {
+	pk_client_state_remove_packages_fd_filter (state);
 	if (state->proxy != NULL) {
 		g_signal_handlers_disconnect_by_func (state->proxy,
 						      G_CALLBACK (pk_client_properties_changed_cb),
@@ -266,6 +318,7 @@ pk_client_state_dispose (GObject *object)
 	}
 	g_clear_object (&state->cancellable);
 	g_clear_object (&state->cancellable_client);
+	g_clear_handle_id (&state->stream_idle_id, g_source_remove);
 
 	G_OBJECT_CLASS (pk_client_state_parent_class)->dispose (object);
 }
@@ -288,6 +341,11 @@ pk_client_state_finalize (GObject *object)
 	g_free (state->transaction_id);
 	g_strfreev (state->files);
 	g_strfreev (state->package_ids);
+	pk_client_state_remove_packages_fd_filter (state);
+	if (state->packages_fds != NULL)
+		g_async_queue_unref (state->packages_fds);
+	g_clear_pointer (&state->stream, pk_client_stream_release);
+	g_clear_object (&state->stream_batch);
 	/* results will not exist if the CreateTransaction fails */
 	g_clear_object (&state->results);
 	g_clear_object (&state->progress);
@@ -339,19 +397,8 @@ pk_client_cancel_cb (GObject *source_object,
 }
 
 static void
-pk_client_cancellable_cancel_cb (GCancellable *cancellable,
-				 gpointer user_data)
+pk_client_state_cancel (PkClientState *state)
 {
-	GWeakRef *weak_ref = user_data;
-	g_autoptr(PkClientState) state = NULL;
-
-	state = g_weak_ref_get (weak_ref);
-
-	if (state == NULL) {
-		g_debug ("Cancelled, but the operation is already over");
-		return;
-	}
-
 	/* D-Bus method has not yet fired. This can happen, for example, when
 	 * pk_client_state_new() is called with a #GCancellable which has
 	 * already been cancelled. */
@@ -375,6 +422,22 @@ pk_client_cancellable_cancel_cb (GCancellable *cancellable,
 			   pk_client_cancel_cb, pk_client_weak_ref_new (state));
 }
 
+static void
+pk_client_cancellable_cancel_cb (GCancellable *cancellable,
+				 gpointer user_data)
+{
+	GWeakRef *weak_ref = user_data;
+	g_autoptr(PkClientState) state = NULL;
+
+	state = g_weak_ref_get (weak_ref);
+
+	if (state == NULL) {
+		g_debug ("Cancelled, but the operation is already over");
+		return;
+	}
+	pk_client_state_cancel (state);
+}
+
 static PkClientState *
 pk_client_state_new (PkClient *client,
 		     GAsyncReadyCallback callback_ready,
@@ -383,6 +446,7 @@ pk_client_state_new (PkClient *client,
 		     PkRoleEnum role,
 		     GCancellable *cancellable)
 {
+	PkClientPrivate *priv;
 	PkClientState *state;
 
 	state = g_object_new (PK_TYPE_CLIENT_STATE, NULL);
@@ -391,6 +455,9 @@ pk_client_state_new (PkClient *client,
 	state->res = g_task_new (client, state->cancellable, callback_ready, user_data);
 	state->client = g_object_ref (client);
 	g_task_set_source_tag (state->res, source_tag);
+	priv = pk_client_get_instance_private (client);
+	if (priv->stream != NULL)
+		state->stream = g_rc_box_acquire (priv->stream);
 
 	if (cancellable != NULL) {
 		state->cancellable_client = g_object_ref (cancellable);
@@ -819,6 +886,130 @@ pk_client_properties_changed_cb (GDBusProxy *proxy,
 	}
 }
 
+/*
+ * pk_client_state_stream_batch:
+ *
+ * Gets the results the next batch for the stream callback is collected in,
+ * or %NULL if the transaction is not being streamed. The caller has to add
+ * exactly one item to the returned results.
+ */
+static PkResults *
+pk_client_state_stream_batch (PkClientState *state)
+{
+	if (state->stream == NULL || state->stream_stopped)
+		return NULL;
+	if (state->stream_batch == NULL) {
+		state->stream_batch = pk_results_new ();
+		g_object_set (state->stream_batch,
+			      "role", state->role,
+			      "progress", state->progress,
+			      "transaction-flags", state->transaction_flags,
+			      NULL);
+	}
+	state->stream_batch_len++;
+	return state->stream_batch;
+}
+
+static void
+pk_client_set_signals_paused_cb (GObject *source_object,
+				 GAsyncResult *res,
+				 gpointer user_data)
+{
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GVariant) value = NULL;
+
+	/* an older daemon cannot pause, so the batches just queue up here */
+	value = g_dbus_proxy_call_finish (G_DBUS_PROXY (source_object), res, &error);
+	if (value == NULL)
+		g_debug ("failed to set signals paused: %s", error->message);
+}
+
+/*
+ * pk_client_state_stream_set_paused:
+ */
+static void
+pk_client_state_stream_set_paused (PkClientState *state, gboolean paused)
+{
+	state->stream_paused = paused;
+	if (state->proxy == NULL)
+		return;
+	g_dbus_proxy_call (state->proxy, "SetSignalsPaused",
+			   g_variant_new ("(b)", paused),
+			   G_DBUS_CALL_FLAGS_NONE,
+			   PK_CLIENT_DBUS_METHOD_TIMEOUT,
+			   NULL,
+			   pk_client_set_signals_paused_cb, NULL);
+}
+
+/*
+ * pk_client_state_stream_dispatch:
+ * @finished: if this is the last batch, when the action is ignored
+ *
+ * Hands the collected batch to the stream callback and acts on the answer.
+ */
+static void
+pk_client_state_stream_dispatch (PkClientState *state, gboolean finished)
+{
+	PkClientStreamAction action;
+	g_autoptr(PkResults) batch = NULL;
+
+	if (state->stream_batch_len == 0 || state->stream_stopped)
+		return;
+	if (state->stream_paused && !finished)
+		return;
+
+	batch = g_steal_pointer (&state->stream_batch);
+	state->stream_batch_len = 0;
+	action = state->stream->callback (state->client, batch, state->stream->user_data);
+	if (finished)
+		return;
+
+	switch (action) {
+	case PK_CLIENT_STREAM_ACTION_PAUSE:
+		g_debug ("pausing %s", state->tid);
+		pk_client_state_stream_set_paused (state, TRUE);
+		break;
+	case PK_CLIENT_STREAM_ACTION_STOP:
+		state->stream_stopped = TRUE;
+		pk_client_state_cancel (state);
+		break;
+	default:
+		break;
+	}
+}
+
+static gboolean
+pk_client_state_stream_idle_cb (gpointer user_data)
+{
+	GWeakRef *weak_ref = user_data;
+	g_autoptr(PkClientState) state = g_weak_ref_get (weak_ref);
+
+	if (state == NULL)
+		return G_SOURCE_REMOVE;
+	state->stream_idle_id = 0;
+	pk_client_state_stream_dispatch (state, FALSE);
+	return G_SOURCE_REMOVE;
+}
+
+/*
+ * pk_client_state_stream_schedule:
+ *
+ * The idle runs after the D-Bus signals that are already queued, so
+ * everything that arrived in one go is delivered as one batch.
+ */
+static void
+pk_client_state_stream_schedule (PkClientState *state)
+{
+	if (state->stream_batch_len == 0 ||
+	    state->stream_paused ||
+	    state->stream_idle_id != 0)
+		return;
+	state->stream_idle_id = g_idle_add_full (G_PRIORITY_DEFAULT_IDLE,
+						 pk_client_state_stream_idle_cb,
+						 pk_client_weak_ref_new (state),
+						 pk_client_weak_ref_free);
+}
+
 /*
  * pk_client_signal_package:
  */
@@ -829,26 +1020,24 @@ pk_client_signal_package (PkClientState *state,
 			  const gchar *package_id,
 			  const gchar *summary)
 {
+	PkResults *batch;
 	g_autoptr(GError) error = NULL;
 	g_autoptr(PkPackage) package = NULL;
 
-	/* create virtual package */
-	package = pk_package_new ();
-	if (!pk_package_set_id (package, package_id, &error)) {
+	/* add to results, which only creates an object when asked for one */
+	if (state->results != NULL && info_enum != PK_INFO_ENUM_FINISHED &&
+	    !pk_results_add_package_row (state->results, info_enum, update_severity,
+					 package_id, summary, FALSE,
+					 state->transaction_id)) {
 		g_warning ("failed to set package id for %s", package_id);
 		return;
 	}
-	g_object_set (package,
-		      "info", info_enum,
-		      "summary", summary,
-		      "update-severity", update_severity,
-		      "role", state->role,
-		      "transaction-id", state->transaction_id,
-		      NULL);
-
-	/* add to results */
-	if (state->results != NULL && info_enum != PK_INFO_ENUM_FINISHED)
-		pk_results_add_package (state->results, package);
+	if (info_enum != PK_INFO_ENUM_FINISHED &&
+	    (batch = pk_client_state_stream_batch (state)) != NULL) {
+		pk_results_add_package_row (batch, info_enum, update_severity,
+					    package_id, summary, FALSE,
+					    state->transaction_id);
+	}
 
 	/* only emit progress for verb packages */
 	switch (info_enum) {
@@ -863,6 +1052,18 @@ pk_client_signal_package (PkClientState *state,
 	case PK_INFO_ENUM_PREPARING:
 	case PK_INFO_ENUM_DECOMPRESSING:
 	case PK_INFO_ENUM_FINISHED:
+		package = pk_package_new ();
+		if (!pk_package_set_id (package, package_id, &error)) {
+			g_warning ("failed to set package id for %s", package_id);
+			return;
+		}
+		g_object_set (package,
+			      "info", info_enum,
+			      "summary", summary,
+			      "update-severity", update_severity,
+			      "role", state->role,
+			      "transaction-id", state->transaction_id,
+			      NULL);
 		pk_progress_set_package_id (state->progress, package_id);
 		pk_progress_set_package (state->progress, package);
 		break;
@@ -1058,6 +1259,9 @@ pk_client_signal_finished (PkClientState *state,
 	g_autoptr(GError) error = NULL;
 	g_autoptr(PkError) error_code = NULL;
 
+	/* the stream callback gets everything before the transaction completes */
+	pk_client_state_stream_dispatch (state, TRUE);
+
 	/* yay */
 	pk_results_set_exit_code (state->results, exit_enum);
 
@@ -1148,6 +1352,47 @@ results_add_update_detail_from_variant (PkResults   *results,
 	pk_results_add_update_detail (results, item);
 }
 
+static PkDetails *
+details_from_variant (GVariant *details_variant)
+{
+	const gchar *key;
+	GVariantIter iter;
+	GVariant *value;
+	PkDetails *item = pk_details_new ();
+
+	g_variant_iter_init (&iter, details_variant);
+	while (g_variant_iter_loop (&iter, "{&sv}", &key, &value)) {
+		if (g_strcmp0 (key, "group") == 0)
+			g_object_set (item, "group", g_variant_get_uint32 (value), NULL);
+		else if (g_strcmp0 (key, "size") == 0)
+			g_object_set (item, "size", g_variant_get_uint64 (value), NULL);
+		else if (g_strcmp0 (key, "download-size") == 0)
+			g_object_set (item, "download-size", g_variant_get_uint64 (value), NULL);
+		else
+			g_object_set (item, key, g_variant_get_string (value, NULL), NULL);
+	}
+	return item;
+}
+
+static PkFiles *
+files_from_variant (GVariant    *files_variant,
+                    PkRoleEnum   role,
+                    const gchar *transaction_id)
+{
+	const gchar *package_id;
+	g_autofree gchar **files = NULL;
+	PkFiles *item = pk_files_new ();
+
+	g_variant_get (files_variant, "(&s^a&s)", &package_id, &files);
+	g_object_set (item,
+		      "package-id", package_id,
+		      "files", files,
+		      "role", role,
+		      "transaction-id", transaction_id,
+		      NULL);
+	return item;
+}
+
 /*
  * pk_client_signal_cb:
  **/
@@ -1160,6 +1405,7 @@ pk_client_signal_cb (GDBusProxy *proxy,
 {
 	GWeakRef *weak_ref = user_data;
 	g_autoptr(PkClientState) state = g_weak_ref_get (weak_ref);
+	PkResults *batch;
 	gchar *tmp_str[12];
 	gboolean tmp_bool;
 	guint tmp_uint;
@@ -1193,6 +1439,7 @@ pk_client_signal_cb (GDBusProxy *proxy,
 					  tmp_uint3,
 					  tmp_str[1],
 					  tmp_str[2]);
+		pk_client_state_stream_schedule (state);
 		return;
 	}
 	if (g_strcmp0 (signal_name, "Packages") == 0) {
@@ -1216,31 +1463,50 @@ pk_client_signal_cb (GDBusProxy *proxy,
 						  package_id,
 						  summary);
 		}
+		pk_client_state_stream_schedule (state);
+
+		return;
+	}
+	if (g_strcmp0 (signal_name, "PackagesFd") == 0) {
+		gpointer fd_ptr = NULL;
+		gint fd;
+		g_autoptr(GBytes) blob = NULL;
+		g_autoptr(GError) error_local = NULL;
+
+		/* the filter saw this message first and kept the fd */
+		if (state->packages_fds != NULL)
+			fd_ptr = g_async_queue_try_pop (state->packages_fds);
+		if (fd_ptr == NULL) {
+			g_warning ("no file descriptor for PackagesFd");
+			return;
+		}
+		fd = GPOINTER_TO_INT (fd_ptr) - 1;
+		blob = pk_packages_fd_map (fd, &error_local);
+		close (fd);
+		if (blob == NULL) {
+			g_warning ("failed to map packages: %s", error_local->message);
+			return;
+		}
 
+		/* the packages are only parsed when asked for */
+		if (state->results != NULL)
+			pk_results_add_package_blob (state->results, blob, state->transaction_id);
+		batch = pk_client_state_stream_batch (state);
+		if (batch != NULL) {
+			pk_results_add_package_blob (batch, blob, state->transaction_id);
+			pk_client_state_stream_schedule (state);
+		}
 		return;
 	}
 	if (g_strcmp0 (signal_name, "Details") == 0) {
-		gchar *key;
-		GVariantIter *dictionary;
-		GVariant *value;
 		g_autoptr(PkDetails) item = NULL;
-		item = pk_details_new ();
 
 		if (g_variant_is_of_type (parameters, G_VARIANT_TYPE ("(a{sv})"))) {
-			g_variant_get_child (parameters, 0, "a{sv}", &dictionary);
-			while (g_variant_iter_loop (dictionary, "{sv}", &key, &value)) {
-				if (g_strcmp0 (key, "group") == 0)
-					g_object_set (item, "group", g_variant_get_uint32 (value), NULL);
-				else if (g_strcmp0 (key, "size") == 0)
-					g_object_set (item, "size", g_variant_get_uint64 (value), NULL);
-				else if (g_strcmp0 (key, "download-size") == 0)
-					g_object_set (item, "download-size", g_variant_get_uint64 (value), NULL);
-				else
-					g_object_set (item, key, g_variant_get_string (value, NULL), NULL);
-			}
-			g_variant_iter_free (dictionary);
+			g_autoptr(GVariant) dictionary = g_variant_get_child_value (parameters, 0);
+			item = details_from_variant (dictionary);
 		} else {
 			guint64 tmp_uint64;
+			item = pk_details_new ();
 			g_variant_get (parameters,
 				       "(&s&su&s&st)",
 				       &tmp_str[0],
@@ -1261,11 +1527,39 @@ pk_client_signal_cb (GDBusProxy *proxy,
 				      NULL);
 		}
 		pk_results_add_details (state->results, item);
+		batch = pk_client_state_stream_batch (state);
+		if (batch != NULL) {
+			pk_results_add_details (batch, item);
+			pk_client_state_stream_schedule (state);
+		}
+		return;
+	}
+	if (g_strcmp0 (signal_name, "DetailsList") == 0) {
+		g_autoptr(GVariant) details = g_variant_get_child_value (parameters, 0);
+		GVariantIter iter;
+		GVariant *child;
+
+		g_variant_iter_init (&iter, details);
+		while ((child = g_variant_iter_next_value (&iter)) != NULL) {
+			g_autoptr(PkDetails) item = details_from_variant (child);
+			pk_results_add_details (state->results, item);
+			batch = pk_client_state_stream_batch (state);
+			if (batch != NULL)
+				pk_results_add_details (batch, item);
+			g_variant_unref (child);
+		}
+		pk_client_state_stream_schedule (state);
 		return;
 	}
 	if (g_strcmp0 (signal_name, "UpdateDetail") == 0) {
 		results_add_update_detail_from_variant (state->results, parameters,
 							state->role, state->transaction_id);
+		batch = pk_client_state_stream_batch (state);
+		if (batch != NULL) {
+			results_add_update_detail_from_variant (batch, parameters,
+								state->role, state->transaction_id);
+			pk_client_state_stream_schedule (state);
+		}
 		return;
 	}
 	if (g_strcmp0 (signal_name, "UpdateDetails") == 0) {
@@ -1277,8 +1571,14 @@ pk_client_signal_cb (GDBusProxy *proxy,
 		while ((update_detail = g_variant_iter_next_value (iter))) {
 			results_add_update_detail_from_variant (state->results, update_detail,
 								state->role, state->transaction_id);
+			batch = pk_client_state_stream_batch (state);
+			if (batch != NULL) {
+				results_add_update_detail_from_variant (batch, update_detail,
+									state->role, state->transaction_id);
+			}
 			g_clear_pointer (&update_detail, g_variant_unref);
 		}
+		pk_client_state_stream_schedule (state);
 
 		return;
 	}
@@ -1367,20 +1667,31 @@ pk_client_signal_cb (GDBusProxy *proxy,
 		return;
 	}
 	if (g_strcmp0 (signal_name, "Files") == 0) {
-		g_autofree gchar **files = NULL;
 		g_autoptr(PkFiles) item = NULL;
-		g_variant_get (parameters,
-			       "(&s^a&s)",
-			       &tmp_str[0],
-			       &files);
-		item = pk_files_new ();
-		g_object_set (item,
-			      "package-id", tmp_str[0],
-			      "files", files,
-			      "role", state->role,
-			      "transaction-id", state->transaction_id,
-			      NULL);
+		item = files_from_variant (parameters, state->role, state->transaction_id);
 		pk_results_add_files (state->results, item);
+		batch = pk_client_state_stream_batch (state);
+		if (batch != NULL) {
+			pk_results_add_files (batch, item);
+			pk_client_state_stream_schedule (state);
+		}
+		return;
+	}
+	if (g_strcmp0 (signal_name, "FilesList") == 0) {
+		g_autoptr(GVariant) files = g_variant_get_child_value (parameters, 0);
+		GVariantIter iter;
+		GVariant *child;
+
+		g_variant_iter_init (&iter, files);
+		while ((child = g_variant_iter_next_value (&iter)) != NULL) {
+			g_autoptr(PkFiles) item = files_from_variant (child, state->role, state->transaction_id);
+			pk_results_add_files (state->results, item);
+			batch = pk_client_state_stream_batch (state);
+			if (batch != NULL)
+				pk_results_add_files (batch, item);
+			g_variant_unref (child);
+		}
+		pk_client_state_stream_schedule (state);
 		return;
 	}
 	if (g_strcmp0 (signal_name, "RepoSignatureRequired") == 0) {
@@ -2158,6 +2469,80 @@ pk_client_create_helper_socket (PkClientState *state)
 	return g_strdup_printf ("frontend-socket=%s", socket_filename);
 }
 
+static void
+pk_client_packages_fd_close (gpointer data)
+{
+	close (GPOINTER_TO_INT (data) - 1);
+}
+
+static void
+pk_client_packages_fd_filter_free (gpointer user_data)
+{
+	PkClientPackagesFdFilter *filter = user_data;
+	g_free (filter->object_path);
+	g_async_queue_unref (filter->fds);
+	g_free (filter);
+}
+
+/*
+ * pk_client_packages_fd_filter_cb:
+ *
+ * Runs in the GDBus worker thread, before the signal is dispatched.
+ **/
+static GDBusMessage *
+pk_client_packages_fd_filter_cb (GDBusConnection *connection,
+				 GDBusMessage *message,
+				 gboolean incoming,
+				 gpointer user_data)
+{
+	PkClientPackagesFdFilter *filter = user_data;
+	GUnixFDList *fd_list;
+	gint fd;
+
+	if (!incoming ||
+	    g_dbus_message_get_message_type (message) != G_DBUS_MESSAGE_TYPE_SIGNAL ||
+	    g_strcmp0 (g_dbus_message_get_member (message), "PackagesFd") != 0 ||
+	    g_strcmp0 (g_dbus_message_get_interface (message), PK_DBUS_INTERFACE_TRANSACTION) != 0 ||
+	    g_strcmp0 (g_dbus_message_get_path (message), filter->object_path) != 0)
+		return message;
+
+	fd_list = g_dbus_message_get_unix_fd_list (message);
+	if (fd_list == NULL || g_unix_fd_list_get_length (fd_list) < 1)
+		return message;
+	fd = g_unix_fd_list_get (fd_list, 0, NULL);
+	if (fd >= 0)
+		g_async_queue_push (filter->fds, GINT_TO_POINTER (fd + 1));
+	return message;
+}
+
+/*
+ * pk_client_packages_fd_setup:
+ *
+ * Returns: %TRUE if packages can be received as a file descriptor
+ **/
+static gboolean
+pk_client_packages_fd_setup (PkClientState *state)
+{
+	GDBusConnection *connection = g_dbus_proxy_get_connection (state->proxy);
+	PkClientPackagesFdFilter *filter;
+
+	if ((g_dbus_connection_get_capabilities (connection) &
+	     G_DBUS_CAPABILITY_FLAGS_UNIX_FD_PASSING) == 0)
+		return FALSE;
+
+	state->packages_fds = g_async_queue_new_full (pk_client_packages_fd_close);
+	filter = g_new0 (PkClientPackagesFdFilter, 1);
+	filter->object_path = g_strdup (state->tid);
+	filter->fds = g_async_queue_ref (state->packages_fds);
+	state->packages_fd_connection = g_object_ref (connection);
+	state->packages_fd_filter_id =
+		g_dbus_connection_add_filter (connection,
+					      pk_client_packages_fd_filter_cb,
+					      filter,
+					      pk_client_packages_fd_filter_free);
+	return TRUE;
+}
+
 /*
  * pk_client_get_proxy_cb:
  **/
@@ -2210,6 +2595,11 @@ pk_client_get_proxy_cb (GObject *object,
 
 	/* Always set the supports-plural-signals hint to get higher performance signals */
 	g_ptr_array_add (array, g_strdup ("supports-plural-signals=true"));
+	g_ptr_array_add (array, g_strdup ("supports-list-signals=true"));
+
+	/* large package lists can then skip the bus daemon entirely */
+	if (pk_client_packages_fd_setup (state))
+		g_ptr_array_add (array, g_strdup ("supports-packages-fd=true"));
 
 	/* create socket for roles that need interaction */
 	if (state->role == PK_ROLE_ENUM_INSTALL_FILES ||
@@ -4572,6 +4962,86 @@ pk_client_get_details_with_deps_size (PkClient *client)
 	return priv->details_with_deps_size;
 }
 
+/**
+ * pk_client_set_stream_callback:
+ * @client: a valid #PkClient instance
+ * @callback: (nullable) (scope notified): the function to hand each batch of results to, or %NULL
+ * @user_data: data to pass to @callback
+ * @destroy_func: (nullable): the function to free @user_data with, or %NULL
+ *
+ * Sets a function that is given the packages, files, details and update
+ * details of a transaction in batches as they arrive, rather than only in
+ * the #PkResults once the transaction has finished. This applies to the
+ * transactions started with @client after this has been called.
+ *
+ * Each batch only holds the results that arrived since the previous batch,
+ * and the last batch is always delivered before the transaction completes.
+ * The transaction ID of a batch can be found using pk_results_get_progress().
+ *
+ * Returning %PK_CLIENT_STREAM_ACTION_PAUSE asks the daemon to hold back
+ * results until pk_client_resume_stream() is called. Returning
+ * %PK_CLIENT_STREAM_ACTION_STOP cancels the transaction, which then
+ * completes with the results that were received so far.
+ *
+ * Since: 1.3.2
+ **/
+void
+pk_client_set_stream_callback (PkClient *client,
+			       PkClientStreamCallback callback,
+			       gpointer user_data,
+			       GDestroyNotify destroy_func)
+{
+	PkClientPrivate *priv = pk_client_get_instance_private (client);
+
+	g_return_if_fail (PK_IS_CLIENT (client));
+
+	g_clear_pointer (&priv->stream, pk_client_stream_release);
+	if (callback == NULL) {
+		if (destroy_func != NULL)
+			destroy_func (user_data);
+		return;
+	}
+	priv->stream = g_rc_box_new0 (PkClientStream);
+	priv->stream->callback = callback;
+	priv->stream->user_data = user_data;
+	priv->stream->destroy_func = destroy_func;
+}
+
+/**
+ * pk_client_resume_stream:
+ * @client: a valid #PkClient instance
+ * @transaction_id: a transaction ID such as "/21_ebcbdaae_data"
+ *
+ * Resumes a transaction that was paused by returning
+ * %PK_CLIENT_STREAM_ACTION_PAUSE from the #PkClientStreamCallback.
+ *
+ * Return value: %TRUE if the transaction was paused
+ *
+ * Since: 1.3.2
+ **/
+gboolean
+pk_client_resume_stream (PkClient *client, const gchar *transaction_id)
+{
+	PkClientPrivate *priv = pk_client_get_instance_private (client);
+
+	g_return_val_if_fail (PK_IS_CLIENT (client), FALSE);
+	g_return_val_if_fail (transaction_id != NULL, FALSE);
+
+	for (guint i = 0; i < priv->calls->len; i++) {
+		PkClientState *state = g_ptr_array_index (priv->calls, i);
+
+		if (g_strcmp0 (state->tid, transaction_id) != 0)
+			continue;
+		if (!state->stream_paused)
+			return FALSE;
+		g_debug ("resuming %s", state->tid);
+		pk_client_state_stream_set_paused (state, FALSE);
+		pk_client_state_stream_schedule (state);
+		return TRUE;
+	}
+	return FALSE;
+}
+
 /*
  * pk_client_class_init:
  **/
@@ -4690,6 +5160,7 @@ pk_client_finalize (GObject *object)
 	g_clear_pointer (&priv->locale, g_free);
 	g_clear_object (&priv->control);
 	g_clear_pointer (&priv->calls, g_ptr_array_unref);
+	g_clear_pointer (&priv->stream, pk_client_stream_release);
 
 	G_OBJECT_CLASS (pk_client_parent_class)->finalize (object);
 }
@@ -79,6 +79,25 @@ typedef enum
 	PK_CLIENT_ERROR_LAST
 } PkClientError;
 
+/**
+ * PkClientStreamAction:
+ * @PK_CLIENT_STREAM_ACTION_CONTINUE: keep delivering batches of results
+ * @PK_CLIENT_STREAM_ACTION_PAUSE: hold back results until pk_client_resume_stream() is called
+ * @PK_CLIENT_STREAM_ACTION_STOP: cancel the transaction and deliver no more batches
+ * @PK_CLIENT_STREAM_ACTION_LAST:
+ *
+ * What should happen after a #PkClientStreamCallback has been given a batch.
+ *
+ * Since: 1.3.2
+ */
+typedef enum
+{
+	PK_CLIENT_STREAM_ACTION_CONTINUE,
+	PK_CLIENT_STREAM_ACTION_PAUSE,
+	PK_CLIENT_STREAM_ACTION_STOP,
+	PK_CLIENT_STREAM_ACTION_LAST
+} PkClientStreamAction;
+
 typedef struct _PkClientPrivate		PkClientPrivate;
 typedef struct _PkClient		PkClient;
 typedef struct _PkClientClass		PkClientClass;
@@ -93,6 +112,22 @@ struct _PkClient
 	 PkClientPrivate	*priv;
 };
 
+/**
+ * PkClientStreamCallback:
+ * @client: the #PkClient
+ * @batch: the results that arrived since the previous batch
+ * @user_data: User data supplied when the callback was registered.
+ *
+ * Function that is given the results of a transaction as they arrive.
+ *
+ * Return value: what should happen next, e.g. %PK_CLIENT_STREAM_ACTION_CONTINUE
+ *
+ * Since: 1.3.2
+ */
+typedef PkClientStreamAction (*PkClientStreamCallback)	(PkClient		*client,
+							 PkResults		*batch,
+							 gpointer		 user_data);
+
 struct _PkClientClass
 {
 	GObjectClass	parent_class;
@@ -434,6 +469,12 @@ guint		 pk_client_get_cache_age		(PkClient		*client);
 void		 pk_client_set_details_with_deps_size	(PkClient		*client,
 							 gboolean		 details_with_deps_size);
 gboolean	 pk_client_get_details_with_deps_size	(PkClient		*client);
+void		 pk_client_set_stream_callback		(PkClient		*client,
+							 PkClientStreamCallback	 callback,
+							 gpointer		 user_data,
+							 GDestroyNotify		 destroy_func);
+gboolean	 pk_client_resume_stream		(PkClient		*client,
+							 const gchar		*transaction_id);
 
 G_END_DECLS
 
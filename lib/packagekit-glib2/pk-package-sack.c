@@ -52,6 +52,9 @@ static void     pk_package_sack_finalize	(GObject     *object);
 struct _PkPackageSackPrivate
 {
 	GHashTable		*table;
+	GHashTable		*name_table;
+	GHashTable		*name_arch_table;
+	GHashTable		*positions;	/* PkPackage : first index in array */
 	GPtrArray		*array;
 	PkClient		*client;
 };
@@ -63,6 +66,166 @@ enum {
 
 G_DEFINE_TYPE (PkPackageSack, pk_package_sack, G_TYPE_OBJECT)
 
+/*
+ * pk_package_sack_name_arch_key:
+ *
+ * The key used for the name+arch index, e.g. "hal;i386"
+ **/
+static gchar *
+pk_package_sack_name_arch_key (const gchar *name, const gchar *arch)
+{
+	return g_strdup_printf ("%s;%s", name, arch != NULL ? arch : "");
+}
+
+/*
+ * pk_package_sack_index_bucket_add:
+ *
+ * The buckets do not own the packages and keep them in array order, so the
+ * first entry is always the first match a linear scan would have found.
+ **/
+static void
+pk_package_sack_index_bucket_add (GHashTable *index, gchar *key, PkPackage *package)
+{
+	GPtrArray *bucket;
+
+	bucket = g_hash_table_lookup (index, key);
+	if (bucket == NULL) {
+		bucket = g_ptr_array_new ();
+		g_hash_table_insert (index, key, bucket);
+	} else {
+		g_free (key);
+	}
+	g_ptr_array_add (bucket, package);
+}
+
+/*
+ * pk_package_sack_index_bucket_remove:
+ **/
+static void
+pk_package_sack_index_bucket_remove (GHashTable *index, const gchar *key, PkPackage *package)
+{
+	GPtrArray *bucket;
+
+	bucket = g_hash_table_lookup (index, key);
+	if (bucket == NULL)
+		return;
+	g_ptr_array_remove (bucket, package);
+	if (bucket->len == 0)
+		g_hash_table_remove (index, key);
+}
+
+/*
+ * pk_package_sack_index_add:
+ *
+ * Adds the package to the id, name and name+arch indexes.
+ **/
+static void
+pk_package_sack_index_add (PkPackageSack *sack, PkPackage *package)
+{
+	PkPackageSackPrivate *priv = sack->priv;
+	const gchar *name = pk_package_get_name (package);
+
+	g_hash_table_insert (priv->table,
+			     (gpointer) pk_package_get_id (package),
+			     (gpointer) package);
+	if (name == NULL)
+		return;
+	pk_package_sack_index_bucket_add (priv->name_table,
+					  g_strdup (name),
+					  package);
+	pk_package_sack_index_bucket_add (priv->name_arch_table,
+					  pk_package_sack_name_arch_key (name, pk_package_get_arch (package)),
+					  package);
+}
+
+/*
+ * pk_package_sack_index_remove:
+ *
+ * Removes the package from the id, name and name+arch indexes.
+ **/
+static void
+pk_package_sack_index_remove (PkPackageSack *sack, PkPackage *package)
+{
+	PkPackageSackPrivate *priv = sack->priv;
+	GPtrArray *bucket;
+	PkPackage *pkg_tmp;
+	const gchar *name = pk_package_get_name (package);
+	const gchar *package_id = pk_package_get_id (package);
+	g_autofree gchar *key = NULL;
+
+	if (name == NULL) {
+		if (g_hash_table_lookup (priv->table, package_id) == package)
+			g_hash_table_remove (priv->table, package_id);
+		return;
+	}
+	key = pk_package_sack_name_arch_key (name, pk_package_get_arch (package));
+	pk_package_sack_index_bucket_remove (priv->name_arch_table, key, package);
+	pk_package_sack_index_bucket_remove (priv->name_table, name, package);
+
+	/* the sack may hold the same package_id more than once, so point
+	 * the id index at the newest remaining copy like an add would */
+	if (g_hash_table_lookup (priv->table, package_id) != package)
+		return;
+	g_hash_table_remove (priv->table, package_id);
+	bucket = g_hash_table_lookup (priv->name_table, name);
+	for (guint i = bucket != NULL ? bucket->len : 0; i > 0; i--) {
+		pkg_tmp = g_ptr_array_index (bucket, i - 1);
+		if (g_strcmp0 (pk_package_get_id (pkg_tmp), package_id) == 0) {
+			g_hash_table_insert (priv->table,
+					     (gpointer) pk_package_get_id (pkg_tmp),
+					     (gpointer) pkg_tmp);
+			break;
+		}
+	}
+}
+
+/*
+ * pk_package_sack_index_rebuild:
+ *
+ * Rebuilds all the indexes from the array, e.g. after sorting.
+ **/
+static void
+pk_package_sack_index_rebuild (PkPackageSack *sack)
+{
+	PkPackageSackPrivate *priv = sack->priv;
+
+	g_hash_table_remove_all (priv->table);
+	g_hash_table_remove_all (priv->name_table);
+	g_hash_table_remove_all (priv->name_arch_table);
+	g_hash_table_remove_all (priv->positions);
+	for (guint i = 0; i < priv->array->len; i++) {
+		PkPackage *package = g_ptr_array_index (priv->array, i);
+		if (!g_hash_table_contains (priv->positions, package))
+			g_hash_table_insert (priv->positions, package, GUINT_TO_POINTER (i));
+		pk_package_sack_index_add (sack, package);
+	}
+}
+
+/*
+ * pk_package_sack_index_lookup_position:
+ *
+ * Finds the first slot of the package in the array. The array itself is
+ * handed out by pk_package_sack_get_array(), so if the slot no longer
+ * holds the package the indexes are rebuilt rather than trusted.
+ **/
+static gboolean
+pk_package_sack_index_lookup_position (PkPackageSack *sack, PkPackage *package, guint *index)
+{
+	PkPackageSackPrivate *priv = sack->priv;
+	gpointer value;
+
+	if (!g_hash_table_lookup_extended (priv->positions, package, NULL, &value))
+		return FALSE;
+	if (GPOINTER_TO_UINT (value) >= priv->array->len ||
+	    g_ptr_array_index (priv->array, GPOINTER_TO_UINT (value)) != package) {
+		pk_package_sack_index_rebuild (sack);
+		if (!g_hash_table_lookup_extended (priv->positions, package, NULL, &value))
+			return FALSE;
+	}
+	*index = GPOINTER_TO_UINT (value);
+	return TRUE;
+}
+
 /**
  * pk_package_sack_clear:
  * @sack: a valid #PkPackageSack instance
@@ -78,6 +241,9 @@ pk_package_sack_clear (PkPackageSack *sack)
 
 	g_ptr_array_set_size (sack->priv->array, 0);
 	g_hash_table_remove_all (sack->priv->table);
+	g_hash_table_remove_all (sack->priv->name_table);
+	g_hash_table_remove_all (sack->priv->name_arch_table);
+	g_hash_table_remove_all (sack->priv->positions);
 }
 
 /**
@@ -237,9 +403,11 @@ pk_package_sack_add_package (PkPackageSack *sack, PkPackage *package)
 	/* add to array */
 	g_ptr_array_add (sack->priv->array,
 			 g_object_ref (package));
-	g_hash_table_insert (sack->priv->table,
-			     (gpointer) pk_package_get_id (package),
-			     (gpointer) package);
+	if (!g_hash_table_contains (sack->priv->positions, package)) {
+		g_hash_table_insert (sack->priv->positions, package,
+				     GUINT_TO_POINTER (sack->priv->array->len - 1));
+	}
+	pk_package_sack_index_add (sack, package);
 
 	return TRUE;
 }
@@ -411,12 +579,32 @@ pk_package_sack_to_file (PkPackageSack *sack, GFile *file, GError **error)
 gboolean
 pk_package_sack_remove_package (PkPackageSack *sack, PkPackage *package)
 {
+	PkPackageSackPrivate *priv;
+	gpointer value;
+	guint i;
+
 	g_return_val_if_fail (PK_IS_PACKAGE_SACK (sack), FALSE);
 	g_return_val_if_fail (PK_IS_PACKAGE (package), FALSE);
 
-	/* remove from array */
-	g_hash_table_remove (sack->priv->table, pk_package_get_id (package));
-	return g_ptr_array_remove (sack->priv->array, package);
+	/* not in this sack */
+	priv = sack->priv;
+	if (!pk_package_sack_index_lookup_position (sack, package, &i))
+		return FALSE;
+
+	/* remove from array, keeping the order */
+	pk_package_sack_index_remove (sack, package);
+	g_hash_table_remove (priv->positions, package);
+	g_ptr_array_remove_index (priv->array, i);
+
+	/* everything after the gap moved down by one; a later copy of
+	 * the same object becomes its first slot */
+	for (; i < priv->array->len; i++) {
+		PkPackage *pkg_tmp = g_ptr_array_index (priv->array, i);
+		if (!g_hash_table_lookup_extended (priv->positions, pkg_tmp, NULL, &value) ||
+		    GPOINTER_TO_UINT (value) == i + 1)
+			g_hash_table_insert (priv->positions, pkg_tmp, GUINT_TO_POINTER (i));
+	}
+	return TRUE;
 }
 
 /**
@@ -436,21 +624,14 @@ pk_package_sack_remove_package_by_id (PkPackageSack *sack,
 				      const gchar *package_id)
 {
 	PkPackage *package;
-	guint i;
-	GPtrArray *array;
 
 	g_return_val_if_fail (PK_IS_PACKAGE_SACK (sack), FALSE);
 	g_return_val_if_fail (package_id != NULL, FALSE);
 
-	array = sack->priv->array;
-	for (i = 0; i < array->len; i++) {
-		package = g_ptr_array_index (array, i);
-		if (g_strcmp0 (package_id, pk_package_get_id (package)) == 0) {
-			pk_package_sack_remove_package (sack, package);
-			return TRUE;
-		}
-	}
-	return FALSE;
+	package = g_hash_table_lookup (sack->priv->table, package_id);
+	if (package == NULL)
+		return FALSE;
+	return pk_package_sack_remove_package (sack, package);
 }
 
 /**
@@ -471,26 +652,36 @@ pk_package_sack_remove_by_filter (PkPackageSack *sack,
 				  PkPackageSackFilterFunc filter_cb,
 				  gpointer user_data)
 {
-	gboolean ret = FALSE;
 	PkPackage *package;
-	gint i;
+	guint i;
+	guint j = 0;
 	PkPackageSackPrivate *priv = sack->priv;
 
 	g_return_val_if_fail (PK_IS_PACKAGE_SACK (sack), FALSE);
 	g_return_val_if_fail (filter_cb != NULL, FALSE);
 
-	/* add each that matches the info enum */
-	for (i = 0; i < (gint) priv->array->len; i++) {
+	/* compact the array in one pass rather than shifting the tail
+	 * down for every package removed */
+	g_hash_table_remove_all (priv->positions);
+	for (i = 0; i < priv->array->len; i++) {
 		package = g_ptr_array_index (priv->array, i);
-		if (!filter_cb (package, user_data)) {
-			ret = TRUE;
-			pk_package_sack_remove_package (sack, package);
-
-			/* ensure we pick up subsequent matches */
-			i--;
+		if (filter_cb (package, user_data)) {
+			if (!g_hash_table_contains (priv->positions, package))
+				g_hash_table_insert (priv->positions, package, GUINT_TO_POINTER (j));
+			priv->array->pdata[j++] = package;
+			continue;
 		}
+		pk_package_sack_index_remove (sack, package);
+		g_object_unref (package);
 	}
-	return ret;
+	if (j == priv->array->len)
+		return FALSE;
+
+	/* the tail has already been unreffed */
+	g_ptr_array_set_free_func (priv->array, NULL);
+	g_ptr_array_set_size (priv->array, j);
+	g_ptr_array_set_free_func (priv->array, g_object_unref);
+	return TRUE;
 }
 
 /**
@@ -535,8 +726,8 @@ pk_package_sack_find_by_id (PkPackageSack *sack, const gchar *package_id)
 PkPackage *
 pk_package_sack_find_by_id_name_arch (PkPackageSack *sack, const gchar *package_id)
 {
-	PkPackage *pkg_tmp;
-	guint i;
+	GPtrArray *bucket;
+	g_autofree gchar *key = NULL;
 	g_auto(GStrv) split = NULL;
 
 	g_return_val_if_fail (PK_IS_PACKAGE_SACK (sack), NULL);
@@ -546,16 +737,12 @@ pk_package_sack_find_by_id_name_arch (PkPackageSack *sack, const gchar *package_
 	split = pk_package_id_split (package_id);
 	if (split == NULL)
 		return NULL;
-	for (i = 0; i < sack->priv->array->len; i++) {
-		pkg_tmp = g_ptr_array_index (sack->priv->array, i);
-		if (g_strcmp0 (pk_package_get_name (pkg_tmp),
-			       split[PK_PACKAGE_ID_NAME]) == 0 &&
-		    g_strcmp0 (pk_package_get_arch (pkg_tmp),
-			       split[PK_PACKAGE_ID_ARCH]) == 0) {
-			return g_object_ref (pkg_tmp);
-		}
-	}
-	return NULL;
+	key = pk_package_sack_name_arch_key (split[PK_PACKAGE_ID_NAME],
+					     split[PK_PACKAGE_ID_ARCH]);
+	bucket = g_hash_table_lookup (sack->priv->name_arch_table, key);
+	if (bucket == NULL)
+		return NULL;
+	return g_object_ref (g_ptr_array_index (bucket, 0));
 }
 
 /*
@@ -640,6 +827,11 @@ pk_package_sack_sort (PkPackageSack *sack, PkPackageSackSortType type)
 		g_ptr_array_sort (sack->priv->array, (GCompareFunc) pk_package_sack_sort_compare_summary_func);
 	else if (type == PK_PACKAGE_SACK_SORT_TYPE_INFO)
 		g_ptr_array_sort (sack->priv->array, (GCompareFunc) pk_package_sack_sort_compare_info_func);
+	else
+		return;
+
+	/* keep the "first match" of each bucket in the new order */
+	pk_package_sack_index_rebuild (sack);
 }
 
 /**
@@ -1082,6 +1274,11 @@ pk_package_sack_init (PkPackageSack *sack)
 	priv = sack->priv;
 
 	priv->table = g_hash_table_new (g_str_hash, g_str_equal);
+	priv->name_table = g_hash_table_new_full (g_str_hash, g_str_equal,
+						  g_free, (GDestroyNotify) g_ptr_array_unref);
+	priv->name_arch_table = g_hash_table_new_full (g_str_hash, g_str_equal,
+						       g_free, (GDestroyNotify) g_ptr_array_unref);
+	priv->positions = g_hash_table_new (g_direct_hash, g_direct_equal);
 	priv->array = g_ptr_array_new_with_free_func (g_object_unref);
 	priv->client = pk_client_new ();
 }
@@ -1097,6 +1294,9 @@ pk_package_sack_finalize (GObject *object)
 
 	g_ptr_array_unref (priv->array);
 	g_hash_table_unref (priv->table);
+	g_hash_table_unref (priv->name_table);
+	g_hash_table_unref (priv->name_arch_table);
+	g_hash_table_unref (priv->positions);
 	g_object_unref (priv->client);
 
 	G_OBJECT_CLASS (pk_package_sack_parent_class)->finalize (object);
@@ -30,6 +30,7 @@
 
 #include "config.h"
 
+#include <string.h>
 #include <glib-object.h>
 
 #include <packagekit-glib2/pk-package.h>
@@ -155,6 +156,21 @@ pk_package_equal_id (PkPackage *package1, PkPackage *package2)
 	return (g_strcmp0 (priv1->package_id, priv2->package_id) == 0);
 }
 
+/*
+ * pk_package_clear_id:
+ **/
+static void
+pk_package_clear_id (PkPackagePrivate *priv)
+{
+	/* package_id points into the same allocation */
+	priv->package_id = NULL;
+	g_clear_pointer (&priv->package_id_data, g_free);
+	priv->package_id_split[PK_PACKAGE_ID_NAME] = NULL;
+	priv->package_id_split[PK_PACKAGE_ID_VERSION] = NULL;
+	priv->package_id_split[PK_PACKAGE_ID_ARCH] = NULL;
+	priv->package_id_split[PK_PACKAGE_ID_DATA] = NULL;
+}
+
 /**
  * pk_package_set_id:
  * @package: a valid #PkPackage instance
@@ -171,6 +187,8 @@ gboolean
 pk_package_set_id (PkPackage *package, const gchar *package_id, GError **error)
 {
 	PkPackagePrivate *priv = pk_package_get_instance_private (package);
+	gchar *split;
+	gsize len;
 	guint cnt = 0;
 	guint i;
 
@@ -181,20 +199,24 @@ pk_package_set_id (PkPackage *package, const gchar *package_id, GError **error)
 		return TRUE;
 
 	/* free old data */
-	g_free (priv->package_id);
-	g_free (priv->package_id_data);
-
-	/* copy the package-id into package_id_data, change the ';' into '\0'
-	 * and reference the pointers in the const gchar * array */
-	priv->package_id = g_strdup (package_id);
-	priv->package_id_data = g_strdup (package_id);
-	priv->package_id_split[PK_PACKAGE_ID_NAME] = priv->package_id_data;
-	for (i = 0; priv->package_id_data[i] != '\0'; i++) {
+	pk_package_clear_id (priv);
+
+	/* copy the package-id twice into one allocation, change the ';' into
+	 * '\0' in the second copy and reference the pointers in the
+	 * const gchar * array */
+	len = strlen (package_id);
+	priv->package_id_data = g_malloc (2 * (len + 1));
+	priv->package_id = priv->package_id_data;
+	memcpy (priv->package_id_data, package_id, len + 1);
+	split = priv->package_id_data + len + 1;
+	memcpy (split, package_id, len + 1);
+	priv->package_id_split[PK_PACKAGE_ID_NAME] = split;
+	for (i = 0; split[i] != '\0'; i++) {
 		if (package_id[i] == ';') {
 			if (++cnt > 3)
 				continue;
-			priv->package_id_split[cnt] = &priv->package_id_data[i+1];
-			priv->package_id_data[i] = '\0';
+			priv->package_id_split[cnt] = &split[i+1];
+			split[i] = '\0';
 		}
 	}
 	if (cnt != 3) {
@@ -212,15 +234,97 @@ pk_package_set_id (PkPackage *package, const gchar *package_id, GError **error)
 	return TRUE;
 
 out:
-	g_clear_pointer (&priv->package_id, g_free);
-	g_clear_pointer (&priv->package_id_data, g_free);
-	priv->package_id_split[PK_PACKAGE_ID_NAME] = NULL;
-	priv->package_id_split[PK_PACKAGE_ID_VERSION] = NULL;
-	priv->package_id_split[PK_PACKAGE_ID_ARCH] = NULL;
-	priv->package_id_split[PK_PACKAGE_ID_DATA] = NULL;
+	pk_package_clear_id (priv);
 	return FALSE;
 }
 
+/**
+ * pk_package_set_id_parts:
+ * @package: a valid #PkPackage instance
+ * @name: the package name
+ * @version: (nullable): the package version
+ * @arch: (nullable): the package architecture
+ * @data: (nullable): the package extra data
+ * @error: a #GError to put the error code and message in, or %NULL
+ *
+ * Sets the package object to have the ID made of the given sections.
+ * This is the same as calling pk_package_set_id() with the result of
+ * pk_package_id_build(), without building and splitting the ID again.
+ *
+ * Returns: %TRUE if the package_id was set
+ *
+ * Since: 1.3.2
+ **/
+gboolean
+pk_package_set_id_parts (PkPackage *package,
+			 const gchar *name,
+			 const gchar *version,
+			 const gchar *arch,
+			 const gchar *data,
+			 GError **error)
+{
+	PkPackagePrivate *priv = pk_package_get_instance_private (package);
+	const gchar *parts[4];
+	gsize lens[4];
+	gsize len = 0;
+	gchar *split;
+	gchar *id;
+
+	g_return_val_if_fail (PK_IS_PACKAGE (package), FALSE);
+	g_return_val_if_fail (name != NULL, FALSE);
+	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+	parts[PK_PACKAGE_ID_NAME] = name;
+	parts[PK_PACKAGE_ID_VERSION] = version != NULL ? version : "";
+	parts[PK_PACKAGE_ID_ARCH] = arch != NULL ? arch : "";
+	parts[PK_PACKAGE_ID_DATA] = data != NULL ? data : "";
+
+	/* name has to be valid */
+	if (name[0] == '\0') {
+		g_set_error_literal (error, 1, 0, "name invalid");
+		return FALSE;
+	}
+
+	/* no section may contain the separator */
+	for (guint i = 0; i < 4; i++) {
+		if (strchr (parts[i], ';') != NULL) {
+			g_set_error (error, 1, 0, "invalid section %s", parts[i]);
+			return FALSE;
+		}
+		lens[i] = strlen (parts[i]);
+		len += lens[i] + 1;
+	}
+
+	/* unchanged */
+	if (priv->package_id != NULL &&
+	    g_strcmp0 (priv->package_id_split[PK_PACKAGE_ID_NAME], parts[PK_PACKAGE_ID_NAME]) == 0 &&
+	    g_strcmp0 (priv->package_id_split[PK_PACKAGE_ID_VERSION], parts[PK_PACKAGE_ID_VERSION]) == 0 &&
+	    g_strcmp0 (priv->package_id_split[PK_PACKAGE_ID_ARCH], parts[PK_PACKAGE_ID_ARCH]) == 0 &&
+	    g_strcmp0 (priv->package_id_split[PK_PACKAGE_ID_DATA], parts[PK_PACKAGE_ID_DATA]) == 0)
+		return TRUE;
+
+	/* free old data */
+	pk_package_clear_id (priv);
+
+	/* same layout as pk_package_set_id(): the joined ID followed by the
+	 * nul-separated sections */
+	priv->package_id_data = g_malloc (2 * len);
+	priv->package_id = priv->package_id_data;
+	id = priv->package_id_data;
+	split = priv->package_id_data + len;
+	for (guint i = 0; i < 4; i++) {
+		memcpy (id, parts[i], lens[i]);
+		id[lens[i]] = i < PK_PACKAGE_ID_DATA ? ';' : '\0';
+		id += lens[i] + 1;
+		memcpy (split, parts[i], lens[i] + 1);
+		priv->package_id_split[i] = split;
+		split += lens[i] + 1;
+	}
+
+	g_object_notify_by_pspec (G_OBJECT(package), obj_properties[PROP_PACKAGE_ID]);
+	return TRUE;
+}
+
 /**
  * pk_package_parse:
  * @package: a valid #PkPackage instance
@@ -908,7 +1012,7 @@ pk_package_finalize (GObject *object)
 	PkPackage *package = PK_PACKAGE (object);
 	PkPackagePrivate *priv = pk_package_get_instance_private (package);
 
-	g_clear_pointer (&priv->package_id, g_free);
+	pk_package_clear_id (priv);
 	g_clear_pointer (&priv->summary, g_free);
 	g_clear_pointer (&priv->license, g_free);
 	g_clear_pointer (&priv->description, g_free);
@@ -922,7 +1026,6 @@ pk_package_finalize (GObject *object)
 	g_clear_pointer (&priv->update_changelog, g_free);
 	g_clear_pointer (&priv->update_issued, g_free);
 	g_clear_pointer (&priv->update_updated, g_free);
-	g_clear_pointer (&priv->package_id_data, g_free);
 
 	G_OBJECT_CLASS (pk_package_parent_class)->finalize (object);
 }
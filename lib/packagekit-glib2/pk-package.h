@@ -75,6 +75,12 @@ PkPackage	*pk_package_new				(void);
 gboolean	 pk_package_set_id			(PkPackage	*package,
 							 const gchar	*package_id,
 							 GError		**error);
+gboolean	 pk_package_set_id_parts		(PkPackage	*package,
+							 const gchar	*name,
+							 const gchar	*version,
+							 const gchar	*arch,
+							 const gchar	*data,
+							 GError		**error);
 gboolean	 pk_package_parse			(PkPackage	*package,
 							 const gchar	*data,
 							 GError		**error);
@@ -0,0 +1,252 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 The PackageKit Authors
+ *
+ * Licensed under the GNU Lesser General Public License Version 2.1
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+/*
+ * A package list in a sealed memfd, so that very large result sets can be
+ * passed to the client as a file descriptor rather than copied through
+ * the bus daemon as a Packages signal.
+ *
+ * The layout is in host byte order, as it never leaves the machine:
+ *
+ *   guint32 magic, guint32 n_packages
+ *   then for each package:
+ *   guint32 flags, guint32 id_len, guint32 summary_len,
+ *   the package ID and the summary, each NUL terminated,
+ *   padded to a multiple of four bytes
+ */
+
+/* for memfd_create() and the file sealing API */
+#define _GNU_SOURCE
+
+#include "config.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <glib/gstdio.h>
+
+#include <packagekit-glib2/pk-package.h>
+#include <packagekit-glib2/pk-packages-fd-private.h>
+
+#define PK_PACKAGES_FD_MAGIC		0x31504b50	/* "PKP1" */
+#define PK_PACKAGES_FD_SEALS		(F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL)
+
+typedef struct {
+	guint32		 magic;
+	guint32		 n_packages;
+} PkPackagesFdHeader;
+
+typedef struct {
+	guint32		 flags;
+	guint32		 id_len;
+	guint32		 summary_len;
+} PkPackagesFdRecord;
+
+static gsize
+pk_packages_fd_record_size (gsize id_len, gsize summary_len)
+{
+	gsize size = sizeof (PkPackagesFdRecord) + id_len + 1 + summary_len + 1;
+	return (size + 3) & ~((gsize) 3);
+}
+
+/**
+ * pk_packages_fd_new:
+ * @packages: (element-type PkPackage): the packages to save
+ * @error: a #GError, or %NULL
+ *
+ * Writes the packages into a new memfd which is then sealed so that the
+ * receiver can map it without the contents changing underneath it.
+ *
+ * Return value: a file descriptor, or -1 for error
+ **/
+gint
+pk_packages_fd_new (GPtrArray *packages, GError **error)
+{
+	PkPackagesFdHeader *header;
+	gsize size = sizeof (PkPackagesFdHeader);
+	gsize offset;
+	guint8 *data;
+	gint fd;
+
+	/* work out the size first so there is only one allocation */
+	for (guint i = 0; i < packages->len; i++) {
+		PkPackage *package = g_ptr_array_index (packages, i);
+		const gchar *summary = pk_package_get_summary (package);
+		size += pk_packages_fd_record_size (strlen (pk_package_get_id (package)),
+						    summary != NULL ? strlen (summary) : 0);
+	}
+
+	fd = memfd_create ("packagekit-packages", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+	if (fd < 0) {
+		g_set_error (error, G_IO_ERROR, g_io_error_from_errno (errno),
+			     "failed to create memfd: %s", g_strerror (errno));
+		return -1;
+	}
+	if (ftruncate (fd, size) < 0) {
+		g_set_error (error, G_IO_ERROR, g_io_error_from_errno (errno),
+			     "failed to size memfd: %s", g_strerror (errno));
+		close (fd);
+		return -1;
+	}
+	data = mmap (NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (data == MAP_FAILED) {
+		g_set_error (error, G_IO_ERROR, g_io_error_from_errno (errno),
+			     "failed to map memfd: %s", g_strerror (errno));
+		close (fd);
+		return -1;
+	}
+
+	/* the mapping is zeroed, so the terminators and padding are free */
+	header = (PkPackagesFdHeader *) data;
+	header->magic = PK_PACKAGES_FD_MAGIC;
+	header->n_packages = packages->len;
+	offset = sizeof (PkPackagesFdHeader);
+	for (guint i = 0; i < packages->len; i++) {
+		PkPackage *package = g_ptr_array_index (packages, i);
+		PkPackagesFdRecord *record = (PkPackagesFdRecord *) (data + offset);
+		const gchar *package_id = pk_package_get_id (package);
+		const gchar *summary = pk_package_get_summary (package);
+
+		record->flags = pk_package_get_info (package) |
+				(((guint32) pk_package_get_update_severity (package)) << 16);
+		record->id_len = strlen (package_id);
+		record->summary_len = summary != NULL ? strlen (summary) : 0;
+		memcpy (record + 1, package_id, record->id_len);
+		if (record->summary_len > 0)
+			memcpy ((guint8 *) (record + 1) + record->id_len + 1,
+				summary, record->summary_len);
+		offset += pk_packages_fd_record_size (record->id_len, record->summary_len);
+	}
+	munmap (data, size);
+
+	/* nobody can change this now, including us */
+	if (fcntl (fd, F_ADD_SEALS, PK_PACKAGES_FD_SEALS) < 0) {
+		g_set_error (error, G_IO_ERROR, g_io_error_from_errno (errno),
+			     "failed to seal memfd: %s", g_strerror (errno));
+		close (fd);
+		return -1;
+	}
+	return fd;
+}
+
+/**
+ * pk_packages_fd_map:
+ * @fd: a file descriptor from pk_packages_fd_new(), which is not consumed
+ * @error: a #GError, or %NULL
+ *
+ * Maps the sealed package list read-only without copying it.
+ *
+ * Return value: (transfer full): the mapped data, or %NULL for error
+ **/
+GBytes *
+pk_packages_fd_map (gint fd, GError **error)
+{
+	gint seals;
+	g_autoptr(GMappedFile) mapped = NULL;
+
+	/* the sender must not be able to truncate the file while it is
+	 * mapped, as we would then get SIGBUS when reading it */
+	seals = fcntl (fd, F_GET_SEALS);
+	if (seals < 0 || (seals & (F_SEAL_SHRINK | F_SEAL_WRITE)) != (F_SEAL_SHRINK | F_SEAL_WRITE)) {
+		g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+				     "package list is not sealed");
+		return NULL;
+	}
+	mapped = g_mapped_file_new_from_fd (fd, FALSE, error);
+	if (mapped == NULL)
+		return NULL;
+	return g_mapped_file_get_bytes (mapped);
+}
+
+/**
+ * pk_packages_fd_foreach:
+ * @blob: the data from pk_packages_fd_map()
+ * @func: called for each package
+ * @user_data: the data to pass to @func
+ * @error: a #GError, or %NULL
+ *
+ * Checks and walks the package list. The strings passed to @func point
+ * into @blob and are only valid while it is.
+ *
+ * Return value: %TRUE if every package was valid
+ **/
+gboolean
+pk_packages_fd_foreach (GBytes *blob, PkPackagesFdFunc func,
+			gpointer user_data, GError **error)
+{
+	const PkPackagesFdHeader *header;
+	const guint8 *data;
+	gsize offset;
+	gsize size;
+
+	data = g_bytes_get_data (blob, &size);
+	if (size < sizeof (PkPackagesFdHeader)) {
+		g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+				     "package list is truncated");
+		return FALSE;
+	}
+	header = (const PkPackagesFdHeader *) data;
+	if (header->magic != PK_PACKAGES_FD_MAGIC) {
+		g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+				     "package list has an unknown format");
+		return FALSE;
+	}
+
+	offset = sizeof (PkPackagesFdHeader);
+	for (guint i = 0; i < header->n_packages; i++) {
+		const PkPackagesFdRecord *record;
+		const gchar *package_id;
+		gsize record_size;
+
+		/* check everything before trusting the lengths */
+		if (size - offset < sizeof (PkPackagesFdRecord)) {
+			g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+				     "package %u is truncated", i);
+			return FALSE;
+		}
+		record = (const PkPackagesFdRecord *) (data + offset);
+		if (record->id_len > size || record->summary_len > size) {
+			g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+				     "package %u is truncated", i);
+			return FALSE;
+		}
+		record_size = pk_packages_fd_record_size (record->id_len, record->summary_len);
+		if (size - offset < record_size) {
+			g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+				     "package %u is truncated", i);
+			return FALSE;
+		}
+		package_id = (const gchar *) (record + 1);
+		if (package_id[record->id_len] != '\0' ||
+		    package_id[record->id_len + 1 + record->summary_len] != '\0') {
+			g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+				     "package %u is not terminated", i);
+			return FALSE;
+		}
+		func (record->flags, package_id,
+		      package_id + record->id_len + 1, user_data);
+		offset += record_size;
+	}
+	return TRUE;
+}
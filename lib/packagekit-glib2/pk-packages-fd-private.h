@@ -0,0 +1,61 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 The PackageKit Authors
+ *
+ * Licensed under the GNU Lesser General Public License Version 2.1
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#if !defined (__PACKAGEKIT_H_INSIDE__) && !defined (PK_COMPILATION)
+#error "Only <packagekit.h> can be included directly."
+#endif
+
+#ifndef __PK_PACKAGES_FD_PRIVATE_H
+#define __PK_PACKAGES_FD_PRIVATE_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* the number of packages before the daemon bothers with a memfd */
+#define PK_PACKAGES_FD_THRESHOLD		1024
+
+/**
+ * PkPackagesFdFunc:
+ * @flags: the info and update severity, encoded as in the Packages signal
+ * @package_id: the package ID, pointing into the mapped data
+ * @summary: the package summary, pointing into the mapped data
+ * @user_data: the user data
+ *
+ * Called for each package in a sealed package list.
+ **/
+typedef void	 (*PkPackagesFdFunc)			(guint32	 flags,
+							 const gchar	*package_id,
+							 const gchar	*summary,
+							 gpointer	 user_data);
+
+gint		 pk_packages_fd_new			(GPtrArray	*packages,
+							 GError		**error);
+GBytes		*pk_packages_fd_map			(gint		 fd,
+							 GError		**error);
+gboolean	 pk_packages_fd_foreach			(GBytes		*blob,
+							 PkPackagesFdFunc func,
+							 gpointer	 user_data,
+							 GError		**error);
+
+G_END_DECLS
+
+#endif /* __PK_PACKAGES_FD_PRIVATE_H */
@@ -36,6 +36,8 @@
 #include <packagekit-glib2/pk-results.h>
 #include <packagekit-glib2/pk-enum.h>
 #include <packagekit-glib2/pk-enum-types.h>
+#include <packagekit-glib2/pk-packages-fd-private.h>
+#include <packagekit-glib2/pk-results-private.h>
 
 static void     pk_results_finalize	(GObject     *object);
 
@@ -65,9 +67,34 @@ struct _PkResultsPrivate
 	GPtrArray		*eula_required_array;
 	GPtrArray		*media_change_required_array;
 	GPtrArray		*repo_detail_array;
+	/* packages are kept as columns, and only become objects when asked
+	 * for; rows added as objects have NULL strings in the columns */
+	GStringChunk		*package_strings;
+	GString			*package_scratch;
+	GPtrArray		*package_names;
+	GPtrArray		*package_versions;
+	GPtrArray		*package_arches;
+	GPtrArray		*package_datas;
+	GPtrArray		*package_summaries;
+	GPtrArray		*package_transaction_ids;
+	GArray			*package_infos;
+	GArray			*package_update_severities;
+	GPtrArray		*package_objects;
+	GPtrArray		*package_blobs;
+	/* created when first asked for, and shared by all callers */
 	PkPackageSack		*package_sack;
+	guint			 package_sack_rows;
 };
 
+/* the public iterator is opaque */
+typedef struct {
+	PkResults		*results;
+	guint			 index;
+	GPtrArray		*sack_array;	/* (nullable), owned by the sack */
+} PkResultsRealPackageIter;
+
+G_STATIC_ASSERT (sizeof (PkResultsRealPackageIter) <= sizeof (PkResultsPackageIter));
+
 enum {
 	PROP_0,
 	PROP_ROLE,
@@ -181,6 +208,187 @@ pk_results_set_exit_code (PkResults *results, PkExitEnum exit_enum)
 	return TRUE;
 }
 
+static void
+pk_results_package_object_free (gpointer data)
+{
+	if (data != NULL)
+		g_object_unref (data);
+}
+
+static void
+pk_results_add_package_columns (PkResults *results,
+				PkInfoEnum info,
+				PkInfoEnum update_severity,
+				const gchar *name,
+				const gchar *version,
+				const gchar *arch,
+				const gchar *data,
+				const gchar *summary,
+				const gchar *transaction_id,
+				PkPackage *object)
+{
+	PkResultsPrivate *priv = results->priv;
+	guint16 tmp;
+
+	g_ptr_array_add (priv->package_names, (gpointer) name);
+	g_ptr_array_add (priv->package_versions, (gpointer) version);
+	g_ptr_array_add (priv->package_arches, (gpointer) arch);
+	g_ptr_array_add (priv->package_datas, (gpointer) data);
+	g_ptr_array_add (priv->package_summaries, (gpointer) summary);
+	g_ptr_array_add (priv->package_transaction_ids, (gpointer) transaction_id);
+	tmp = info;
+	g_array_append_val (priv->package_infos, tmp);
+	tmp = update_severity;
+	g_array_append_val (priv->package_update_severities, tmp);
+	g_ptr_array_add (priv->package_objects, object);
+}
+
+/*
+ * pk_results_add_package_row:
+ * @results: a valid #PkResults instance
+ * @info: the #PkInfoEnum
+ * @update_severity: the update severity, or %PK_INFO_ENUM_UNKNOWN
+ * @package_id: the package ID
+ * @summary: the package summary, or %NULL
+ * @summary_is_static: if @summary stays valid for the life of @results
+ * @transaction_id: the transaction the package came from
+ *
+ * Adds a package to the results set without creating a #PkPackage.
+ * The strings that repeat between packages are interned.
+ *
+ * Return value: %TRUE if the package ID was valid
+ **/
+gboolean
+pk_results_add_package_row (PkResults *results,
+			    PkInfoEnum info,
+			    PkInfoEnum update_severity,
+			    const gchar *package_id,
+			    const gchar *summary,
+			    gboolean summary_is_static,
+			    const gchar *transaction_id)
+{
+	PkResultsPrivate *priv = results->priv;
+	const gchar *split[4];
+	gchar *tmp;
+	guint cnt = 0;
+
+	g_return_val_if_fail (PK_IS_RESULTS (results), FALSE);
+	g_return_val_if_fail (package_id != NULL, FALSE);
+
+	if (info == PK_INFO_ENUM_FINISHED) {
+		g_warning ("Finished packages cannot be added to PkResults");
+		return FALSE;
+	}
+
+	/* split a copy in place, as pk_package_set_id() does */
+	g_string_assign (priv->package_scratch, package_id);
+	tmp = priv->package_scratch->str;
+	split[PK_PACKAGE_ID_NAME] = tmp;
+	for (guint i = 0; tmp[i] != '\0'; i++) {
+		if (tmp[i] != ';')
+			continue;
+		if (++cnt > 3)
+			break;
+		split[cnt] = &tmp[i + 1];
+		tmp[i] = '\0';
+	}
+	if (cnt != 3 || split[PK_PACKAGE_ID_NAME][0] == '\0')
+		return FALSE;
+
+	if (summary == NULL)
+		summary = "";
+	pk_results_add_package_columns (results, info, update_severity,
+					g_string_chunk_insert_const (priv->package_strings, split[PK_PACKAGE_ID_NAME]),
+					g_string_chunk_insert_const (priv->package_strings, split[PK_PACKAGE_ID_VERSION]),
+					g_string_chunk_insert_const (priv->package_strings, split[PK_PACKAGE_ID_ARCH]),
+					g_string_chunk_insert_const (priv->package_strings, split[PK_PACKAGE_ID_DATA]),
+					summary_is_static ? summary : g_string_chunk_insert (priv->package_strings, summary),
+					transaction_id != NULL ? g_string_chunk_insert_const (priv->package_strings, transaction_id) : NULL,
+					NULL);
+	return TRUE;
+}
+
+typedef struct {
+	PkResults		*results;
+	const gchar		*transaction_id;
+} PkResultsPackageBlobHelper;
+
+static void
+pk_results_package_blob_cb (guint32 flags,
+			    const gchar *package_id,
+			    const gchar *summary,
+			    gpointer user_data)
+{
+	PkResultsPackageBlobHelper *helper = user_data;
+
+	/* the 'info' and 'update-severity' are encoded in the single value,
+	 * and the summary can stay in the mapped file */
+	if ((flags & 0xFFFF) == PK_INFO_ENUM_FINISHED)
+		return;
+	if (!pk_results_add_package_row (helper->results,
+					 flags & 0xFFFF,
+					 (flags >> 16) & 0xFFFF,
+					 package_id, summary, TRUE,
+					 helper->transaction_id))
+		g_warning ("failed to set package id for %s", package_id);
+}
+
+/*
+ * pk_results_add_package_blob:
+ * @results: a valid #PkResults instance
+ * @blob: a package list from pk_packages_fd_map()
+ * @transaction_id: the transaction the packages came from
+ *
+ * Adds a mapped package list to the results set. No #PkPackage objects
+ * are created, and the summaries are not copied out of @blob.
+ **/
+void
+pk_results_add_package_blob (PkResults *results, GBytes *blob, const gchar *transaction_id)
+{
+	PkResultsPackageBlobHelper helper = { results, transaction_id };
+	g_autoptr(GError) error = NULL;
+
+	g_return_if_fail (PK_IS_RESULTS (results));
+	g_return_if_fail (blob != NULL);
+
+	g_ptr_array_add (results->priv->package_blobs, g_bytes_ref (blob));
+	if (!pk_packages_fd_foreach (blob, pk_results_package_blob_cb, &helper, &error))
+		g_warning ("failed to load packages: %s", error->message);
+}
+
+/*
+ * pk_results_get_package_object:
+ *
+ * Creates the #PkPackage for a row the first time it is needed.
+ **/
+static PkPackage *
+pk_results_get_package_object (PkResults *results, guint idx)
+{
+	PkResultsPrivate *priv = results->priv;
+	PkPackage *package = g_ptr_array_index (priv->package_objects, idx);
+	g_autoptr(GError) error = NULL;
+
+	if (package != NULL)
+		return package;
+	package = pk_package_new ();
+	if (!pk_package_set_id_parts (package,
+				      g_ptr_array_index (priv->package_names, idx),
+				      g_ptr_array_index (priv->package_versions, idx),
+				      g_ptr_array_index (priv->package_arches, idx),
+				      g_ptr_array_index (priv->package_datas, idx),
+				      &error))
+		g_warning ("failed to set package id: %s", error->message);
+	g_object_set (package,
+		      "info", g_array_index (priv->package_infos, guint16, idx),
+		      "summary", g_ptr_array_index (priv->package_summaries, idx),
+		      "update-severity", g_array_index (priv->package_update_severities, guint16, idx),
+		      "role", priv->role,
+		      "transaction-id", g_ptr_array_index (priv->package_transaction_ids, idx),
+		      NULL);
+	priv->package_objects->pdata[idx] = package;
+	return package;
+}
+
 /**
  * pk_results_add_package:
  * @results: a valid #PkResults instance
@@ -203,7 +411,13 @@ pk_results_add_package (PkResults *results, PkPackage *item)
 		g_warning ("Finished packages cannot be added to PkResults");
 		return FALSE;
 	}
-	pk_package_sack_add_package (results->priv->package_sack, item);
+
+	/* the object is kept, so the columns are not needed */
+	pk_results_add_package_columns (results,
+					pk_package_get_info (item),
+					pk_package_get_update_severity (item),
+					NULL, NULL, NULL, NULL, NULL, NULL,
+					g_object_ref (item));
 	return TRUE;
 }
 
@@ -564,6 +778,21 @@ pk_results_get_error_code (PkResults *results)
 	return g_object_ref (results->priv->error_code);
 }
 
+/* adds the rows received since the sack was last asked for */
+static PkPackageSack *
+pk_results_ensure_package_sack (PkResults *results)
+{
+	PkResultsPrivate *priv = results->priv;
+
+	if (priv->package_sack == NULL)
+		priv->package_sack = pk_package_sack_new ();
+	for (; priv->package_sack_rows < priv->package_objects->len; priv->package_sack_rows++) {
+		pk_package_sack_add_package (priv->package_sack,
+					     pk_results_get_package_object (results, priv->package_sack_rows));
+	}
+	return priv->package_sack;
+}
+
 /**
  * pk_results_get_package_array:
  * @results: a valid #PkResults instance
@@ -577,15 +806,29 @@ pk_results_get_error_code (PkResults *results)
 GPtrArray *
 pk_results_get_package_array (PkResults *results)
 {
+	GPtrArray *array;
+	guint len;
+
 	g_return_val_if_fail (PK_IS_RESULTS (results), NULL);
-	return pk_package_sack_get_array (results->priv->package_sack);
+
+	/* packages may have been removed from the sack */
+	if (results->priv->package_sack != NULL)
+		return pk_package_sack_get_array (pk_results_ensure_package_sack (results));
+
+	len = results->priv->package_objects->len;
+	array = g_ptr_array_new_full (len, (GDestroyNotify) g_object_unref);
+	for (guint i = 0; i < len; i++)
+		g_ptr_array_add (array, g_object_ref (pk_results_get_package_object (results, i)));
+	return array;
 }
 
 /**
  * pk_results_get_package_sack:
  * @results: a valid #PkResults instance
  *
- * Gets a package sack from the transaction.
+ * Gets a package sack from the transaction. The sack is shared by all
+ * callers, so packages removed from it are also no longer returned by
+ * pk_results_get_package_array().
  *
  * Return value: (transfer full): A #PkPackageSack of data, g_object_unref() to free.
  *
@@ -595,7 +838,235 @@ PkPackageSack *
 pk_results_get_package_sack (PkResults *results)
 {
 	g_return_val_if_fail (PK_IS_RESULTS (results), NULL);
-	return g_object_ref (results->priv->package_sack);
+	return g_object_ref (pk_results_ensure_package_sack (results));
+}
+
+/**
+ * pk_results_get_package_count:
+ * @results: a valid #PkResults instance
+ *
+ * Gets the number of packages from the transaction, without creating
+ * any #PkPackage objects. Once pk_results_get_package_sack() has been
+ * called this is the size of the shared sack, so it agrees with
+ * pk_results_get_package_array().
+ *
+ * Return value: the number of packages
+ *
+ * Since: 1.3.2
+ **/
+guint
+pk_results_get_package_count (PkResults *results)
+{
+	g_return_val_if_fail (PK_IS_RESULTS (results), 0);
+	if (results->priv->package_sack != NULL)
+		return pk_package_sack_get_size (pk_results_ensure_package_sack (results));
+	return results->priv->package_objects->len;
+}
+
+/**
+ * pk_results_package_iter_init:
+ * @iter: an uninitialized #PkResultsPackageIter
+ * @results: a valid #PkResults instance
+ *
+ * Initializes an iterator over the packages from the transaction. Unlike
+ * pk_results_get_package_array() this never creates #PkPackage objects,
+ * which matters for very large results such as GetPackages.
+ *
+ * |[
+ * PkResultsPackageIter iter;
+ * pk_results_package_iter_init (&iter, results);
+ * while (pk_results_package_iter_next (&iter))
+ *         g_print ("%s\n", pk_results_package_iter_get_name (&iter));
+ * ]|
+ *
+ * Once pk_results_get_package_sack() has been called the iterator walks
+ * the shared sack instead, so packages removed from it are skipped just
+ * like in pk_results_get_package_array().
+ *
+ * The results must not have packages added or removed while iterating.
+ *
+ * Since: 1.3.2
+ **/
+void
+pk_results_package_iter_init (PkResultsPackageIter *iter, PkResults *results)
+{
+	PkResultsRealPackageIter *ri = (PkResultsRealPackageIter *) iter;
+
+	g_return_if_fail (iter != NULL);
+	g_return_if_fail (PK_IS_RESULTS (results));
+
+	ri->results = results;
+	ri->index = G_MAXUINT;
+	ri->sack_array = NULL;
+	if (results->priv->package_sack != NULL) {
+		g_autoptr(GPtrArray) array = NULL;
+		array = pk_package_sack_get_array (pk_results_ensure_package_sack (results));
+		ri->sack_array = array;
+	}
+}
+
+/**
+ * pk_results_package_iter_next:
+ * @iter: an initialized #PkResultsPackageIter
+ *
+ * Advances @iter to the next package.
+ *
+ * Return value: %FALSE if the end of the packages has been reached
+ *
+ * Since: 1.3.2
+ **/
+gboolean
+pk_results_package_iter_next (PkResultsPackageIter *iter)
+{
+	PkResultsRealPackageIter *ri = (PkResultsRealPackageIter *) iter;
+
+	g_return_val_if_fail (iter != NULL, FALSE);
+
+	ri->index++;
+	if (ri->sack_array != NULL)
+		return ri->index < ri->sack_array->len;
+	return ri->index < ri->results->priv->package_objects->len;
+}
+
+/* either the object, if the row was added as one or is in the sack, or NULL */
+static PkPackage *
+pk_results_package_iter_get_object (PkResultsPackageIter *iter)
+{
+	PkResultsRealPackageIter *ri = (PkResultsRealPackageIter *) iter;
+	if (ri->sack_array != NULL)
+		return g_ptr_array_index (ri->sack_array, ri->index);
+	return g_ptr_array_index (ri->results->priv->package_objects, ri->index);
+}
+
+static const gchar *
+pk_results_package_iter_get_column (PkResultsPackageIter *iter, GPtrArray *column)
+{
+	PkResultsRealPackageIter *ri = (PkResultsRealPackageIter *) iter;
+	return g_ptr_array_index (column, ri->index);
+}
+
+/**
+ * pk_results_package_iter_get_info:
+ * @iter: an initialized #PkResultsPackageIter
+ *
+ * Return value: the #PkInfoEnum of the current package
+ *
+ * Since: 1.3.2
+ **/
+PkInfoEnum
+pk_results_package_iter_get_info (PkResultsPackageIter *iter)
+{
+	PkResultsRealPackageIter *ri = (PkResultsRealPackageIter *) iter;
+	if (ri->sack_array != NULL)
+		return pk_package_get_info (pk_results_package_iter_get_object (iter));
+	return g_array_index (ri->results->priv->package_infos, guint16, ri->index);
+}
+
+/**
+ * pk_results_package_iter_get_update_severity:
+ * @iter: an initialized #PkResultsPackageIter
+ *
+ * Return value: the update severity of the current package
+ *
+ * Since: 1.3.2
+ **/
+PkInfoEnum
+pk_results_package_iter_get_update_severity (PkResultsPackageIter *iter)
+{
+	PkResultsRealPackageIter *ri = (PkResultsRealPackageIter *) iter;
+	if (ri->sack_array != NULL)
+		return pk_package_get_update_severity (pk_results_package_iter_get_object (iter));
+	return g_array_index (ri->results->priv->package_update_severities, guint16, ri->index);
+}
+
+/**
+ * pk_results_package_iter_get_name:
+ * @iter: an initialized #PkResultsPackageIter
+ *
+ * Return value: the name of the current package, valid for the life of the results
+ *
+ * Since: 1.3.2
+ **/
+const gchar *
+pk_results_package_iter_get_name (PkResultsPackageIter *iter)
+{
+	PkPackage *package = pk_results_package_iter_get_object (iter);
+	PkResultsRealPackageIter *ri = (PkResultsRealPackageIter *) iter;
+	if (package != NULL)
+		return pk_package_get_name (package);
+	return pk_results_package_iter_get_column (iter, ri->results->priv->package_names);
+}
+
+/**
+ * pk_results_package_iter_get_version:
+ * @iter: an initialized #PkResultsPackageIter
+ *
+ * Return value: the version of the current package, valid for the life of the results
+ *
+ * Since: 1.3.2
+ **/
+const gchar *
+pk_results_package_iter_get_version (PkResultsPackageIter *iter)
+{
+	PkPackage *package = pk_results_package_iter_get_object (iter);
+	PkResultsRealPackageIter *ri = (PkResultsRealPackageIter *) iter;
+	if (package != NULL)
+		return pk_package_get_version (package);
+	return pk_results_package_iter_get_column (iter, ri->results->priv->package_versions);
+}
+
+/**
+ * pk_results_package_iter_get_arch:
+ * @iter: an initialized #PkResultsPackageIter
+ *
+ * Return value: the architecture of the current package, valid for the life of the results
+ *
+ * Since: 1.3.2
+ **/
+const gchar *
+pk_results_package_iter_get_arch (PkResultsPackageIter *iter)
+{
+	PkPackage *package = pk_results_package_iter_get_object (iter);
+	PkResultsRealPackageIter *ri = (PkResultsRealPackageIter *) iter;
+	if (package != NULL)
+		return pk_package_get_arch (package);
+	return pk_results_package_iter_get_column (iter, ri->results->priv->package_arches);
+}
+
+/**
+ * pk_results_package_iter_get_data:
+ * @iter: an initialized #PkResultsPackageIter
+ *
+ * Return value: the data section of the current package ID, valid for the life of the results
+ *
+ * Since: 1.3.2
+ **/
+const gchar *
+pk_results_package_iter_get_data (PkResultsPackageIter *iter)
+{
+	PkPackage *package = pk_results_package_iter_get_object (iter);
+	PkResultsRealPackageIter *ri = (PkResultsRealPackageIter *) iter;
+	if (package != NULL)
+		return pk_package_get_data (package);
+	return pk_results_package_iter_get_column (iter, ri->results->priv->package_datas);
+}
+
+/**
+ * pk_results_package_iter_get_summary:
+ * @iter: an initialized #PkResultsPackageIter
+ *
+ * Return value: the summary of the current package, valid for the life of the results
+ *
+ * Since: 1.3.2
+ **/
+const gchar *
+pk_results_package_iter_get_summary (PkResultsPackageIter *iter)
+{
+	PkPackage *package = pk_results_package_iter_get_object (iter);
+	PkResultsRealPackageIter *ri = (PkResultsRealPackageIter *) iter;
+	if (package != NULL)
+		return pk_package_get_summary (package);
+	return pk_results_package_iter_get_column (iter, ri->results->priv->package_summaries);
 }
 
 /**
@@ -897,7 +1368,18 @@ pk_results_init (PkResults *results)
 	results->priv->inputs = 0;
 	results->priv->progress = NULL;
 	results->priv->error_code = NULL;
-	results->priv->package_sack = pk_package_sack_new ();
+	results->priv->package_strings = g_string_chunk_new (16 * 1024);
+	results->priv->package_scratch = g_string_new (NULL);
+	results->priv->package_names = g_ptr_array_new ();
+	results->priv->package_versions = g_ptr_array_new ();
+	results->priv->package_arches = g_ptr_array_new ();
+	results->priv->package_datas = g_ptr_array_new ();
+	results->priv->package_summaries = g_ptr_array_new ();
+	results->priv->package_transaction_ids = g_ptr_array_new ();
+	results->priv->package_infos = g_array_new (FALSE, FALSE, sizeof (guint16));
+	results->priv->package_update_severities = g_array_new (FALSE, FALSE, sizeof (guint16));
+	results->priv->package_objects = g_ptr_array_new_with_free_func (pk_results_package_object_free);
+	results->priv->package_blobs = g_ptr_array_new_with_free_func ((GDestroyNotify) g_bytes_unref);
 	results->priv->details_array = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
 	results->priv->update_detail_array = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
 	results->priv->category_array = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
@@ -931,7 +1413,20 @@ pk_results_finalize (GObject *object)
 	g_ptr_array_unref (priv->eula_required_array);
 	g_ptr_array_unref (priv->media_change_required_array);
 	g_ptr_array_unref (priv->repo_detail_array);
-	g_object_unref (priv->package_sack);
+	g_ptr_array_unref (priv->package_objects);
+	g_ptr_array_unref (priv->package_names);
+	g_ptr_array_unref (priv->package_versions);
+	g_ptr_array_unref (priv->package_arches);
+	g_ptr_array_unref (priv->package_datas);
+	g_ptr_array_unref (priv->package_summaries);
+	g_ptr_array_unref (priv->package_transaction_ids);
+	g_array_unref (priv->package_infos);
+	g_array_unref (priv->package_update_severities);
+	g_string_chunk_free (priv->package_strings);
+	g_string_free (priv->package_scratch, TRUE);
+	g_ptr_array_unref (priv->package_blobs);
+	if (priv->package_sack != NULL)
+		g_object_unref (priv->package_sack);
 	if (results->priv->progress != NULL)
 		g_object_unref (results->priv->progress);
 	if (results->priv->error_code != NULL)
@@ -78,6 +78,21 @@ struct _PkResultsClass
 	void (*_pk_reserved5) (void);
 };
 
+/**
+ * PkResultsPackageIter:
+ *
+ * An opaque structure used to iterate over the packages in a #PkResults
+ * without creating #PkPackage objects.
+ *
+ * Since: 1.3.2
+ **/
+typedef struct {
+	/*< private >*/
+	gpointer	 dummy1;
+	guint		 dummy2;
+	gpointer	 dummy3;
+} PkResultsPackageIter;
+
 GType		 pk_results_get_type		  	(void);
 PkResults	*pk_results_new				(void);
 
@@ -137,6 +152,19 @@ GPtrArray	*pk_results_get_eula_required_array	(PkResults		*results);
 GPtrArray	*pk_results_get_media_change_required_array (PkResults		*results);
 GPtrArray	*pk_results_get_repo_detail_array	(PkResults		*results);
 
+/* iterate packages */
+guint		 pk_results_get_package_count		(PkResults		*results);
+void		 pk_results_package_iter_init		(PkResultsPackageIter	*iter,
+							 PkResults		*results);
+gboolean	 pk_results_package_iter_next		(PkResultsPackageIter	*iter);
+PkInfoEnum	 pk_results_package_iter_get_info	(PkResultsPackageIter	*iter);
+PkInfoEnum	 pk_results_package_iter_get_update_severity (PkResultsPackageIter *iter);
+const gchar	*pk_results_package_iter_get_name	(PkResultsPackageIter	*iter);
+const gchar	*pk_results_package_iter_get_version	(PkResultsPackageIter	*iter);
+const gchar	*pk_results_package_iter_get_arch	(PkResultsPackageIter	*iter);
+const gchar	*pk_results_package_iter_get_data	(PkResultsPackageIter	*iter);
+const gchar	*pk_results_package_iter_get_summary	(PkResultsPackageIter	*iter);
+
 G_END_DECLS
 
 #endif /* __PK_RESULTS_H */
@@ -69,7 +69,6 @@ _g_test_loop_run_with_timeout (guint timeout_ms)
 	g_main_loop_run (_test_loop);
 }
 
-#if 0
 static gboolean
 _g_test_hang_wait_cb (gpointer user_data)
 {
@@ -89,7 +88,6 @@ _g_test_loop_wait (guint timeout_ms)
 	_test_loop_timeout_id = g_timeout_add (timeout_ms, _g_test_hang_wait_cb, &timeout_ms);
 	g_main_loop_run (_test_loop);
 }
-#endif
 
 /*
  * _g_test_loop_quit:
@@ -389,6 +387,53 @@ pk_test_client_get_updates_cb (GObject *object, GAsyncResult *res, gpointer user
 	_g_test_loop_quit ();
 }
 
+typedef struct {
+	guint		 batches;
+	guint		 packages;
+	guint		 stop_after;	/* packages, or 0 to never stop */
+	gboolean	 pause;		/* after the first batch */
+	gchar		*tid;
+} PkTestClientStream;
+
+static PkClientStreamAction
+pk_test_client_stream_cb (PkClient *client, PkResults *batch, gpointer user_data)
+{
+	PkTestClientStream *stream = user_data;
+	g_autoptr(PkProgress) progress = NULL;
+
+	/* nothing is delivered after asking to stop */
+	if (stream->stop_after > 0)
+		g_assert_cmpint (stream->packages, <, stream->stop_after);
+
+	/* only the new packages are in each batch */
+	stream->batches++;
+	stream->packages += pk_results_get_package_count (batch);
+	if (stream->tid == NULL) {
+		g_object_get (batch, "progress", &progress, NULL);
+		stream->tid = g_strdup (pk_progress_get_transaction_id (progress));
+	}
+
+	if (stream->stop_after > 0 && stream->packages >= stream->stop_after)
+		return PK_CLIENT_STREAM_ACTION_STOP;
+	if (stream->pause && stream->batches == 1) {
+		_g_test_loop_quit ();
+		return PK_CLIENT_STREAM_ACTION_PAUSE;
+	}
+	return PK_CLIENT_STREAM_ACTION_CONTINUE;
+}
+
+static void
+pk_test_client_stream_finished_cb (GObject *object, GAsyncResult *res, gpointer user_data)
+{
+	PkResults **results = user_data;
+	g_autoptr(GError) error = NULL;
+
+	*results = pk_client_generic_finish (PK_CLIENT (object), res, &error);
+	g_assert_no_error (error);
+	g_assert (*results != NULL);
+	_g_test_loop_quit ();
+}
+
 static void
 pk_test_client_search_name_cb (GObject *object, GAsyncResult *res, gpointer user_data)
 {
@@ -554,6 +599,7 @@ pk_test_client_func (void)
 	GError *error = NULL;
 	PkProgress *progress;
 	gchar *tid;
+	PkTestClientStream stream = { 0 };
 	PkRoleEnum role;
 	PkStatusEnum status;
 //	PkResults *results;
@@ -670,6 +716,16 @@ pk_test_client_func (void)
 		g_assert_cmpint (_status_cb, >, 0);
 	}
 
+	/* get updates again, streaming the packages as they arrive */
+	pk_client_set_stream_callback (client, pk_test_client_stream_cb, &stream, NULL);
+	pk_client_get_updates_async (client, pk_bitfield_value (PK_FILTER_ENUM_NONE), NULL,
+		     (PkProgressCallback) pk_test_client_progress_cb, NULL,
+		     (GAsyncReadyCallback) pk_test_client_get_updates_cb, NULL);
+	_g_test_loop_run_with_timeout (15000);
+	g_assert_cmpint (stream.packages, ==, 3);
+	pk_client_set_stream_callback (client, NULL, NULL, NULL);
+	g_free (stream.tid);
+
 	/* search by name */
 	cancellable = g_cancellable_new ();
 	values = g_strsplit ("power", "&", -1);
@@ -722,6 +778,77 @@ pk_test_client_func (void)
 #endif
 }
 
+static void
+pk_test_client_stream_func (void)
+{
+	gchar *values[] = { NULL, NULL };
+	PkResults *results = NULL;
+	PkTestClientStream stream = { 0 };
+	g_autoptr(PkClient) client = NULL;
+
+	client = pk_client_new ();
+	pk_client_set_stream_callback (client, pk_test_client_stream_cb, &stream, NULL);
+
+	/* nothing more is delivered while paused */
+	stream.pause = TRUE;
+	values[0] = (gchar *) "stream;100";
+	pk_client_search_names_async (client, pk_bitfield_value (PK_FILTER_ENUM_NONE), values, NULL,
+		     NULL, NULL,
+		     (GAsyncReadyCallback) pk_test_client_stream_finished_cb, &results);
+	_g_test_loop_run_with_timeout (15000);
+	g_assert_cmpint (stream.batches, ==, 1);
+	_g_test_loop_wait (1000);
+	g_assert_cmpint (stream.batches, ==, 1);
+	g_assert (results == NULL);
+
+	/* and the rest arrives once resumed */
+	g_assert (pk_client_resume_stream (client, stream.tid));
+	_g_test_loop_run_with_timeout (15000);
+	g_assert (results != NULL);
+	g_assert_cmpint (pk_results_get_exit_code (results), ==, PK_EXIT_ENUM_SUCCESS);
+	g_assert_cmpint (stream.batches, >, 1);
+	g_assert_cmpint (stream.packages, ==, 100);
+	g_assert_cmpint (pk_results_get_package_count (results), ==, 100);
+	g_assert (!pk_client_resume_stream (client, stream.tid));
+	g_clear_object (&results);
+	g_clear_pointer (&stream.tid, g_free);
+
+	/* stopping cancels the transaction, and no batch comes after it */
+	memset (&stream, 0, sizeof (stream));
+	stream.stop_after = 10;
+	pk_client_search_names_async (client, pk_bitfield_value (PK_FILTER_ENUM_NONE), values, NULL,
+		     NULL, NULL,
+		     (GAsyncReadyCallback) pk_test_client_stream_finished_cb, &results);
+	_g_test_loop_run_with_timeout (15000);
+	g_assert (results != NULL);
+	g_assert_cmpint (pk_results_get_exit_code (results), ==, PK_EXIT_ENUM_CANCELLED);
+	g_assert_cmpint (stream.packages, >=, 10);
+	g_assert_cmpint (stream.packages, <, 100);
+	g_clear_object (&results);
+	g_clear_pointer (&stream.tid, g_free);
+
+	/* the daemon stops holding back signals when there are too many,
+	 * so the transaction completes even if it is never resumed */
+	memset (&stream, 0, sizeof (stream));
+	stream.pause = TRUE;
+	values[0] = (gchar *) "stream;600";
+	pk_client_search_names_async (client, pk_bitfield_value (PK_FILTER_ENUM_NONE), values, NULL,
+		     NULL, NULL,
+		     (GAsyncReadyCallback) pk_test_client_stream_finished_cb, &results);
+	_g_test_loop_run_with_timeout (15000);
+	g_assert_cmpint (stream.batches, ==, 1);
+	_g_test_loop_run_with_timeout (15000);
+	g_assert (results != NULL);
+	g_assert_cmpint (pk_results_get_exit_code (results), ==, PK_EXIT_ENUM_SUCCESS);
+
+	/* with everything held in the client handed over at the end */
+	g_assert_cmpint (stream.batches, ==, 2);
+	g_assert_cmpint (stream.packages, ==, 600);
+	g_assert_cmpint (pk_results_get_package_count (results), ==, 600);
+	g_clear_object (&results);
+	g_clear_pointer (&stream.tid, g_free);
+}
+
 static void
 pk_test_console_func (void)
 {
@@ -1437,6 +1564,7 @@ main (int argc, char **argv)
 	g_test_add_func ("/packagekit-glib2/transaction-list", pk_test_transaction_list_func);
 	g_test_add_func ("/packagekit-glib2/client-helper", pk_test_client_helper_func);
 	g_test_add_func ("/packagekit-glib2/client", pk_test_client_func);
+	g_test_add_func ("/packagekit-glib2/client-stream", pk_test_client_stream_func);
 	g_test_add_func ("/packagekit-glib2/package-sack", pk_test_package_sack_func);
 	g_test_add_func ("/packagekit-glib2/task", pk_test_task_func);
 	g_test_add_func ("/packagekit-glib2/task-wrapper", pk_test_task_wrapper_func);
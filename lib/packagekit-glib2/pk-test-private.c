@@ -23,6 +23,7 @@
 #include "config.h"
 
 #include <glib-object.h>
+#include <unistd.h>
 
 #include "pk-common.h"
 #include "pk-debug.h"
@@ -32,8 +33,11 @@
 #include "pk-package.h"
 #include "pk-package-id.h"
 #include "pk-package-ids.h"
+#include "pk-package-sack.h"
+#include "pk-packages-fd-private.h"
 #include "pk-progress-bar.h"
 #include "pk-results.h"
+#include "pk-results-private.h"
 
 static void
 pk_test_bitfield_func (void)
@@ -596,6 +600,26 @@ pk_test_package_func (void)
 	g_assert_cmpstr (text, ==, "gnome-power-manager;0.1.2;i386;fedora");
 	g_free (text);
 
+	/* set invalid sections */
+	ret = pk_package_set_id_parts (package, "", "0.1.2", "i386", "fedora", &error);
+	g_assert_error (error, 1, 0);
+	g_assert_true (!ret);
+	g_clear_error (&error);
+	ret = pk_package_set_id_parts (package, "gnome-power-manager", "0.1.2", "i386", "fedora;dave", &error);
+	g_assert_error (error, 1, 0);
+	g_assert_true (!ret);
+	g_clear_error (&error);
+
+	/* set valid sections */
+	ret = pk_package_set_id_parts (package, "gnome-packagekit", "3.0", NULL, "installed:fedora", &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	g_assert_cmpstr (pk_package_get_id (package), ==, "gnome-packagekit;3.0;;installed:fedora");
+	g_assert_cmpstr (pk_package_get_name (package), ==, "gnome-packagekit");
+	g_assert_cmpstr (pk_package_get_version (package), ==, "3.0");
+	g_assert_cmpstr (pk_package_get_arch (package), ==, "");
+	g_assert_cmpstr (pk_package_get_data (package), ==, "installed:fedora");
+
 	g_object_unref (package);
 }
 
@@ -910,6 +934,307 @@ pk_test_offline_upgrade_func (void)
 	g_assert_true (!g_file_test (PK_OFFLINE_RESULTS_FILENAME, G_FILE_TEST_EXISTS));
 }
 
+static void
+pk_test_results_iter_func (void)
+{
+	gboolean ret;
+	guint cnt = 0;
+	PkPackage *item;
+	PkResultsPackageIter iter;
+	GError *error = NULL;
+	g_autofree gchar *tid = NULL;
+	g_autoptr(GPtrArray) packages = NULL;
+	g_autoptr(PkPackageSack) sack = NULL;
+	g_autoptr(PkPackageSack) sack2 = NULL;
+	g_autoptr(PkResults) results = NULL;
+
+	/* add a row, an object and then another row */
+	results = pk_results_new ();
+	ret = pk_results_add_package_row (results, PK_INFO_ENUM_INSTALLED,
+					  PK_INFO_ENUM_UNKNOWN,
+					  "powertop;1.8;x86_64;installed",
+					  "Power consumption monitor", FALSE, "/1_abc");
+	g_assert_true (ret);
+	item = pk_package_new ();
+	ret = pk_package_set_id (item, "gnome-power-manager;0.1.2;i386;fedora", &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	g_object_set (item, "info", PK_INFO_ENUM_AVAILABLE, NULL);
+	ret = pk_results_add_package (results, item);
+	g_assert_true (ret);
+	ret = pk_results_add_package_row (results, PK_INFO_ENUM_AVAILABLE,
+					  PK_INFO_ENUM_SECURITY,
+					  "powertop;1.9;x86_64;fedora",
+					  NULL, FALSE, "/1_abc");
+	g_assert_true (ret);
+
+	/* invalid IDs are refused */
+	ret = pk_results_add_package_row (results, PK_INFO_ENUM_AVAILABLE,
+					  PK_INFO_ENUM_UNKNOWN,
+					  ";1.9;x86_64;fedora", NULL, FALSE, NULL);
+	g_assert_false (ret);
+	g_assert_cmpint (pk_results_get_package_count (results), ==, 3);
+
+	/* iterate without creating objects, in order */
+	pk_results_package_iter_init (&iter, results);
+	while (pk_results_package_iter_next (&iter)) {
+		if (cnt == 0) {
+			g_assert_cmpint (pk_results_package_iter_get_info (&iter), ==, PK_INFO_ENUM_INSTALLED);
+			g_assert_cmpstr (pk_results_package_iter_get_name (&iter), ==, "powertop");
+			g_assert_cmpstr (pk_results_package_iter_get_version (&iter), ==, "1.8");
+			g_assert_cmpstr (pk_results_package_iter_get_arch (&iter), ==, "x86_64");
+			g_assert_cmpstr (pk_results_package_iter_get_data (&iter), ==, "installed");
+			g_assert_cmpstr (pk_results_package_iter_get_summary (&iter), ==, "Power consumption monitor");
+		} else if (cnt == 1) {
+			g_assert_cmpstr (pk_results_package_iter_get_name (&iter), ==, "gnome-power-manager");
+		} else {
+			g_assert_cmpint (pk_results_package_iter_get_update_severity (&iter), ==, PK_INFO_ENUM_SECURITY);
+			g_assert_cmpstr (pk_results_package_iter_get_version (&iter), ==, "1.9");
+			g_assert_cmpstr (pk_results_package_iter_get_summary (&iter), ==, "");
+		}
+		cnt++;
+	}
+	g_assert_cmpint (cnt, ==, 3);
+
+	/* the object is kept, and the others are created once */
+	packages = pk_results_get_package_array (results);
+	g_assert_cmpint (packages->len, ==, 3);
+	g_assert_true (g_ptr_array_index (packages, 1) == item);
+	g_assert_cmpstr (pk_package_get_id (g_ptr_array_index (packages, 0)), ==, "powertop;1.8;x86_64;installed");
+	g_object_get (g_ptr_array_index (packages, 0), "transaction-id", &tid, NULL);
+	g_assert_cmpstr (tid, ==, "/1_abc");
+	g_ptr_array_unref (packages);
+	packages = pk_results_get_package_array (results);
+	g_assert_cmpstr (pk_package_get_id (g_ptr_array_index (packages, 2)), ==, "powertop;1.9;x86_64;fedora");
+	g_ptr_array_unref (packages);
+
+	/* the sack is shared, so filtering it is seen by everyone */
+	sack = pk_results_get_package_sack (results);
+	pk_package_sack_remove_package (sack, item);
+	sack2 = pk_results_get_package_sack (results);
+	g_assert_true (sack == sack2);
+	g_assert_cmpint (pk_package_sack_get_size (sack2), ==, 2);
+	packages = pk_results_get_package_array (results);
+	g_assert_cmpint (packages->len, ==, 2);
+
+	/* and by the count and the iterator */
+	g_assert_cmpint (pk_results_get_package_count (results), ==, 2);
+	cnt = 0;
+	pk_results_package_iter_init (&iter, results);
+	while (pk_results_package_iter_next (&iter)) {
+		g_assert_cmpstr (pk_results_package_iter_get_name (&iter), ==, "powertop");
+		g_assert_cmpint (pk_results_package_iter_get_info (&iter), ==,
+				 cnt == 0 ? PK_INFO_ENUM_INSTALLED : PK_INFO_ENUM_AVAILABLE);
+		cnt++;
+	}
+	g_assert_cmpint (cnt, ==, 2);
+
+	/* rows added later still show up */
+	ret = pk_results_add_package_row (results, PK_INFO_ENUM_AVAILABLE,
+					  PK_INFO_ENUM_UNKNOWN,
+					  "colord;1.0;x86_64;fedora",
+					  NULL, FALSE, "/1_abc");
+	g_assert_true (ret);
+	g_ptr_array_unref (packages);
+	packages = pk_results_get_package_array (results);
+	g_assert_cmpint (packages->len, ==, 3);
+	g_assert_cmpint (pk_package_sack_get_size (sack), ==, 3);
+	g_assert_cmpint (pk_results_get_package_count (results), ==, 3);
+	g_object_unref (item);
+}
+
+static void
+pk_test_packages_fd_func (void)
+{
+	gboolean ret;
+	gint fd;
+	PkPackage *item;
+	GError *error = NULL;
+	g_autoptr(GBytes) blob = NULL;
+	g_autoptr(GPtrArray) packages = NULL;
+	g_autoptr(PkResults) results = NULL;
+
+	/* write two packages, one without a summary */
+	packages = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	item = pk_package_new ();
+	ret = pk_package_set_id (item, "gnome-power-manager;0.1.2;i386;fedora", &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	g_object_set (item,
+		      "info", PK_INFO_ENUM_AVAILABLE,
+		      "update-severity", PK_INFO_ENUM_SECURITY,
+		      "summary", "Power manager for GNOME",
+		      NULL);
+	g_ptr_array_add (packages, item);
+	item = pk_package_new ();
+	ret = pk_package_set_id (item, "powertop;1.8;x86_64;installed", &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	g_object_set (item, "info", PK_INFO_ENUM_INSTALLED, NULL);
+	g_ptr_array_add (packages, item);
+	fd = pk_packages_fd_new (packages, &error);
+	g_assert_no_error (error);
+	g_assert_cmpint (fd, >=, 0);
+
+	/* map it back */
+	blob = pk_packages_fd_map (fd, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (blob);
+	close (fd);
+
+	/* the packages only exist once they are asked for */
+	results = pk_results_new ();
+	pk_results_add_package_blob (results, blob, "/42_abcdef");
+	g_ptr_array_unref (packages);
+	packages = pk_results_get_package_array (results);
+	g_assert_cmpint (packages->len, ==, 2);
+	item = g_ptr_array_index (packages, 0);
+	g_assert_cmpstr (pk_package_get_id (item), ==, "gnome-power-manager;0.1.2;i386;fedora");
+	g_assert_cmpint (pk_package_get_info (item), ==, PK_INFO_ENUM_AVAILABLE);
+	g_assert_cmpint (pk_package_get_update_severity (item), ==, PK_INFO_ENUM_SECURITY);
+	g_assert_cmpstr (pk_package_get_summary (item), ==, "Power manager for GNOME");
+	item = g_ptr_array_index (packages, 1);
+	g_assert_cmpstr (pk_package_get_id (item), ==, "powertop;1.8;x86_64;installed");
+	g_assert_cmpint (pk_package_get_info (item), ==, PK_INFO_ENUM_INSTALLED);
+	g_assert_cmpstr (pk_package_get_summary (item), ==, "");
+}
+
+static gboolean
+pk_test_package_sack_filter_cb (PkPackage *package, gpointer user_data)
+{
+	return g_strcmp0 (pk_package_get_arch (package), "i386") != 0;
+}
+
+static void
+pk_test_package_sack_func (void)
+{
+	gboolean ret;
+	guint i;
+	guint n_names = g_test_perf () ? 100000 : 10000;
+	PkPackage *item;
+	GError *error = NULL;
+	g_autoptr(GPtrArray) packages = NULL;
+	g_autoptr(PkPackageSack) sack = NULL;
+
+	/* two versions of every package for x86_64, one for i386 */
+	sack = pk_package_sack_new ();
+	for (i = 0; i < n_names; i++) {
+		g_autofree gchar *id1 = g_strdup_printf ("pkg%u;1.0;x86_64;fedora", i);
+		g_autofree gchar *id2 = g_strdup_printf ("pkg%u;2.0;x86_64;updates", i);
+		g_autofree gchar *id3 = g_strdup_printf ("pkg%u;1.0;i386;fedora", i);
+		ret = pk_package_sack_add_package_by_id (sack, id1, &error);
+		g_assert_no_error (error);
+		g_assert_true (ret);
+		ret = pk_package_sack_add_package_by_id (sack, id2, &error);
+		g_assert_no_error (error);
+		g_assert_true (ret);
+		ret = pk_package_sack_add_package_by_id (sack, id3, &error);
+		g_assert_no_error (error);
+		g_assert_true (ret);
+	}
+	g_assert_cmpint (pk_package_sack_get_size (sack), ==, n_names * 3);
+
+	/* the first package added wins */
+	item = pk_package_sack_find_by_id_name_arch (sack, "pkg7;9.9;x86_64;koji");
+	g_assert_nonnull (item);
+	g_assert_cmpstr (pk_package_get_id (item), ==, "pkg7;1.0;x86_64;fedora");
+	g_object_unref (item);
+	item = pk_package_sack_find_by_id_name_arch (sack, "pkg7;9.9;armv7l;koji");
+	g_assert_null (item);
+
+	/* look up every package by name and arch */
+	g_test_timer_start ();
+	for (i = 0; i < n_names; i++) {
+		g_autofree gchar *id = g_strdup_printf ("pkg%u;;i386;", i);
+		item = pk_package_sack_find_by_id_name_arch (sack, id);
+		g_assert_nonnull (item);
+		g_object_unref (item);
+	}
+	g_test_message ("%u name+arch lookups took %.3fs", n_names, g_test_timer_elapsed ());
+
+	/* removing the first version promotes the second */
+	g_test_timer_start ();
+	for (i = 0; i < n_names; i++) {
+		g_autofree gchar *id = g_strdup_printf ("pkg%u;1.0;x86_64;fedora", i);
+		ret = pk_package_sack_remove_package_by_id (sack, id);
+		g_assert_true (ret);
+	}
+	g_test_message ("%u removals by id took %.3fs", n_names, g_test_timer_elapsed ());
+	g_assert_cmpint (pk_package_sack_get_size (sack), ==, n_names * 2);
+	ret = pk_package_sack_remove_package_by_id (sack, "pkg7;1.0;x86_64;fedora");
+	g_assert_false (ret);
+	item = pk_package_sack_find_by_id_name_arch (sack, "pkg7;;x86_64;");
+	g_assert_nonnull (item);
+	g_assert_cmpstr (pk_package_get_id (item), ==, "pkg7;2.0;x86_64;updates");
+	g_object_unref (item);
+
+	/* drop all the i386 packages in one go */
+	g_test_timer_start ();
+	ret = pk_package_sack_remove_by_filter (sack, pk_test_package_sack_filter_cb, NULL);
+	g_assert_true (ret);
+	g_test_message ("filtering %u packages took %.3fs", n_names * 2, g_test_timer_elapsed ());
+	g_assert_cmpint (pk_package_sack_get_size (sack), ==, n_names);
+	item = pk_package_sack_find_by_id_name_arch (sack, "pkg7;;i386;");
+	g_assert_null (item);
+	item = pk_package_sack_find_by_id (sack, "pkg7;1.0;i386;fedora");
+	g_assert_null (item);
+	item = pk_package_sack_find_by_id (sack, "pkg7;2.0;x86_64;updates");
+	g_assert_nonnull (item);
+	g_object_unref (item);
+
+	/* sorting keeps the indexes in step */
+	pk_package_sack_sort (sack, PK_PACKAGE_SACK_SORT_TYPE_PACKAGE_ID);
+	item = pk_package_sack_find_by_id_name_arch (sack, "pkg42;;x86_64;");
+	g_assert_nonnull (item);
+	g_assert_cmpstr (pk_package_get_id (item), ==, "pkg42;2.0;x86_64;updates");
+	g_object_unref (item);
+
+	/* removing keeps the order of the other packages, and the indexes
+	 * still give the first match */
+	pk_package_sack_clear (sack);
+	ret = pk_package_sack_add_package_by_id (sack, "bar;1.0;x86_64;fedora", &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	ret = pk_package_sack_add_package_by_id (sack, "foo;1.0;x86_64;fedora", &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	ret = pk_package_sack_add_package_by_id (sack, "foo;2.0;x86_64;updates", &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	ret = pk_package_sack_add_package_by_id (sack, "baz;1.0;x86_64;fedora", &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	ret = pk_package_sack_remove_package_by_id (sack, "bar;1.0;x86_64;fedora");
+	g_assert_true (ret);
+	packages = pk_package_sack_get_array (sack);
+	g_assert_cmpint (packages->len, ==, 3);
+	g_assert_cmpstr (pk_package_get_id (g_ptr_array_index (packages, 0)), ==, "foo;1.0;x86_64;fedora");
+	g_assert_cmpstr (pk_package_get_id (g_ptr_array_index (packages, 1)), ==, "foo;2.0;x86_64;updates");
+	g_assert_cmpstr (pk_package_get_id (g_ptr_array_index (packages, 2)), ==, "baz;1.0;x86_64;fedora");
+	item = pk_package_sack_find_by_id_name_arch (sack, "foo;;x86_64;");
+	g_assert_nonnull (item);
+	g_assert_cmpstr (pk_package_get_id (item), ==, "foo;1.0;x86_64;fedora");
+
+	/* the same object is not removed twice */
+	ret = pk_package_sack_remove_package (sack, item);
+	g_assert_true (ret);
+	ret = pk_package_sack_remove_package (sack, item);
+	g_assert_false (ret);
+	g_object_unref (item);
+	g_assert_cmpint (pk_package_sack_get_size (sack), ==, 2);
+	item = pk_package_sack_find_by_id_name_arch (sack, "foo;;x86_64;");
+	g_assert_nonnull (item);
+	g_assert_cmpstr (pk_package_get_id (item), ==, "foo;2.0;x86_64;updates");
+
+	/* positions after the gap were moved down too */
+	ret = pk_package_sack_remove_package_by_id (sack, "baz;1.0;x86_64;fedora");
+	g_assert_true (ret);
+	ret = pk_package_sack_remove_package (sack, item);
+	g_assert_true (ret);
+	g_object_unref (item);
+	g_assert_cmpint (pk_package_sack_get_size (sack), ==, 0);
+}
+
 int
 main (int argc, char **argv)
 {
@@ -929,7 +1254,10 @@ main (int argc, char **argv)
 	g_test_add_func ("/packagekit-glib2/package-ids", pk_test_package_ids_func);
 	g_test_add_func ("/packagekit-glib2/progress", pk_test_progress_func);
 	g_test_add_func ("/packagekit-glib2/results", pk_test_results_func);
+	g_test_add_func ("/packagekit-glib2/results-iter", pk_test_results_iter_func);
+	g_test_add_func ("/packagekit-glib2/packages-fd", pk_test_packages_fd_func);
 	g_test_add_func ("/packagekit-glib2/package", pk_test_package_func);
+	g_test_add_func ("/packagekit-glib2/package-sack", pk_test_package_sack_func);
 	g_test_add_func ("/packagekit-glib2/progress-bar", pk_test_progress_bar);
 	g_test_add_func ("/packagekit-glib2/offline", pk_test_offline_func);
 	g_test_add_func ("/packagekit-glib2/offline-upgrade", pk_test_offline_upgrade_func);
@@ -56,6 +56,8 @@ struct _PkTransactionPastPrivate
 	gchar				*data;
 	guint				 uid;
 	gchar				*cmdline;
+	guint				 queue_time; /* ms */
+	guint				 first_result_time; /* ms */
 };
 
 enum {
@@ -68,6 +70,8 @@ enum {
 	PROP_DATA,
 	PROP_UID,
 	PROP_CMDLINE,
+	PROP_QUEUE_TIME,
+	PROP_FIRST_RESULT_TIME,
 	PROP_LAST
 };
 
@@ -203,6 +207,40 @@ pk_transaction_past_get_duration (PkTransactionPast *past)
 	return past->priv->duration;
 }
 
+/**
+ * pk_transaction_past_get_queue_time:
+ * @past: a valid #PkTransactionPast instance
+ *
+ * Gets how long the transaction waited before it was started;
+ *
+ * Return value: The time spent queued in ms
+ *
+ * Since: 1.3.2
+ **/
+guint
+pk_transaction_past_get_queue_time (PkTransactionPast *past)
+{
+	g_return_val_if_fail (PK_IS_TRANSACTION_PAST (past), 0);
+	return past->priv->queue_time;
+}
+
+/**
+ * pk_transaction_past_get_first_result_time:
+ * @past: a valid #PkTransactionPast instance
+ *
+ * Gets how long the transaction ran before it emitted its first result;
+ *
+ * Return value: The time to the first result in ms, or 0 if there were none
+ *
+ * Since: 1.3.2
+ **/
+guint
+pk_transaction_past_get_first_result_time (PkTransactionPast *past)
+{
+	g_return_val_if_fail (PK_IS_TRANSACTION_PAST (past), 0);
+	return past->priv->first_result_time;
+}
+
 /**
  * pk_transaction_past_get_data:
  * @past: a valid #PkTransactionPast instance
@@ -288,6 +326,12 @@ pk_transaction_past_get_property (GObject *object, guint prop_id, GValue *value,
 	case PROP_CMDLINE:
 		g_value_set_string (value, priv->cmdline);
 		break;
+	case PROP_QUEUE_TIME:
+		g_value_set_uint (value, priv->queue_time);
+		break;
+	case PROP_FIRST_RESULT_TIME:
+		g_value_set_uint (value, priv->first_result_time);
+		break;
 	default:
 		G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
 		break;
@@ -332,6 +376,12 @@ pk_transaction_past_set_property (GObject *object, guint prop_id, const GValue *
 		g_free (priv->cmdline);
 		priv->cmdline = g_strdup (g_value_get_string (value));
 		break;
+	case PROP_QUEUE_TIME:
+		priv->queue_time = g_value_get_uint (value);
+		break;
+	case PROP_FIRST_RESULT_TIME:
+		priv->first_result_time = g_value_get_uint (value);
+		break;
 	default:
 		G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
 		break;
@@ -430,6 +480,26 @@ pk_transaction_past_class_init (PkTransactionPastClass *klass)
 				     G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
 	g_object_class_install_property (object_class, PROP_CMDLINE, pspec);
 
+	/**
+	 * PkTransactionPast:queue-time:
+	 *
+	 * Since: 1.3.2
+	 */
+	pspec = g_param_spec_uint ("queue-time", NULL, NULL,
+				   0, G_MAXUINT, 0,
+				   G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+	g_object_class_install_property (object_class, PROP_QUEUE_TIME, pspec);
+
+	/**
+	 * PkTransactionPast:first-result-time:
+	 *
+	 * Since: 1.3.2
+	 */
+	pspec = g_param_spec_uint ("first-result-time", NULL, NULL,
+				   0, G_MAXUINT, 0,
+				   G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+	g_object_class_install_property (object_class, PROP_FIRST_RESULT_TIME, pspec);
+
 	g_type_class_add_private (klass, sizeof (PkTransactionPastPrivate));
 }
 
@@ -75,6 +75,8 @@ GDateTime		*pk_transaction_past_get_datetime	(PkTransactionPast	*past);
 gint64			 pk_transaction_past_get_timestamp	(PkTransactionPast	*past);
 gboolean		 pk_transaction_past_get_succeeded	(PkTransactionPast	*past);
 guint			 pk_transaction_past_get_duration	(PkTransactionPast	*past);
+guint			 pk_transaction_past_get_queue_time	(PkTransactionPast	*past);
+guint			 pk_transaction_past_get_first_result_time (PkTransactionPast	*past);
 guint			 pk_transaction_past_get_uid		(PkTransactionPast	*past);
 PkRoleEnum		 pk_transaction_past_get_role		(PkTransactionPast	*past);
 
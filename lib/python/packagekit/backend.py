@@ -25,6 +25,7 @@
 from __future__ import print_function
 
 import sys
+import struct
 import traceback
 import os.path
 
@@ -33,6 +34,37 @@ from .enums import *
 PACKAGE_IDS_DELIM = '&'
 FILENAME_DELIM = '|'
 
+# the binary protocol, see pk-spawn.c and pk-backend-spawn.c; the opcodes
+# must match PkBackendSpawnOp and are never renumbered
+FRAME_MAGIC = b'\x1e'
+FRAME_OPCODES = {
+    'hello': 1,
+    'package': 2,
+    'packages': 3,
+    'details': 4,
+    'finished': 5,
+    'files': 6,
+    'repo-detail': 7,
+    'updatedetail': 8,
+    'percentage': 9,
+    'item-progress': 10,
+    'error': 11,
+    'requirerestart': 12,
+    'status': 13,
+    'speed': 14,
+    'download-size-remaining': 15,
+    'allow-cancel': 16,
+    'no-percentage-updates': 17,
+    'repo-signature-required': 18,
+    'eula-required': 19,
+    'media-change-required': 20,
+    'distro-upgrade': 21,
+    'category': 22,
+}
+
+# number of packages sent in one 'packages' frame
+PACKAGES_BATCH_SIZE = 128
+
 def _to_unicode(txt, encoding='utf-8'):
     if isinstance(txt, str):
         if not isinstance(txt, str):
@@ -67,7 +99,20 @@ class PackageKitBaseBackend:
         self.interactive = False
         self.cache_age = 0
         self.percentage_old = 0
+        self._packages = []
+        # the binary protocol needs python 3, older helpers keep using text
+        self._framed = os.environ.get('FRAMING') == 'binary' and sys.version_info[0] >= 3
+        self._read_environment()
+
+        # tell the daemon we can take commands as frames
+        if self._framed:
+            self._write('hello')
 
+    def _read_environment(self):
+        '''
+        Read the per-transaction settings, which are sent along with every
+        command when using the binary protocol
+        '''
         # try to get LANG
         try:
             self.lang = os.environ['LANG']
@@ -107,6 +152,31 @@ class PackageKitBaseBackend:
         except KeyError as e:
             pass
 
+    def _write(self, command, *fields):
+        '''
+        Send one command to the daemon, as a frame if the daemon asked for the
+        binary protocol and knows the command, otherwise as a line of text
+        '''
+        if self._packages:
+            self._flush_packages()
+        fields = [str(field) for field in fields]
+        opcode = FRAME_OPCODES.get(command) if self._framed else None
+        if opcode is None:
+            sys.stdout.write(_to_utf8('\t'.join([command] + fields) + '\n'))
+            sys.stdout.flush()
+            return
+        payload = bytes([opcode])
+        for field in fields:
+            payload += field.encode('utf-8', errors='replace').replace(b'\0', b' ') + b'\0'
+        sys.stdout.flush()
+        sys.stdout.buffer.write(FRAME_MAGIC + struct.pack('<I', len(payload)) + payload)
+        sys.stdout.buffer.flush()
+
+    def _flush_packages(self):
+        fields = self._packages
+        self._packages = []
+        self._write('packages', *fields)
+
     def doLock(self):
         ''' Generic locking, overide and extend in child class'''
         self._locked = True
@@ -124,9 +194,9 @@ class PackageKitBaseBackend:
         @param percent: Progress percentage (int preferred)
         '''
         if percent == None:
-            sys.stdout.write(_to_utf8("no-percentage-updates\n"))
+            self._write("no-percentage-updates")
         elif percent == 0 or percent > self.percentage_old:
-            sys.stdout.write(_to_utf8("percentage\t%i\n" % percent))
+            self._write("percentage", "%i" % percent)
             self.percentage_old = percent
         sys.stdout.flush()
 
@@ -135,8 +205,7 @@ class PackageKitBaseBackend:
         Write progress speed
         @param bps: Progress speed (int, bytes per second)
         '''
-        sys.stdout.write(_to_utf8("speed\t%i\n" % bps))
-        sys.stdout.flush()
+        self._write("speed", "%i" % bps)
 
     def item_progress(self, package_id, status, percent=None):
         '''
@@ -144,8 +213,7 @@ class PackageKitBaseBackend:
         @param package_id: The package ID name, e.g. openoffice-clipart;2.6.22;ppc64;fedora
         @param percent: percentage of the current item (int preferred)
         '''
-        sys.stdout.write(_to_utf8("item-progress\t%s\t%s\t%i\n" % (package_id, status, percent)))
-        sys.stdout.flush()
+        self._write("item-progress", package_id, status, "%i" % percent)
 
     def error(self, err, description, exit=True):
         '''
@@ -159,8 +227,7 @@ class PackageKitBaseBackend:
             self.unLock()
 
         # this should be fast now
-        sys.stdout.write(_to_utf8("error\t%s\t%s\n" % (err, description)))
-        sys.stdout.flush()
+        self._write("error", err, description)
         if exit:
             # Paradoxically, we don't want to print "finished" to stdout here.
             # Python takes an _enormous_ amount of time to exit, and leaves a
@@ -174,8 +241,7 @@ class PackageKitBaseBackend:
         send 'message' signal
         @param typ: MESSAGE_BROKEN_MIRROR
         '''
-        sys.stdout.write(_to_utf8("message\t%s\t%s\n" % (typ, msg)))
-        sys.stdout.flush()
+        self._write("message", typ, msg)
 
     def package(self, package_id, status, summary):
         '''
@@ -184,8 +250,14 @@ class PackageKitBaseBackend:
         @param package_id: The package ID name, e.g. openoffice-clipart;2.6.22;ppc64;fedora
         @param summary: The package Summary
         '''
-        sys.stdout.write(_to_utf8("package\t%s\t%s\t%s\n" % (status, package_id, summary)))
-        sys.stdout.flush()
+        if not self._framed:
+            self._write("package", status, package_id, summary)
+            return
+
+        # batch these up, they are sent before any other command
+        self._packages.extend((status, package_id, summary))
+        if len(self._packages) >= 3 * PACKAGES_BATCH_SIZE:
+            self._flush_packages()
 
     def media_change_required(self, mtype, id, text):
         '''
@@ -194,8 +266,7 @@ class PackageKitBaseBackend:
         @param id: the localised label of the media
         @param text: the localised text describing the media
         '''
-        sys.stdout.write(_to_utf8("media-change-required\t%s\t%s\t%s\n" % (mtype, id, text)))
-        sys.stdout.flush()
+        self._write("media-change-required", mtype, id, text)
 
     def distro_upgrade(self, dtype, name, summary):
         '''
@@ -204,16 +275,14 @@ class PackageKitBaseBackend:
         @param name: The distro name, e.g. "fedora-9"
         @param summary: The localised distribution name and description
         '''
-        sys.stdout.write(_to_utf8("distro-upgrade\t%s\t%s\t%s\n" % (dtype, name, summary)))
-        sys.stdout.flush()
+        self._write("distro-upgrade", dtype, name, summary)
 
     def status(self, state):
         '''
         send 'status' signal
         @param state: STATUS_DOWNLOAD, STATUS_INSTALL, STATUS_UPDATE, STATUS_REMOVE, STATUS_WAIT
         '''
-        sys.stdout.write(_to_utf8("status\t%s\n" % state))
-        sys.stdout.flush()
+        self._write("status", state)
 
     def repo_detail(self, repoid, name, state):
         '''
@@ -221,16 +290,14 @@ class PackageKitBaseBackend:
         @param repoid: The repo id tag
         @param state: false is repo is disabled else true.
         '''
-        sys.stdout.write(_to_utf8("repo-detail\t%s\t%s\t%s\n" % (repoid, name, _bool_to_string(state))))
-        sys.stdout.flush()
+        self._write("repo-detail", repoid, name, _bool_to_string(state))
 
     def data(self, data):
         '''
         send 'data' signal:
         @param data:  The current worked on package
         '''
-        sys.stdout.write(_to_utf8("data\t%s\n" % data))
-        sys.stdout.flush()
+        self._write("data", data)
 
     def details(self, package_id, summary, package_license, group, desc, url, bytes):
         '''
@@ -243,16 +310,14 @@ class PackageKitBaseBackend:
         @param url: The upstream project homepage
         @param bytes: The size of the package, in bytes
         '''
-        sys.stdout.write(_to_utf8("details\t%s\t%s\t%s\t%s\t%s\t%s\t%ld\n" % (package_id, summary, package_license, group, desc, url, bytes)))
-        sys.stdout.flush()
+        self._write("details", package_id, summary, package_license, group, desc, url, "%ld" % bytes)
 
     def files(self, package_id, file_list):
         '''
         Send 'files' signal
         @param file_list: List of the files in the package, separated by ';'
         '''
-        sys.stdout.write(_to_utf8("files\t%s\t%s\n" % (package_id, file_list)))
-        sys.stdout.flush()
+        self._write("files", package_id, file_list)
 
     def category(self, parent_id, cat_id, name, summary, icon):
         '''
@@ -263,15 +328,13 @@ class PackageKitBaseBackend:
         summery   : a summary of the category in current locale.
         icon      : an icon name to represent the category
         '''
-        sys.stdout.write(_to_utf8("category\t%s\t%s\t%s\t%s\t%s\n" % (parent_id, cat_id, name, summary, icon)))
-        sys.stdout.flush()
+        self._write("category", parent_id, cat_id, name, summary, icon)
 
     def finished(self):
         '''
         Send 'finished' signal
         '''
-        sys.stdout.write(_to_utf8("finished\n"))
-        sys.stdout.flush()
+        self._write("finished")
 
     def update_detail(self, package_id, updates, obsoletes, vendor_url, bugzilla_url, cve_url, restart, update_text, changelog, state, issued, updated):
         '''
@@ -289,8 +352,7 @@ class PackageKitBaseBackend:
         @param issued:
         @param updated:
         '''
-        sys.stdout.write(_to_utf8("updatedetail\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\n" % (package_id, updates, obsoletes, vendor_url, bugzilla_url, cve_url, restart, update_text, changelog, state, issued, updated)))
-        sys.stdout.flush()
+        self._write("updatedetail", package_id, updates, obsoletes, vendor_url, bugzilla_url, cve_url, restart, update_text, changelog, state, issued, updated)
 
     def require_restart(self, restart_type, details):
         '''
@@ -298,8 +360,7 @@ class PackageKitBaseBackend:
         @param restart_type: RESTART_SYSTEM, RESTART_APPLICATION, RESTART_SESSION
         @param details: Optional details about the restart
         '''
-        sys.stdout.write(_to_utf8("requirerestart\t%s\t%s\n" % (restart_type, details)))
-        sys.stdout.flush()
+        self._write("requirerestart", restart_type, details)
 
     def allow_cancel(self, allow):
         '''
@@ -310,8 +371,7 @@ class PackageKitBaseBackend:
             data = 'true'
         else:
             data = 'false'
-        sys.stdout.write(_to_utf8("allow-cancel\t%s\n" % data))
-        sys.stdout.flush()
+        self._write("allow-cancel", data)
 
     def repo_signature_required(self, package_id, repo_name, key_url, key_userid, key_id, key_fingerprint, key_timestamp, sig_type):
         '''
@@ -325,10 +385,8 @@ class PackageKitBaseBackend:
         @param key_timestamp:   Key timestamp
         @param sig_type:        Key type (GPG)
         '''
-        sys.stdout.write(_to_utf8("repo-signature-required\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\n" % (
-            package_id, repo_name, key_url, key_userid, key_id, key_fingerprint, key_timestamp, sig_type
-            )))
-        sys.stdout.flush()
+        self._write("repo-signature-required",
+            package_id, repo_name, key_url, key_userid, key_id, key_fingerprint, key_timestamp, sig_type)
 
     def eula_required(self, eula_id, package_id, vendor_name, license_agreement):
         '''
@@ -338,10 +396,8 @@ class PackageKitBaseBackend:
         @param vendor_name:     Name of the vendor that wrote the EULA
         @param license_agreement: The license text
         '''
-        sys.stdout.write(_to_utf8("eula-required\t%s\t%s\t%s\t%s\n" % (
-            eula_id, package_id, vendor_name, license_agreement
-            )))
-        sys.stdout.flush()
+        self._write("eula-required",
+            eula_id, package_id, vendor_name, license_agreement)
 
 #
 # Backend Action Methods
@@ -724,19 +780,51 @@ class PackageKitBaseBackend:
             self.error(ERROR_INTERNAL_ERROR, errmsg, exit=False)
             self.finished()
 
+    def _read_frame(self, stdin):
+        '''
+        Read the rest of a command frame, which is the number of arguments and
+        environment entries followed by all of them NUL terminated
+        '''
+        size = struct.unpack('<I', stdin.read(4))[0]
+        payload = stdin.read(size)
+        n_args, n_env = struct.unpack('<II', payload[:8])
+        fields = [field.decode('utf-8', errors='replace') for field in payload[8:].split(b'\0')]
+        env = {}
+        for item in fields[n_args:n_args + n_env]:
+            key, _, value = item.partition('=')
+            env[key] = value
+        return fields[:n_args], env
+
     def dispatcher(self, args):
         if len(args) > 0:
             self.dispatch_command(args[0], args[1:])
         while True:
+            env = None
             try:
-                line = sys.stdin.readline().strip('\n')
+                if self._framed:
+                    line = sys.stdin.buffer.read(1)
+                    if line == FRAME_MAGIC:
+                        args, env = self._read_frame(sys.stdin.buffer)
+                        line = '\t'.join(args)
+                    else:
+                        line = line + sys.stdin.buffer.readline()
+                        line = line.decode('utf-8', errors='replace').strip('\n')
+                else:
+                    line = sys.stdin.readline().strip('\n')
             except IOError as e:
                 self.error(ERROR_TRANSACTION_CANCELLED, 'could not read from stdin: %s' % str(e))
             except KeyboardInterrupt as e:
                 self.error(ERROR_PROCESS_KILL, 'process was killed by ctrl-c: %s' % str(e))
             if not line or line == 'exit':
                 break
-            args = line.split('\t')
+
+            # frames carry the environment of the new transaction
+            if env is not None:
+                os.environ.clear()
+                os.environ.update(env)
+                self._read_environment()
+            else:
+                args = line.split('\t')
             self.dispatch_command(args[0], args[1:])
 
         # unlock backend and exit with success
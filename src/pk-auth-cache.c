@@ -0,0 +1,211 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 The PackageKit Authors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#include <glib.h>
+
+#include "pk-auth-cache.h"
+
+#define PK_AUTH_CACHE_GET_PRIVATE(o) (G_TYPE_INSTANCE_GET_PRIVATE ((o), PK_TYPE_AUTH_CACHE, PkAuthCachePrivate))
+
+#define PK_AUTH_CACHE_TIMEOUT_DEFAULT	10 /* s */
+
+/*
+ * Remembers that a caller was allowed to do an action without having to
+ * interact with anyone, either because the policy says so or because polkit
+ * retained an earlier authentication, so that polkit would say the same
+ * again.
+ *
+ * Entries are keyed on the sender and the action only. Rules that look at
+ * the package_ids or cmdline details therefore see the first answer reused
+ * for other packages until the entry expires; administrators relying on
+ * such rules should set AuthorizationCacheTimeout=0.
+ */
+struct PkAuthCachePrivate
+{
+	GHashTable		*entries;	/* "sender\naction" : gint64 expiry */
+	guint			 timeout;	/* s, where 0 turns the cache off */
+	PolkitAuthority		*authority;	/* (nullable) */
+	gulong			 authority_changed_id;
+};
+
+G_DEFINE_TYPE (PkAuthCache, pk_auth_cache, G_TYPE_OBJECT)
+
+static gchar *
+pk_auth_cache_key (const gchar *sender, const gchar *action_id)
+{
+	return g_strdup_printf ("%s\n%s", sender, action_id);
+}
+
+static gboolean
+pk_auth_cache_expired_cb (gpointer key, gpointer value, gpointer user_data)
+{
+	return *((gint64 *) value) <= *((gint64 *) user_data);
+}
+
+static void
+pk_auth_cache_authority_changed_cb (PolkitAuthority *authority, PkAuthCache *cache)
+{
+	g_debug ("polkit configuration changed, forgetting %u authorizations",
+		 g_hash_table_size (cache->priv->entries));
+	pk_auth_cache_invalidate (cache);
+}
+
+/**
+ * pk_auth_cache_set_authority:
+ *
+ * Forget everything whenever polkit says that its configuration or the
+ * sessions changed.
+ **/
+void
+pk_auth_cache_set_authority (PkAuthCache *cache, PolkitAuthority *authority)
+{
+	PkAuthCachePrivate *priv = cache->priv;
+
+	g_return_if_fail (PK_IS_AUTH_CACHE (cache));
+	g_return_if_fail (POLKIT_IS_AUTHORITY (authority));
+
+	if (priv->authority != NULL) {
+		g_signal_handler_disconnect (priv->authority, priv->authority_changed_id);
+		g_object_unref (priv->authority);
+	}
+	priv->authority = g_object_ref (authority);
+	priv->authority_changed_id =
+		g_signal_connect (priv->authority, "changed",
+				  G_CALLBACK (pk_auth_cache_authority_changed_cb), cache);
+}
+
+/**
+ * pk_auth_cache_lookup:
+ *
+ * Return value: %TRUE if @sender was recently allowed to do @action_id
+ **/
+gboolean
+pk_auth_cache_lookup (PkAuthCache *cache, const gchar *sender, const gchar *action_id)
+{
+	gint64 *expiry;
+	g_autofree gchar *key = NULL;
+
+	g_return_val_if_fail (PK_IS_AUTH_CACHE (cache), FALSE);
+
+	if (sender == NULL)
+		return FALSE;
+	key = pk_auth_cache_key (sender, action_id);
+	expiry = g_hash_table_lookup (cache->priv->entries, key);
+	if (expiry == NULL)
+		return FALSE;
+	if (*expiry <= g_get_monotonic_time ()) {
+		g_hash_table_remove (cache->priv->entries, key);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/**
+ * pk_auth_cache_add:
+ *
+ * As the answer also depends on the session of the caller staying active
+ * it is only kept for a few seconds.
+ **/
+void
+pk_auth_cache_add (PkAuthCache *cache, const gchar *sender, const gchar *action_id)
+{
+	PkAuthCachePrivate *priv = cache->priv;
+	gint64 now = g_get_monotonic_time ();
+	gint64 *expiry;
+
+	g_return_if_fail (PK_IS_AUTH_CACHE (cache));
+
+	if (priv->timeout == 0 || sender == NULL)
+		return;
+
+	/* callers come and go, so don't let the old ones pile up */
+	g_hash_table_foreach_remove (priv->entries, pk_auth_cache_expired_cb, &now);
+
+	expiry = g_new (gint64, 1);
+	*expiry = now + (gint64) priv->timeout * G_USEC_PER_SEC;
+	g_hash_table_insert (priv->entries,
+			     pk_auth_cache_key (sender, action_id),
+			     expiry);
+}
+
+void
+pk_auth_cache_invalidate (PkAuthCache *cache)
+{
+	g_return_if_fail (PK_IS_AUTH_CACHE (cache));
+	g_hash_table_remove_all (cache->priv->entries);
+}
+
+guint
+pk_auth_cache_get_size (PkAuthCache *cache)
+{
+	g_return_val_if_fail (PK_IS_AUTH_CACHE (cache), 0);
+	return g_hash_table_size (cache->priv->entries);
+}
+
+static void
+pk_auth_cache_finalize (GObject *object)
+{
+	PkAuthCache *cache = PK_AUTH_CACHE (object);
+	PkAuthCachePrivate *priv = cache->priv;
+
+	if (priv->authority != NULL) {
+		g_signal_handler_disconnect (priv->authority, priv->authority_changed_id);
+		g_object_unref (priv->authority);
+	}
+	g_hash_table_unref (priv->entries);
+
+	G_OBJECT_CLASS (pk_auth_cache_parent_class)->finalize (object);
+}
+
+static void
+pk_auth_cache_class_init (PkAuthCacheClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+	object_class->finalize = pk_auth_cache_finalize;
+
+	g_type_class_add_private (klass, sizeof (PkAuthCachePrivate));
+}
+
+static void
+pk_auth_cache_init (PkAuthCache *cache)
+{
+	cache->priv = PK_AUTH_CACHE_GET_PRIVATE (cache);
+	cache->priv->entries = g_hash_table_new_full (g_str_hash, g_str_equal,
+						      g_free, g_free);
+}
+
+PkAuthCache *
+pk_auth_cache_new (GKeyFile *conf)
+{
+	PkAuthCache *cache;
+	gint timeout;
+	g_autoptr(GError) error = NULL;
+
+	cache = PK_AUTH_CACHE (g_object_new (PK_TYPE_AUTH_CACHE, NULL));
+	timeout = g_key_file_get_integer (conf, "Daemon",
+					  "AuthorizationCacheTimeout", &error);
+	if (error != NULL)
+		timeout = PK_AUTH_CACHE_TIMEOUT_DEFAULT;
+	cache->priv->timeout = MAX (timeout, 0);
+	return cache;
+}
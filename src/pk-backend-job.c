@@ -94,6 +94,10 @@ struct PkBackendJobPrivate
 	GCancellable		*cancellable;
 	PkBackend		*backend;
 	PkBackendJobVFuncItem	 vfunc_items[PK_BACKEND_SIGNAL_LAST];
+	GMutex			 queue_mutex;
+	GPtrArray		*queue;
+	gpointer		 queue_latest[PK_BACKEND_SIGNAL_LAST];
+	gboolean		 queue_source_pending;
 	PkBitfield		 transaction_flags;
 	GKeyFile		*conf;
 	PkExitEnum		 exit;
@@ -108,6 +112,7 @@ struct PkBackendJobPrivate
 	PkStatusEnum		 status;
 	GTimer			*timer;
 	gboolean		 started;
+	gint64			 time_thread_started;
 };
 
 G_DEFINE_TYPE (PkBackendJob, pk_backend_job, G_TYPE_OBJECT)
@@ -516,6 +521,22 @@ pk_backend_job_get_runtime (PkBackendJob *job)
 	return g_timer_elapsed (job->priv->timer, NULL) * 1000;
 }
 
+/**
+ * pk_backend_job_get_thread_start_time:
+ *
+ * Gets when the backend thread got the lock and started running. This is
+ * written by the backend thread, so it is only safe to read once the
+ * finished vfunc has been called in the main thread.
+ *
+ * Return value: the monotonic time in µs, or 0 if no thread was started
+ */
+gint64
+pk_backend_job_get_thread_start_time (PkBackendJob *job)
+{
+	g_return_val_if_fail (PK_IS_BACKEND_JOB (job), 0);
+	return job->priv->time_thread_started;
+}
+
 gboolean
 pk_backend_job_get_is_finished (PkBackendJob *job)
 {
@@ -528,12 +549,33 @@ pk_backend_job_get_is_error_set (PkBackendJob *job)
 	return job->priv->set_error;
 }
 
+/**
+ * pk_backend_job_reset:
+ *
+ * Forgets the outcome of a run that failed to get the package manager lock,
+ * so that the job can be started again later.
+ */
+void
+pk_backend_job_reset (PkBackendJob *job)
+{
+	g_return_if_fail (PK_IS_BACKEND_JOB (job));
+
+	job->priv->finished = FALSE;
+	job->priv->set_error = FALSE;
+	job->priv->has_sent_package = FALSE;
+	job->priv->download_files = 0;
+	job->priv->exit = PK_EXIT_ENUM_UNKNOWN;
+	job->priv->last_error_code = PK_ERROR_ENUM_UNKNOWN;
+	job->priv->time_thread_started = 0;
+	g_hash_table_remove_all (job->priv->emitted);
+}
+
 /* used to call vfuncs in the main daemon thread */
 typedef struct {
-	PkBackendJob		*job;
 	PkBackendJobSignal	 signal_kind;
 	GObject			*object;
 	GDestroyNotify		 destroy_func;
+	gboolean		 merged;
 } PkBackendJobVFuncHelper;
 
 static const gchar *
@@ -583,6 +625,10 @@ pk_backend_job_signal_to_string (PkBackendJobSignal id)
 		return "UpdateDetails";
 	if (id == PK_BACKEND_SIGNAL_CATEGORY)
 		return "Category";
+	if (id == PK_BACKEND_SIGNAL_DETAILS_LIST)
+		return "DetailsList";
+	if (id == PK_BACKEND_SIGNAL_FILES_LIST)
+		return "FilesList";
 	return NULL;
 }
 
@@ -591,25 +637,59 @@ pk_backend_job_vfunc_event_free (PkBackendJobVFuncHelper *helper)
 {
 	if (helper->destroy_func != NULL)
 		helper->destroy_func (helper->object);
-	g_object_unref (helper->job);
 	g_free (helper);
 }
 
 static gboolean
-pk_backend_job_call_vfunc_idle_cb (gpointer user_data)
+pk_backend_job_dispatch_queue_cb (gpointer user_data)
+{
+	PkBackendJob *job = PK_BACKEND_JOB (user_data);
+	g_autoptr(GPtrArray) queue = NULL;
+
+	/* take everything queued so far, the backend can keep on emitting */
+	g_mutex_lock (&job->priv->queue_mutex);
+	queue = job->priv->queue;
+	job->priv->queue = g_ptr_array_new_with_free_func ((GDestroyNotify) pk_backend_job_vfunc_event_free);
+	job->priv->queue_source_pending = FALSE;
+	memset (job->priv->queue_latest, 0, sizeof (job->priv->queue_latest));
+	g_mutex_unlock (&job->priv->queue_mutex);
+
+	/* call transaction vfuncs on main thread, in the order they were emitted */
+	for (guint i = 0; i < queue->len; i++) {
+		PkBackendJobVFuncHelper *helper = g_ptr_array_index (queue, i);
+		PkBackendJobVFuncItem *item = &job->priv->vfunc_items[helper->signal_kind];
+		if (item->vfunc != NULL) {
+			item->vfunc (job, helper->object, item->user_data);
+		} else {
+			g_warning ("tried to do signal %s when no longer connected",
+				   pk_backend_job_signal_to_string (helper->signal_kind));
+		}
+	}
+	return G_SOURCE_REMOVE;
+}
+
+/* only the latest value of these is interesting */
+static gboolean
+pk_backend_job_signal_is_coalesced (PkBackendJobSignal signal_kind)
 {
-	PkBackendJobVFuncHelper *helper = (PkBackendJobVFuncHelper *) user_data;
-	PkBackendJobVFuncItem *item;
+	return signal_kind == PK_BACKEND_SIGNAL_PERCENTAGE ||
+	       signal_kind == PK_BACKEND_SIGNAL_SPEED ||
+	       signal_kind == PK_BACKEND_SIGNAL_DOWNLOAD_SIZE_REMAINING;
+}
 
-	/* call transaction vfunc on main thread */
-	item = &helper->job->priv->vfunc_items[helper->signal_kind];
-	if (item != NULL && item->vfunc != NULL) {
-		item->vfunc (helper->job, helper->object, item->user_data);
-	} else {
-		g_warning ("tried to do signal %s when no longer connected",
-			   pk_backend_job_signal_to_string (helper->signal_kind));
-	}
-	return FALSE;
+/* the batch signal consecutive emissions can be merged into */
+static PkBackendJobSignal
+pk_backend_job_signal_get_plural (PkBackendJobSignal signal_kind)
+{
+	if (signal_kind == PK_BACKEND_SIGNAL_PACKAGE)
+		return PK_BACKEND_SIGNAL_PACKAGES;
+	if (signal_kind == PK_BACKEND_SIGNAL_DETAILS)
+		return PK_BACKEND_SIGNAL_DETAILS_LIST;
+	if (signal_kind == PK_BACKEND_SIGNAL_FILES)
+		return PK_BACKEND_SIGNAL_FILES_LIST;
+	if (signal_kind == PK_BACKEND_SIGNAL_UPDATE_DETAIL)
+		return PK_BACKEND_SIGNAL_UPDATE_DETAILS;
+	return PK_BACKEND_SIGNAL_LAST;
 }
 
 /**
@@ -617,6 +697,11 @@ pk_backend_job_call_vfunc_idle_cb (gpointer user_data)
  *
  * This method can be called in any thread, and the vfunc is guaranteed
  * to be called idle in the main thread.
+ *
+ * Emissions are queued per job and dispatched in batches by a single idle
+ * source, consecutive packages, details, files and update details are
+ * merged into one call of the plural vfunc and progress values only keep
+ * the latest one.
  **/
 static void
 pk_backend_job_call_vfunc (PkBackendJob *job,
@@ -626,31 +711,69 @@ pk_backend_job_call_vfunc (PkBackendJob *job,
 {
 	PkBackendJobVFuncHelper *helper;
 	PkBackendJobVFuncItem *item;
-	guint priority = G_PRIORITY_DEFAULT_IDLE;
+	PkBackendJobSignal plural;
 	g_autoptr(GSource) source = NULL;
+	g_autoptr(GMutexLocker) locker = NULL;
 
 	/* call transaction vfunc if not disabled and set */
 	item = &job->priv->vfunc_items[signal_kind];
-	if (!item->enabled || item->vfunc == NULL)
+	if (!item->enabled || item->vfunc == NULL) {
+		if (destroy_func != NULL)
+			destroy_func (object);
 		return;
+	}
 
-	/* order this last if others are still pending */
-	if (signal_kind == PK_BACKEND_SIGNAL_FINISHED)
-		priority = G_PRIORITY_LOW;
+	locker = g_mutex_locker_new (&job->priv->queue_mutex);
 
-	/* emit idle */
-	helper = g_new0 (PkBackendJobVFuncHelper, 1);
-	helper->job = g_object_ref (job);
-	helper->signal_kind = signal_kind;
-	helper->object = object;
-	helper->destroy_func = destroy_func;
+	/* replace a value which has not been dispatched yet */
+	if (pk_backend_job_signal_is_coalesced (signal_kind) &&
+	    job->priv->queue_latest[signal_kind] != NULL) {
+		helper = job->priv->queue_latest[signal_kind];
+		if (helper->destroy_func != NULL)
+			helper->destroy_func (helper->object);
+		helper->object = object;
+		helper->destroy_func = destroy_func;
+		return;
+	}
+
+	/* add to the batch of the same kind emitted just before */
+	plural = pk_backend_job_signal_get_plural (signal_kind);
+	if (plural != PK_BACKEND_SIGNAL_LAST &&
+	    pk_backend_job_get_vfunc_enabled (job, plural)) {
+		if (job->priv->queue->len > 0) {
+			helper = g_ptr_array_index (job->priv->queue, job->priv->queue->len - 1);
+			if (helper->merged && helper->signal_kind == plural) {
+				g_ptr_array_add ((GPtrArray *) helper->object, object);
+				return;
+			}
+		}
+		helper = g_new0 (PkBackendJobVFuncHelper, 1);
+		helper->signal_kind = plural;
+		helper->object = (GObject *) g_ptr_array_new_with_free_func (destroy_func);
+		helper->destroy_func = (GDestroyNotify) g_ptr_array_unref;
+		helper->merged = TRUE;
+		g_ptr_array_add ((GPtrArray *) helper->object, object);
+	} else {
+		helper = g_new0 (PkBackendJobVFuncHelper, 1);
+		helper->signal_kind = signal_kind;
+		helper->object = object;
+		helper->destroy_func = destroy_func;
+	}
+	g_ptr_array_add (job->priv->queue, helper);
+	if (pk_backend_job_signal_is_coalesced (signal_kind))
+		job->priv->queue_latest[signal_kind] = helper;
+
+	/* one idle source dispatches everything queued until it runs */
+	if (job->priv->queue_source_pending)
+		return;
+	job->priv->queue_source_pending = TRUE;
 	source = g_idle_source_new ();
-	g_source_set_priority (source, priority);
+	g_source_set_priority (source, G_PRIORITY_DEFAULT_IDLE);
 	g_source_set_callback (source,
-			       pk_backend_job_call_vfunc_idle_cb,
-			       helper,
-			       (GDestroyNotify) pk_backend_job_vfunc_event_free);
-	g_source_set_name (source, "[PkBackendJob] idle_event_cb");
+			       pk_backend_job_dispatch_queue_cb,
+			       g_object_ref (job),
+			       g_object_unref);
+	g_source_set_name (source, "[PkBackendJob] dispatch_queue_cb");
 	g_source_attach (source, NULL);
 }
 
@@ -740,6 +863,7 @@ pk_backend_job_thread_setup (gpointer thread_data)
 
 	/* run original function with automatic locking */
 	pk_backend_thread_start (helper->backend, helper->job, helper->func);
+	helper->job->priv->time_thread_started = g_get_monotonic_time ();
 	helper->func (helper->job, helper->job->priv->params, helper->user_data);
 	pk_backend_job_finished (helper->job);
 	pk_backend_thread_stop (helper->backend, helper->job, helper->func);
@@ -1015,10 +1139,10 @@ pk_backend_job_package_full (PkBackendJob *job,
 	if (emitted_item != NULL && pk_package_equal (emitted_item, item))
 		return;
 
-	/* update the emitted package table */
-	g_hash_table_insert (job->priv->emitted,
-	                     g_strdup (pk_package_get_id (item)),
-	                     g_object_ref (item));
+	/* update the emitted package table, keyed by the ID owned by @item */
+	g_hash_table_replace (job->priv->emitted,
+	                      (gpointer) pk_package_get_id (item),
+	                      g_object_ref (item));
 
 	/* have we already set an error? */
 	if (job->priv->set_error) {
@@ -1067,10 +1191,10 @@ pk_backend_job_packages (PkBackendJob *job,
 		if (emitted_item != NULL && pk_package_equal (emitted_item, item))
 			continue;
 
-		/* update the emitted package table */
-		g_hash_table_insert (job->priv->emitted,
-			             g_strdup (pk_package_get_id (item)),
-			             g_object_ref (item));
+		/* update the emitted package table, keyed by the ID owned by @item */
+		g_hash_table_replace (job->priv->emitted,
+		                      (gpointer) pk_package_get_id (item),
+		                      g_object_ref (item));
 
 		/* have we already set an error? */
 		if (job->priv->set_error) {
@@ -1106,6 +1230,213 @@ pk_backend_job_packages (PkBackendJob *job,
 					   (GDestroyNotify) g_ptr_array_unref);
 }
 
+static void
+pk_backend_job_replay_array (PkBackendJob *job,
+			     PkBackendJobSignal signal_kind,
+			     GPtrArray *array)
+{
+	for (guint i = 0; i < array->len; i++) {
+		pk_backend_job_call_vfunc (job,
+					   signal_kind,
+					   g_object_ref (g_ptr_array_index (array, i)),
+					   g_object_unref);
+	}
+}
+
+/**
+ * pk_backend_job_replay_results:
+ *
+ * Emits everything a query returned in @results as if the backend had
+ * sent it for this job, so a transaction can share the run of another
+ * one with identical parameters.
+ **/
+void
+pk_backend_job_replay_results (PkBackendJob *job, PkResults *results)
+{
+	g_autoptr(GPtrArray) packages = NULL;
+	g_autoptr(GPtrArray) details = NULL;
+	g_autoptr(GPtrArray) update_details = NULL;
+	g_autoptr(GPtrArray) files = NULL;
+	g_autoptr(GPtrArray) repo_details = NULL;
+	g_autoptr(GPtrArray) categories = NULL;
+	g_autoptr(GPtrArray) distro_upgrades = NULL;
+	g_autoptr(GPtrArray) require_restarts = NULL;
+
+	g_return_if_fail (PK_IS_BACKEND_JOB (job));
+	g_return_if_fail (PK_IS_RESULTS (results));
+
+	packages = pk_results_get_package_array (results);
+	if (packages->len > 0)
+		pk_backend_job_packages (job, packages);
+
+	details = pk_results_get_details_array (results);
+	pk_backend_job_replay_array (job, PK_BACKEND_SIGNAL_DETAILS, details);
+	update_details = pk_results_get_update_detail_array (results);
+	if (update_details->len > 0)
+		pk_backend_job_update_details (job, update_details);
+	files = pk_results_get_files_array (results);
+	pk_backend_job_replay_array (job, PK_BACKEND_SIGNAL_FILES, files);
+	repo_details = pk_results_get_repo_detail_array (results);
+	pk_backend_job_replay_array (job, PK_BACKEND_SIGNAL_REPO_DETAIL, repo_details);
+	categories = pk_results_get_category_array (results);
+	pk_backend_job_replay_array (job, PK_BACKEND_SIGNAL_CATEGORY, categories);
+	distro_upgrades = pk_results_get_distro_upgrade_array (results);
+	pk_backend_job_replay_array (job, PK_BACKEND_SIGNAL_DISTRO_UPGRADE, distro_upgrades);
+	require_restarts = pk_results_get_require_restart_array (results);
+	pk_backend_job_replay_array (job, PK_BACKEND_SIGNAL_REQUIRE_RESTART, require_restarts);
+}
+
+G_DEFINE_QUARK (pk-backend-job-variant, pk_backend_job_variant)
+
+static GVariant *
+pk_backend_job_details_to_variant (PkDetails *item)
+{
+	GVariantBuilder builder;
+	PkGroupEnum group;
+	const gchar *tmp;
+	guint64 size;
+
+	g_variant_builder_init (&builder, G_VARIANT_TYPE ("a{sv}"));
+	g_variant_builder_add (&builder, "{sv}", "package-id",
+			       g_variant_new_string (pk_details_get_package_id (item)));
+	group = pk_details_get_group (item);
+	if (group != PK_GROUP_ENUM_UNKNOWN)
+		g_variant_builder_add (&builder, "{sv}", "group",
+				       g_variant_new_uint32 (group));
+	tmp = pk_details_get_summary (item);
+	if (tmp != NULL)
+		g_variant_builder_add (&builder, "{sv}", "summary",
+				       g_variant_new_string (tmp));
+	tmp = pk_details_get_description (item);
+	if (tmp != NULL)
+		g_variant_builder_add (&builder, "{sv}", "description",
+				       g_variant_new_string (tmp));
+	tmp = pk_details_get_url (item);
+	if (tmp != NULL)
+		g_variant_builder_add (&builder, "{sv}", "url",
+				       g_variant_new_string (tmp));
+	tmp = pk_details_get_license (item);
+	if (tmp != NULL)
+		g_variant_builder_add (&builder, "{sv}", "license",
+				       g_variant_new_string (tmp));
+	size = pk_details_get_size (item);
+	if (size != 0)
+		g_variant_builder_add (&builder, "{sv}", "size",
+				       g_variant_new_uint64 (size));
+	size = pk_details_get_download_size (item);
+	if (size != G_MAXUINT64)
+		g_variant_builder_add (&builder, "{sv}", "download-size",
+				       g_variant_new_uint64 (size));
+	return g_variant_builder_end (&builder);
+}
+
+static GVariant *
+pk_backend_job_files_to_variant (PkFiles *item)
+{
+	const gchar *package_id = pk_files_get_package_id (item);
+	gchar **files = pk_files_get_files (item);
+	gchar *empty[] = { NULL };
+
+	return g_variant_new ("(s^as)",
+			      package_id != NULL ? package_id : "",
+			      files != NULL ? files : empty);
+}
+
+static GVariant *
+pk_backend_job_update_detail_to_variant (PkUpdateDetail *item)
+{
+	const gchar *changelog = pk_update_detail_get_changelog (item);
+	const gchar *issued = pk_update_detail_get_issued (item);
+	const gchar *updated = pk_update_detail_get_updated (item);
+	const gchar *update_text = pk_update_detail_get_update_text (item);
+	gchar **bugzilla_urls = pk_update_detail_get_bugzilla_urls (item);
+	gchar **cve_urls = pk_update_detail_get_cve_urls (item);
+	gchar **obsoletes = pk_update_detail_get_obsoletes (item);
+	gchar **updates = pk_update_detail_get_updates (item);
+	gchar **vendor_urls = pk_update_detail_get_vendor_urls (item);
+	gchar *empty[] = { NULL };
+
+	return g_variant_new ("(s^as^as^as^as^asussuss)",
+			      pk_update_detail_get_package_id (item),
+			      updates != NULL ? updates : empty,
+			      obsoletes != NULL ? obsoletes : empty,
+			      vendor_urls != NULL ? vendor_urls : empty,
+			      bugzilla_urls != NULL ? bugzilla_urls : empty,
+			      cve_urls != NULL ? cve_urls : empty,
+			      pk_update_detail_get_restart (item),
+			      update_text != NULL ? update_text : "",
+			      changelog != NULL ? changelog : "",
+			      pk_update_detail_get_state (item),
+			      issued != NULL ? issued : "",
+			      updated != NULL ? updated : "");
+}
+
+/* serialize in the backend thread so the daemon only has to forward it */
+static void
+pk_backend_job_attach_variant (gpointer item, GVariant *value)
+{
+	g_variant_ref_sink (value);
+	g_variant_get_data (value);
+	g_object_set_qdata_full (G_OBJECT (item),
+				 pk_backend_job_variant_quark (),
+				 value,
+				 (GDestroyNotify) g_variant_unref);
+}
+
+/**
+ * pk_backend_job_get_details_variant:
+ * @item: a #PkDetails
+ *
+ * Gets the a{sv} sent in the Details() signal, which was serialized when
+ * the backend emitted @item.
+ *
+ * Return value: (transfer full): a #GVariant
+ **/
+GVariant *
+pk_backend_job_get_details_variant (PkDetails *item)
+{
+	GVariant *value = g_object_get_qdata (G_OBJECT (item), pk_backend_job_variant_quark ());
+	if (value != NULL)
+		return g_variant_ref (value);
+	return g_variant_ref_sink (pk_backend_job_details_to_variant (item));
+}
+
+/**
+ * pk_backend_job_get_files_variant:
+ * @item: a #PkFiles
+ *
+ * Gets the (sas) sent in the Files() signal, which was serialized when
+ * the backend emitted @item.
+ *
+ * Return value: (transfer full): a #GVariant
+ **/
+GVariant *
+pk_backend_job_get_files_variant (PkFiles *item)
+{
+	GVariant *value = g_object_get_qdata (G_OBJECT (item), pk_backend_job_variant_quark ());
+	if (value != NULL)
+		return g_variant_ref (value);
+	return g_variant_ref_sink (pk_backend_job_files_to_variant (item));
+}
+
+/**
+ * pk_backend_job_get_update_detail_variant:
+ * @item: a #PkUpdateDetail
+ *
+ * Gets the tuple sent in the UpdateDetail() signal, which was serialized
+ * when the backend emitted @item.
+ *
+ * Return value: (transfer full): a #GVariant
+ **/
+GVariant *
+pk_backend_job_get_update_detail_variant (PkUpdateDetail *item)
+{
+	GVariant *value = g_object_get_qdata (G_OBJECT (item), pk_backend_job_variant_quark ());
+	if (value != NULL)
+		return g_variant_ref (value);
+	return g_variant_ref_sink (pk_backend_job_update_detail_to_variant (item));
+}
+
 void
 pk_backend_job_update_detail (PkBackendJob *job,
 			      const gchar *package_id,
@@ -1165,6 +1496,7 @@ pk_backend_job_update_detail (PkBackendJob *job,
 		      "issued", issued_text,
 		      "updated", updated_text,
 		      NULL);
+	pk_backend_job_attach_variant (item, pk_backend_job_update_detail_to_variant (item));
 
 	/* emit */
 	pk_backend_job_call_vfunc (job,
@@ -1186,6 +1518,14 @@ pk_backend_job_update_details (PkBackendJob *job,
 		return;
 	}
 
+	/* serialize what has not been yet, e.g. items not made by
+	 * pk_backend_job_update_detail() */
+	for (guint i = 0; i < update_details->len; i++) {
+		PkUpdateDetail *item = g_ptr_array_index (update_details, i);
+		if (g_object_get_qdata (G_OBJECT (item), pk_backend_job_variant_quark ()) == NULL)
+			pk_backend_job_attach_variant (item, pk_backend_job_update_detail_to_variant (item));
+	}
+
 	/* emit; this relies on the @update_details array having ownership of
 	 * all its elements, as the job is asynchronous so they may be freed in
 	 * their original calling context */
@@ -1279,11 +1619,12 @@ pk_backend_job_details_full (PkBackendJob *job,
 		      "size", (guint64) size,
 		      "download-size", download_size,
 		      NULL);
+	pk_backend_job_attach_variant (item, pk_backend_job_details_to_variant (item));
 
 	/* emit */
 	pk_backend_job_call_vfunc (job,
-			       PK_BACKEND_SIGNAL_DETAILS,
-			       g_object_ref (item),
+				   PK_BACKEND_SIGNAL_DETAILS,
+				   g_object_ref (item),
 				   g_object_unref);
 }
 
@@ -1322,6 +1663,7 @@ pk_backend_job_files (PkBackendJob *job,
 		      "package-id", package_id,
 		      "files", files,
 		      NULL);
+	pk_backend_job_attach_variant (item, pk_backend_job_files_to_variant (item));
 
 	/* emit */
 	pk_backend_job_call_vfunc (job,
@@ -1789,6 +2131,8 @@ pk_backend_job_finalize (GObject *object)
 	g_free (job->priv->locale);
 	g_free (job->priv->frontend_socket);
 	g_hash_table_unref (job->priv->emitted);
+	g_ptr_array_unref (job->priv->queue);
+	g_mutex_clear (&job->priv->queue_mutex);
 	if (job->priv->params != NULL)
 		g_variant_unref (job->priv->params);
 	g_timer_destroy (job->priv->timer);
@@ -1820,7 +2164,9 @@ pk_backend_job_init (PkBackendJob *job)
 	job->priv->role = PK_ROLE_ENUM_UNKNOWN;
 	job->priv->status = PK_STATUS_ENUM_UNKNOWN;
 	job->priv->emitted = g_hash_table_new_full (g_str_hash, g_str_equal,
-	                                            g_free, (GDestroyNotify) g_object_unref);
+	                                            NULL, (GDestroyNotify) g_object_unref);
+	g_mutex_init (&job->priv->queue_mutex);
+	job->priv->queue = g_ptr_array_new_with_free_func ((GDestroyNotify) pk_backend_job_vfunc_event_free);
 }
 
 /**
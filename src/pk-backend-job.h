@@ -26,6 +26,7 @@
 
 #include "pk-shared.h"
 #include <packagekit-glib2/pk-bitfield.h>
+#include <packagekit-glib2/pk-results.h>
 
 G_BEGIN_DECLS
 
@@ -62,6 +63,8 @@ typedef enum {
 	PK_BACKEND_SIGNAL_UPDATE_DETAIL,
 	PK_BACKEND_SIGNAL_UPDATE_DETAILS,
 	PK_BACKEND_SIGNAL_CATEGORY,
+	PK_BACKEND_SIGNAL_DETAILS_LIST,
+	PK_BACKEND_SIGNAL_FILES_LIST,
 	PK_BACKEND_SIGNAL_LAST
 } PkBackendJobSignal;
 
@@ -115,8 +118,10 @@ void		 pk_backend_job_set_exit_code		(PkBackendJob	*job,
 							 PkExitEnum	 exit);
 gboolean	 pk_backend_job_has_set_error_code	(PkBackendJob	*job);
 guint		 pk_backend_job_get_runtime		(PkBackendJob	*job);
+gint64		 pk_backend_job_get_thread_start_time	(PkBackendJob	*job);
 gboolean	 pk_backend_job_get_is_finished		(PkBackendJob	*job);
 gboolean	 pk_backend_job_get_is_error_set	(PkBackendJob	*job);
+void		 pk_backend_job_reset			(PkBackendJob	*job);
 gboolean	 pk_backend_job_get_allow_cancel	(PkBackendJob	*job);
 void		 pk_backend_job_set_proxy		(PkBackendJob	*job,
 							 const gchar	*proxy_http,
@@ -165,6 +170,11 @@ void		 pk_backend_job_set_vfunc		(PkBackendJob	*job,
 gboolean	 pk_backend_job_get_vfunc_enabled	(PkBackendJob	*job,
 							 PkBackendJobSignal signal_kind);
 
+/* D-Bus serialization of results, done in the backend thread */
+GVariant	*pk_backend_job_get_details_variant	(PkDetails	*item);
+GVariant	*pk_backend_job_get_files_variant	(PkFiles	*item);
+GVariant	*pk_backend_job_get_update_detail_variant (PkUpdateDetail *item);
+
 /* thread helpers */
 typedef void	(*PkBackendJobThreadFunc)		(PkBackendJob	*job,
 							 GVariant	*params,
@@ -187,6 +197,8 @@ void		 pk_backend_job_package_full		(PkBackendJob	*job,
 							 PkInfoEnum	 update_severity);
 void		 pk_backend_job_packages		(PkBackendJob	*job,
 							 GPtrArray	*packages);
+void		 pk_backend_job_replay_results		(PkBackendJob	*job,
+							 PkResults	*results);
 void		 pk_backend_job_repo_detail		(PkBackendJob	*job,
 							 const gchar	*repo_id,
 							 const gchar	*description,
@@ -124,14 +124,117 @@ pk_backend_spawn_start_kill_timer (PkBackendSpawn *backend_spawn)
 	g_source_set_name_by_id (priv->kill_id, "[PkBackendSpawn] exit");
 }
 
+/* the opcodes are sent by helpers speaking the binary protocol, so never
+ * renumber them; only append new ones before PK_BACKEND_SPAWN_OP_LAST */
+typedef enum {
+	PK_BACKEND_SPAWN_OP_UNKNOWN			= 0,
+	PK_BACKEND_SPAWN_OP_HELLO			= 1,
+	PK_BACKEND_SPAWN_OP_PACKAGE			= 2,
+	PK_BACKEND_SPAWN_OP_PACKAGES			= 3,
+	PK_BACKEND_SPAWN_OP_DETAILS			= 4,
+	PK_BACKEND_SPAWN_OP_FINISHED			= 5,
+	PK_BACKEND_SPAWN_OP_FILES			= 6,
+	PK_BACKEND_SPAWN_OP_REPO_DETAIL			= 7,
+	PK_BACKEND_SPAWN_OP_UPDATE_DETAIL		= 8,
+	PK_BACKEND_SPAWN_OP_PERCENTAGE			= 9,
+	PK_BACKEND_SPAWN_OP_ITEM_PROGRESS		= 10,
+	PK_BACKEND_SPAWN_OP_ERROR			= 11,
+	PK_BACKEND_SPAWN_OP_REQUIRE_RESTART		= 12,
+	PK_BACKEND_SPAWN_OP_STATUS			= 13,
+	PK_BACKEND_SPAWN_OP_SPEED			= 14,
+	PK_BACKEND_SPAWN_OP_DOWNLOAD_SIZE_REMAINING	= 15,
+	PK_BACKEND_SPAWN_OP_ALLOW_CANCEL		= 16,
+	PK_BACKEND_SPAWN_OP_NO_PERCENTAGE_UPDATES	= 17,
+	PK_BACKEND_SPAWN_OP_REPO_SIGNATURE_REQUIRED	= 18,
+	PK_BACKEND_SPAWN_OP_EULA_REQUIRED		= 19,
+	PK_BACKEND_SPAWN_OP_MEDIA_CHANGE_REQUIRED	= 20,
+	PK_BACKEND_SPAWN_OP_DISTRO_UPGRADE		= 21,
+	PK_BACKEND_SPAWN_OP_CATEGORY			= 22,
+	PK_BACKEND_SPAWN_OP_LAST
+} PkBackendSpawnOp;
+
+typedef struct {
+	const gchar		*name;
+	guint			 size;	/* including the command, or 0 for batches */
+} PkBackendSpawnOpItem;
+
+static const PkBackendSpawnOpItem pk_backend_spawn_ops[] = {
+	[PK_BACKEND_SPAWN_OP_HELLO]			= { "hello",			1 },
+	[PK_BACKEND_SPAWN_OP_PACKAGE]			= { "package",			4 },
+	[PK_BACKEND_SPAWN_OP_PACKAGES]			= { "packages",			0 },
+	[PK_BACKEND_SPAWN_OP_DETAILS]			= { "details",			8 },
+	[PK_BACKEND_SPAWN_OP_FINISHED]			= { "finished",			1 },
+	[PK_BACKEND_SPAWN_OP_FILES]			= { "files",			3 },
+	[PK_BACKEND_SPAWN_OP_REPO_DETAIL]		= { "repo-detail",		4 },
+	[PK_BACKEND_SPAWN_OP_UPDATE_DETAIL]		= { "updatedetail",		13 },
+	[PK_BACKEND_SPAWN_OP_PERCENTAGE]		= { "percentage",		2 },
+	[PK_BACKEND_SPAWN_OP_ITEM_PROGRESS]		= { "item-progress",		4 },
+	[PK_BACKEND_SPAWN_OP_ERROR]			= { "error",			3 },
+	[PK_BACKEND_SPAWN_OP_REQUIRE_RESTART]		= { "requirerestart",		3 },
+	[PK_BACKEND_SPAWN_OP_STATUS]			= { "status",			2 },
+	[PK_BACKEND_SPAWN_OP_SPEED]			= { "speed",			2 },
+	[PK_BACKEND_SPAWN_OP_DOWNLOAD_SIZE_REMAINING]	= { "download-size-remaining",	2 },
+	[PK_BACKEND_SPAWN_OP_ALLOW_CANCEL]		= { "allow-cancel",		2 },
+	[PK_BACKEND_SPAWN_OP_NO_PERCENTAGE_UPDATES]	= { "no-percentage-updates",	1 },
+	[PK_BACKEND_SPAWN_OP_REPO_SIGNATURE_REQUIRED]	= { "repo-signature-required",	9 },
+	[PK_BACKEND_SPAWN_OP_EULA_REQUIRED]		= { "eula-required",		5 },
+	[PK_BACKEND_SPAWN_OP_MEDIA_CHANGE_REQUIRED]	= { "media-change-required",	4 },
+	[PK_BACKEND_SPAWN_OP_DISTRO_UPGRADE]		= { "distro-upgrade",		4 },
+	[PK_BACKEND_SPAWN_OP_CATEGORY]			= { "category",			6 },
+	[PK_BACKEND_SPAWN_OP_LAST]			= { NULL,			0 }
+};
+
+/* command name to PkBackendSpawnOp, built once in class_init */
+static GHashTable *pk_backend_spawn_op_names = NULL;
+
+/* batches are the command followed by any number of info, package_id and
+ * summary triplets */
 static gboolean
-pk_backend_spawn_parse_stdout (PkBackendSpawn *backend_spawn,
-			       PkBackendJob *job,
-			       const gchar *line,
-			       GError **error)
+pk_backend_spawn_check_size (PkBackendSpawnOp op, guint size)
+{
+	if (pk_backend_spawn_ops[op].size == 0)
+		return size >= 4 && (size - 1) % 3 == 0;
+	return size == pk_backend_spawn_ops[op].size;
+}
+
+/* @sections is info, package_id and summary */
+static gboolean
+pk_backend_spawn_check_package (gchar **sections, PkInfoEnum *info, GError **error)
 {
-	guint size;
-	gchar *command;
+	if (pk_package_id_check (sections[1]) == FALSE) {
+		g_set_error_literal (error, 1, 0, "invalid package_id");
+		return FALSE;
+	}
+	*info = pk_info_enum_from_string (sections[0]);
+	if (*info == PK_INFO_ENUM_UNKNOWN) {
+		g_set_error (error, 1, 0, "Info enum not recognised, and hence ignored: '%s'", sections[0]);
+		return FALSE;
+	}
+	g_strdelimit (sections[2], PK_UNSAFE_DELIMITERS, ' ');
+	if (!g_utf8_validate (sections[2], -1, NULL)) {
+		g_set_error (error, 1, 0,
+			     "text '%s' was not valid UTF8!",
+			     sections[2]);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/**
+ * pk_backend_spawn_dispatch:
+ *
+ * Checks and runs one command from the helper, whichever protocol it came
+ * in on. sections[0] is the command name and is only used for errors.
+ **/
+static gboolean
+pk_backend_spawn_dispatch (PkBackendSpawn *backend_spawn,
+			   PkBackendJob *job,
+			   PkBackendSpawnOp op,
+			   gchar **sections,
+			   guint size,
+			   GError **error)
+{
+	const gchar *command = sections[0];
 	gchar *text;
 	guint64 speed;
 	guint64 download_size_remaining;
@@ -148,50 +251,47 @@ pk_backend_spawn_parse_stdout (PkBackendSpawn *backend_spawn,
 	PkMediaTypeEnum media_type_enum;
 	PkDistroUpgradeEnum distro_upgrade_enum;
 	PkBackendSpawnPrivate *priv = backend_spawn->priv;
-	g_auto(GStrv) sections = NULL;
-
-	g_return_val_if_fail (PK_IS_BACKEND_SPAWN (backend_spawn), FALSE);
-
-	/* check if output line */
-	if (line == NULL)
+	g_autoptr(GPtrArray) packages = NULL;
+	g_auto(GStrv) tmp = NULL;
+	g_auto(GStrv) updates = NULL;
+	g_auto(GStrv) obsoletes = NULL;
+	g_auto(GStrv) vendor_urls = NULL;
+	g_auto(GStrv) bugzilla_urls = NULL;
+	g_auto(GStrv) cve_urls = NULL;
+
+	if (op == PK_BACKEND_SPAWN_OP_UNKNOWN || op >= PK_BACKEND_SPAWN_OP_LAST) {
+		g_set_error (error, 1, 0, "invalid command '%s'", command);
 		return FALSE;
+	}
+	if (!pk_backend_spawn_check_size (op, size)) {
+		g_set_error (error, 1, 0, "invalid command'%s', size %i", command, size);
+		return FALSE;
+	}
 
-	/* split by tab */
-	sections = g_strsplit (line, "\t", 0);
-	command = sections[0];
-
-	/* get size */
-	size = g_strv_length (sections);
-
-	if (g_strcmp0 (command, "package") == 0) {
-		if (size != 4) {
-			g_set_error (error, 1, 0, "invalid command'%s', size %i", command, size);
+	switch (op) {
+	case PK_BACKEND_SPAWN_OP_HELLO:
+		g_debug ("helper speaks the binary protocol");
+		break;
+	case PK_BACKEND_SPAWN_OP_PACKAGE:
+		if (!pk_backend_spawn_check_package (&sections[1], &info, error))
 			return FALSE;
-		}
-		if (pk_package_id_check (sections[2]) == FALSE) {
-			g_set_error_literal (error, 1, 0, "invalid package_id");
-			return FALSE;
-		}
-		info = pk_info_enum_from_string (sections[1]);
-		if (info == PK_INFO_ENUM_UNKNOWN) {
-			g_set_error (error, 1, 0, "Info enum not recognised, and hence ignored: '%s'", sections[1]);
-			return FALSE;
-		}
-		g_strdelimit (sections[3], PK_UNSAFE_DELIMITERS, ' ');
-		if (!g_utf8_validate (sections[3], -1, NULL)) {
-			g_set_error (error, 1, 0,
-				     "text '%s' was not valid UTF8!",
-				     sections[3]);
-			return FALSE;
-		}
 		pk_backend_job_package (job, info, sections[2], sections[3]);
-	} else if (g_strcmp0 (command, "details") == 0) {
-		if (size != 8) {
-			g_set_error (error, 1, 0,
-				     "invalid command'%s', size %i",
-				     command, size);
-			return FALSE;
+		break;
+	case PK_BACKEND_SPAWN_OP_PACKAGES:
+		packages = g_ptr_array_new_with_free_func (g_object_unref);
+		for (guint i = 1; i + 2 < size; i += 3) {
+			g_autoptr(PkPackage) item = pk_package_new ();
+			if (!pk_backend_spawn_check_package (&sections[i], &info, error))
+				return FALSE;
+			if (!pk_package_set_id (item, sections[i + 1], error))
+				return FALSE;
+			pk_package_set_info (item, info);
+			pk_package_set_summary (item, sections[i + 2]);
+			g_ptr_array_add (packages, g_steal_pointer (&item));
 		}
+		pk_backend_job_packages (job, packages);
+		break;
+	case PK_BACKEND_SPAWN_OP_DETAILS:
 		group = pk_group_enum_from_string (sections[4]);
 
 		/* ITS4: ignore, checked for overflow */
@@ -214,30 +314,19 @@ pk_backend_spawn_parse_stdout (PkBackendSpawn *backend_spawn,
 		pk_backend_job_details (job, sections[1], sections[2], sections[3],
 					group, text, sections[6], package_size);
 		g_free (text);
-	} else if (g_strcmp0 (command, "finished") == 0) {
-		if (size != 1) {
-			g_set_error (error, 1, 0, "invalid command'%s', size %i", command, size);
-			return FALSE;
-		}
+		break;
+	case PK_BACKEND_SPAWN_OP_FINISHED:
 		pk_backend_job_finished (job);
 		priv->is_busy = FALSE;
 
 		/* from this point on, we can start the kill timer */
 		pk_backend_spawn_start_kill_timer (backend_spawn);
-
-	} else if (g_strcmp0 (command, "files") == 0) {
-		g_auto(GStrv) tmp = NULL;
-		if (size != 3) {
-			g_set_error (error, 1, 0, "invalid command'%s', size %i", command, size);
-			return FALSE;
-		}
+		break;
+	case PK_BACKEND_SPAWN_OP_FILES:
 		tmp = g_strsplit (sections[2], ";", -1);
 		pk_backend_job_files (job, sections[1], tmp);
-	} else if (g_strcmp0 (command, "repo-detail") == 0) {
-		if (size != 4) {
-			g_set_error (error, 1, 0, "invalid command'%s', size %i", command, size);
-			return FALSE;
-		}
+		break;
+	case PK_BACKEND_SPAWN_OP_REPO_DETAIL:
 		g_strdelimit (sections[2], PK_UNSAFE_DELIMITERS, ' ');
 		if (!g_utf8_validate (sections[2], -1, NULL)) {
 			g_set_error (error, 1, 0,
@@ -253,16 +342,8 @@ pk_backend_spawn_parse_stdout (PkBackendSpawn *backend_spawn,
 			g_set_error (error, 1, 0, "invalid qualifier '%s'", sections[3]);
 			return FALSE;
 		}
-	} else if (g_strcmp0 (command, "updatedetail") == 0) {
-		g_auto(GStrv) updates = NULL;
-		g_auto(GStrv) obsoletes = NULL;
-		g_auto(GStrv) vendor_urls = NULL;
-		g_auto(GStrv) bugzilla_urls = NULL;
-		g_auto(GStrv) cve_urls = NULL;
-		if (size != 13) {
-			g_set_error (error, 1, 0, "invalid command '%s', size %i", command, size);
-			return FALSE;
-		}
+		break;
+	case PK_BACKEND_SPAWN_OP_UPDATE_DETAIL:
 		restart = pk_restart_enum_from_string (sections[7]);
 		if (restart == PK_RESTART_ENUM_UNKNOWN) {
 			g_set_error (error, 1, 0, "Restart enum not recognised, and hence ignored: '%s'", sections[7]);
@@ -297,11 +378,8 @@ pk_backend_spawn_parse_stdout (PkBackendSpawn *backend_spawn,
 					  update_state_enum,
 					  sections[11],
 					  sections[12]);
-	} else if (g_strcmp0 (command, "percentage") == 0) {
-		if (size != 2) {
-			g_set_error (error, 1, 0, "invalid command'%s', size %i", command, size);
-			return FALSE;
-		}
+		break;
+	case PK_BACKEND_SPAWN_OP_PERCENTAGE:
 		if (!pk_strtoint (sections[1], &percentage)) {
 			g_set_error (error, 1, 0, "invalid percentage value %s", sections[1]);
 			return FALSE;
@@ -311,11 +389,8 @@ pk_backend_spawn_parse_stdout (PkBackendSpawn *backend_spawn,
 		} else {
 			pk_backend_job_set_percentage (job, percentage);
 		}
-	} else if (g_strcmp0 (command, "item-progress") == 0) {
-		if (size != 4) {
-			g_set_error (error, 1, 0, "invalid command'%s', size %i", command, size);
-			return FALSE;
-		}
+		break;
+	case PK_BACKEND_SPAWN_OP_ITEM_PROGRESS:
 		if (!pk_package_id_check (sections[1])) {
 			g_set_error (error, 1, 0, "invalid package_id");
 			return FALSE;
@@ -337,11 +412,8 @@ pk_backend_spawn_parse_stdout (PkBackendSpawn *backend_spawn,
 						  sections[1],
 						  status_enum,
 						  percentage);
-	} else if (g_strcmp0 (command, "error") == 0) {
-		if (size != 3) {
-			g_set_error (error, 1, 0, "invalid command'%s', size %i", command, size);
-			return FALSE;
-		}
+		break;
+	case PK_BACKEND_SPAWN_OP_ERROR:
 		error_enum = pk_error_enum_from_string (sections[1]);
 		if (error_enum == PK_ERROR_ENUM_UNKNOWN) {
 			g_set_error (error, 1, 0, "Error enum not recognised, and hence ignored: '%s'", sections[1]);
@@ -358,11 +430,8 @@ pk_backend_spawn_parse_stdout (PkBackendSpawn *backend_spawn,
 
 		pk_backend_job_error_code (job, error_enum, "%s", text);
 		g_free (text);
-	} else if (g_strcmp0 (command, "requirerestart") == 0) {
-		if (size != 3) {
-			g_set_error (error, 1, 0, "invalid command'%s', size %i", command, size);
-			return FALSE;
-		}
+		break;
+	case PK_BACKEND_SPAWN_OP_REQUIRE_RESTART:
 		restart_enum = pk_restart_enum_from_string (sections[1]);
 		if (restart_enum == PK_RESTART_ENUM_UNKNOWN) {
 			g_set_error (error, 1, 0, "Restart enum not recognised, and hence ignored: '%s'", sections[1]);
@@ -373,22 +442,16 @@ pk_backend_spawn_parse_stdout (PkBackendSpawn *backend_spawn,
 			return FALSE;
 		}
 		pk_backend_job_require_restart (job, restart_enum, sections[2]);
-	} else if (g_strcmp0 (command, "status") == 0) {
-		if (size != 2) {
-			g_set_error (error, 1, 0, "invalid command'%s', size %i", command, size);
-			return FALSE;
-		}
+		break;
+	case PK_BACKEND_SPAWN_OP_STATUS:
 		status_enum = pk_status_enum_from_string (sections[1]);
 		if (status_enum == PK_STATUS_ENUM_UNKNOWN) {
 			g_set_error (error, 1, 0, "Status enum not recognised, and hence ignored: '%s'", sections[1]);
 			return FALSE;
 		}
 		pk_backend_job_set_status (job, status_enum);
-	} else if (g_strcmp0 (command, "speed") == 0) {
-		if (size != 2) {
-			g_set_error (error, 1, 0, "invalid command'%s', size %i", command, size);
-			return FALSE;
-		}
+		break;
+	case PK_BACKEND_SPAWN_OP_SPEED:
 		if (!pk_strtouint64 (sections[1], &speed)) {
 			g_set_error (error, 1, 0,
 				     "failed to parse speed: '%s'",
@@ -396,11 +459,8 @@ pk_backend_spawn_parse_stdout (PkBackendSpawn *backend_spawn,
 			return FALSE;
 		}
 		pk_backend_job_set_speed (job, speed);
-	} else if (g_strcmp0 (command, "download-size-remaining") == 0) {
-		if (size != 2) {
-			g_set_error (error, 1, 0, "invalid command'%s', size %i", command, size);
-			return FALSE;
-		}
+		break;
+	case PK_BACKEND_SPAWN_OP_DOWNLOAD_SIZE_REMAINING:
 		if (!pk_strtouint64 (sections[1], &download_size_remaining)) {
 			g_set_error (error, 1, 0,
 				     "failed to parse download_size_remaining: '%s'",
@@ -408,11 +468,8 @@ pk_backend_spawn_parse_stdout (PkBackendSpawn *backend_spawn,
 			return FALSE;
 		}
 		pk_backend_job_set_download_size_remaining (job, download_size_remaining);
-	} else if (g_strcmp0 (command, "allow-cancel") == 0) {
-		if (size != 2) {
-			g_set_error (error, 1, 0, "invalid command'%s', size %i", command, size);
-			return FALSE;
-		}
+		break;
+	case PK_BACKEND_SPAWN_OP_ALLOW_CANCEL:
 		if (g_strcmp0 (sections[1], "true") == 0) {
 			pk_backend_job_set_allow_cancel (job, TRUE);
 		} else if (g_strcmp0 (sections[1], "false") == 0) {
@@ -421,19 +478,11 @@ pk_backend_spawn_parse_stdout (PkBackendSpawn *backend_spawn,
 			g_set_error (error, 1, 0, "invalid section '%s'", sections[1]);
 			return FALSE;
 		}
-	} else if (g_strcmp0 (command, "no-percentage-updates") == 0) {
-		if (size != 1) {
-			g_set_error (error, 1, 0, "invalid command'%s', size %i", command, size);
-			return FALSE;
-		}
+		break;
+	case PK_BACKEND_SPAWN_OP_NO_PERCENTAGE_UPDATES:
 		pk_backend_job_set_percentage (job, PK_BACKEND_PERCENTAGE_INVALID);
-	} else if (g_strcmp0 (command, "repo-signature-required") == 0) {
-
-		if (size != 9) {
-			g_set_error (error, 1, 0, "invalid command'%s', size %i", command, size);
-			return FALSE;
-		}
-
+		break;
+	case PK_BACKEND_SPAWN_OP_REPO_SIGNATURE_REQUIRED:
 		sig_type = pk_sig_type_enum_from_string (sections[8]);
 		if (sig_type == PK_SIGTYPE_ENUM_UNKNOWN) {
 			g_set_error (error, 1, 0, "Sig enum not recognised, and hence ignored: '%s'", sections[8]);
@@ -452,13 +501,8 @@ pk_backend_spawn_parse_stdout (PkBackendSpawn *backend_spawn,
 		pk_backend_job_repo_signature_required (job, sections[1],
 							  sections[2], sections[3], sections[4],
 							  sections[5], sections[6], sections[7], sig_type);
-	} else if (g_strcmp0 (command, "eula-required") == 0) {
-
-		if (size != 5) {
-			g_set_error (error, 1, 0, "invalid command'%s', size %i", command, size);
-			return FALSE;
-		}
-
+		break;
+	case PK_BACKEND_SPAWN_OP_EULA_REQUIRED:
 		if (pk_strzero (sections[1])) {
 			g_set_error (error, 1, 0, "eula_id blank, and hence ignored: '%s'", sections[1]);
 			return FALSE;
@@ -475,13 +519,8 @@ pk_backend_spawn_parse_stdout (PkBackendSpawn *backend_spawn,
 		}
 
 		pk_backend_job_eula_required (job, sections[1], sections[2], sections[3], sections[4]);
-	} else if (g_strcmp0 (command, "media-change-required") == 0) {
-
-		if (size != 4) {
-			g_set_error (error, 1, 0, "invalid command'%s', size %i", command, size);
-			return FALSE;
-		}
-
+		break;
+	case PK_BACKEND_SPAWN_OP_MEDIA_CHANGE_REQUIRED:
 		media_type_enum = pk_media_type_enum_from_string (sections[1]);
 		if (media_type_enum == PK_MEDIA_TYPE_ENUM_UNKNOWN) {
 			g_set_error (error, 1, 0, "media type enum not recognised, and hence ignored: '%s'", sections[1]);
@@ -489,13 +528,8 @@ pk_backend_spawn_parse_stdout (PkBackendSpawn *backend_spawn,
 		}
 
 		pk_backend_job_media_change_required (job, media_type_enum, sections[2], sections[3]);
-	} else if (g_strcmp0 (command, "distro-upgrade") == 0) {
-
-		if (size != 4) {
-			g_set_error (error, 1, 0, "invalid command'%s', size %i", command, size);
-			return FALSE;
-		}
-
+		break;
+	case PK_BACKEND_SPAWN_OP_DISTRO_UPGRADE:
 		distro_upgrade_enum = pk_distro_upgrade_enum_from_string (sections[1]);
 		if (distro_upgrade_enum == PK_DISTRO_UPGRADE_ENUM_UNKNOWN) {
 			g_set_error (error, 1, 0, "distro upgrade enum not recognised, and hence ignored: '%s'", sections[1]);
@@ -510,12 +544,8 @@ pk_backend_spawn_parse_stdout (PkBackendSpawn *backend_spawn,
 		}
 
 		pk_backend_job_distro_upgrade (job, distro_upgrade_enum, sections[2], sections[3]);
-	} else if (g_strcmp0 (command, "category") == 0) {
-
-		if (size != 6) {
-			g_set_error (error, 1, 0, "invalid command'%s', size %i", command, size);
-			return FALSE;
-		}
+		break;
+	case PK_BACKEND_SPAWN_OP_CATEGORY:
 		if (g_strcmp0 (sections[1], sections[2]) == 0) {
 			g_set_error_literal (error, 1, 0, "cat_id cannot be the same as parent_id");
 			return FALSE;
@@ -544,13 +574,94 @@ pk_backend_spawn_parse_stdout (PkBackendSpawn *backend_spawn,
 			return FALSE;
 		}
 		pk_backend_job_category (job, sections[1], sections[2], sections[3], sections[4], sections[5]);
-	} else {
+		break;
+	default:
 		g_set_error (error, 1, 0, "invalid command '%s'", command);
 		return FALSE;
 	}
 	return TRUE;
 }
 
+static gboolean
+pk_backend_spawn_parse_stdout (PkBackendSpawn *backend_spawn,
+			       PkBackendJob *job,
+			       const gchar *line,
+			       GError **error)
+{
+	PkBackendSpawnOp op;
+	g_auto(GStrv) sections = NULL;
+
+	g_return_val_if_fail (PK_IS_BACKEND_SPAWN (backend_spawn), FALSE);
+
+	/* check if output line */
+	if (line == NULL)
+		return FALSE;
+
+	/* split by tab */
+	sections = g_strsplit (line, "\t", 0);
+	if (sections[0] != NULL)
+		op = GPOINTER_TO_UINT (g_hash_table_lookup (pk_backend_spawn_op_names, sections[0]));
+	else
+		op = PK_BACKEND_SPAWN_OP_UNKNOWN;
+	return pk_backend_spawn_dispatch (backend_spawn, job, op,
+					  sections, g_strv_length (sections),
+					  error);
+}
+
+/**
+ * pk_backend_spawn_parse_frame:
+ *
+ * A frame payload is the opcode as a single byte, followed by the same
+ * fields as the text protocol, each NUL terminated rather than tab
+ * separated, so no escaping is needed.
+ **/
+static gboolean
+pk_backend_spawn_parse_frame (PkBackendSpawn *backend_spawn,
+			      PkBackendJob *job,
+			      GBytes *payload,
+			      GError **error)
+{
+	const guint8 *data;
+	gsize len;
+	guint size = 1;
+	guint op;
+	g_autofree gchar *fields = NULL;
+	g_autofree gchar **sections = NULL;
+
+	g_return_val_if_fail (PK_IS_BACKEND_SPAWN (backend_spawn), FALSE);
+
+	data = g_bytes_get_data (payload, &len);
+	if (len == 0) {
+		g_set_error_literal (error, 1, 0, "empty frame");
+		return FALSE;
+	}
+	op = data[0];
+	if (op == PK_BACKEND_SPAWN_OP_UNKNOWN || op >= PK_BACKEND_SPAWN_OP_LAST) {
+		g_set_error (error, 1, 0, "invalid opcode %u", op);
+		return FALSE;
+	}
+	if (len > 1 && data[len - 1] != '\0') {
+		g_set_error (error, 1, 0, "unterminated frame for '%s'",
+			     pk_backend_spawn_ops[op].name);
+		return FALSE;
+	}
+
+	/* the dispatcher modifies the fields in place */
+	fields = g_malloc (len);
+	memcpy (fields, data + 1, len - 1);
+	for (gsize i = 0; i < len - 1; i++) {
+		if (fields[i] == '\0')
+			size++;
+	}
+	sections = g_new0 (gchar *, size + 1);
+	sections[0] = (gchar *) pk_backend_spawn_ops[op].name;
+	for (gsize i = 0, j = 1; j < size; j++) {
+		sections[j] = fields + i;
+		i += strlen (sections[j]) + 1;
+	}
+	return pk_backend_spawn_dispatch (backend_spawn, job, op, sections, size, error);
+}
+
 static void
 pk_backend_spawn_exit_cb (PkSpawn *spawn, PkSpawnExitType exit_enum, PkBackendSpawn *backend_spawn)
 {
@@ -617,6 +728,32 @@ pk_backend_spawn_stdout_cb (PkBackendSpawn *spawn, const gchar *line, PkBackendS
 		g_warning ("failed to parse: %s: %s", line, error->message);
 }
 
+gboolean
+pk_backend_spawn_inject_frame (PkBackendSpawn *backend_spawn,
+			       PkBackendJob *job,
+			       GBytes *payload,
+			       GError **error)
+{
+	g_return_val_if_fail (PK_IS_BACKEND_SPAWN (backend_spawn), FALSE);
+	g_return_val_if_fail (payload != NULL, FALSE);
+
+	/* the filter funcs only understand text lines */
+	return pk_backend_spawn_parse_frame (backend_spawn, job, payload, error);
+}
+
+static void
+pk_backend_spawn_stdout_frame_cb (PkSpawn *spawn, GBytes *payload, PkBackendSpawn *backend_spawn)
+{
+	gboolean ret;
+	g_autoptr(GError) error = NULL;
+	ret = pk_backend_spawn_inject_frame (backend_spawn,
+					     backend_spawn->priv->job,
+					     payload,
+					     &error);
+	if (!ret)
+		g_warning ("failed to parse frame: %s", error->message);
+}
+
 static void
 pk_backend_spawn_stderr_cb (PkBackendSpawn *spawn, const gchar *line, PkBackendSpawn *backend_spawn)
 {
@@ -752,6 +889,9 @@ pk_backend_spawn_get_envp (PkBackendSpawn *backend_spawn)
 			      g_strdup ("UID"),
 			      g_strdup_printf ("%u", pk_backend_job_get_uid (priv->job)));
 
+	/* ask helpers to use the binary protocol, old ones just ignore this */
+	g_hash_table_replace (env_table, g_strdup ("FRAMING"), g_strdup ("binary"));
+
 	/* CACHE_AGE */
 	cache_age = pk_backend_job_get_cache_age (priv->job);
 	if (cache_age == G_MAXUINT) {
@@ -1028,6 +1168,13 @@ pk_backend_spawn_class_init (PkBackendSpawnClass *klass)
 	GObjectClass *object_class = G_OBJECT_CLASS (klass);
 	object_class->finalize = pk_backend_spawn_finalize;
 	g_type_class_add_private (klass, sizeof (PkBackendSpawnPrivate));
+
+	pk_backend_spawn_op_names = g_hash_table_new (g_str_hash, g_str_equal);
+	for (guint i = PK_BACKEND_SPAWN_OP_HELLO; i < PK_BACKEND_SPAWN_OP_LAST; i++) {
+		g_hash_table_insert (pk_backend_spawn_op_names,
+				     (gpointer) pk_backend_spawn_ops[i].name,
+				     GUINT_TO_POINTER (i));
+	}
 }
 
 static void
@@ -1049,6 +1196,8 @@ pk_backend_spawn_new (GKeyFile *conf)
 			  G_CALLBACK (pk_backend_spawn_stdout_cb), backend_spawn);
 	g_signal_connect (backend_spawn->priv->spawn, "stderr",
 			  G_CALLBACK (pk_backend_spawn_stderr_cb), backend_spawn);
+	g_signal_connect (backend_spawn->priv->spawn, "stdout-frame",
+			  G_CALLBACK (pk_backend_spawn_stdout_frame_cb), backend_spawn);
 	return PK_BACKEND_SPAWN (backend_spawn);
 }
 
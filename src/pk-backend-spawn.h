@@ -68,6 +68,10 @@ gboolean	 pk_backend_spawn_inject_data		(PkBackendSpawn *backend_spawn,
 							 PkBackendJob	*job,
 							 const gchar	*line,
 							 GError		**error);
+gboolean	 pk_backend_spawn_inject_frame		(PkBackendSpawn *backend_spawn,
+							 PkBackendJob	*job,
+							 GBytes		*payload,
+							 GError		**error);
 
 /* filtering */
 typedef gboolean (*PkBackendSpawnFilterFunc)		(PkBackendJob	*job,
@@ -203,6 +203,7 @@ struct PkBackendPrivate
 	guint			 repo_list_changed_id;
 	guint			 installed_db_changed_id;
 	guint			 updates_changed_id;
+	guint			 cache_generation;
 };
 
 G_DEFINE_TYPE (PkBackend, pk_backend, G_TYPE_OBJECT)
@@ -610,11 +611,39 @@ pk_backend_repo_list_changed_cb (gpointer user_data)
 	PkBackend *backend = PK_BACKEND (user_data);
 
 	g_debug ("emitting repo-list-changed");
+	pk_backend_cache_invalidate (backend);
 	g_signal_emit (backend, signals [SIGNAL_REPO_LIST_CHANGED], 0);
 	backend->priv->repo_list_changed_id = 0;
 	return FALSE;
 }
 
+/**
+ * pk_backend_cache_invalidate:
+ *
+ * Makes the daemon forget the results of earlier queries, as the
+ * packages, updates or repositories may have changed.
+ **/
+void
+pk_backend_cache_invalidate (PkBackend *backend)
+{
+	g_return_if_fail (PK_IS_BACKEND (backend));
+	g_return_if_fail (pk_is_thread_default ());
+	backend->priv->cache_generation++;
+}
+
+/**
+ * pk_backend_get_cache_generation:
+ *
+ * Return value: a number that changes every time the results of queries
+ * have to be considered outdated
+ **/
+guint
+pk_backend_get_cache_generation (PkBackend *backend)
+{
+	g_return_val_if_fail (PK_IS_BACKEND (backend), 0);
+	return backend->priv->cache_generation;
+}
+
 void
 pk_backend_repo_list_changed (PkBackend *backend)
 {
@@ -637,6 +666,7 @@ pk_backend_updates_changed (PkBackend *backend)
 	g_return_val_if_fail (pk_is_thread_default (), FALSE);
 
 	g_debug ("emitting updates-changed");
+	pk_backend_cache_invalidate (backend);
 	g_signal_emit (backend, signals [SIGNAL_UPDATES_CHANGED], 0);
 	return TRUE;
 }
@@ -682,6 +712,7 @@ pk_backend_installed_db_changed_cb (gpointer user_data)
 	}
 	backend->priv->installed_db_changed_id = 0;
 	g_debug ("emitting installed-changed");
+	pk_backend_cache_invalidate (backend);
 	g_signal_emit (backend, signals [SIGNAL_INSTALLED_CHANGED], 0);
 	return FALSE;
 }
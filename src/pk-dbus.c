@@ -33,34 +33,161 @@
 
 #define PK_DBUS_GET_PRIVATE(o) (G_TYPE_INSTANCE_GET_PRIVATE ((o), PK_TYPE_DBUS, PkDbusPrivate))
 
+/* a unique bus name that has talked to us, which is kept until it leaves the
+ * bus as unique names are never reused */
+typedef struct {
+	PkDbus			*dbus;		/* not owned */
+	gchar			*name;
+	guint			 watch_id;
+	gboolean		 vanished;
+	gboolean		 resolved;
+	guint32			 uid;
+	guint32			 pid;
+	gchar			*session;	/* (nullable) */
+	GPtrArray		*tasks;		/* GTask, waiting for the lookup */
+	GPtrArray		*watchers;	/* PkDbusWatcher, not owned */
+} PkDbusSender;
+
+typedef struct {
+	guint			 id;
+	PkDbusSender		*sender;
+	PkDbusVanishedFunc	 func;
+	gpointer		 user_data;
+} PkDbusWatcher;
+
 struct PkDbusPrivate
 {
 	GDBusConnection		*connection;
 	GDBusProxy		*proxy_pid;
 	GDBusProxy		*proxy_uid;
 	GDBusProxy		*proxy_session;
+	GHashTable		*senders;	/* name : PkDbusSender */
+	GHashTable		*watchers;	/* id : PkDbusWatcher */
+	guint			 watcher_id_last;
 };
 
 static gpointer pk_dbus_object = NULL;
 
 G_DEFINE_TYPE (PkDbus, pk_dbus, G_TYPE_OBJECT)
 
+/* set in the test suite */
+static gboolean
+pk_dbus_sender_is_self_check (const gchar *sender)
+{
+	if (g_strcmp0 (sender, ":org.freedesktop.PackageKit") != 0)
+		return FALSE;
+	g_debug ("using self-check shortcut");
+	return TRUE;
+}
+
+static void
+pk_dbus_sender_free (PkDbusSender *item)
+{
+	g_assert (item->tasks->len == 0);
+	for (guint i = 0; i < item->watchers->len; i++) {
+		PkDbusWatcher *watcher = g_ptr_array_index (item->watchers, i);
+		g_hash_table_remove (item->dbus->priv->watchers,
+				     GUINT_TO_POINTER (watcher->id));
+	}
+	if (item->watch_id != 0)
+		g_bus_unwatch_name (item->watch_id);
+	g_ptr_array_unref (item->watchers);
+	g_ptr_array_unref (item->tasks);
+	g_free (item->session);
+	g_free (item->name);
+	g_free (item);
+}
+
+static void
+pk_dbus_sender_vanished_cb (GDBusConnection *connection,
+			    const gchar *name,
+			    gpointer user_data)
+{
+	PkDbusSender *item = (PkDbusSender *) user_data;
+	PkDbus *dbus = item->dbus;
+	g_autoptr(GPtrArray) watchers = NULL;
+
+	g_debug ("%s left the bus, forgetting its credentials", item->name);
+
+	/* the callbacks may unwatch themselves or others */
+	watchers = g_ptr_array_new_with_free_func (g_free);
+	for (guint i = 0; i < item->watchers->len; i++) {
+		PkDbusWatcher *watcher = g_new (PkDbusWatcher, 1);
+		*watcher = *((PkDbusWatcher *) g_ptr_array_index (item->watchers, i));
+		g_ptr_array_add (watchers, watcher);
+	}
+
+	/* the lookup in progress frees it when it completes */
+	item->vanished = TRUE;
+	g_hash_table_steal (dbus->priv->senders, item->name);
+	for (guint i = 0; i < watchers->len; i++) {
+		PkDbusWatcher *watcher = g_ptr_array_index (watchers, i);
+		if (!g_hash_table_contains (dbus->priv->watchers,
+					    GUINT_TO_POINTER (watcher->id)))
+			continue;
+		watcher->func (dbus, name, watcher->user_data);
+	}
+	if (item->tasks->len == 0)
+		pk_dbus_sender_free (item);
+}
+
+/* gets the cached entry, watching for the name to leave the bus if new */
+static PkDbusSender *
+pk_dbus_sender_ensure (PkDbus *dbus, const gchar *sender)
+{
+	PkDbusSender *item;
+
+	item = g_hash_table_lookup (dbus->priv->senders, sender);
+	if (item != NULL)
+		return item;
+	item = g_new0 (PkDbusSender, 1);
+	item->dbus = dbus;
+	item->name = g_strdup (sender);
+	item->tasks = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	item->watchers = g_ptr_array_new ();
+	g_hash_table_insert (dbus->priv->senders, item->name, item);
+	item->watch_id =
+		g_bus_watch_name_on_connection (dbus->priv->connection,
+						sender,
+						G_BUS_NAME_WATCHER_FLAGS_NONE,
+						NULL,
+						pk_dbus_sender_vanished_cb,
+						item,
+						NULL);
+	return item;
+}
+
+static void
+pk_dbus_sender_set_credentials (PkDbusSender *item, GVariant *credentials)
+{
+	const gchar *key;
+	GVariant *value;
+	GVariantIter iter;
+
+	item->uid = G_MAXUINT;
+	item->pid = G_MAXUINT;
+	g_variant_iter_init (&iter, credentials);
+	while (g_variant_iter_loop (&iter, "{&sv}", &key, &value)) {
+		if (g_strcmp0 (key, "ProcessID") == 0)
+			item->pid = g_variant_get_uint32 (value);
+		else if (g_strcmp0 (key, "UnixUserID") == 0)
+			item->uid = g_variant_get_uint32 (value);
+	}
+	item->resolved = TRUE;
+}
+
 gboolean
 pk_dbus_get_uid_pid (PkDbus *dbus, const gchar *sender, guint32 *uid, guint32 *pid)
 {
-	GVariant *reply_var;
-	const char *key;
-	GVariant *value;
-	gboolean need_pid, need_uid;
-	g_autoptr(GVariantIter) iter = NULL;
+	PkDbusSender *item;
+	g_autoptr(GVariant) credentials = NULL;
+	g_autoptr(GVariant) reply_var = NULL;
 	g_autoptr(GError) error = NULL;
 
 	g_return_val_if_fail (PK_IS_DBUS (dbus), G_MAXUINT);
 	g_return_val_if_fail (sender != NULL, G_MAXUINT);
 
-	/* set in the test suite */
-	if (g_strcmp0 (sender, ":org.freedesktop.PackageKit") == 0) {
-		g_debug ("using self-check shortcut");
+	if (pk_dbus_sender_is_self_check (sender)) {
 		if (uid != NULL)
 			*uid = 500;
 		if (pid != NULL)
@@ -72,39 +199,30 @@ pk_dbus_get_uid_pid (PkDbus *dbus, const gchar *sender, guint32 *uid, guint32 *p
 	if (dbus->priv->proxy_pid == NULL)
 		return FALSE;
 
-	/* get caller credentials from DBus */
-	reply_var = g_dbus_proxy_call_sync (dbus->priv->proxy_pid,
-					"GetConnectionCredentials",
-					g_variant_new ("(s)",
-						       sender),
-					G_DBUS_CALL_FLAGS_NONE,
-					2000,
-					NULL,
-					&error);
-	if (reply_var == NULL) {
-		g_warning ("Failed to get uid/pid for %s: %s",
-			   sender, error->message);
-		return FALSE;
-	}
-
-	need_pid = pid != NULL;
-	need_uid = uid != NULL;
-	g_variant_get (reply_var, "(a{sv})", &iter);
-	while (g_variant_iter_loop (iter, "{&sv}", &key, &value)) {
-		if (need_pid && g_strcmp0 (key, "ProcessID") == 0) {
-			*pid = g_variant_get_uint32 (value);
-			need_pid = FALSE;
-		} else if (need_uid && g_strcmp0 (key, "UnixUserID") == 0) {
-			*uid = g_variant_get_uint32 (value);
-			need_uid = FALSE;
-		}
-
-		if (!need_pid && !need_uid) {
-			g_variant_unref (value);
-			break;
+	/* usually resolved by pk_dbus_get_credentials_async() already */
+	item = g_hash_table_lookup (dbus->priv->senders, sender);
+	if (item == NULL || !item->resolved) {
+		reply_var = g_dbus_proxy_call_sync (dbus->priv->proxy_pid,
+						    "GetConnectionCredentials",
+						    g_variant_new ("(s)",
+								   sender),
+						    G_DBUS_CALL_FLAGS_NONE,
+						    2000,
+						    NULL,
+						    &error);
+		if (reply_var == NULL) {
+			g_warning ("Failed to get uid/pid for %s: %s",
+				   sender, error->message);
+			return FALSE;
 		}
+		credentials = g_variant_get_child_value (reply_var, 0);
+		item = pk_dbus_sender_ensure (dbus, sender);
+		pk_dbus_sender_set_credentials (item, credentials);
 	}
-
+	if (uid != NULL)
+		*uid = item->uid;
+	if (pid != NULL)
+		*pid = item->pid;
 	return TRUE;
 }
 
@@ -120,36 +238,14 @@ pk_dbus_get_uid_pid (PkDbus *dbus, const gchar *sender, guint32 *uid, guint32 *p
 guint32
 pk_dbus_get_uid (PkDbus *dbus, const gchar *sender)
 {
-	guint uid = G_MAXUINT;
-	g_autoptr(GError) error = NULL;
-	g_autoptr(GVariant) value = NULL;
+	guint32 uid = G_MAXUINT;
 
 	g_return_val_if_fail (PK_IS_DBUS (dbus), G_MAXUINT);
 	g_return_val_if_fail (sender != NULL, G_MAXUINT);
 
-	/* no connection to DBus */
-	if (dbus->priv->proxy_uid == NULL)
-		return G_MAXUINT;
-
-	/* set in the test suite */
-	if (g_strcmp0 (sender, ":org.freedesktop.PackageKit") == 0) {
-		g_debug ("using self-check shortcut");
-		return 500;
-	}
-	value = g_dbus_proxy_call_sync (dbus->priv->proxy_uid,
-					"GetConnectionUnixUser",
-					g_variant_new ("(s)",
-						       sender),
-					G_DBUS_CALL_FLAGS_NONE,
-					2000,
-					NULL,
-					&error);
-	if (value == NULL) {
-		g_warning ("Failed to get uid for %s: %s",
-			   sender, error->message);
+	/* resolves and caches the uid and pid together */
+	if (!pk_dbus_get_uid_pid (dbus, sender, &uid, NULL))
 		return G_MAXUINT;
-	}
-	g_variant_get (value, "(u)", &uid);
 	return uid;
 }
 
@@ -165,38 +261,17 @@ pk_dbus_get_uid (PkDbus *dbus, const gchar *sender)
 guint32
 pk_dbus_get_pid (PkDbus *dbus, const gchar *sender)
 {
-	guint pid = G_MAXUINT;
-	g_autoptr(GError) error = NULL;
-	g_autoptr(GVariant) value = NULL;
+	guint32 pid = G_MAXUINT;
 
 	g_return_val_if_fail (PK_IS_DBUS (dbus), G_MAXUINT);
 	g_return_val_if_fail (sender != NULL, G_MAXUINT);
 
-	/* set in the test suite */
-	if (g_strcmp0 (sender, ":org.freedesktop.PackageKit") == 0) {
-		g_debug ("using self-check shortcut");
+	if (pk_dbus_sender_is_self_check (sender))
 		return G_MAXUINT - 1;
-	}
-
-	/* no connection to DBus */
-	if (dbus->priv->proxy_pid == NULL)
-		return G_MAXUINT;
 
-	/* get pid from DBus */
-	value = g_dbus_proxy_call_sync (dbus->priv->proxy_pid,
-					"GetConnectionUnixProcessID",
-					g_variant_new ("(s)",
-						       sender),
-					G_DBUS_CALL_FLAGS_NONE,
-					2000,
-					NULL,
-					&error);
-	if (value == NULL) {
-		g_warning ("Failed to get pid for %s: %s",
-			   sender, error->message);
+	/* resolves and caches the uid and pid together */
+	if (!pk_dbus_get_uid_pid (dbus, sender, NULL, &pid))
 		return G_MAXUINT;
-	}
-	g_variant_get (value, "(u)", &pid);
 	return pid;
 }
 
@@ -245,18 +320,22 @@ pk_dbus_get_session (PkDbus *dbus, const gchar *sender)
 	g_autoptr(GError) error = NULL;
 #endif
 	guint pid;
+	PkDbusSender *item;
 	g_autoptr(GVariant) value = NULL;
 
 	g_return_val_if_fail (PK_IS_DBUS (dbus), NULL);
 	g_return_val_if_fail (sender != NULL, NULL);
 
-	/* set in the test suite */
-	if (g_strcmp0 (sender, ":org.freedesktop.PackageKit") == 0) {
-		g_debug ("using self-check shortcut");
+	if (pk_dbus_sender_is_self_check (sender)) {
 		session = g_strdup ("xxx");
 		goto out;
 	}
 
+	/* already known */
+	item = g_hash_table_lookup (dbus->priv->senders, sender);
+	if (item != NULL && item->session != NULL)
+		return g_strdup (item->session);
+
 	/* get pid */
 	pid = pk_dbus_get_pid (dbus, sender);
 	if (pid == G_MAXUINT) {
@@ -291,10 +370,309 @@ pk_dbus_get_session (PkDbus *dbus, const gchar *sender)
 	}
 	g_variant_get (value, "(o)", &session);
 #endif
+
+	/* pk_dbus_get_pid() cached the sender, unless it failed */
+	item = g_hash_table_lookup (dbus->priv->senders, sender);
+	if (item != NULL && session != NULL && item->session == NULL)
+		item->session = g_strdup (session);
 out:
 	return session;
 }
 
+/* completes everyone waiting for the lookup */
+static void
+pk_dbus_sender_return (PkDbusSender *item, const GError *error)
+{
+	g_autoptr(GPtrArray) tasks = NULL;
+
+	tasks = g_steal_pointer (&item->tasks);
+	item->tasks = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	for (guint i = 0; i < tasks->len; i++) {
+		GTask *task = g_ptr_array_index (tasks, i);
+		if (error != NULL)
+			g_task_return_error (task, g_error_copy (error));
+		else
+			g_task_return_boolean (task, TRUE);
+	}
+
+	/* it left the bus while we were asking */
+	if (item->vanished)
+		pk_dbus_sender_free (item);
+}
+
+#ifndef HAVE_SYSTEMD_SD_LOGIN_H
+static void
+pk_dbus_session_cb (GObject *source, GAsyncResult *res, gpointer user_data)
+{
+	PkDbusSender *item = (PkDbusSender *) user_data;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GVariant) value = NULL;
+	g_autoptr(PkDbus) dbus = item->dbus;
+
+	/* not fatal, pk_dbus_get_session() tries again when needed */
+	value = g_dbus_proxy_call_finish (G_DBUS_PROXY (source), res, &error);
+	if (value == NULL) {
+		g_debug ("failed to get session for %s: %s",
+			 item->name, error->message);
+	} else {
+		g_variant_get (value, "(o)", &item->session);
+	}
+	pk_dbus_sender_return (item, NULL);
+}
+#endif
+
+/* the uid and pid are known, so look up the session without blocking */
+static void
+pk_dbus_sender_resolved (PkDbusSender *item)
+{
+#ifndef HAVE_SYSTEMD_SD_LOGIN_H
+	PkDbus *dbus = item->dbus;
+#endif
+
+	item->resolved = TRUE;
+	if (item->pid == G_MAXUINT) {
+		pk_dbus_sender_return (item, NULL);
+		return;
+	}
+#ifdef HAVE_SYSTEMD_SD_LOGIN_H
+	/* this only reads from /run */
+	item->session = pk_dbus_get_session_systemd (item->pid);
+	pk_dbus_sender_return (item, NULL);
+#else
+	if (dbus->priv->proxy_session == NULL) {
+		pk_dbus_sender_return (item, NULL);
+		return;
+	}
+	g_dbus_proxy_call (dbus->priv->proxy_session,
+			   "GetSessionForUnixProcess",
+			   g_variant_new ("(u)", item->pid),
+			   G_DBUS_CALL_FLAGS_NONE,
+			   2000,
+			   NULL,
+			   pk_dbus_session_cb,
+			   item);
+	g_object_ref (dbus);
+#endif
+}
+
+static void
+pk_dbus_pid_cb (GObject *source, GAsyncResult *res, gpointer user_data)
+{
+	PkDbusSender *item = (PkDbusSender *) user_data;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GVariant) value = NULL;
+	g_autoptr(PkDbus) dbus = item->dbus;
+
+	value = g_dbus_proxy_call_finish (G_DBUS_PROXY (source), res, &error);
+	if (value == NULL) {
+		g_prefix_error (&error, "failed to get pid for %s: ", item->name);
+		pk_dbus_sender_return (item, error);
+		return;
+	}
+	g_variant_get (value, "(u)", &item->pid);
+	pk_dbus_sender_resolved (item);
+}
+
+static void
+pk_dbus_uid_cb (GObject *source, GAsyncResult *res, gpointer user_data)
+{
+	PkDbusSender *item = (PkDbusSender *) user_data;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GVariant) value = NULL;
+	g_autoptr(PkDbus) dbus = item->dbus;
+
+	value = g_dbus_proxy_call_finish (G_DBUS_PROXY (source), res, &error);
+	if (value == NULL) {
+		g_prefix_error (&error, "failed to get uid for %s: ", item->name);
+		pk_dbus_sender_return (item, error);
+		return;
+	}
+	g_variant_get (value, "(u)", &item->uid);
+	g_dbus_proxy_call (dbus->priv->proxy_pid,
+			   "GetConnectionUnixProcessID",
+			   g_variant_new ("(s)", item->name),
+			   G_DBUS_CALL_FLAGS_NONE,
+			   2000,
+			   NULL,
+			   pk_dbus_pid_cb,
+			   item);
+	g_object_ref (dbus);
+}
+
+static void
+pk_dbus_credentials_cb (GObject *source, GAsyncResult *res, gpointer user_data)
+{
+	PkDbusSender *item = (PkDbusSender *) user_data;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GVariant) credentials = NULL;
+	g_autoptr(GVariant) value = NULL;
+	g_autoptr(PkDbus) dbus = item->dbus;
+
+	value = g_dbus_proxy_call_finish (G_DBUS_PROXY (source), res, &error);
+	if (value == NULL) {
+		/* fallback in case our D-Bus does not support GetConnectionCredentials */
+		if (g_error_matches (error, G_DBUS_ERROR, G_DBUS_ERROR_UNKNOWN_METHOD)) {
+			g_dbus_proxy_call (dbus->priv->proxy_uid,
+					   "GetConnectionUnixUser",
+					   g_variant_new ("(s)", item->name),
+					   G_DBUS_CALL_FLAGS_NONE,
+					   2000,
+					   NULL,
+					   pk_dbus_uid_cb,
+					   item);
+			g_object_ref (dbus);
+			return;
+		}
+		g_prefix_error (&error, "failed to get uid/pid for %s: ", item->name);
+		pk_dbus_sender_return (item, error);
+		return;
+	}
+	credentials = g_variant_get_child_value (value, 0);
+	pk_dbus_sender_set_credentials (item, credentials);
+	pk_dbus_sender_resolved (item);
+}
+
+/**
+ * pk_dbus_get_credentials_async:
+ * @dbus: the #PkDbus instance
+ * @sender: the unique bus name of the caller
+ * @cancellable: a #GCancellable, or %NULL
+ * @callback: the function to run on completion
+ * @user_data: the data to pass to @callback
+ *
+ * Looks up the uid, pid and session of the caller without blocking the
+ * main loop. Once complete, pk_dbus_get_uid_pid(), pk_dbus_get_uid(),
+ * pk_dbus_get_pid() and pk_dbus_get_session() return immediately for
+ * @sender until it leaves the bus. Lookups for the same sender which are
+ * already in progress are shared.
+ **/
+void
+pk_dbus_get_credentials_async (PkDbus *dbus,
+			       const gchar *sender,
+			       GCancellable *cancellable,
+			       GAsyncReadyCallback callback,
+			       gpointer user_data)
+{
+	PkDbusSender *item;
+	g_autoptr(GTask) task = NULL;
+
+	g_return_if_fail (PK_IS_DBUS (dbus));
+	g_return_if_fail (sender != NULL);
+
+	task = g_task_new (dbus, cancellable, callback, user_data);
+	g_task_set_source_tag (task, pk_dbus_get_credentials_async);
+	if (pk_dbus_sender_is_self_check (sender)) {
+		g_task_return_boolean (task, TRUE);
+		return;
+	}
+	if (dbus->priv->proxy_pid == NULL) {
+		g_task_return_new_error (task, G_IO_ERROR, G_IO_ERROR_NOT_CONNECTED,
+					 "not connected to the system bus");
+		return;
+	}
+	item = pk_dbus_sender_ensure (dbus, sender);
+	if (item->resolved && item->tasks->len == 0) {
+		g_task_return_boolean (task, TRUE);
+		return;
+	}
+
+	/* already asking */
+	g_ptr_array_add (item->tasks, g_steal_pointer (&task));
+	if (item->tasks->len > 1)
+		return;
+
+	g_dbus_proxy_call (dbus->priv->proxy_pid,
+			   "GetConnectionCredentials",
+			   g_variant_new ("(s)", sender),
+			   G_DBUS_CALL_FLAGS_NONE,
+			   2000,
+			   NULL,
+			   pk_dbus_credentials_cb,
+			   item);
+
+	/* the callback owns a reference, so the cache outlives the call */
+	g_object_ref (dbus);
+}
+
+/**
+ * pk_dbus_get_credentials_finish:
+ * @dbus: the #PkDbus instance
+ * @res: the #GAsyncResult
+ * @error: a #GError, or %NULL
+ *
+ * Gets the result of pk_dbus_get_credentials_async().
+ *
+ * Return value: %TRUE if the uid and pid of the caller are known
+ **/
+gboolean
+pk_dbus_get_credentials_finish (PkDbus *dbus, GAsyncResult *res, GError **error)
+{
+	g_return_val_if_fail (g_task_is_valid (res, dbus), FALSE);
+	return g_task_propagate_boolean (G_TASK (res), error);
+}
+
+/**
+ * pk_dbus_watch_sender:
+ * @dbus: the #PkDbus instance
+ * @sender: the unique bus name of the caller
+ * @func: the function to call when @sender leaves the bus
+ * @user_data: the data to pass to @func
+ *
+ * Watches for the caller leaving the bus. All the watches for the same
+ * sender share a single name watch, which also invalidates the cached
+ * credentials.
+ *
+ * Return value: an ID for pk_dbus_unwatch_sender()
+ **/
+guint
+pk_dbus_watch_sender (PkDbus *dbus,
+		      const gchar *sender,
+		      PkDbusVanishedFunc func,
+		      gpointer user_data)
+{
+	PkDbusSender *item;
+	PkDbusWatcher *watcher;
+
+	g_return_val_if_fail (PK_IS_DBUS (dbus), 0);
+	g_return_val_if_fail (sender != NULL, 0);
+	g_return_val_if_fail (dbus->priv->connection != NULL, 0);
+
+	item = pk_dbus_sender_ensure (dbus, sender);
+	watcher = g_new0 (PkDbusWatcher, 1);
+	watcher->id = ++dbus->priv->watcher_id_last;
+	watcher->sender = item;
+	watcher->func = func;
+	watcher->user_data = user_data;
+	g_ptr_array_add (item->watchers, watcher);
+	g_hash_table_insert (dbus->priv->watchers,
+			     GUINT_TO_POINTER (watcher->id),
+			     watcher);
+	return watcher->id;
+}
+
+/**
+ * pk_dbus_unwatch_sender:
+ * @dbus: the #PkDbus instance
+ * @watch_id: an ID from pk_dbus_watch_sender()
+ *
+ * Stops watching for the caller leaving the bus. This is safe to call
+ * after the caller has left.
+ **/
+void
+pk_dbus_unwatch_sender (PkDbus *dbus, guint watch_id)
+{
+	PkDbusWatcher *watcher;
+
+	g_return_if_fail (PK_IS_DBUS (dbus));
+
+	watcher = g_hash_table_lookup (dbus->priv->watchers,
+				       GUINT_TO_POINTER (watch_id));
+	if (watcher == NULL)
+		return;
+	g_ptr_array_remove (watcher->sender->watchers, watcher);
+	g_hash_table_remove (dbus->priv->watchers, GUINT_TO_POINTER (watch_id));
+}
+
 static void
 pk_dbus_finalize (GObject *object)
 {
@@ -310,6 +688,10 @@ pk_dbus_finalize (GObject *object)
 		g_object_unref (dbus->priv->proxy_uid);
 	if (dbus->priv->proxy_session != NULL)
 		g_object_unref (dbus->priv->proxy_session);
+	g_hash_table_unref (dbus->priv->senders);
+	g_hash_table_unref (dbus->priv->watchers);
+	if (dbus->priv->connection != NULL)
+		g_object_unref (dbus->priv->connection);
 
 	G_OBJECT_CLASS (pk_dbus_parent_class)->finalize (object);
 }
@@ -400,6 +782,10 @@ static void
 pk_dbus_init (PkDbus *dbus)
 {
 	dbus->priv = PK_DBUS_GET_PRIVATE (dbus);
+	dbus->priv->senders = g_hash_table_new_full (g_str_hash, g_str_equal, NULL,
+						     (GDestroyNotify) pk_dbus_sender_free);
+	dbus->priv->watchers = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+						      NULL, g_free);
 }
 
 PkDbus *
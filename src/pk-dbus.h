@@ -23,6 +23,7 @@
 #define __PK_DBUS_H
 
 #include <glib-object.h>
+#include <gio/gio.h>
 
 G_BEGIN_DECLS
 
@@ -50,6 +51,10 @@ typedef struct
 G_DEFINE_AUTOPTR_CLEANUP_FUNC(PkDbus, g_object_unref)
 #endif
 
+typedef void	(*PkDbusVanishedFunc)			(PkDbus		*dbus,
+							 const gchar	*sender,
+							 gpointer	 user_data);
+
 GType		 pk_dbus_get_type		(void);
 PkDbus		*pk_dbus_new			(void);
 gboolean	 pk_dbus_connect		(PkDbus		*dbus,
@@ -64,6 +69,20 @@ guint32		 pk_dbus_get_pid		(PkDbus		*dbus,
 						 const gchar 	*sender);
 gchar		*pk_dbus_get_session		(PkDbus		*dbus,
 						 const gchar	*sender);
+void		 pk_dbus_get_credentials_async	(PkDbus		*dbus,
+						 const gchar	*sender,
+						 GCancellable	*cancellable,
+						 GAsyncReadyCallback callback,
+						 gpointer	 user_data);
+gboolean	 pk_dbus_get_credentials_finish	(PkDbus		*dbus,
+						 GAsyncResult	*res,
+						 GError		**error);
+guint		 pk_dbus_watch_sender		(PkDbus		*dbus,
+						 const gchar	*sender,
+						 PkDbusVanishedFunc func,
+						 gpointer	 user_data);
+void		 pk_dbus_unwatch_sender		(PkDbus		*dbus,
+						 guint		 watch_id);
 
 G_END_DECLS
 
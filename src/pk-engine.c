@@ -43,6 +43,7 @@
 #include <packagekit-glib2/pk-version.h>
 #include <polkit/polkit.h>
 
+#include "pk-auth-cache.h"
 #include "pk-backend.h"
 #include "pk-dbus.h"
 #include "pk-engine.h"
@@ -69,6 +70,7 @@ struct PkEnginePrivate
 	gboolean		 shutdown_as_soon_as_possible;
 	PkScheduler		*scheduler;
 	PkTransactionDb		*transaction_db;
+	PkAuthCache		*auth_cache;
 	PkBackend		*backend;
 	GNetworkMonitor		*network_monitor;
 	GKeyFile		*conf;
@@ -989,6 +991,8 @@ pk_engine_load_backend (PkEngine *engine, GError **error)
 	engine->priv->authority = polkit_authority_get_sync (NULL, error);
 	if (engine->priv->authority == NULL)
 		return FALSE;
+	pk_auth_cache_set_authority (engine->priv->auth_cache,
+				     engine->priv->authority);
 	if (!pk_transaction_db_load (engine->priv->transaction_db, error))
 		return FALSE;
 
@@ -1120,180 +1124,40 @@ pk_engine_daemon_get_property (GDBusConnection *connection_, const gchar *sender
 	return NULL;
 }
 
-static gboolean
-pk_engine_package_name_in_strv (gchar **strv, PkPackage *pkg)
-{
-	guint i;
-	for (i = 0; strv[i] != NULL; i++) {
-		if (g_strcmp0 (strv[i], pk_package_get_name (pkg)) == 0)
-			return TRUE;
-	}
-	return FALSE;
-}
-
-static GVariant *
-pk_engine_get_package_history_pkg (PkTransactionPast *item, PkPackage *pkg)
-{
-	GVariantBuilder builder;
-	g_variant_builder_init (&builder, G_VARIANT_TYPE_ARRAY);
-	g_variant_builder_add (&builder, "{sv}", "info",
-			       g_variant_new_uint32 (pk_package_get_info (pkg)));
-	g_variant_builder_add (&builder, "{sv}", "source",
-			       g_variant_new_string (pk_package_get_data (pkg)));
-	g_variant_builder_add (&builder, "{sv}", "version",
-			       g_variant_new_string (pk_package_get_version (pkg)));
-	g_variant_builder_add (&builder, "{sv}", "timestamp",
-			       g_variant_new_uint64 (pk_transaction_past_get_timestamp (item)));
-	g_variant_builder_add (&builder, "{sv}", "user-id",
-			       g_variant_new_uint32 (pk_transaction_past_get_uid (item)));
-	return g_variant_builder_end (&builder);
-}
-
-static gboolean
-pk_engine_is_package_history_interesing (PkPackage *package)
-{
-	gboolean ret;
-
-	switch (pk_package_get_info (package)) {
-	case PK_INFO_ENUM_INSTALLING:
-	case PK_INFO_ENUM_REMOVING:
-	case PK_INFO_ENUM_UPDATING:
-		ret = TRUE;
-		break;
-	default:
-		ret = FALSE;
-		break;
-	}
-	return ret;
-}
-
 static GVariant *
 pk_engine_get_package_history (PkEngine *engine,
 			       gchar **package_names,
 			       guint max_size,
 			       GError **error)
 {
-	const gchar *data;
-	const gchar *pkgname;
-	gboolean ret;
-	gchar *key;
-	gint64 timestamp;
-	GList *l;
-	GList *list;
-	GPtrArray *array = NULL;
-	guint i;
+	GVariant *value;
 	GVariantBuilder builder;
-	GVariant *value = NULL;
-	PkTransactionPast *item;
-	g_autoptr(GHashTable) deduplicate_hash = NULL;
+	guint i;
 	g_autoptr(GHashTable) pkgname_hash = NULL;
-	g_autoptr(GList) keys = NULL;
-	g_autoptr(PkPackage) package_tmp = NULL;
-
-	list = pk_transaction_db_get_list (engine->priv->transaction_db, max_size);
-
-	/* simplify the loop */
-	if (max_size == 0)
-		max_size = G_MAXUINT;
 
-	pkgname_hash = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, (GDestroyNotify) g_ptr_array_unref);
-	deduplicate_hash = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
-	package_tmp = pk_package_new ();
-	for (l = list; l != NULL; l = l->next) {
-		g_auto(GStrv) package_lines = NULL;
-		item = PK_TRANSACTION_PAST (l->data);
-
-		/* ignore anything that failed */
-		if (!pk_transaction_past_get_succeeded (item))
+	/* each name is an indexed lookup into the history */
+	pkgname_hash = g_hash_table_new (g_str_hash, g_str_equal);
+	g_variant_builder_init (&builder, G_VARIANT_TYPE ("a{saa{sv}}"));
+	for (i = 0; package_names[i] != NULL; i++) {
+		if (!g_hash_table_add (pkgname_hash, package_names[i]))
 			continue;
-
-		/* split up data */
-		data = pk_transaction_past_get_data (item);
-		if (data == NULL)
+		value = pk_transaction_db_get_package_history (engine->priv->transaction_db,
+							       package_names[i],
+							       max_size);
+		if (value == NULL)
 			continue;
-		package_lines = g_strsplit (data, "\n", -1);
-		for (i = 0; package_lines[i] != NULL; i++) {
-			g_autoptr(GError) error_local = NULL;
-			ret = pk_package_parse (package_tmp,
-						package_lines[i],
-						&error_local);
-			if (!ret) {
-				g_warning ("Failed to parse package: '%s': %s",
-					   package_lines[i], error_local->message);
-				continue;
-			}
-
-			/* not the package we care about */
-			if (!pk_engine_package_name_in_strv (package_names, package_tmp))
-				continue;
-
-			/* not a state we care about */
-			if (!pk_engine_is_package_history_interesing (package_tmp))
-				continue;
-
-			/* transactions without a timestamp are not interesting */
-			timestamp = pk_transaction_past_get_timestamp (item);
-			if (timestamp == 0)
-				continue;
-
-			/* de-duplicate the entry, in the case of multiarch */
-			key = g_strdup_printf ("%s-%" G_GINT64_FORMAT,
-					       pk_package_get_name (package_tmp),
-					       timestamp);
-			if (g_hash_table_lookup (deduplicate_hash, key) != NULL) {
-				g_free (key);
-				continue;
-			}
-			g_hash_table_insert (deduplicate_hash, key, package_lines[i]);
-
-			/* get the blob for this data item */
-			value = pk_engine_get_package_history_pkg (item, package_tmp);
-			if (value == NULL)
-				continue;
-
-			/* find the array */
-			pkgname = pk_package_get_name (package_tmp);
-			array = g_hash_table_lookup (pkgname_hash, pkgname);
-			if (array == NULL) {
-				array = g_ptr_array_new ();
-				g_hash_table_insert (pkgname_hash,
-						     g_strdup (pkgname),
-						     array);
-			}
-			g_ptr_array_add (array, value);
-		}
+		g_variant_builder_add (&builder, "{s@aa{sv}}", package_names[i], value);
 	}
 
 	/* no history returns an empty array */
-	if (g_hash_table_size (pkgname_hash) == 0) {
-		value = g_variant_new_array (G_VARIANT_TYPE ("{saa{sv}}"), NULL, 0);
-		goto out;
-	}
-
-	/* we have a hash of pkgname:GPtrArray where the GPtrArray is an array
-	 * of GVariants of type a{sv} */
-	g_variant_builder_init (&builder, G_VARIANT_TYPE_ARRAY);
-	keys = g_hash_table_get_keys (pkgname_hash);
-	for (l = keys; l != NULL; l = l->next) {
-		pkgname = l->data;
-		array = g_hash_table_lookup (pkgname_hash, pkgname);
-		/* create aa{sv} */
-		value = g_variant_new_array (NULL,
-					     (GVariant * const *) array->pdata,
-					     MIN (array->len, max_size));
-		g_variant_builder_add (&builder, "{s@aa{sv}}", pkgname, value);
-	}
-	value = g_variant_builder_end (&builder);
-out:
-	g_list_free_full (list, (GDestroyNotify) g_object_unref);
-	return value;
+	return g_variant_builder_end (&builder);
 }
 
 static void
-pk_engine_daemon_method_call (GDBusConnection *connection_, const gchar *sender,
-			      const gchar *object_path, const gchar *interface_name,
-			      const gchar *method_name, GVariant *parameters,
-			      GDBusMethodInvocation *invocation, gpointer user_data)
+pk_engine_daemon_method_call_resolved (GDBusConnection *connection_, const gchar *sender,
+				       const gchar *object_path, const gchar *interface_name,
+				       const gchar *method_name, GVariant *parameters,
+				       GDBusMethodInvocation *invocation, gpointer user_data)
 {
 	const gchar *tmp = NULL;
 	gboolean ret;
@@ -1331,6 +1195,13 @@ pk_engine_daemon_method_call (GDBusConnection *connection_, const gchar *sender,
 		return;
 	}
 
+	if (g_strcmp0 (method_name, "GetTransactionStats") == 0) {
+		value = pk_scheduler_get_stats (engine->priv->scheduler);
+		tuple = g_variant_new_tuple (&value, 1);
+		g_dbus_method_invocation_return_value (invocation, tuple);
+		return;
+	}
+
 	if (g_strcmp0 (method_name, "GetPackageHistory") == 0) {
 		g_autofree gchar **package_names = NULL;
 
@@ -1503,6 +1374,51 @@ pk_engine_daemon_method_call (GDBusConnection *connection_, const gchar *sender,
 	}
 }
 
+static void
+pk_engine_daemon_credentials_cb (GObject *source, GAsyncResult *res, gpointer user_data)
+{
+	GDBusMethodInvocation *invocation = G_DBUS_METHOD_INVOCATION (user_data);
+	g_autoptr(GError) error = NULL;
+
+	/* not fatal, the method handler retries and returns the error */
+	if (!pk_dbus_get_credentials_finish (PK_DBUS (source), res, &error))
+		g_debug ("failed to resolve caller: %s", error->message);
+	pk_engine_daemon_method_call_resolved (g_dbus_method_invocation_get_connection (invocation),
+					       g_dbus_method_invocation_get_sender (invocation),
+					       g_dbus_method_invocation_get_object_path (invocation),
+					       g_dbus_method_invocation_get_interface_name (invocation),
+					       g_dbus_method_invocation_get_method_name (invocation),
+					       g_dbus_method_invocation_get_parameters (invocation),
+					       invocation,
+					       g_dbus_method_invocation_get_user_data (invocation));
+}
+
+static void
+pk_engine_daemon_method_call (GDBusConnection *connection_, const gchar *sender,
+			      const gchar *object_path, const gchar *interface_name,
+			      const gchar *method_name, GVariant *parameters,
+			      GDBusMethodInvocation *invocation, gpointer user_data)
+{
+	PkEngine *engine = PK_ENGINE (user_data);
+
+	/* look up who the caller is without blocking the other transactions,
+	 * so that the method finds the credentials already cached */
+	if ((g_strcmp0 (method_name, "CreateTransaction") == 0 ||
+	     g_strcmp0 (method_name, "SetProxy") == 0) &&
+	    pk_dbus_connect (engine->priv->dbus, NULL)) {
+		pk_dbus_get_credentials_async (engine->priv->dbus,
+					       sender,
+					       NULL,
+					       pk_engine_daemon_credentials_cb,
+					       invocation);
+		return;
+	}
+	pk_engine_daemon_method_call_resolved (connection_, sender,
+					       object_path, interface_name,
+					       method_name, parameters,
+					       invocation, user_data);
+}
+
 typedef enum {
 	PK_ENGINE_OFFLINE_ROLE_CANCEL,
 	PK_ENGINE_OFFLINE_ROLE_CLEAR_RESULTS,
@@ -2008,6 +1924,7 @@ pk_engine_finalize (GObject *object)
 	g_object_unref (engine->priv->monitor_offline_upgrade);
 	g_object_unref (engine->priv->scheduler);
 	g_object_unref (engine->priv->transaction_db);
+	g_object_unref (engine->priv->auth_cache);
 	if (engine->priv->authority != NULL)
 		g_object_unref (engine->priv->authority);
 	g_object_unref (engine->priv->backend);
@@ -2032,9 +1949,14 @@ pk_engine_new (GKeyFile *conf)
 			  G_CALLBACK (pk_engine_backend_repo_list_changed_cb), engine);
 	g_signal_connect (engine->priv->backend, "updates-changed",
 			  G_CALLBACK (pk_engine_backend_updates_changed_cb), engine);
+	engine->priv->auth_cache = pk_auth_cache_new (engine->priv->conf);
 	engine->priv->scheduler = pk_scheduler_new (engine->priv->conf);
 	pk_scheduler_set_backend (engine->priv->scheduler,
 				  engine->priv->backend);
+	pk_scheduler_set_transaction_db (engine->priv->scheduler,
+					 engine->priv->transaction_db);
+	pk_scheduler_set_auth_cache (engine->priv->scheduler,
+				     engine->priv->auth_cache);
 	g_signal_connect (engine->priv->scheduler, "changed",
 			  G_CALLBACK (pk_engine_scheduler_changed_cb), engine);
 	return PK_ENGINE (engine);
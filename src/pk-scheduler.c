@@ -83,8 +83,65 @@ static void     pk_scheduler_finalize	(GObject	*object);
 /* how long the transaction is valid before it's destroyed */
 #define PK_SCHEDULER_CREATE_COMMIT_TIMEOUT		300 /* s */
 
-/* maximum number of requests a given user is able to request and queue */
-#define PK_SCHEDULER_SIMULTANEOUS_TRANSACTIONS_FOR_UID	500
+/* how long query results are reused, in case the backend misses a change
+ * made to the package database outside of the daemon */
+#define PK_SCHEDULER_RESULTS_CACHE_TTL			60 /* s */
+
+/* number of requests all users together are able to request and queue,
+ * which is shared fairly between the users having transactions */
+#define PK_SCHEDULER_SIMULTANEOUS_TRANSACTIONS		1000
+
+/* number of requests a user is always able to request and queue */
+#define PK_SCHEDULER_SIMULTANEOUS_TRANSACTIONS_FOR_UID	100
+
+/* latency histograms use quarter-octave buckets, so a reported percentile is
+ * within 25% of the real value, and the last bucket starts at about 2 hours */
+#define PK_SCHEDULER_HISTOGRAM_BUCKETS			128
+
+/* the transaction phases that are tracked for each role */
+typedef enum {
+	PK_SCHEDULER_METRIC_QUEUE,
+	PK_SCHEDULER_METRIC_FIRST_RESULT,
+	PK_SCHEDULER_METRIC_RUN,
+	PK_SCHEDULER_METRIC_TOTAL,
+	PK_SCHEDULER_METRIC_LAST
+} PkSchedulerMetric;
+
+/* these match the keys of pk_transaction_get_stats() */
+static const gchar *pk_scheduler_metric_names[] = {
+	"queue-time",
+	"first-result-time",
+	"run-time",
+	"total-time",
+};
+
+typedef struct {
+	guint			 count;		/* transactions */
+	guint			 samples[PK_SCHEDULER_METRIC_LAST];
+	guint64			 max[PK_SCHEDULER_METRIC_LAST];
+	guint			 buckets[PK_SCHEDULER_METRIC_LAST][PK_SCHEDULER_HISTOGRAM_BUCKETS];
+} PkSchedulerHistogram;
+
+/* the order in which waiting transactions are run */
+typedef enum {
+	PK_SCHEDULER_CLASS_INTERACTIVE_QUERY,
+	PK_SCHEDULER_CLASS_INTERACTIVE_MODIFY,
+	PK_SCHEDULER_CLASS_BACKGROUND,
+	PK_SCHEDULER_CLASS_IDLE,
+	PK_SCHEDULER_CLASS_LAST
+} PkSchedulerClass;
+
+/* the waiting transactions of one class, taking turns between users */
+typedef struct {
+	GQueue			 uids;		/* PkSchedulerUidQueue */
+	GHashTable		*uid_queues;	/* uid : PkSchedulerUidQueue */
+} PkSchedulerReadyQueue;
+
+typedef struct {
+	guint			 uid;
+	GQueue			 items;		/* PkSchedulerItem, not owned */
+	GList			 link;		/* in PkSchedulerReadyQueue.uids */
+} PkSchedulerUidQueue;
 
 struct PkSchedulerPrivate
 {
@@ -92,9 +149,20 @@ struct PkSchedulerPrivate
 	guint			 unwedge_id;
 	GKeyFile		*conf;
 	PkBackend		*backend;
+	PkTransactionDb		*transaction_db;
+	PkAuthCache		*auth_cache;
 	GDBusNodeInfo		*introspection;
+	GHashTable		*results_cache;	/* coalesce key : PkSchedulerCached */
+	PkSchedulerReadyQueue	 ready[PK_SCHEDULER_CLASS_LAST];
+	PkSchedulerHistogram	*histograms[PK_ROLE_ENUM_LAST];	/* (nullable) */
 };
 
+typedef struct {
+	guint			 generation;
+	gint64			 time_added;
+	PkResults		*results;
+} PkSchedulerCached;
+
 typedef struct {
 	PkTransaction		*transaction;
 	PkScheduler		*scheduler;
@@ -107,6 +175,13 @@ typedef struct {
 	gulong			 allow_cancel_changed_id;
 	guint			 uid;
 	guint			 tries;
+	gchar			*coalesce_key;
+	gpointer		 leader;	/* PkSchedulerItem, not owned */
+	GPtrArray		*subscribers;	/* PkSchedulerItem, not owned */
+	PkResults		*replay;
+	guint			 cache_generation;
+	PkSchedulerClass	 priority_class;
+	GList			*ready_link;	/* in PkSchedulerUidQueue.items */
 } PkSchedulerItem;
 
 enum {
@@ -118,6 +193,8 @@ static guint signals [PK_SCHEDULER_LAST_SIGNAL] = { 0 };
 
 G_DEFINE_TYPE (PkScheduler, pk_scheduler, G_TYPE_OBJECT)
 
+static void	pk_scheduler_run_next_items	(PkScheduler	*scheduler);
+
 /**
  * pk_scheduler_get_from_tid:
  **/
@@ -188,10 +265,127 @@ pk_scheduler_role_present (PkScheduler *scheduler, PkRoleEnum role)
 	return FALSE;
 }
 
+static const gchar *
+pk_scheduler_class_to_string (PkSchedulerClass priority_class)
+{
+	switch (priority_class) {
+	case PK_SCHEDULER_CLASS_INTERACTIVE_QUERY:
+		return "interactive-query";
+	case PK_SCHEDULER_CLASS_INTERACTIVE_MODIFY:
+		return "interactive-modify";
+	case PK_SCHEDULER_CLASS_BACKGROUND:
+		return "background";
+	case PK_SCHEDULER_CLASS_IDLE:
+		return "idle";
+	default:
+		return "unknown";
+	}
+}
+
+static PkSchedulerClass
+pk_scheduler_get_class (PkTransaction *transaction)
+{
+	PkRoleEnum role;
+
+	if (!pk_transaction_get_background (transaction)) {
+		if (pk_transaction_is_query (transaction))
+			return PK_SCHEDULER_CLASS_INTERACTIVE_QUERY;
+		return PK_SCHEDULER_CLASS_INTERACTIVE_MODIFY;
+	}
+
+	/* only preparing for later, nobody is waiting for the result */
+	role = pk_transaction_get_role (transaction);
+	if (role == PK_ROLE_ENUM_REFRESH_CACHE ||
+	    role == PK_ROLE_ENUM_DOWNLOAD_PACKAGES)
+		return PK_SCHEDULER_CLASS_IDLE;
+	return PK_SCHEDULER_CLASS_BACKGROUND;
+}
+
+static void
+pk_scheduler_uid_queue_free (PkSchedulerUidQueue *uid_queue)
+{
+	g_queue_clear (&uid_queue->items);
+	g_free (uid_queue);
+}
+
+/* queue a committed transaction until it can be run */
+static void
+pk_scheduler_ready_push (PkScheduler *scheduler, PkSchedulerItem *item)
+{
+	PkSchedulerReadyQueue *ready = &scheduler->priv->ready[item->priority_class];
+	PkSchedulerUidQueue *uid_queue;
+
+	if (item->ready_link != NULL)
+		return;
+	uid_queue = g_hash_table_lookup (ready->uid_queues, GUINT_TO_POINTER (item->uid));
+	if (uid_queue == NULL) {
+		uid_queue = g_new0 (PkSchedulerUidQueue, 1);
+		uid_queue->uid = item->uid;
+		uid_queue->link.data = uid_queue;
+		g_queue_push_tail_link (&ready->uids, &uid_queue->link);
+		g_hash_table_insert (ready->uid_queues,
+				     GUINT_TO_POINTER (item->uid), uid_queue);
+	}
+	g_queue_push_tail (&uid_queue->items, item);
+	item->ready_link = uid_queue->items.tail;
+}
+
+/* stop waiting, and let the next user have a turn if @item was run */
+static void
+pk_scheduler_ready_remove (PkScheduler *scheduler, PkSchedulerItem *item, gboolean ran)
+{
+	PkSchedulerReadyQueue *ready = &scheduler->priv->ready[item->priority_class];
+	PkSchedulerUidQueue *uid_queue;
+
+	if (item->ready_link == NULL)
+		return;
+	uid_queue = g_hash_table_lookup (ready->uid_queues, GUINT_TO_POINTER (item->uid));
+	g_queue_delete_link (&uid_queue->items, item->ready_link);
+	item->ready_link = NULL;
+
+	if (g_queue_is_empty (&uid_queue->items)) {
+		g_queue_unlink (&ready->uids, &uid_queue->link);
+		g_hash_table_remove (ready->uid_queues, GUINT_TO_POINTER (item->uid));
+		return;
+	}
+	if (ran) {
+		g_queue_unlink (&ready->uids, &uid_queue->link);
+		g_queue_push_tail_link (&ready->uids, &uid_queue->link);
+	}
+}
+
+/* stop sharing the results of another transaction, or sharing ours */
+static gboolean
+pk_scheduler_item_detach (PkSchedulerItem *item)
+{
+	PkSchedulerItem *leader = item->leader;
+	gboolean released = item->subscribers->len > 0;
+
+	if (leader != NULL) {
+		g_ptr_array_remove (leader->subscribers, item);
+		item->leader = NULL;
+	}
+	for (guint i = 0; i < item->subscribers->len; i++) {
+		PkSchedulerItem *subscriber = g_ptr_array_index (item->subscribers, i);
+		g_debug ("%s no longer waits for %s", subscriber->tid, item->tid);
+		subscriber->leader = NULL;
+		if (pk_transaction_get_state (subscriber->transaction) == PK_TRANSACTION_STATE_READY)
+			pk_scheduler_ready_push (item->scheduler, subscriber);
+	}
+	g_ptr_array_set_size (item->subscribers, 0);
+	return released;
+}
+
 static void
 pk_scheduler_item_free (PkSchedulerItem *item)
 {
 	g_return_if_fail (item != NULL);
+	pk_scheduler_item_detach (item);
+	pk_scheduler_ready_remove (item->scheduler, item, FALSE);
+	g_ptr_array_unref (item->subscribers);
+	g_free (item->coalesce_key);
+	if (item->replay != NULL)
+		g_object_unref (item->replay);
 	if (item->finished_id != 0)
 		g_signal_handler_disconnect (item->transaction, item->finished_id);
 	if (item->state_changed_id != 0)
@@ -220,6 +414,7 @@ static gboolean
 pk_scheduler_remove_internal (PkScheduler *scheduler, PkSchedulerItem *item)
 {
 	gboolean ret;
+	gboolean released;
 
 	g_return_val_if_fail (PK_IS_SCHEDULER (scheduler), FALSE);
 	g_return_val_if_fail (item != NULL, FALSE);
@@ -230,7 +425,12 @@ pk_scheduler_remove_internal (PkScheduler *scheduler, PkSchedulerItem *item)
 		g_warning ("could not remove %p as not present in list", item);
 		return FALSE;
 	}
+
+	/* anything that was waiting for the results has to run itself */
+	released = pk_scheduler_item_detach (item);
 	pk_scheduler_item_free (item);
+	if (released)
+		pk_scheduler_run_next_items (scheduler);
 
 	return TRUE;
 }
@@ -288,10 +488,13 @@ pk_scheduler_run_idle_cb (PkSchedulerItem *item)
 {
 	gboolean ret;
 
-	/* run the transaction */
+	/* run the transaction, or give it the results of an identical one */
 	pk_transaction_set_backend (item->transaction,
 				    item->scheduler->priv->backend);
-	ret = pk_transaction_run (item->transaction);
+	if (item->replay != NULL)
+		ret = pk_transaction_replay (item->transaction, item->replay);
+	else
+		ret = pk_transaction_run (item->transaction);
 	if (!ret)
 		g_error ("failed to run transaction (fatal)");
 
@@ -303,9 +506,14 @@ pk_scheduler_run_idle_cb (PkSchedulerItem *item)
 static void
 pk_scheduler_run_item (PkScheduler *scheduler, PkSchedulerItem *item)
 {
+	pk_scheduler_ready_remove (scheduler, item, TRUE);
+
 	/* we set this here so that we don't try starting more than one */
 	pk_transaction_set_state (item->transaction, PK_TRANSACTION_STATE_RUNNING);
 
+	/* results are only worth keeping if nothing changed while running */
+	item->cache_generation = pk_backend_get_cache_generation (scheduler->priv->backend);
+
 	/* add this idle, so that we don't have a deep out-of-order callchain */
 	item->idle_id = g_idle_add ((GSourceFunc) pk_scheduler_run_idle_cb, item);
 	g_source_set_name_by_id (item->idle_id, "[PkScheduler] run");
@@ -360,6 +568,10 @@ pk_scheduler_get_exclusive_running (PkScheduler *scheduler)
 	for (i = 0; i < array->len; i++) {
 		item = (PkSchedulerItem *) g_ptr_array_index (array, i);
 
+		/* replaying results does not touch the backend */
+		if (item->replay != NULL)
+			continue;
+
 		/* check if a transaction is running in exclusive */
 		if (pk_transaction_is_exclusive (item->transaction)) {
 			/* should never be more that one, but we count them for sanity checks */
@@ -369,84 +581,335 @@ pk_scheduler_get_exclusive_running (PkScheduler *scheduler)
 	return exclusive_running;
 }
 
-static gboolean
-pk_scheduler_get_background_running (PkScheduler *scheduler)
+/**
+ * pk_scheduler_preempt:
+ *
+ * Cancels the background transactions that would keep @item from running,
+ * as long as they are at a point where they can be cancelled.
+ **/
+static void
+pk_scheduler_preempt (PkScheduler *scheduler, PkSchedulerItem *item)
 {
-	PkSchedulerItem *item = NULL;
+	PkSchedulerItem *running;
 	guint i;
 	g_autoptr(GPtrArray) array = NULL;
 
-	g_return_val_if_fail (PK_IS_SCHEDULER (scheduler), FALSE);
+	/* only exclusive transactions have to wait for others */
+	if (!pk_transaction_is_exclusive (item->transaction))
+		return;
 
-	/* anything running? */
 	array = pk_scheduler_get_active_transactions (scheduler);
-	if (array->len == 0)
-		return FALSE;
-
-	/* check if we have any running background transaction */
 	for (i = 0; i < array->len; i++) {
-		item = (PkSchedulerItem *) g_ptr_array_index (array, i);
-		if (pk_transaction_get_background (item->transaction))
-			return TRUE;
+		running = (PkSchedulerItem *) g_ptr_array_index (array, i);
+		if (running->priority_class < PK_SCHEDULER_CLASS_BACKGROUND)
+			continue;
+		if (running->replay != NULL ||
+		    !pk_transaction_is_exclusive (running->transaction))
+			continue;
+		if (!pk_backend_job_get_allow_cancel (pk_transaction_get_backend_job (running->transaction))) {
+			g_debug ("not preempting %s as it cannot be cancelled now", running->tid);
+			continue;
+		}
+		g_debug ("cancelling running background transaction %s and instead running %s",
+			 running->tid, item->tid);
+		pk_transaction_cancel_bg (running->transaction);
 	}
-	return FALSE;
 }
 
+/**
+ * pk_scheduler_get_next_item:
+ *
+ * Return value: the waiting transaction to run next, taking the classes in
+ * order and the users of each class in turns
+ **/
 static PkSchedulerItem *
 pk_scheduler_get_next_item (PkScheduler *scheduler)
 {
-	PkSchedulerItem *item = NULL;
-	GPtrArray *array;
-	guint i;
-	PkTransactionState state;
 	gboolean exclusive_running;
 
-	array = scheduler->priv->array;
-
 	/* check for running exclusive transaction */
 	exclusive_running = pk_scheduler_get_exclusive_running (scheduler) > 0;
 
-	/* first try the waiting non-background transactions */
-	for (i = 0; i < array->len; i++) {
-		item = (PkSchedulerItem *) g_ptr_array_index (array, i);
-		state = pk_transaction_get_state (item->transaction);
+	for (guint i = 0; i < PK_SCHEDULER_CLASS_LAST; i++) {
+		PkSchedulerReadyQueue *ready = &scheduler->priv->ready[i];
+		for (GList *l = ready->uids.head; l != NULL; l = l->next) {
+			PkSchedulerUidQueue *uid_queue = l->data;
+			for (GList *j = uid_queue->items.head; j != NULL; j = j->next) {
+				PkSchedulerItem *item = j->data;
 
-		if ((state == PK_TRANSACTION_STATE_READY) && (!pk_transaction_get_background (item->transaction))) {
-			/* check if we can run the transaction now or if we need to wait for lock release */
-			if (pk_transaction_is_exclusive (item->transaction)) {
-				if (!exclusive_running)
-					goto out;
-			} else {
-				goto out;
+				/* check if we can run the transaction now or if we need to wait for lock release */
+				if (!exclusive_running || !pk_transaction_is_exclusive (item->transaction))
+					return item;
 			}
 		}
 	}
 
-	/* then try the other waiting transactions (background tasks) */
-	for (i = 0; i < array->len; i++) {
-		item = (PkSchedulerItem *) g_ptr_array_index (array, i);
-		state = pk_transaction_get_state (item->transaction);
+	/* nothing to run */
+	return NULL;
+}
+
+static void
+pk_scheduler_run_next_items (PkScheduler *scheduler)
+{
+	PkSchedulerItem *item;
+
+	while ((item = pk_scheduler_get_next_item (scheduler)) != NULL) {
+		g_debug ("running %s", item->tid);
+		pk_scheduler_run_item (scheduler, item);
+	}
+}
+
+static void
+pk_scheduler_cached_free (PkSchedulerCached *cached)
+{
+	g_object_unref (cached->results);
+	g_free (cached);
+}
+
+/* values below 4 get a bucket each, then every octave is split in four */
+static guint
+pk_scheduler_histogram_bucket (guint64 value)
+{
+	guint octave = 2;
+	guint idx;
+
+	if (value < 4)
+		return value;
+	while (value >> (octave + 1) != 0)
+		octave++;
+	idx = 4 * (octave - 1) + ((value >> (octave - 2)) & 3);
+	return MIN (idx, PK_SCHEDULER_HISTOGRAM_BUCKETS - 1);
+}
+
+/* the largest value that falls into the bucket */
+static guint64
+pk_scheduler_histogram_bucket_max (guint idx)
+{
+	if (idx < 4)
+		return idx;
+	return ((guint64) (5 + idx % 4) << (idx / 4 - 1)) - 1;
+}
+
+static guint64
+pk_scheduler_histogram_percentile (PkSchedulerHistogram *histogram,
+				   PkSchedulerMetric metric,
+				   guint percentile)
+{
+	guint64 rank;
+	guint64 seen = 0;
+
+	if (histogram->samples[metric] == 0)
+		return 0;
+	rank = ((guint64) histogram->samples[metric] * percentile + 99) / 100;
+	for (guint i = 0; i < PK_SCHEDULER_HISTOGRAM_BUCKETS; i++) {
+		seen += histogram->buckets[metric][i];
+		if (seen >= rank) {
+			return MIN (pk_scheduler_histogram_bucket_max (i),
+				    histogram->max[metric]);
+		}
+	}
+	return histogram->max[metric];
+}
+
+static void
+pk_scheduler_histogram_add (PkScheduler *scheduler, PkTransaction *transaction)
+{
+	PkSchedulerHistogram *histogram;
+	PkRoleEnum role = pk_transaction_get_role (transaction);
+	g_autoptr(GVariant) stats = NULL;
+
+	if (role <= PK_ROLE_ENUM_UNKNOWN || role >= PK_ROLE_ENUM_LAST)
+		return;
+	histogram = scheduler->priv->histograms[role];
+	if (histogram == NULL) {
+		histogram = g_new0 (PkSchedulerHistogram, 1);
+		scheduler->priv->histograms[role] = histogram;
+	}
+	histogram->count++;
+
+	stats = g_variant_ref_sink (pk_transaction_get_stats (transaction));
+	for (guint i = 0; i < PK_SCHEDULER_METRIC_LAST; i++) {
+		guint64 value = 0;
+
+		/* a phase that was never reached is not a sample */
+		if (!g_variant_lookup (stats, pk_scheduler_metric_names[i], "t", &value) ||
+		    value == 0)
+			continue;
+		histogram->samples[i]++;
+		histogram->buckets[i][pk_scheduler_histogram_bucket (value)]++;
+		histogram->max[i] = MAX (histogram->max[i], value);
+	}
+}
+
+/**
+ * pk_scheduler_get_stats:
+ *
+ * Gets the latency percentiles of all the transactions that finished since
+ * the daemon started, keyed by role. Each role has a "count" of transactions
+ * and for each phase of pk_transaction_get_stats() the p50, p90, p99 and max
+ * in µs, e.g. "run-time-p99".
+ *
+ * Return value: (transfer floating): a new #GVariant of type a{sa{st}}
+ **/
+GVariant *
+pk_scheduler_get_stats (PkScheduler *scheduler)
+{
+	GVariantBuilder builder;
+	const guint percentiles[] = { 50, 90, 99 };
 
-		if (state == PK_TRANSACTION_STATE_READY) {
-			/* check if we can run the transaction now or if we need to wait for lock release */
-			if (pk_transaction_is_exclusive (item->transaction)) {
-				if (!exclusive_running)
-					goto out;
-			} else {
-				goto out;
+	g_return_val_if_fail (PK_IS_SCHEDULER (scheduler), NULL);
+
+	g_variant_builder_init (&builder, G_VARIANT_TYPE ("a{sa{st}}"));
+	for (guint role = 0; role < PK_ROLE_ENUM_LAST; role++) {
+		PkSchedulerHistogram *histogram = scheduler->priv->histograms[role];
+		GVariantBuilder role_builder;
+
+		if (histogram == NULL)
+			continue;
+		g_variant_builder_init (&role_builder, G_VARIANT_TYPE ("a{st}"));
+		g_variant_builder_add (&role_builder, "{st}", "count",
+				       (guint64) histogram->count);
+		for (guint i = 0; i < PK_SCHEDULER_METRIC_LAST; i++) {
+			g_autofree gchar *key_max = NULL;
+
+			for (guint j = 0; j < G_N_ELEMENTS (percentiles); j++) {
+				g_autofree gchar *key = NULL;
+				key = g_strdup_printf ("%s-p%u",
+						       pk_scheduler_metric_names[i],
+						       percentiles[j]);
+				g_variant_builder_add (&role_builder, "{st}", key,
+						       pk_scheduler_histogram_percentile (histogram, i, percentiles[j]));
 			}
+			key_max = g_strdup_printf ("%s-max", pk_scheduler_metric_names[i]);
+			g_variant_builder_add (&role_builder, "{st}", key_max,
+					       histogram->max[i]);
 		}
+		g_variant_builder_add (&builder, "{sa{st}}",
+				       pk_role_enum_to_string (role),
+				       &role_builder);
 	}
+	return g_variant_builder_end (&builder);
+}
 
-	/* nothing to run */
-	item = NULL;
-out:
-	return item;
+/* only queries which are repeated a lot and expensive to answer */
+static gboolean
+pk_scheduler_role_is_cached (PkRoleEnum role)
+{
+	return role == PK_ROLE_ENUM_GET_UPDATES ||
+	       role == PK_ROLE_ENUM_GET_PACKAGES ||
+	       role == PK_ROLE_ENUM_GET_REPO_LIST;
+}
+
+typedef struct {
+	guint			 generation;
+	gint64			 now;
+} PkSchedulerCacheExpireHelper;
+
+static gboolean
+pk_scheduler_cached_is_outdated_cb (gpointer key, gpointer value, gpointer user_data)
+{
+	PkSchedulerCached *cached = (PkSchedulerCached *) value;
+	PkSchedulerCacheExpireHelper *helper = (PkSchedulerCacheExpireHelper *) user_data;
+	if (cached->generation != helper->generation)
+		return TRUE;
+	return helper->now - cached->time_added > PK_SCHEDULER_RESULTS_CACHE_TTL * G_USEC_PER_SEC;
+}
+
+/* drop everything from before the packages or repositories changed,
+ * and everything that is too old to trust */
+static void
+pk_scheduler_cache_expire (PkScheduler *scheduler)
+{
+	PkSchedulerCacheExpireHelper helper;
+
+	helper.generation = pk_backend_get_cache_generation (scheduler->priv->backend);
+	helper.now = g_get_monotonic_time ();
+	g_hash_table_foreach_remove (scheduler->priv->results_cache,
+				     pk_scheduler_cached_is_outdated_cb,
+				     &helper);
+}
+
+static PkResults *
+pk_scheduler_cache_lookup (PkScheduler *scheduler, PkSchedulerItem *item)
+{
+	PkSchedulerCached *cached;
+
+	if (item->coalesce_key == NULL ||
+	    !pk_scheduler_role_is_cached (pk_transaction_get_role (item->transaction)))
+		return NULL;
+	pk_scheduler_cache_expire (scheduler);
+	cached = g_hash_table_lookup (scheduler->priv->results_cache, item->coalesce_key);
+	if (cached == NULL)
+		return NULL;
+	return cached->results;
+}
+
+static void
+pk_scheduler_cache_add (PkScheduler *scheduler, PkSchedulerItem *item)
+{
+	PkResults *results;
+	PkSchedulerCached *cached;
+
+	if (item->coalesce_key == NULL || item->replay != NULL ||
+	    !pk_scheduler_role_is_cached (pk_transaction_get_role (item->transaction)))
+		return;
+	if (item->cache_generation != pk_backend_get_cache_generation (scheduler->priv->backend))
+		return;
+	results = pk_transaction_get_results (item->transaction);
+	if (results == NULL ||
+	    pk_results_get_exit_code (results) != PK_EXIT_ENUM_SUCCESS)
+		return;
+
+	pk_scheduler_cache_expire (scheduler);
+	cached = g_new0 (PkSchedulerCached, 1);
+	cached->generation = item->cache_generation;
+	cached->time_added = g_get_monotonic_time ();
+	cached->results = g_object_ref (results);
+	g_hash_table_replace (scheduler->priv->results_cache,
+			      g_strdup (item->coalesce_key), cached);
+}
+
+/**
+ * pk_scheduler_find_leader:
+ *
+ * Return value: a queued or running transaction doing the very same
+ * query as @item, so @item can wait for its results
+ **/
+static PkSchedulerItem *
+pk_scheduler_find_leader (PkScheduler *scheduler, PkSchedulerItem *item)
+{
+	GPtrArray *array = scheduler->priv->array;
+
+	if (item->coalesce_key == NULL)
+		return NULL;
+
+	for (guint i = 0; i < array->len; i++) {
+		PkSchedulerItem *leader = g_ptr_array_index (array, i);
+		PkTransactionState state;
+
+		if (leader == item || leader->leader != NULL || leader->replay != NULL)
+			continue;
+		if (g_strcmp0 (leader->coalesce_key, item->coalesce_key) != 0)
+			continue;
+		state = pk_transaction_get_state (leader->transaction);
+		if (state != PK_TRANSACTION_STATE_READY &&
+		    state != PK_TRANSACTION_STATE_RUNNING)
+			continue;
+
+		/* a background leader may be cancelled for a foreground one */
+		if (pk_transaction_get_background (leader->transaction) &&
+		    !pk_transaction_get_background (item->transaction))
+			continue;
+		return leader;
+	}
+	return NULL;
 }
 
 static void
 pk_scheduler_commit (PkScheduler *scheduler, const gchar *tid)
 {
+	PkResults *cached;
+	PkSchedulerItem *leader;
 	PkSchedulerItem *item;
 
 	g_return_if_fail (PK_IS_SCHEDULER (scheduler));
@@ -471,19 +934,45 @@ pk_scheduler_commit (PkScheduler *scheduler, const gchar *tid)
 	/* we will changed what is running */
 	g_signal_emit (scheduler, signals [PK_SCHEDULER_CHANGED], 0);
 
-	/* is one of the current running transactions background, and this new
-	 * transaction foreground? */
-	if (!pk_transaction_get_background (item->transaction) &&
-	    pk_scheduler_get_background_running (scheduler)) {
-		g_debug ("cancelling running background transactions and instead running %s",
-			item->tid);
-		pk_scheduler_cancel_background (scheduler);
+	/* this decides what is run first */
+	pk_scheduler_ready_remove (scheduler, item, FALSE);
+	item->priority_class = pk_scheduler_get_class (item->transaction);
+	item->uid = pk_transaction_get_uid (item->transaction);
+
+	/* answer from memory if nothing changed since the last time */
+	g_free (item->coalesce_key);
+	item->coalesce_key = pk_transaction_get_coalesce_key (item->transaction);
+	cached = pk_scheduler_cache_lookup (scheduler, item);
+	if (cached != NULL) {
+		g_debug ("%s is answered from the cache", item->tid);
+		item->replay = g_object_ref (cached);
+		pk_scheduler_run_item (scheduler, item);
+		return;
+	}
+
+	/* wait for an identical query instead of running the backend again */
+	if (item->subscribers->len == 0)
+		leader = pk_scheduler_find_leader (scheduler, item);
+	else
+		leader = NULL;
+	if (leader != NULL) {
+		g_debug ("%s will get the results of %s", item->tid, leader->tid);
+		item->leader = leader;
+		g_ptr_array_add (leader->subscribers, item);
+		return;
 	}
 
+	/* is one of the current running transactions background, and this new
+	 * transaction interactive? */
+	if (item->priority_class < PK_SCHEDULER_CLASS_BACKGROUND)
+		pk_scheduler_preempt (scheduler, item);
+
 	/* do the transaction now, if possible */
 	if (pk_transaction_is_exclusive (item->transaction) == FALSE ||
 	    pk_scheduler_get_exclusive_running (scheduler) == 0)
 		pk_scheduler_run_item (scheduler, item);
+	else
+		pk_scheduler_ready_push (scheduler, item);
 }
 
 static void
@@ -511,6 +1000,41 @@ pk_scheduler_transaction_state_changed_cb (PkTransaction *transaction,
 	}
 }
 
+/**
+ * pk_scheduler_replay_subscribers:
+ *
+ * Gives the results of a finished transaction to the identical ones that
+ * were waiting for it. If it failed they are run on their own instead.
+ **/
+static void
+pk_scheduler_replay_subscribers (PkScheduler *scheduler, PkSchedulerItem *item)
+{
+	PkResults *results;
+	g_autoptr(GPtrArray) subscribers = NULL;
+
+	if (item->subscribers->len == 0) {
+		pk_scheduler_item_detach (item);
+		return;
+	}
+
+	/* detaching clears the array */
+	subscribers = g_ptr_array_copy (item->subscribers, NULL, NULL);
+	pk_scheduler_item_detach (item);
+
+	results = pk_transaction_get_results (item->transaction);
+	if (results == NULL ||
+	    pk_results_get_exit_code (results) != PK_EXIT_ENUM_SUCCESS) {
+		g_debug ("%s did not succeed, not sharing its results", item->tid);
+		return;
+	}
+	for (guint i = 0; i < subscribers->len; i++) {
+		PkSchedulerItem *subscriber = g_ptr_array_index (subscribers, i);
+		g_debug ("giving the results of %s to %s", item->tid, subscriber->tid);
+		subscriber->replay = g_object_ref (results);
+		pk_scheduler_run_item (scheduler, subscriber);
+	}
+}
+
 static void
 pk_scheduler_transaction_finished_cb (PkTransaction *transaction,
 				      PkScheduler *scheduler)
@@ -535,8 +1059,6 @@ pk_scheduler_transaction_finished_cb (PkTransaction *transaction,
 	}
 
 	if (pk_transaction_is_finished_with_lock_required (item->transaction)) {
-		pk_transaction_reset_after_lock_error (item->transaction);
-
 		/* increase the number of tries */
 		item->tries++;
 
@@ -554,6 +1076,10 @@ pk_scheduler_transaction_finished_cb (PkTransaction *transaction,
 			pk_backend_job_finished (job);
 			return;
 		}
+
+		/* the reset does not go through commit, so wait again here */
+		pk_transaction_reset_after_lock_error (item->transaction);
+		pk_scheduler_ready_push (scheduler, item);
 	} else {
 		/* we've been 'used' */
 		if (item->commit_id != 0) {
@@ -561,6 +1087,13 @@ pk_scheduler_transaction_finished_cb (PkTransaction *transaction,
 			item->commit_id = 0;
 		}
 		pk_transaction_set_state (item->transaction, PK_TRANSACTION_STATE_FINISHED);
+		pk_scheduler_ready_remove (scheduler, item, FALSE);
+		pk_scheduler_histogram_add (scheduler, item->transaction);
+
+		/* hand the results to everyone asking the same, or let a
+		 * subscriber that was cancelled while waiting go */
+		pk_scheduler_replay_subscribers (scheduler, item);
+		pk_scheduler_cache_add (scheduler, item);
 
 		/* give the client a few seconds to still query the runner */
 		item->remove_id = g_timeout_add_seconds (PK_TRANSACTION_KEEP_FINISHED_TIMOUT,
@@ -569,12 +1102,8 @@ pk_scheduler_transaction_finished_cb (PkTransaction *transaction,
 		g_source_set_name_by_id (item->remove_id, "[PkScheduler] remove");
 	}
 
-	/* try to run the next transaction, if possible */
-	item = pk_scheduler_get_next_item (scheduler);
-	if (item != NULL) {
-		g_debug ("running %s as previous one finished", item->tid);
-		pk_scheduler_run_item (scheduler, item);
-	}
+	/* try to run the next transactions, if possible */
+	pk_scheduler_run_next_items (scheduler);
 
 	/* we have changed what is running */
 	g_signal_emit (scheduler, signals [PK_SCHEDULER_CHANGED], 0);
@@ -592,22 +1121,32 @@ pk_scheduler_no_commit_cb (gpointer user_data)
 	return FALSE;
 }
 
+/**
+ * pk_scheduler_get_share_for_uid:
+ *
+ * Return value: the number of transactions @uid may have in progress, an
+ * equal share between all users having transactions
+ **/
 static guint
-pk_scheduler_get_number_transactions_for_uid (PkScheduler *scheduler, guint uid)
+pk_scheduler_get_share_for_uid (PkScheduler *scheduler, guint uid, guint *count)
 {
 	guint i;
 	GPtrArray *array;
 	PkSchedulerItem *item;
-	guint count = 0;
+	g_autoptr(GHashTable) uids = g_hash_table_new (g_direct_hash, g_direct_equal);
 
 	/* find all the transactions in progress */
+	*count = 0;
+	g_hash_table_add (uids, GUINT_TO_POINTER (uid));
 	array = scheduler->priv->array;
 	for (i = 0; i < array->len; i++) {
 		item = (PkSchedulerItem *) g_ptr_array_index (array, i);
 		if (item->uid == uid)
-			count++;
+			(*count)++;
+		g_hash_table_add (uids, GUINT_TO_POINTER (item->uid));
 	}
-	return count;
+	return MAX (PK_SCHEDULER_SIMULTANEOUS_TRANSACTIONS / g_hash_table_size (uids),
+		    PK_SCHEDULER_SIMULTANEOUS_TRANSACTIONS_FOR_UID);
 }
 
 gboolean
@@ -617,6 +1156,7 @@ pk_scheduler_create (PkScheduler *scheduler,
 			    GError **error)
 {
 	guint count;
+	guint share;
 	gboolean ret = FALSE;
 	PkSchedulerItem *item;
 
@@ -635,6 +1175,7 @@ pk_scheduler_create (PkScheduler *scheduler,
 	item = g_new0 (PkSchedulerItem, 1);
 	item->scheduler = g_object_ref (scheduler);
 	item->tid = g_strdup (tid);
+	item->subscribers = g_ptr_array_new ();
 	item->transaction = pk_transaction_new (scheduler->priv->conf,
 						scheduler->priv->introspection);
 	item->finished_id =
@@ -675,14 +1216,24 @@ pk_scheduler_create (PkScheduler *scheduler,
 					    scheduler->priv->backend);
 	}
 
+	/* share the engine database rather than loading one per transaction */
+	if (scheduler->priv->transaction_db != NULL) {
+		pk_transaction_set_transaction_db (item->transaction,
+						   scheduler->priv->transaction_db);
+	}
+	if (scheduler->priv->auth_cache != NULL) {
+		pk_transaction_set_auth_cache (item->transaction,
+					       scheduler->priv->auth_cache);
+	}
+
 	/* get the uid for the transaction */
 	item->uid = pk_transaction_get_uid (item->transaction);
 
 	/* find out the number of transactions this uid already has in progress */
-	count = pk_scheduler_get_number_transactions_for_uid (scheduler, item->uid);
+	share = pk_scheduler_get_share_for_uid (scheduler, item->uid, &count);
 
 	/* would this take us over the maximum number of requests allowed */
-	if (count > PK_SCHEDULER_SIMULTANEOUS_TRANSACTIONS_FOR_UID) {
+	if (count >= share) {
 		g_set_error (error, 1, 0,
 			     "failed to allocate %s as uid %i already has "
 			     "%i transactions in progress",
@@ -881,11 +1432,13 @@ pk_scheduler_get_state (PkScheduler *scheduler)
 
 		role = pk_transaction_get_role (item->transaction);
 		g_string_append_printf (string, "%0i\t%s\t%s\tstate[%s] "
-					"exclusive[%i] background[%i]\n", i,
+					"exclusive[%i] background[%i] class[%s] uid[%u]\n", i,
 					pk_role_enum_to_string (role), item->tid,
 					pk_transaction_state_to_string (state),
 					pk_transaction_is_exclusive (item->transaction),
-					pk_transaction_get_background (item->transaction));
+					pk_transaction_get_background (item->transaction),
+					pk_scheduler_class_to_string (item->priority_class),
+					item->uid);
 	}
 
 	/* nothing running */
@@ -1007,6 +1560,38 @@ pk_scheduler_set_backend (PkScheduler *scheduler,
 	scheduler->priv->backend = g_object_ref (backend);
 }
 
+/**
+ * pk_scheduler_set_transaction_db:
+ *
+ * Note: this is the database the engine has loaded, and it is handed to
+ * every transaction the scheduler creates.
+ */
+void
+pk_scheduler_set_transaction_db (PkScheduler *scheduler,
+				 PkTransactionDb *transaction_db)
+{
+	g_return_if_fail (PK_IS_SCHEDULER (scheduler));
+	g_return_if_fail (PK_IS_TRANSACTION_DB (transaction_db));
+	g_return_if_fail (scheduler->priv->transaction_db == NULL);
+	scheduler->priv->transaction_db = g_object_ref (transaction_db);
+}
+
+/**
+ * pk_scheduler_set_auth_cache:
+ *
+ * Note: the cache of recent polkit answers, handed to every transaction
+ * the scheduler creates.
+ */
+void
+pk_scheduler_set_auth_cache (PkScheduler *scheduler,
+			     PkAuthCache *auth_cache)
+{
+	g_return_if_fail (PK_IS_SCHEDULER (scheduler));
+	g_return_if_fail (PK_IS_AUTH_CACHE (auth_cache));
+	g_return_if_fail (scheduler->priv->auth_cache == NULL);
+	scheduler->priv->auth_cache = g_object_ref (auth_cache);
+}
+
 static void
 pk_scheduler_class_init (PkSchedulerClass *klass)
 {
@@ -1028,6 +1613,14 @@ pk_scheduler_init (PkScheduler *scheduler)
 {
 	scheduler->priv = PK_SCHEDULER_GET_PRIVATE (scheduler);
 	scheduler->priv->array = g_ptr_array_new ();
+	scheduler->priv->results_cache = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+								(GDestroyNotify) pk_scheduler_cached_free);
+	for (guint i = 0; i < PK_SCHEDULER_CLASS_LAST; i++) {
+		g_queue_init (&scheduler->priv->ready[i].uids);
+		scheduler->priv->ready[i].uid_queues =
+			g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL,
+					       (GDestroyNotify) pk_scheduler_uid_queue_free);
+	}
 	scheduler->priv->introspection = pk_load_introspection (PK_DBUS_INTERFACE_TRANSACTION ".xml",
 							    NULL);
 	scheduler->priv->unwedge_id = g_timeout_add_seconds (PK_TRANSACTION_WEDGE_CHECK,
@@ -1052,11 +1645,20 @@ pk_scheduler_finalize (GObject *object)
 	g_ptr_array_foreach (scheduler->priv->array,
 			     (GFunc) pk_scheduler_item_free_cb, NULL);
 	g_ptr_array_free (scheduler->priv->array, TRUE);
+	g_hash_table_unref (scheduler->priv->results_cache);
+	for (guint i = 0; i < PK_SCHEDULER_CLASS_LAST; i++)
+		g_hash_table_unref (scheduler->priv->ready[i].uid_queues);
+	for (guint i = 0; i < PK_ROLE_ENUM_LAST; i++)
+		g_free (scheduler->priv->histograms[i]);
 
 	g_dbus_node_info_unref (scheduler->priv->introspection);
 	g_key_file_unref (scheduler->priv->conf);
 	if (scheduler->priv->backend != NULL)
 		g_object_unref (scheduler->priv->backend);
+	if (scheduler->priv->transaction_db != NULL)
+		g_object_unref (scheduler->priv->transaction_db);
+	if (scheduler->priv->auth_cache != NULL)
+		g_object_unref (scheduler->priv->auth_cache);
 
 	G_OBJECT_CLASS (pk_scheduler_parent_class)->finalize (object);
 }
@@ -70,6 +70,7 @@ gchar		**pk_scheduler_get_array	(PkScheduler	*scheduler)
 						 G_GNUC_WARN_UNUSED_RESULT;
 gchar		*pk_scheduler_get_state		(PkScheduler	*scheduler)
 						 G_GNUC_WARN_UNUSED_RESULT;
+GVariant	*pk_scheduler_get_stats		(PkScheduler	*scheduler);
 guint		 pk_scheduler_get_size		(PkScheduler	*scheduler);
 gboolean	 pk_scheduler_get_locked	(PkScheduler	*scheduler);
 gboolean	 pk_scheduler_get_inhibited	(PkScheduler	*scheduler);
@@ -79,6 +80,10 @@ void		 pk_scheduler_cancel_background	(PkScheduler	*scheduler);
 void		 pk_scheduler_cancel_queued	(PkScheduler	*scheduler);
 void		 pk_scheduler_set_backend	(PkScheduler	*scheduler,
 						 PkBackend	*backend);
+void		 pk_scheduler_set_transaction_db (PkScheduler	*scheduler,
+						 PkTransactionDb *transaction_db);
+void		 pk_scheduler_set_auth_cache	(PkScheduler	*scheduler,
+						 PkAuthCache	*auth_cache);
 
 G_END_DECLS
 
@@ -26,6 +26,7 @@
 #include <glib-object.h>
 #include <glib/gstdio.h>
 
+#include "pk-auth-cache.h"
 #include "pk-backend.h"
 #include "pk-backend-spawn.h"
 #include "pk-dbus.h"
@@ -126,6 +127,22 @@ pk_test_backend_func_true (PkBackendJob *job,
 				"The vips documentation package.");
 }
 
+static void
+pk_test_backend_func_details (PkBackendJob *job,
+			      GVariant *params,
+			      gpointer user_data)
+{
+	gchar *files[] = { (gchar *) "/usr/share/doc/vips-doc", NULL };
+
+	pk_backend_job_details (job, "vips-doc;7.12.4-2.fc8;noarch;linva",
+				"The vips documentation package.", "LGPL",
+				PK_GROUP_ENUM_DOCUMENTATION, NULL, NULL, 1024);
+	pk_backend_job_details (job, "vips;7.12.4-2.fc8;x86_64;linva",
+				"The vips library.", "LGPL",
+				PK_GROUP_ENUM_PROGRAMMING, NULL, NULL, 2048);
+	pk_backend_job_files (job, "vips-doc;7.12.4-2.fc8;noarch;linva", files);
+}
+
 static void
 pk_test_backend_func_immediate_false (PkBackendJob *job,
 				      GVariant *params,
@@ -140,6 +157,30 @@ pk_test_backend_package_cb (PkBackend *backend, PkPackage *package, gpointer use
 	number_packages++;
 }
 
+static guint number_details = 0;
+static guint number_files = 0;
+
+static void
+pk_test_backend_details_list_cb (PkBackend *backend, GPtrArray *details_array, gpointer user_data)
+{
+	for (guint i = 0; i < details_array->len; i++) {
+		g_autoptr(GVariant) value = NULL;
+		const gchar *package_id = NULL;
+
+		/* serialized in the backend thread already */
+		value = pk_backend_job_get_details_variant (g_ptr_array_index (details_array, i));
+		g_assert_true (g_variant_lookup (value, "package-id", "&s", &package_id));
+		g_assert_true (pk_package_id_check (package_id));
+		number_details++;
+	}
+}
+
+static void
+pk_test_backend_files_list_cb (PkBackend *backend, GPtrArray *files_array, gpointer user_data)
+{
+	number_files += files_array->len;
+}
+
 static void
 pk_test_backend_packages_cb (PkBackend *backend, GPtrArray *package_array, gpointer user_data)
 {
@@ -290,6 +331,27 @@ pk_test_backend_func (void)
 	/* wait for Finished */
 	_g_test_loop_wait (10);
 
+	/* details and files are merged into the batch vfuncs */
+	g_object_unref (job);
+	job = pk_backend_job_new (conf);
+	pk_backend_job_set_backend (job, backend);
+	pk_backend_job_set_vfunc (job,
+				  PK_BACKEND_SIGNAL_DETAILS_LIST,
+				  PK_BACKEND_JOB_VFUNC (pk_test_backend_details_list_cb),
+				  NULL);
+	pk_backend_job_set_vfunc (job,
+				  PK_BACKEND_SIGNAL_FILES_LIST,
+				  PK_BACKEND_JOB_VFUNC (pk_test_backend_files_list_cb),
+				  NULL);
+	ret = pk_backend_job_thread_create (job,
+					    pk_test_backend_func_details,
+					    NULL,
+					    NULL);
+	g_assert_true (ret);
+	_g_test_loop_wait (500);
+	g_assert_cmpint (number_details, ==, 2);
+	g_assert_cmpint (number_files, ==, 1);
+
 	/* reset */
 	g_object_unref (job);
 	job = pk_backend_job_new (conf);
@@ -333,6 +395,7 @@ pk_test_backend_spawn_func (void)
 	const gchar *text;
 	gboolean ret;
 	gchar *uri;
+	GBytes *frame;
 	g_autoptr(GKeyFile) conf = NULL;
 	g_autoptr(PkBackend) backend = NULL;
 	g_autoptr(PkBackendJob) job = NULL;
@@ -434,6 +497,26 @@ pk_test_backend_spawn_func (void)
 		"package\tinstalled\tgnome-power-manager;0.0.1;i386;data\tMore useless software", NULL);
 	g_assert_true (ret);
 
+	/* test pk_backend_spawn_inject_frame Packages */
+	frame = g_bytes_new_static ("\x03installed\0gnome-power-manager;0.0.1;i386;data\0More useless software\0"
+				    "available\0gnome-power-manager;0.0.2;i386;data\0More useless software\0", 137);
+	ret = pk_backend_spawn_inject_frame (backend_spawn, job, frame, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	g_bytes_unref (frame);
+
+	/* test pk_backend_spawn_inject_frame Packages with a missing summary */
+	frame = g_bytes_new_static ("\x03installed\0gnome-power-manager;0.0.1;i386;data\0", 47);
+	ret = pk_backend_spawn_inject_frame (backend_spawn, job, frame, NULL);
+	g_assert_true (!ret);
+	g_bytes_unref (frame);
+
+	/* test pk_backend_spawn_inject_frame invalid opcode */
+	frame = g_bytes_new_static ("\xff", 1);
+	ret = pk_backend_spawn_inject_frame (backend_spawn, job, frame, NULL);
+	g_assert_true (!ret);
+	g_bytes_unref (frame);
+
 	/* manually unlock as we have no engine */
 	ret = pk_backend_unload (backend);
 	g_assert_true (ret);
@@ -482,13 +565,150 @@ pk_test_backend_spawn_func (void)
 	g_object_unref (backend_spawn);
 }
 
+static void
+pk_test_backend_spawn_throughput_run (PkBackendSpawn *backend_spawn,
+				      PkBackend *backend,
+				      GKeyFile *conf,
+				      const gchar *mode,
+				      guint count)
+{
+	gboolean ret;
+	gdouble elapsed;
+	g_autofree gchar *count_str = g_strdup_printf ("%u", count);
+	g_autoptr(PkBackendJob) job = NULL;
+
+	/* a new job, as packages are only emitted once per job */
+	job = pk_backend_job_new (conf);
+	pk_backend_job_set_backend (job, backend);
+	pk_backend_job_set_vfunc (job,
+				  PK_BACKEND_SIGNAL_FINISHED,
+				  PK_BACKEND_JOB_VFUNC (pk_test_backend_spawn_finished_cb),
+				  backend_spawn);
+	pk_backend_job_set_vfunc (job,
+				  PK_BACKEND_SIGNAL_PACKAGE,
+				  PK_BACKEND_JOB_VFUNC (pk_test_backend_spawn_package_cb),
+				  backend_spawn);
+	pk_backend_job_set_vfunc (job,
+				  PK_BACKEND_SIGNAL_PACKAGES,
+				  PK_BACKEND_JOB_VFUNC (pk_test_backend_spawn_packages_cb),
+				  backend_spawn);
+
+	_backend_spawn_number_packages = 0;
+	g_test_timer_start ();
+	ret = pk_backend_spawn_helper (backend_spawn, job, "packages-throughput.py",
+				       mode, count_str, "get-packages", "none", NULL);
+	g_assert_true (ret);
+	_g_test_loop_run_with_timeout (60000);
+	elapsed = g_test_timer_elapsed ();
+
+	g_assert_cmpint (_backend_spawn_number_packages, ==, count);
+	g_test_message ("%s protocol: %u packages in %.3fs (%.0f packages/s)",
+			mode, count, elapsed, count / elapsed);
+}
+
+static void
+pk_test_backend_spawn_throughput_func (void)
+{
+	gboolean ret;
+	guint count = g_test_perf () ? 200000 : 2000;
+	g_autofree gchar *enums = NULL;
+	g_autoptr(GKeyFile) conf = NULL;
+	g_autoptr(PkBackend) backend = NULL;
+	PkBackendSpawn *backend_spawn;
+
+	/* the python module is only generated with the python backend */
+	enums = g_build_filename (g_getenv ("PYTHONPATH") != NULL ? g_getenv ("PYTHONPATH") : ".",
+				  "packagekit", "enums.py", NULL);
+	if (!g_file_test (enums, G_FILE_TEST_EXISTS)) {
+		g_test_skip ("python backend module not built");
+		return;
+	}
+
+	/* keep PYTHONPATH for the helper */
+	conf = g_key_file_new ();
+	g_key_file_set_string (conf, "Daemon", "DefaultBackend", "test_spawn");
+	g_key_file_set_boolean (conf, "Daemon", "KeepEnvironment", TRUE);
+	backend = pk_backend_new (conf);
+	backend_spawn = pk_backend_spawn_new (conf);
+	ret = pk_backend_spawn_set_name (backend_spawn, "test_spawn");
+	g_assert_true (ret);
+
+	/* one line per package */
+	pk_test_backend_spawn_throughput_run (backend_spawn, backend, conf, "text", count);
+	ret = pk_backend_spawn_exit (backend_spawn);
+	g_assert_true (ret);
+
+	/* batched frames, then again reusing the same helper */
+	pk_test_backend_spawn_throughput_run (backend_spawn, backend, conf, "binary", count);
+	pk_test_backend_spawn_throughput_run (backend_spawn, backend, conf, "binary", count);
+	ret = pk_backend_spawn_exit (backend_spawn);
+	g_assert_true (ret);
+
+	/* manually unlock as we have no engine */
+	ret = pk_backend_unload (backend);
+	g_assert_true (ret);
+
+	g_object_unref (backend_spawn);
+}
+
+static void
+pk_test_dbus_credentials_cb (GObject *source, GAsyncResult *res, gpointer user_data)
+{
+	g_autoptr(GError) error = NULL;
+	gboolean *ret = (gboolean *) user_data;
+
+	*ret = pk_dbus_get_credentials_finish (PK_DBUS (source), res, &error);
+	g_assert_no_error (error);
+	_g_test_loop_quit ();
+}
+
+static void
+pk_test_dbus_vanished_cb (PkDbus *dbus, const gchar *sender, gpointer user_data)
+{
+	guint *vanished = (guint *) user_data;
+	(*vanished)++;
+	_g_test_loop_quit ();
+}
+
 static void
 pk_test_dbus_func (void)
 {
+	gboolean ret = FALSE;
+	guint32 uid = 0;
+	guint32 pid = 0;
+	guint vanished = 0;
+	guint watch_id;
 	g_autoptr(PkDbus) dbus = NULL;
+	g_autoptr(GError) error = NULL;
 
 	dbus = pk_dbus_new ();
 	g_assert_true (dbus != NULL);
+	if (!pk_dbus_connect (dbus, &error)) {
+		g_test_skip (error->message);
+		return;
+	}
+
+	/* resolve the self-check sender without blocking */
+	pk_dbus_get_credentials_async (dbus, ":org.freedesktop.PackageKit", NULL,
+				       pk_test_dbus_credentials_cb, &ret);
+	_g_test_loop_run_with_timeout (5000);
+	g_assert_true (ret);
+	g_assert_true (pk_dbus_get_uid_pid (dbus, ":org.freedesktop.PackageKit", &uid, &pid));
+	g_assert_cmpint (uid, ==, 500);
+
+	/* a name that is not on the bus vanishes straight away, and only
+	 * the watchers still registered are told */
+	watch_id = pk_dbus_watch_sender (dbus, ":1.999999",
+					 pk_test_dbus_vanished_cb, &vanished);
+	g_assert_cmpint (watch_id, >, 0);
+	pk_dbus_unwatch_sender (dbus, pk_dbus_watch_sender (dbus, ":1.999999",
+							    pk_test_dbus_vanished_cb,
+							    &vanished));
+	_g_test_loop_run_with_timeout (5000);
+	g_assert_cmpint (vanished, ==, 1);
+
+	/* unwatching after it vanished is fine */
+	pk_dbus_unwatch_sender (dbus, watch_id);
 }
 
 PkSpawnExitType mexit = PK_SPAWN_EXIT_TYPE_UNKNOWN;
@@ -659,6 +879,26 @@ pk_test_spawn_func (void)
 	/* make sure finished in SIGQUIT */
 	g_assert_cmpint (mexit, ==, PK_SPAWN_EXIT_TYPE_SIGQUIT);
 
+	/* get new object */
+	new_spawn_object (&spawn);
+
+	/* make sure a helper sending an oversized frame is killed */
+	mexit = PK_SPAWN_EXIT_TYPE_UNKNOWN;
+	argv = g_strsplit (TESTDATADIR "/pk-spawn-test-bad-frame.sh", " ", 0);
+	ret = pk_spawn_argv (spawn, argv, NULL, PK_SPAWN_ARGV_FLAGS_NONE, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	g_strfreev (argv);
+
+	/* wait for finished, well before the helper would exit itself */
+	g_test_expect_message (G_LOG_DOMAIN, G_LOG_LEVEL_WARNING, "invalid frame*");
+	_g_test_loop_run_with_timeout (5000);
+	g_test_assert_expected_messages ();
+
+	/* make sure it failed */
+	g_assert_cmpint (mexit, ==, PK_SPAWN_EXIT_TYPE_FAILED);
+	g_assert_cmpint (stdout_count, ==, 0);
+
 	/* run lots of data for profiling */
 	argv = g_strsplit (TESTDATADIR "/pk-spawn-test-profiling.sh", " ", 0);
 	ret = pk_spawn_argv (spawn, argv, NULL, PK_SPAWN_ARGV_FLAGS_NONE, &error);
@@ -722,6 +962,135 @@ pk_test_spawn_func (void)
 	g_assert_true (!ret);
 }
 
+static void
+pk_test_spawn_latency_stdout_cb (PkSpawn *spawn, const gchar *line, GTimer *timer)
+{
+	g_timer_stop (timer);
+	_g_test_loop_quit ();
+}
+
+static void
+pk_test_spawn_latency_func (void)
+{
+	GError *error = NULL;
+	gboolean ret;
+	gdouble elapsed;
+	g_autoptr(PkSpawn) spawn = NULL;
+	g_autoptr(GTimer) timer = g_timer_new ();
+	g_auto(GStrv) argv = NULL;
+
+	new_spawn_object (&spawn);
+	g_signal_connect (spawn, "stdout",
+			  G_CALLBACK (pk_test_spawn_latency_stdout_cb), timer);
+
+	/* print a line, then stay alive so only the output can wake us */
+	mexit = PK_SPAWN_EXIT_TYPE_UNKNOWN;
+	argv = g_strsplit ("/bin/sh\t-c\techo ready; exec sleep 10", "\t", 0);
+	g_timer_start (timer);
+	ret = pk_spawn_argv (spawn, argv, NULL, PK_SPAWN_ARGV_FLAGS_NONE, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	_g_test_loop_run_with_timeout (5000);
+
+	/* the line arrived while the helper was still running */
+	elapsed = g_timer_elapsed (timer, NULL) * 1000;
+	g_debug ("got first line after %.1f ms", elapsed);
+	g_assert_cmpint (stdout_count, ==, 1);
+	g_assert_cmpint (mexit, ==, PK_SPAWN_EXIT_TYPE_UNKNOWN);
+
+	/* the old 50 ms poll could never deliver it sooner, but wall-clock
+	 * timings are only reliable enough to check on a quiet machine */
+	if (g_test_perf ())
+		g_assert_cmpfloat (elapsed, <, 50);
+
+	/* the exit is noticed without polling as well */
+	g_timer_start (timer);
+	ret = pk_spawn_kill (spawn);
+	g_assert_true (ret);
+	_g_test_loop_run_with_timeout (5000);
+	elapsed = g_timer_elapsed (timer, NULL) * 1000;
+	g_debug ("got exit after %.1f ms", elapsed);
+	g_assert_cmpint (mexit, ==, PK_SPAWN_EXIT_TYPE_SIGQUIT);
+	g_assert_cmpint (stdout_count, ==, 1);
+	if (g_test_perf ())
+		g_assert_cmpfloat (elapsed, <, 50);
+}
+
+static void
+pk_test_auth_cache_func (void)
+{
+	g_autoptr(GKeyFile) conf = g_key_file_new ();
+	g_autoptr(PkAuthCache) cache = NULL;
+
+	g_key_file_set_integer (conf, "Daemon", "AuthorizationCacheTimeout", 1);
+	cache = pk_auth_cache_new (conf);
+
+	/* nothing is known yet */
+	g_assert_false (pk_auth_cache_lookup (cache, ":1.42", "org.freedesktop.packagekit.package-install"));
+
+	/* a hit for the same caller and action, whatever the packages */
+	pk_auth_cache_add (cache, ":1.42", "org.freedesktop.packagekit.package-install");
+	g_assert_true (pk_auth_cache_lookup (cache, ":1.42", "org.freedesktop.packagekit.package-install"));
+	g_assert_false (pk_auth_cache_lookup (cache, ":1.43", "org.freedesktop.packagekit.package-install"));
+	g_assert_false (pk_auth_cache_lookup (cache, ":1.42", "org.freedesktop.packagekit.package-remove"));
+	g_assert_false (pk_auth_cache_lookup (cache, NULL, "org.freedesktop.packagekit.package-install"));
+
+	/* forgotten when polkit changes */
+	pk_auth_cache_add (cache, ":1.43", "org.freedesktop.packagekit.package-install");
+	g_assert_cmpint (pk_auth_cache_get_size (cache), ==, 2);
+	pk_auth_cache_invalidate (cache);
+	g_assert_cmpint (pk_auth_cache_get_size (cache), ==, 0);
+	g_assert_false (pk_auth_cache_lookup (cache, ":1.42", "org.freedesktop.packagekit.package-install"));
+
+	/* and once the timeout has passed */
+	pk_auth_cache_add (cache, ":1.42", "org.freedesktop.packagekit.package-install");
+	g_usleep (1100 * 1000);
+	g_assert_false (pk_auth_cache_lookup (cache, ":1.42", "org.freedesktop.packagekit.package-install"));
+	g_assert_cmpint (pk_auth_cache_get_size (cache), ==, 0);
+}
+
+static void
+pk_test_auth_cache_disabled_func (void)
+{
+	g_autoptr(GKeyFile) conf = g_key_file_new ();
+	g_autoptr(PkAuthCache) cache = NULL;
+
+	/* a timeout of 0 always asks polkit */
+	g_key_file_set_integer (conf, "Daemon", "AuthorizationCacheTimeout", 0);
+	cache = pk_auth_cache_new (conf);
+	pk_auth_cache_add (cache, ":1.42", "org.freedesktop.packagekit.package-install");
+	g_assert_cmpint (pk_auth_cache_get_size (cache), ==, 0);
+	g_assert_false (pk_auth_cache_lookup (cache, ":1.42", "org.freedesktop.packagekit.package-install"));
+}
+
+static void
+pk_test_auth_cache_changed_func (void)
+{
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GKeyFile) conf = g_key_file_new ();
+	g_autoptr(PkAuthCache) cache = NULL;
+	g_autoptr(PolkitAuthority) authority = NULL;
+
+	authority = polkit_authority_get_sync (NULL, &error);
+	if (authority == NULL) {
+		g_test_skip (error->message);
+		return;
+	}
+	cache = pk_auth_cache_new (conf);
+	pk_auth_cache_set_authority (cache, authority);
+	pk_auth_cache_add (cache, ":1.42", "org.freedesktop.packagekit.package-install");
+	g_assert_true (pk_auth_cache_lookup (cache, ":1.42", "org.freedesktop.packagekit.package-install"));
+
+	/* the polkit Changed signal drops everything */
+	g_signal_emit_by_name (authority, "changed");
+	g_assert_cmpint (pk_auth_cache_get_size (cache), ==, 0);
+	g_assert_false (pk_auth_cache_lookup (cache, ":1.42", "org.freedesktop.packagekit.package-install"));
+
+	/* and the handler goes away with the cache */
+	g_clear_object (&cache);
+	g_signal_emit_by_name (authority, "changed");
+}
+
 static void
 pk_test_transaction_func (void)
 {
@@ -762,6 +1131,9 @@ pk_test_transaction_db_func (void)
 	gboolean ret;
 	gdouble ms;
 	GError *error = NULL;
+	GList *list;
+	PkTransactionPast *past;
+	GVariant *history;
 	g_autoptr(PkTransactionDb) db = NULL;
 	g_autofree gchar *proxy_http = NULL;
 	g_autofree gchar *proxy_ftp = NULL;
@@ -774,6 +1146,8 @@ pk_test_transaction_db_func (void)
 		value = g_unlink ("./transactions.db");
 		g_assert_true (value == 0);
 	}
+	g_unlink ("./transactions.db-wal");
+	g_unlink ("./transactions.db-shm");
 #endif
 	/* check we created quickly */
 	g_test_timer_start ();
@@ -880,6 +1254,49 @@ pk_test_transaction_db_func (void)
 	g_assert_true (ret);
 	g_assert_cmpstr (proxy_http, ==, "127.0.0.1:80");
 	g_assert_cmpstr (proxy_ftp, ==, "127.0.0.1:21");
+
+	/* can we save a finished transaction in one go */
+	past = pk_transaction_past_new ();
+	g_object_set (past,
+		      "tid", "/1_abcdef",
+		      "timespec", "2009-01-01T00:00:00Z",
+		      "role", PK_ROLE_ENUM_INSTALL_PACKAGES,
+		      "succeeded", TRUE,
+		      "duration", 1234,
+		      "queue-time", 56,
+		      "first-result-time", 78,
+		      "uid", 500,
+		      "cmdline", "pkcon",
+		      "data", "installing\tcolord;1.0;x86_64;fedora\tColor daemon\n"
+			      "installing\tcolord;1.0;i686;fedora\tColor daemon\n"
+			      "available\tcolord-gtk;1.0;x86_64;fedora\tColor widgets",
+		      NULL);
+	ret = pk_transaction_db_add (db, past);
+	g_assert_true (ret);
+	g_object_unref (past);
+
+	/* can we get it back */
+	list = pk_transaction_db_get_list (db, 1);
+	g_assert_cmpint (g_list_length (list), ==, 1);
+	past = PK_TRANSACTION_PAST (list->data);
+	g_assert_cmpstr (pk_transaction_past_get_id (past), ==, "/1_abcdef");
+	g_assert_cmpint (pk_transaction_past_get_role (past), ==, PK_ROLE_ENUM_INSTALL_PACKAGES);
+	g_assert_true (pk_transaction_past_get_succeeded (past));
+	g_assert_cmpint (pk_transaction_past_get_duration (past), ==, 1234);
+	g_assert_cmpint (pk_transaction_past_get_queue_time (past), ==, 56);
+	g_assert_cmpint (pk_transaction_past_get_first_result_time (past), ==, 78);
+	g_assert_cmpint (pk_transaction_past_get_uid (past), ==, 500);
+	g_assert_cmpstr (pk_transaction_past_get_cmdline (past), ==, "pkcon");
+	g_list_free_full (list, g_object_unref);
+
+	/* is the package history indexed, without multiarch duplicates */
+	history = pk_transaction_db_get_package_history (db, "colord", 0);
+	g_assert_nonnull (history);
+	g_variant_ref_sink (history);
+	g_assert_cmpint (g_variant_n_children (history), ==, 1);
+	g_variant_unref (history);
+	history = pk_transaction_db_get_package_history (db, "colord-gtk", 0);
+	g_assert_null (history);
 }
 
 static PkTransactionDb *db = NULL;
@@ -908,6 +1325,40 @@ pk_test_scheduler_create_transaction (PkScheduler *tlist)
 	return tid;
 }
 
+/* loads the database and the dummy backend, and gets a scheduler using both */
+static PkScheduler *
+pk_test_scheduler_new (PkBackend **backend_out)
+{
+	gboolean ret;
+	PkScheduler *tlist;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GKeyFile) conf = NULL;
+	g_autoptr(PkBackend) backend = NULL;
+
+	db = pk_transaction_db_new ();
+	ret = pk_transaction_db_load (db, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+
+	/* try to load a valid backend */
+	conf = g_key_file_new ();
+	g_key_file_set_string (conf, "Daemon", "MaximumPackagesToProcess", "1000");
+	g_key_file_set_string (conf, "Daemon", "DefaultBackend", "dummy");
+	backend = pk_backend_new (conf);
+	ret = pk_backend_load (backend, NULL);
+	g_assert_true (ret);
+
+	/* get a transaction list object */
+	tlist = pk_scheduler_new (conf);
+	g_assert_true (tlist != NULL);
+	pk_scheduler_set_backend (tlist, backend);
+	pk_scheduler_set_transaction_db (tlist, db);
+
+	if (backend_out != NULL)
+		*backend_out = g_steal_pointer (&backend);
+	return tlist;
+}
+
 static void
 pk_test_scheduler_func (void)
 {
@@ -920,8 +1371,6 @@ pk_test_scheduler_func (void)
 	g_autofree gchar *tid_item1 = NULL;
 	g_autofree gchar *tid_item2 = NULL;
 	g_autofree gchar *tid_item3 = NULL;
-	g_autoptr(GKeyFile) conf = NULL;
-	g_autoptr(PkBackend) backend = NULL;
 	g_autoptr(PkScheduler) tlist = NULL;
 
 	/* remove the self check file */
@@ -933,27 +1382,13 @@ pk_test_scheduler_func (void)
 		size = g_unlink ("./transactions.db");
 		g_assert_true (size == 0);
 	}
+	g_unlink ("./transactions.db-wal");
+	g_unlink ("./transactions.db-shm");
 #endif
 
-	db = pk_transaction_db_new ();
-	ret = pk_transaction_db_load (db, &error);
-	g_assert_no_error (error);
-	g_assert_true (ret);
-
-	/* try to load a valid backend */
-	conf = g_key_file_new ();
-	backend = pk_backend_new (conf);
-	g_key_file_set_string (conf, "Daemon", "DefaultBackend", "dummy");
-	g_key_file_set_string (conf, "Daemon", "MaximumPackagesToProcess", "1000");
-	ret = pk_backend_load (backend, NULL);
-	g_assert_true (ret);
-
-	/* get a transaction list object */
-	tlist = pk_scheduler_new (conf);
-	g_assert_true (tlist != NULL);
+	tlist = pk_test_scheduler_new (NULL);
 
 	/* make sure we get a valid tid */
-	pk_scheduler_set_backend (tlist, backend);
 	tid = pk_transaction_db_generate_id (db);
 	g_assert_true (tid != NULL);
 
@@ -1219,40 +1654,19 @@ static void
 pk_test_scheduler_parallel_func (void)
 {
 	guint size;
-	gboolean ret;
 	guint i;
 	gchar **array;
 	PkTransaction *transaction1;
 	PkTransaction *transaction2;
 	PkTransaction *transaction3;
-	GError *error = NULL;
 	g_autofree gchar *tid_item1 = NULL;
 	g_autofree gchar *tid_item2 = NULL;
 	g_autofree gchar *tid_item3 = NULL;
 	g_autofree gchar *tid_item4 = NULL;
 	g_autofree gchar *tid_item5 = NULL;
-	g_autoptr(GKeyFile) conf = NULL;
-	g_autoptr(PkBackend) backend = NULL;
 	g_autoptr(PkScheduler) tlist = NULL;
 
-	db = pk_transaction_db_new ();
-	ret = pk_transaction_db_load (db, &error);
-	g_assert_no_error (error);
-	g_assert_true (ret);
-
-	/* try to load a valid backend */
-	conf = g_key_file_new ();
-	g_key_file_set_string (conf, "Daemon", "MaximumPackagesToProcess", "1000");
-	g_key_file_set_string (conf, "Daemon", "DefaultBackend", "dummy");
-	backend = pk_backend_new (conf);
-	ret = pk_backend_load (backend, NULL);
-	g_assert_true (ret);
-
-	/* get a transaction list object */
-	tlist = pk_scheduler_new (conf);
-	g_assert_true (tlist != NULL);
-
-	pk_scheduler_set_backend (tlist, backend);
+	tlist = pk_test_scheduler_new (NULL);
 
 	/* create three instances in list */
 	tid_item1 = pk_test_scheduler_create_transaction (tlist);
@@ -1423,6 +1837,355 @@ pk_test_scheduler_parallel_func (void)
 	g_object_unref (db);
 }
 
+static void
+pk_test_scheduler_coalesce_func (void)
+{
+	guint i;
+	guint size;
+	gchar **array;
+	PkResults *results;
+	PkTransaction *transaction;
+	gchar *tids[3];
+	g_autoptr(PkScheduler) tlist = NULL;
+	g_autoptr(GPtrArray) packages = NULL;
+
+	tlist = pk_test_scheduler_new (NULL);
+
+	/* search for the same thing three times */
+	for (i = 0; i < 3; i++) {
+		tids[i] = pk_test_scheduler_create_transaction (tlist);
+		transaction = pk_scheduler_get_transaction (tlist, tids[i]);
+		g_signal_connect (transaction, "finished",
+				  G_CALLBACK (pk_test_scheduler_finished_cb), NULL);
+		array = g_strsplit ("power", " ", -1);
+		pk_transaction_search_names (transaction,
+					     g_variant_new ("(t^as)",
+							    pk_bitfield_value (PK_FILTER_ENUM_NONE),
+							    array),
+					     NULL);
+		g_strfreev (array);
+	}
+
+	/* only the first one runs, the others wait for its results */
+	transaction = pk_scheduler_get_transaction (tlist, tids[0]);
+	g_assert_cmpint (pk_transaction_get_state (transaction), ==, PK_TRANSACTION_STATE_RUNNING);
+	transaction = pk_scheduler_get_transaction (tlist, tids[1]);
+	g_assert_cmpint (pk_transaction_get_state (transaction), ==, PK_TRANSACTION_STATE_READY);
+	transaction = pk_scheduler_get_transaction (tlist, tids[2]);
+	g_assert_cmpint (pk_transaction_get_state (transaction), ==, PK_TRANSACTION_STATE_READY);
+
+	/* wait for the search */
+	_g_test_loop_run_with_timeout (10000);
+	transaction = pk_scheduler_get_transaction (tlist, tids[0]);
+	g_assert_cmpint (pk_transaction_get_state (transaction), ==, PK_TRANSACTION_STATE_FINISHED);
+	results = pk_transaction_get_results (transaction);
+	g_assert_cmpint (pk_results_get_exit_code (results), ==, PK_EXIT_ENUM_SUCCESS);
+	packages = pk_results_get_package_array (results);
+	g_assert_cmpint (packages->len, >, 0);
+
+	/* the others get the same results, without searching again */
+	for (i = 0; i < 2; i++)
+		_g_test_loop_run_with_timeout (1000);
+	for (i = 1; i < 3; i++) {
+		g_autoptr(GPtrArray) replayed = NULL;
+		transaction = pk_scheduler_get_transaction (tlist, tids[i]);
+		g_assert_cmpint (pk_transaction_get_state (transaction), ==, PK_TRANSACTION_STATE_FINISHED);
+		results = pk_transaction_get_results (transaction);
+		g_assert_cmpint (pk_results_get_exit_code (results), ==, PK_EXIT_ENUM_SUCCESS);
+		replayed = pk_results_get_package_array (results);
+		g_assert_cmpint (replayed->len, ==, packages->len);
+	}
+
+	/* nothing left */
+	array = pk_scheduler_get_array (tlist);
+	size = g_strv_length (array);
+	g_assert_cmpint (size, ==, 0);
+	g_strfreev (array);
+
+	for (i = 0; i < 3; i++)
+		g_free (tids[i]);
+	g_object_unref (db);
+}
+
+static PkResults *
+pk_test_scheduler_get_updates (PkScheduler *tlist, gdouble *elapsed)
+{
+	g_autofree gchar *tid = NULL;
+	g_autoptr(GTimer) timer = g_timer_new ();
+	PkTransaction *transaction;
+
+	tid = pk_test_scheduler_create_transaction (tlist);
+	transaction = pk_scheduler_get_transaction (tlist, tid);
+	g_signal_connect (transaction, "finished",
+			  G_CALLBACK (pk_test_scheduler_finished_cb), NULL);
+	pk_transaction_get_updates (transaction,
+				    g_variant_new ("(t)",
+						   pk_bitfield_value (PK_FILTER_ENUM_NONE)),
+				    NULL);
+	_g_test_loop_run_with_timeout (5000);
+	*elapsed = g_timer_elapsed (timer, NULL) * 1000;
+	g_assert_cmpint (pk_transaction_get_state (transaction), ==, PK_TRANSACTION_STATE_FINISHED);
+	return pk_transaction_get_results (transaction);
+}
+
+static void
+pk_test_scheduler_cache_func (void)
+{
+	gdouble elapsed;
+	PkResults *results;
+	g_autoptr(PkBackend) backend = NULL;
+	g_autoptr(PkScheduler) tlist = NULL;
+	g_autoptr(GPtrArray) packages = NULL;
+	g_autoptr(GPtrArray) cached = NULL;
+	g_autoptr(GVariant) stats = NULL;
+	g_autoptr(GVariant) role_stats = NULL;
+	guint64 value = 0;
+
+	tlist = pk_test_scheduler_new (&backend);
+
+	/* the dummy backend takes a second to get the updates */
+	results = pk_test_scheduler_get_updates (tlist, &elapsed);
+	if (pk_results_get_exit_code (results) != PK_EXIT_ENUM_SUCCESS) {
+		g_test_skip ("cannot get updates when offline");
+		g_object_unref (db);
+		return;
+	}
+	packages = pk_results_get_package_array (results);
+	g_assert_cmpfloat (elapsed, >, 900);
+
+	/* the backend run was recorded in the latency histogram */
+	stats = g_variant_ref_sink (pk_scheduler_get_stats (tlist));
+	role_stats = g_variant_lookup_value (stats, "get-updates", G_VARIANT_TYPE ("a{st}"));
+	g_assert_nonnull (role_stats);
+	g_assert_true (g_variant_lookup (role_stats, "count", "t", &value));
+	g_assert_cmpint (value, ==, 1);
+	g_assert_true (g_variant_lookup (role_stats, "run-time-p50", "t", &value));
+	g_assert_cmpint (value, >, 900 * 750);
+	g_assert_true (g_variant_lookup (role_stats, "run-time-max", "t", &value));
+	g_assert_cmpint (value, >, 900 * 1000);
+
+	/* nothing changed, so the same updates are returned at once */
+	results = pk_test_scheduler_get_updates (tlist, &elapsed);
+	g_assert_cmpint (pk_results_get_exit_code (results), ==, PK_EXIT_ENUM_SUCCESS);
+	cached = pk_results_get_package_array (results);
+	g_assert_cmpint (cached->len, ==, packages->len);
+	g_assert_cmpfloat (elapsed, <, 500);
+
+	/* the backend is asked again once the package database changed */
+	pk_backend_cache_invalidate (backend);
+	results = pk_test_scheduler_get_updates (tlist, &elapsed);
+	g_assert_cmpint (pk_results_get_exit_code (results), ==, PK_EXIT_ENUM_SUCCESS);
+	g_assert_cmpfloat (elapsed, >, 900);
+
+	g_object_unref (db);
+}
+
+/* starts an exclusive search as @uid, which is run in the background if asked */
+static gchar *
+pk_test_scheduler_search (PkScheduler *tlist, const gchar *search, guint uid, gboolean background)
+{
+	gchar *tid;
+	PkTransaction *transaction;
+	g_auto(GStrv) array = NULL;
+
+	tid = pk_test_scheduler_create_transaction (tlist);
+	transaction = pk_scheduler_get_transaction (tlist, tid);
+	g_signal_connect (transaction, "finished",
+			  G_CALLBACK (pk_test_scheduler_finished_cb), NULL);
+	pk_transaction_set_uid (transaction, uid);
+	pk_transaction_make_exclusive (transaction);
+	if (background)
+		pk_backend_job_set_background (pk_transaction_get_backend_job (transaction), TRUE);
+	array = g_strsplit (search, " ", -1);
+	pk_transaction_search_names (transaction,
+				     g_variant_new ("(t^as)",
+						    pk_bitfield_value (PK_FILTER_ENUM_NONE),
+						    array),
+				     NULL);
+	return tid;
+}
+
+static PkTransactionState
+pk_test_scheduler_get_state (PkScheduler *tlist, const gchar *tid)
+{
+	return pk_transaction_get_state (pk_scheduler_get_transaction (tlist, tid));
+}
+
+static void
+pk_test_scheduler_priority_func (void)
+{
+	guint i;
+	gboolean ret;
+	gchar *tid;
+	gchar *tids[4];
+	PkResults *results;
+	GError *error = NULL;
+	g_autoptr(GPtrArray) created = g_ptr_array_new_with_free_func (g_free);
+	g_autoptr(PkScheduler) tlist = NULL;
+
+	tlist = pk_test_scheduler_new (NULL);
+
+	/* a user alone may have all the 1000 transactions in progress */
+	for (i = 0; i < 1000; i++)
+		g_ptr_array_add (created, pk_test_scheduler_create_transaction (tlist));
+	tid = pk_transaction_db_generate_id (db);
+	ret = pk_scheduler_create (tlist, tid, ":org.freedesktop.PackageKit", &error);
+	g_assert_nonnull (error);
+	g_assert_false (ret);
+	g_clear_error (&error);
+	g_free (tid);
+	for (i = 0; i < created->len; i++)
+		g_assert_true (pk_scheduler_remove (tlist, g_ptr_array_index (created, i)));
+	g_ptr_array_set_size (created, 0);
+
+	/* but has to share them equally once another user has one */
+	tids[0] = pk_test_scheduler_search (tlist, "hotel", 501, FALSE);
+	for (i = 0; i < 500; i++)
+		g_ptr_array_add (created, pk_test_scheduler_create_transaction (tlist));
+	tid = pk_transaction_db_generate_id (db);
+	ret = pk_scheduler_create (tlist, tid, ":org.freedesktop.PackageKit", &error);
+	g_assert_nonnull (error);
+	g_assert_false (ret);
+	g_clear_error (&error);
+	g_free (tid);
+	for (i = 0; i < created->len; i++)
+		g_assert_true (pk_scheduler_remove (tlist, g_ptr_array_index (created, i)));
+	_g_test_loop_run_with_timeout (10000);
+	g_assert_cmpint (pk_test_scheduler_get_state (tlist, tids[0]), ==, PK_TRANSACTION_STATE_FINISHED);
+	g_free (tids[0]);
+
+	/* one running, then a background and an interactive one waiting */
+	tids[0] = pk_test_scheduler_search (tlist, "dave", 500, FALSE);
+	tids[1] = pk_test_scheduler_search (tlist, "power", 500, TRUE);
+	tids[2] = pk_test_scheduler_search (tlist, "paul", 500, FALSE);
+	g_assert_cmpint (pk_test_scheduler_get_state (tlist, tids[0]), ==, PK_TRANSACTION_STATE_RUNNING);
+
+	/* the interactive one overtakes the background one */
+	_g_test_loop_run_with_timeout (10000);
+	g_assert_cmpint (pk_test_scheduler_get_state (tlist, tids[0]), ==, PK_TRANSACTION_STATE_FINISHED);
+	g_assert_cmpint (pk_test_scheduler_get_state (tlist, tids[1]), ==, PK_TRANSACTION_STATE_READY);
+	g_assert_cmpint (pk_test_scheduler_get_state (tlist, tids[2]), ==, PK_TRANSACTION_STATE_RUNNING);
+
+	/* and the background one runs last */
+	_g_test_loop_run_with_timeout (10000);
+	g_assert_cmpint (pk_test_scheduler_get_state (tlist, tids[1]), ==, PK_TRANSACTION_STATE_RUNNING);
+	_g_test_loop_run_with_timeout (10000);
+	g_assert_cmpint (pk_test_scheduler_get_state (tlist, tids[1]), ==, PK_TRANSACTION_STATE_FINISHED);
+	for (i = 0; i < 3; i++)
+		g_free (tids[i]);
+
+	/* one user queues two more, and another user queues one after them */
+	tids[0] = pk_test_scheduler_search (tlist, "alpha", 500, FALSE);
+	tids[1] = pk_test_scheduler_search (tlist, "bravo", 500, FALSE);
+	tids[2] = pk_test_scheduler_search (tlist, "charlie", 500, FALSE);
+	tids[3] = pk_test_scheduler_search (tlist, "delta", 501, FALSE);
+	g_assert_cmpint (pk_test_scheduler_get_state (tlist, tids[0]), ==, PK_TRANSACTION_STATE_RUNNING);
+	_g_test_loop_run_with_timeout (10000);
+	g_assert_cmpint (pk_test_scheduler_get_state (tlist, tids[1]), ==, PK_TRANSACTION_STATE_RUNNING);
+
+	/* the other user gets a turn before the first one runs the next */
+	_g_test_loop_run_with_timeout (10000);
+	g_assert_cmpint (pk_test_scheduler_get_state (tlist, tids[1]), ==, PK_TRANSACTION_STATE_FINISHED);
+	g_assert_cmpint (pk_test_scheduler_get_state (tlist, tids[2]), ==, PK_TRANSACTION_STATE_READY);
+	g_assert_cmpint (pk_test_scheduler_get_state (tlist, tids[3]), ==, PK_TRANSACTION_STATE_RUNNING);
+	_g_test_loop_run_with_timeout (10000);
+	g_assert_cmpint (pk_test_scheduler_get_state (tlist, tids[2]), ==, PK_TRANSACTION_STATE_RUNNING);
+	_g_test_loop_run_with_timeout (10000);
+	g_assert_cmpint (pk_test_scheduler_get_state (tlist, tids[2]), ==, PK_TRANSACTION_STATE_FINISHED);
+	for (i = 0; i < 4; i++)
+		g_free (tids[i]);
+
+	/* a running background transaction is cancelled for an interactive
+	 * one, once the backend allows cancelling it */
+	tids[0] = pk_test_scheduler_search (tlist, "echo", 500, TRUE);
+	g_assert_cmpint (pk_test_scheduler_get_state (tlist, tids[0]), ==, PK_TRANSACTION_STATE_RUNNING);
+	_g_test_loop_wait (200);
+	tids[1] = pk_test_scheduler_search (tlist, "foxtrot", 500, FALSE);
+	g_assert_cmpint (pk_test_scheduler_get_state (tlist, tids[1]), ==, PK_TRANSACTION_STATE_READY);
+	_g_test_loop_run_with_timeout (10000);
+	g_assert_cmpint (pk_test_scheduler_get_state (tlist, tids[0]), ==, PK_TRANSACTION_STATE_FINISHED);
+	results = pk_transaction_get_results (pk_scheduler_get_transaction (tlist, tids[0]));
+	g_assert_cmpint (pk_results_get_exit_code (results), ==, PK_EXIT_ENUM_CANCELLED_PRIORITY);
+	g_assert_cmpint (pk_test_scheduler_get_state (tlist, tids[1]), ==, PK_TRANSACTION_STATE_RUNNING);
+	_g_test_loop_run_with_timeout (10000);
+	g_assert_cmpint (pk_test_scheduler_get_state (tlist, tids[1]), ==, PK_TRANSACTION_STATE_FINISHED);
+	for (i = 0; i < 2; i++)
+		g_free (tids[i]);
+
+	g_object_unref (db);
+}
+
+static void
+pk_test_scheduler_lock_retry_func (void)
+{
+	PkResults *results;
+	PkTransaction *transaction1;
+	PkTransaction *transaction2;
+	guint64 queue_time = 0;
+	guint64 auth_time = 0;
+	guint64 wait_time = 0;
+	guint64 run_time = 0;
+	guint64 total_time = 0;
+	g_autofree gchar *tid_item1 = NULL;
+	g_autofree gchar *tid_item2 = NULL;
+	g_autoptr(PkScheduler) tlist = NULL;
+	g_autoptr(GVariant) stats = NULL;
+
+	tlist = pk_test_scheduler_new (NULL);
+
+	/* start two refreshes at the same time, so the second finds the
+	 * package database locked by the first */
+	tid_item1 = pk_test_scheduler_create_transaction (tlist);
+	tid_item2 = pk_test_scheduler_create_transaction (tlist);
+	transaction1 = pk_scheduler_get_transaction (tlist, tid_item1);
+	transaction2 = pk_scheduler_get_transaction (tlist, tid_item2);
+	g_signal_connect (transaction1, "finished",
+			  G_CALLBACK (pk_test_scheduler_finished_cb), NULL);
+	g_signal_connect (transaction2, "finished",
+			  G_CALLBACK (pk_test_scheduler_finished_cb), NULL);
+	pk_transaction_skip_auth_checks (transaction1, TRUE);
+	pk_transaction_skip_auth_checks (transaction2, TRUE);
+	pk_transaction_refresh_cache (transaction1, g_variant_new ("(b)", FALSE), NULL);
+	pk_transaction_refresh_cache (transaction2, g_variant_new ("(b)", FALSE), NULL);
+	g_assert_cmpint (pk_transaction_get_state (transaction1), ==, PK_TRANSACTION_STATE_RUNNING);
+	g_assert_cmpint (pk_transaction_get_state (transaction2), ==, PK_TRANSACTION_STATE_RUNNING);
+	pk_transaction_make_exclusive (transaction1);
+
+	/* the second one failed to get the lock and waits again */
+	_g_test_loop_run_with_timeout (10000);
+	g_assert_cmpint (pk_transaction_get_state (transaction1), ==, PK_TRANSACTION_STATE_RUNNING);
+	g_assert_cmpint (pk_transaction_get_state (transaction2), ==, PK_TRANSACTION_STATE_READY);
+	g_assert_true (pk_transaction_is_exclusive (transaction2));
+
+	/* it is retried once the lock is released */
+	_g_test_loop_run_with_timeout (10000);
+	g_assert_cmpint (pk_transaction_get_state (transaction1), ==, PK_TRANSACTION_STATE_FINISHED);
+	g_assert_cmpint (pk_transaction_get_state (transaction2), ==, PK_TRANSACTION_STATE_RUNNING);
+
+	/* and succeeds this time */
+	_g_test_loop_run_with_timeout (10000);
+	g_assert_cmpint (pk_transaction_get_state (transaction2), ==, PK_TRANSACTION_STATE_FINISHED);
+	results = pk_transaction_get_results (transaction2);
+	g_assert_cmpint (pk_results_get_exit_code (results), ==, PK_EXIT_ENUM_SUCCESS);
+
+	/* it really waited, so every phase was reached, and in order */
+	stats = g_variant_ref_sink (pk_transaction_get_stats (transaction2));
+	g_assert_true (g_variant_lookup (stats, "queue-time", "t", &queue_time));
+	g_assert_true (g_variant_lookup (stats, "auth-time", "t", &auth_time));
+	g_assert_true (g_variant_lookup (stats, "wait-time", "t", &wait_time));
+	g_assert_true (g_variant_lookup (stats, "run-time", "t", &run_time));
+	g_assert_true (g_variant_lookup (stats, "total-time", "t", &total_time));
+	g_assert_cmpuint (auth_time, >, 0);
+	g_assert_cmpuint (wait_time, >, 0);
+	g_assert_cmpuint (run_time, >, 0);
+	g_assert_cmpuint (auth_time, <, queue_time);
+	g_assert_cmpuint (wait_time, <, queue_time);
+	g_assert_cmpuint (queue_time, <, total_time);
+	g_assert_cmpuint (run_time, <, total_time);
+
+	g_object_unref (db);
+}
+
 int
 main (int argc, char **argv)
 {
@@ -1440,14 +2203,23 @@ main (int argc, char **argv)
 	/* components */
 	g_test_add_func ("/packagekit/transaction", pk_test_transaction_func);
 	g_test_add_func ("/packagekit/dbus", pk_test_dbus_func);
+	g_test_add_func ("/packagekit/auth-cache", pk_test_auth_cache_func);
+	g_test_add_func ("/packagekit/auth-cache-disabled", pk_test_auth_cache_disabled_func);
+	g_test_add_func ("/packagekit/auth-cache-changed", pk_test_auth_cache_changed_func);
 	g_test_add_func ("/packagekit/spawn", pk_test_spawn_func);
+	g_test_add_func ("/packagekit/spawn-latency", pk_test_spawn_latency_func);
 	g_test_add_func ("/packagekit/scheduler", pk_test_scheduler_func);
 	g_test_add_func ("/packagekit/scheduler-parallel", pk_test_scheduler_parallel_func);
+	g_test_add_func ("/packagekit/scheduler-coalesce", pk_test_scheduler_coalesce_func);
+	g_test_add_func ("/packagekit/scheduler-cache", pk_test_scheduler_cache_func);
+	g_test_add_func ("/packagekit/scheduler-priority", pk_test_scheduler_priority_func);
+	g_test_add_func ("/packagekit/scheduler-lock-retry", pk_test_scheduler_lock_retry_func);
 	g_test_add_func ("/packagekit/transaction-db", pk_test_transaction_db_func);
 
 	/* backend stuff */
 	g_test_add_func ("/packagekit/backend", pk_test_backend_func);
 	g_test_add_func ("/packagekit/backend_spawn", pk_test_backend_spawn_func);
+	g_test_add_func ("/packagekit/backend_spawn-throughput", pk_test_backend_spawn_throughput_func);
 
 	return g_test_run ();
 }
@@ -36,9 +36,11 @@
 #endif /* HAVE_UNISTD_H */
 
 #include <sys/wait.h>
+#include <sys/syscall.h>
 #include <fcntl.h>
 
 #include <glib/gi18n.h>
+#include <glib-unix.h>
 
 #include "pk-spawn.h"
 #include "pk-shared.h"
@@ -46,15 +48,25 @@
 static void     pk_spawn_finalize	(GObject       *object);
 
 #define PK_SPAWN_GET_PRIVATE(o) (G_TYPE_INSTANCE_GET_PRIVATE ((o), PK_TYPE_SPAWN, PkSpawnPrivate))
-#define PK_SPAWN_POLL_DELAY	50 /* ms */
+#define PK_SPAWN_POLL_DELAY	50 /* ms, only used without pidfd support */
 #define PK_SPAWN_SIGKILL_DELAY	2500 /* ms */
 
+/* A binary frame is the ASCII record separator, which never starts a line
+ * of the text protocol, the payload size as a little endian guint32 and
+ * then the payload itself. */
+#define PK_SPAWN_FRAME_MAGIC		0x1e
+#define PK_SPAWN_FRAME_HEADER_SIZE	5
+#define PK_SPAWN_FRAME_MAX_SIZE		(64 * 1024 * 1024)
+
 struct PkSpawnPrivate
 {
 	pid_t			 child_pid;
 	gint			 stdin_fd;
 	gint			 stdout_fd;
 	gint			 stderr_fd;
+	gint			 pid_fd;
+	guint			 stdout_id;
+	guint			 stderr_id;
 	guint			 poll_id;
 	guint			 kill_id;
 	gboolean		 finished;
@@ -62,6 +74,8 @@ struct PkSpawnPrivate
 	gboolean		 is_sending_exit;
 	gboolean		 is_changing_dispatcher;
 	gboolean		 allow_sigkill;
+	gboolean		 framed;
+	gboolean		 protocol_error;
 	PkSpawnExitType		 exit;
 	GString			*stdout_buf;
 	GString			*stderr_buf;
@@ -74,6 +88,7 @@ enum {
 	SIGNAL_EXIT,
 	SIGNAL_STDOUT,
 	SIGNAL_STDERR,
+	SIGNAL_STDOUT_FRAME,
 	SIGNAL_LAST
 };
 
@@ -88,52 +103,91 @@ static guint signals [SIGNAL_LAST] = { 0 };
 
 G_DEFINE_TYPE (PkSpawn, pk_spawn, G_TYPE_OBJECT)
 
+/* returns FALSE once the other end has been closed */
 static gboolean
 pk_spawn_read_fd_into_buffer (gint fd, GString *string)
 {
-	gint bytes_read;
+	gssize bytes_read;
 	gchar buffer[BUFSIZ];
 
-	/* ITS4: ignore, we manually NULL terminate and GString cannot overflow */
-	while ((bytes_read = read (fd, buffer, BUFSIZ-1)) > 0) {
-		buffer[bytes_read] = '\0';
-		g_string_append (string, buffer);
-	}
+	/* frames can contain NUL bytes, so always append by length */
+	while ((bytes_read = read (fd, buffer, sizeof (buffer))) > 0)
+		g_string_append_len (string, buffer, bytes_read);
 
-	return TRUE;
+	return bytes_read != 0;
 }
 
+/**
+ * pk_spawn_emit_whole_records:
+ *
+ * Emits every complete line and binary frame in @string, and leaves any
+ * incomplete one at the end for the next read.
+ **/
 static gboolean
-pk_spawn_emit_whole_lines (PkSpawn *spawn, GString *string)
+pk_spawn_emit_whole_records (PkSpawn *spawn, GString *string)
 {
-	guint i;
-	guint size;
-	guint bytes_processed;
-	g_auto(GStrv) lines = NULL;
+	gsize offset = 0;
+	g_autoptr(GString) records = NULL;
 
 	/* if nothing then don't emit */
-	if (pk_strzero (string->str))
+	if (string->len == 0)
 		return FALSE;
 
-	/* split into lines - the last line may be incomplete */
-	lines = g_strsplit (string->str, "\n", 0);
-	if (lines == NULL)
+	/* the helper is being killed, so nothing it says can be trusted */
+	if (spawn->priv->protocol_error) {
+		g_string_truncate (string, 0);
 		return FALSE;
+	}
 
-	/* find size */
-	size = g_strv_length (lines);
+	/* take the data, as a signal handler may read more into @string */
+	records = g_string_new_len (string->str, string->len);
+	g_string_truncate (string, 0);
+
+	while (offset < records->len) {
+		const gchar *start = records->str + offset;
+		gsize remaining = records->len - offset;
+		const gchar *end;
+		g_autofree gchar *line = NULL;
+
+		if ((guchar) start[0] == PK_SPAWN_FRAME_MAGIC) {
+			guint32 size;
+			g_autoptr(GBytes) payload = NULL;
+
+			if (remaining < PK_SPAWN_FRAME_HEADER_SIZE)
+				break;
+			memcpy (&size, start + 1, sizeof (size));
+			size = GUINT32_FROM_LE (size);
+			if (size > PK_SPAWN_FRAME_MAX_SIZE) {
+				g_warning ("invalid frame of %u bytes, killing helper", size);
+				spawn->priv->protocol_error = TRUE;
+				if (spawn->priv->kill_id == 0)
+					pk_spawn_kill (spawn);
+				offset = records->len;
+				break;
+			}
+			if (remaining - PK_SPAWN_FRAME_HEADER_SIZE < size)
+				break;
+
+			/* the helper speaks the binary protocol */
+			spawn->priv->framed = TRUE;
+			payload = g_bytes_new (start + PK_SPAWN_FRAME_HEADER_SIZE, size);
+			offset += PK_SPAWN_FRAME_HEADER_SIZE + size;
+			g_signal_emit (spawn, signals [SIGNAL_STDOUT_FRAME], 0, payload);
+			continue;
+		}
 
-	bytes_processed = 0;
-	/* we only emit n-1 strings */
-	for (i = 0; i < (size-1); i++) {
-		g_signal_emit (spawn, signals [SIGNAL_STDOUT], 0, lines[i]);
-		/* ITS4: ignore, g_strsplit always NULL terminates */
-		bytes_processed += strlen (lines[i]) + 1;
+		/* the last line may be incomplete */
+		end = memchr (start, '\n', remaining);
+		if (end == NULL)
+			break;
+		line = g_strndup (start, end - start);
+		offset += end - start + 1;
+		g_signal_emit (spawn, signals [SIGNAL_STDOUT], 0, line);
 	}
 
-	/* remove the text we've processed */
-	g_string_erase (string, 0, bytes_processed);
-	return TRUE;
+	/* keep what is incomplete in front of anything read meanwhile */
+	g_string_prepend_len (string, records->str + offset, records->len - offset);
+	return offset > 0;
 }
 
 static const gchar *
@@ -154,13 +208,33 @@ pk_spawn_exit_type_enum_to_string (PkSpawnExitType type)
 	return "unknown";
 }
 
+static void
+pk_spawn_remove_sources (PkSpawn *spawn)
+{
+	if (spawn->priv->stdout_id != 0) {
+		g_source_remove (spawn->priv->stdout_id);
+		spawn->priv->stdout_id = 0;
+	}
+	if (spawn->priv->stderr_id != 0) {
+		g_source_remove (spawn->priv->stderr_id);
+		spawn->priv->stderr_id = 0;
+	}
+	if (spawn->priv->poll_id != 0) {
+		g_source_remove (spawn->priv->poll_id);
+		spawn->priv->poll_id = 0;
+	}
+	if (spawn->priv->pid_fd != -1) {
+		close (spawn->priv->pid_fd);
+		spawn->priv->pid_fd = -1;
+	}
+}
+
 static gboolean
 pk_spawn_check_child (PkSpawn *spawn)
 {
 	pid_t pid;
 	int status;
 	gint retval;
-	static guint limit_printing = 0;
 
 	/* this shouldn't happen */
 	if (spawn->priv->finished) {
@@ -180,11 +254,7 @@ pk_spawn_check_child (PkSpawn *spawn)
 	}
 
 	/* all usual output goes on standard out, only bad libraries bitch to stderr */
-	pk_spawn_emit_whole_lines (spawn, spawn->priv->stdout_buf);
-
-	/* Only print one in twenty times to avoid filling the screen */
-	if (limit_printing++ % 20 == 0)
-		g_debug ("polling child_pid=%ld (1/20)", (long)spawn->priv->child_pid);
+	pk_spawn_emit_whole_records (spawn, spawn->priv->stdout_buf);
 
 	/* check if the child exited */
 	pid = waitpid (spawn->priv->child_pid, &status, WNOHANG);
@@ -202,11 +272,8 @@ pk_spawn_check_child (PkSpawn *spawn)
 		return TRUE;
 	}
 
-	/* disconnect the poll as there will be no more updates */
-	if (spawn->priv->poll_id > 0) {
-		g_source_remove (spawn->priv->poll_id);
-		spawn->priv->poll_id = 0;
-	}
+	/* disconnect the watches as there will be no more updates */
+	pk_spawn_remove_sources (spawn);
 
 	/* child exited, close resources */
 	close (spawn->priv->stdin_fd);
@@ -263,7 +330,9 @@ pk_spawn_check_child (PkSpawn *spawn)
 	}
 
 	/* are we doing pk_spawn_exit for a good reason? */
-	if (spawn->priv->is_changing_dispatcher)
+	if (spawn->priv->protocol_error)
+		spawn->priv->exit = PK_SPAWN_EXIT_TYPE_FAILED;
+	else if (spawn->priv->is_changing_dispatcher)
 		spawn->priv->exit = PK_SPAWN_EXIT_TYPE_DISPATCHER_CHANGED;
 	else if (spawn->priv->is_sending_exit)
 		spawn->priv->exit = PK_SPAWN_EXIT_TYPE_DISPATCHER_EXIT;
@@ -276,6 +345,72 @@ pk_spawn_check_child (PkSpawn *spawn)
 	return FALSE;
 }
 
+static gboolean
+pk_spawn_stdout_cb (gint fd, GIOCondition condition, gpointer user_data)
+{
+	PkSpawn *spawn = PK_SPAWN (user_data);
+	gboolean ret;
+
+	/* emit the lines as soon as they arrive */
+	ret = pk_spawn_read_fd_into_buffer (fd, spawn->priv->stdout_buf);
+	pk_spawn_emit_whole_records (spawn, spawn->priv->stdout_buf);
+	if (!ret || (condition & (G_IO_HUP | G_IO_ERR)) > 0) {
+		spawn->priv->stdout_id = 0;
+		return G_SOURCE_REMOVE;
+	}
+	return G_SOURCE_CONTINUE;
+}
+
+static gboolean
+pk_spawn_stderr_cb (gint fd, GIOCondition condition, gpointer user_data)
+{
+	PkSpawn *spawn = PK_SPAWN (user_data);
+	gboolean ret;
+
+	ret = pk_spawn_read_fd_into_buffer (fd, spawn->priv->stderr_buf);
+	if (spawn->priv->stderr_buf->len != 0) {
+		g_signal_emit (spawn, signals [SIGNAL_STDERR], 0, spawn->priv->stderr_buf->str);
+		g_string_set_size (spawn->priv->stderr_buf, 0);
+	}
+	if (!ret || (condition & (G_IO_HUP | G_IO_ERR)) > 0) {
+		spawn->priv->stderr_id = 0;
+		return G_SOURCE_REMOVE;
+	}
+	return G_SOURCE_CONTINUE;
+}
+
+static gboolean
+pk_spawn_pid_fd_cb (gint fd, GIOCondition condition, gpointer user_data)
+{
+	PkSpawn *spawn = PK_SPAWN (user_data);
+
+	/* the pidfd becomes readable when the child exits */
+	if (!pk_spawn_check_child (spawn)) {
+		spawn->priv->poll_id = 0;
+		return G_SOURCE_REMOVE;
+	}
+
+	/* the pidfd stays readable, so don't spin if waitpid() disagrees */
+	g_warning ("child %ld not reaped, falling back to polling",
+		   (long) spawn->priv->child_pid);
+	close (spawn->priv->pid_fd);
+	spawn->priv->pid_fd = -1;
+	spawn->priv->poll_id = g_timeout_add (PK_SPAWN_POLL_DELAY, (GSourceFunc) pk_spawn_check_child, spawn);
+	g_source_set_name_by_id (spawn->priv->poll_id, "[PkSpawn] main poll");
+	return G_SOURCE_REMOVE;
+}
+
+static gint
+pk_spawn_pid_fd_open (pid_t pid)
+{
+#ifdef SYS_pidfd_open
+	return syscall (SYS_pidfd_open, pid, 0);
+#else
+	errno = ENOSYS;
+	return -1;
+#endif
+}
+
 static gboolean
 pk_spawn_sigkill_cb (PkSpawn *spawn)
 {
@@ -410,6 +545,65 @@ pk_spawn_send_stdin (PkSpawn *spawn, const gchar *command)
 	return TRUE;
 }
 
+/* keep writing until all of @data is in the pipe */
+static gboolean
+pk_spawn_write_all (gint fd, const gchar *data, gsize length)
+{
+	while (length > 0) {
+		gssize wrote = write (fd, data, length);
+		if (wrote < 0) {
+			if (errno == EINTR)
+				continue;
+			g_warning ("failed to write %" G_GSIZE_FORMAT " bytes on fd %i (%s)",
+				   length, fd, strerror (errno));
+			return FALSE;
+		}
+		data += wrote;
+		length -= wrote;
+	}
+	return TRUE;
+}
+
+/**
+ * pk_spawn_send_frame:
+ *
+ * Send a new command to a running (but idle) dispatcher that speaks the
+ * binary protocol. The payload is the number of arguments and environment
+ * entries as little endian guint32s, followed by all of them as NUL
+ * terminated strings, so the dispatcher can be reused even when the
+ * environment of the transaction changed.
+ **/
+static gboolean
+pk_spawn_send_frame (PkSpawn *spawn, gchar **argv, gchar **envp)
+{
+	guint32 n_args;
+	guint32 n_env;
+	guint32 size;
+	g_autoptr(GString) frame = g_string_sized_new (1024);
+
+	/* check if process has already gone */
+	if (spawn->priv->finished || spawn->priv->child_pid == -1) {
+		g_debug ("no dispatcher to send frame to");
+		return FALSE;
+	}
+
+	n_args = GUINT32_TO_LE (argv != NULL ? g_strv_length (argv) : 0);
+	n_env = GUINT32_TO_LE (envp != NULL ? g_strv_length (envp) : 0);
+	g_string_append_c (frame, PK_SPAWN_FRAME_MAGIC);
+	g_string_append_len (frame, "\0\0\0\0", 4);
+	g_string_append_len (frame, (const gchar *) &n_args, sizeof (n_args));
+	g_string_append_len (frame, (const gchar *) &n_env, sizeof (n_env));
+	for (guint i = 0; argv != NULL && argv[i] != NULL; i++)
+		g_string_append_len (frame, argv[i], strlen (argv[i]) + 1);
+	for (guint i = 0; envp != NULL && envp[i] != NULL; i++)
+		g_string_append_len (frame, envp[i], strlen (envp[i]) + 1);
+	size = GUINT32_TO_LE (frame->len - PK_SPAWN_FRAME_HEADER_SIZE);
+	memcpy (frame->str + 1, &size, sizeof (size));
+
+	g_debug ("sending frame of %" G_GSIZE_FORMAT " bytes", frame->len);
+	return pk_spawn_write_all (spawn->priv->stdin_fd, frame->str, frame->len);
+}
+
 /**
  * pk_spawn_exit:
  *
@@ -531,14 +725,22 @@ pk_spawn_argv (PkSpawn *spawn, gchar **argv, gchar **envp,
 	/* we can reuse the dispatcher if:
 	 *  - it's still running
 	 *  - argv[0] (executable name is the same)
-	 *  - all of envp are the same (proxy and locale settings) */
+	 *  - all of envp are the same (proxy and locale settings), unless
+	 *    it speaks the binary protocol which sends envp along */
 	if (spawn->priv->stdin_fd != -1) {
 		if (g_strcmp0 (spawn->priv->last_argv0, argv[0]) != 0) {
 			g_debug ("argv did not match, not reusing");
-		} else if (!pk_strvequal (spawn->priv->last_envp, envp)) {
+		} else if (!spawn->priv->framed &&
+			   !pk_strvequal (spawn->priv->last_envp, envp)) {
 			g_debug ("envp did not match, not reusing");
 		} else if ((flags & PK_SPAWN_ARGV_FLAGS_NEVER_REUSE) > 0) {
 			g_debug ("not re-using instance due to policy");
+		} else if (spawn->priv->framed) {
+			g_debug ("reusing framed instance");
+			ret = pk_spawn_send_frame (spawn, &argv[1], envp);
+			if (ret)
+				goto out;
+			g_warning ("failed to write, so trying to kill and respawn");
 		} else {
 			/* join with tabs, as spaces could be in file name */
 			g_autofree gchar *command = g_strjoinv ("\t", &argv[1]);
@@ -559,17 +761,16 @@ pk_spawn_argv (PkSpawn *spawn, gchar **argv, gchar **envp,
 		ret = pk_spawn_exit (spawn);
 		if (!ret) {
 			g_warning ("failed to exit previous instance");
-			/* remove poll, as we can't reply on pk_spawn_check_child() */
-			if (spawn->priv->poll_id != 0) {
-				g_source_remove (spawn->priv->poll_id);
-				spawn->priv->poll_id = 0;
-			}
+			/* remove watches, as we can't reply on pk_spawn_check_child() */
+			pk_spawn_remove_sources (spawn);
 		}
 		spawn->priv->is_changing_dispatcher = FALSE;
 	}
 
 	/* create spawned object for tracking */
 	spawn->priv->finished = FALSE;
+	spawn->priv->framed = FALSE;
+	spawn->priv->protocol_error = FALSE;
 	g_debug ("creating new instance of %s", argv[0]);
 	ret = g_spawn_async_with_pipes (NULL, argv, envp,
 				 G_SPAWN_DO_NOT_REAP_CHILD | G_SPAWN_SEARCH_PATH,
@@ -625,14 +826,36 @@ pk_spawn_argv (PkSpawn *spawn, gchar **argv, gchar **envp,
 	}
 
 	/* sanity check */
-	if (spawn->priv->poll_id != 0) {
-		g_warning ("trying to set timeout when already set");
-		g_source_remove (spawn->priv->poll_id);
+	if (spawn->priv->poll_id != 0 ||
+	    spawn->priv->stdout_id != 0 ||
+	    spawn->priv->stderr_id != 0) {
+		g_warning ("trying to set watches when already set");
+		pk_spawn_remove_sources (spawn);
 	}
 
-	/* poll quickly */
-	spawn->priv->poll_id = g_timeout_add (PK_SPAWN_POLL_DELAY, (GSourceFunc) pk_spawn_check_child, spawn);
-	g_source_set_name_by_id (spawn->priv->poll_id, "[PkSpawn] main poll");
+	/* process output as soon as it arrives */
+	spawn->priv->stdout_id = g_unix_fd_add (spawn->priv->stdout_fd,
+						G_IO_IN | G_IO_HUP | G_IO_ERR,
+						pk_spawn_stdout_cb, spawn);
+	g_source_set_name_by_id (spawn->priv->stdout_id, "[PkSpawn] stdout");
+	spawn->priv->stderr_id = g_unix_fd_add (spawn->priv->stderr_fd,
+						G_IO_IN | G_IO_HUP | G_IO_ERR,
+						pk_spawn_stderr_cb, spawn);
+	g_source_set_name_by_id (spawn->priv->stderr_id, "[PkSpawn] stderr");
+
+	/* wake up when the child exits, we still reap it ourselves as
+	 * pk_spawn_exit() has to block until it is gone */
+	spawn->priv->pid_fd = pk_spawn_pid_fd_open (spawn->priv->child_pid);
+	if (spawn->priv->pid_fd != -1) {
+		spawn->priv->poll_id = g_unix_fd_add (spawn->priv->pid_fd, G_IO_IN,
+						      pk_spawn_pid_fd_cb, spawn);
+		g_source_set_name_by_id (spawn->priv->poll_id, "[PkSpawn] child exit");
+	} else {
+		/* no pidfd support, so poll quickly */
+		g_debug ("failed to open pidfd, polling: %s", g_strerror (errno));
+		spawn->priv->poll_id = g_timeout_add (PK_SPAWN_POLL_DELAY, (GSourceFunc) pk_spawn_check_child, spawn);
+		g_source_set_name_by_id (spawn->priv->poll_id, "[PkSpawn] main poll");
+	}
 out:
 	return ret;
 }
@@ -719,6 +942,11 @@ pk_spawn_class_init (PkSpawnClass *klass)
 			      G_TYPE_FROM_CLASS (object_class), G_SIGNAL_RUN_LAST,
 			      0, NULL, NULL, g_cclosure_marshal_VOID__STRING,
 			      G_TYPE_NONE, 1, G_TYPE_STRING);
+	signals [SIGNAL_STDOUT_FRAME] =
+		g_signal_new ("stdout-frame",
+			      G_TYPE_FROM_CLASS (object_class), G_SIGNAL_RUN_LAST,
+			      0, NULL, NULL, g_cclosure_marshal_VOID__BOXED,
+			      G_TYPE_NONE, 1, G_TYPE_BYTES);
 
 	g_type_class_add_private (klass, sizeof (PkSpawnPrivate));
 }
@@ -732,12 +960,17 @@ pk_spawn_init (PkSpawn *spawn)
 	spawn->priv->stdout_fd = -1;
 	spawn->priv->stderr_fd = -1;
 	spawn->priv->stdin_fd = -1;
+	spawn->priv->pid_fd = -1;
+	spawn->priv->stdout_id = 0;
+	spawn->priv->stderr_id = 0;
 	spawn->priv->poll_id = 0;
 	spawn->priv->kill_id = 0;
 	spawn->priv->finished = FALSE;
 	spawn->priv->is_sending_exit = FALSE;
 	spawn->priv->is_changing_dispatcher = FALSE;
 	spawn->priv->allow_sigkill = TRUE;
+	spawn->priv->framed = FALSE;
+	spawn->priv->protocol_error = FALSE;
 	spawn->priv->last_argv0 = NULL;
 	spawn->priv->last_envp = NULL;
 	spawn->priv->background = FALSE;
@@ -759,11 +992,8 @@ pk_spawn_finalize (GObject *object)
 
 	g_return_if_fail (spawn->priv != NULL);
 
-	/* disconnect the poll in case we were cancelled before completion */
-	if (spawn->priv->poll_id != 0) {
-		g_source_remove (spawn->priv->poll_id);
-		spawn->priv->poll_id = 0;
-	}
+	/* disconnect the watches in case we were cancelled before completion */
+	pk_spawn_remove_sources (spawn);
 
 	/* disconnect the SIGKILL check */
 	if (spawn->priv->kill_id != 0) {
@@ -39,6 +39,7 @@
 #include <packagekit-glib2/pk-enum.h>
 #include <packagekit-glib2/pk-results.h>
 #include <packagekit-glib2/pk-common.h>
+#include <packagekit-glib2/pk-package-id.h>
 
 #include "pk-shared.h"
 
@@ -48,7 +49,72 @@ static void     pk_transaction_db_finalize	(GObject        *object);
 
 #define PK_TRANSACTION_DB_GET_PRIVATE(o) (G_TYPE_INSTANCE_GET_PRIVATE ((o), PK_TYPE_TRANSACTION_DB, PkTransactionDbPrivate))
 
-G_DEFINE_AUTOPTR_CLEANUP_FUNC (sqlite3_stmt, sqlite3_finalize);
+/* the statements used for every transaction, prepared only once */
+typedef enum {
+	PK_TRANSACTION_DB_STATEMENT_ADD,
+	PK_TRANSACTION_DB_STATEMENT_GET_LIST,
+	PK_TRANSACTION_DB_STATEMENT_ACTION_TIME_SINCE,
+	PK_TRANSACTION_DB_STATEMENT_ACTION_TIME_RESET,
+	PK_TRANSACTION_DB_STATEMENT_SET_JOB_COUNT,
+	PK_TRANSACTION_DB_STATEMENT_GET_PROXY,
+	PK_TRANSACTION_DB_STATEMENT_UPDATE_PROXY,
+	PK_TRANSACTION_DB_STATEMENT_INSERT_PROXY,
+	PK_TRANSACTION_DB_STATEMENT_ADD_PACKAGE_EVENT,
+	PK_TRANSACTION_DB_STATEMENT_GET_PACKAGE_EVENTS,
+	PK_TRANSACTION_DB_STATEMENT_GET_PACKAGE_EVENTS_RECENT,
+	PK_TRANSACTION_DB_STATEMENT_LAST
+} PkTransactionDbStatementId;
+
+static const gchar *pk_transaction_db_statements[] = {
+	/* PK_TRANSACTION_DB_STATEMENT_ADD */
+	"INSERT OR REPLACE INTO transactions (transaction_id, timespec, succeeded, "
+	"duration, role, data, uid, cmdline, queue_time, first_result_time) "
+	"VALUES (?1, ?2, ?3, ?4, ?5, ?6, ?7, ?8, ?9, ?10)",
+	/* PK_TRANSACTION_DB_STATEMENT_GET_LIST, a negative limit is none */
+	"SELECT transaction_id, timespec, succeeded, duration, role, data, uid, cmdline, "
+	"queue_time, first_result_time "
+	"FROM transactions ORDER BY timespec DESC LIMIT ?1",
+	/* PK_TRANSACTION_DB_STATEMENT_ACTION_TIME_SINCE */
+	"SELECT timespec FROM last_action WHERE role = ?1",
+	/* PK_TRANSACTION_DB_STATEMENT_ACTION_TIME_RESET */
+	"INSERT OR REPLACE INTO last_action (role, timespec) VALUES (?1, ?2)",
+	/* PK_TRANSACTION_DB_STATEMENT_SET_JOB_COUNT */
+	"UPDATE config SET value = ?1 WHERE key = 'job_count'",
+	/* PK_TRANSACTION_DB_STATEMENT_GET_PROXY */
+	"SELECT proxy_http, proxy_https, proxy_ftp, proxy_socks, no_proxy, pac "
+	"FROM proxy WHERE uid = ?1 AND session = ?2 LIMIT 1",
+	/* PK_TRANSACTION_DB_STATEMENT_UPDATE_PROXY */
+	"UPDATE proxy SET proxy_http = ?1, proxy_https = ?2, proxy_ftp = ?3, "
+	"proxy_socks = ?4, no_proxy = ?5, pac = ?6 WHERE uid = ?7 AND session = ?8",
+	/* PK_TRANSACTION_DB_STATEMENT_INSERT_PROXY */
+	"INSERT INTO proxy (created, uid, session, proxy_http, proxy_https, "
+	"proxy_ftp, proxy_socks, no_proxy, pac) "
+	"VALUES (?1, ?2, ?3, ?4, ?5, ?6, ?7, ?8, ?9)",
+	/* PK_TRANSACTION_DB_STATEMENT_ADD_PACKAGE_EVENT, multiarch duplicates are ignored */
+	"INSERT OR IGNORE INTO package_events (name, tid, info, timestamp, package_id) "
+	"VALUES (?1, ?2, ?3, ?4, ?5)",
+	/* PK_TRANSACTION_DB_STATEMENT_GET_PACKAGE_EVENTS */
+	"SELECT e.package_id, e.info, e.timestamp, t.uid FROM package_events e "
+	"JOIN transactions t ON t.transaction_id = e.tid "
+	"WHERE e.name = ?1 ORDER BY e.timestamp, e.rowid",
+	/* PK_TRANSACTION_DB_STATEMENT_GET_PACKAGE_EVENTS_RECENT, only in the last ?2 transactions */
+	"SELECT e.package_id, e.info, e.timestamp, t.uid FROM package_events e "
+	"JOIN transactions t ON t.transaction_id = e.tid "
+	"WHERE e.name = ?1 AND e.tid IN (SELECT transaction_id FROM transactions "
+	"ORDER BY timespec DESC LIMIT ?2) ORDER BY e.timestamp, e.rowid",
+};
+
+/* a cached statement, which is only reset when going out of scope */
+typedef sqlite3_stmt PkTransactionDbStatement;
+
+static void
+pk_transaction_db_statement_reset (PkTransactionDbStatement *statement)
+{
+	sqlite3_reset (statement);
+	sqlite3_clear_bindings (statement);
+}
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (PkTransactionDbStatement, pk_transaction_db_statement_reset);
 
 struct PkTransactionDbPrivate
 {
@@ -56,76 +122,35 @@ struct PkTransactionDbPrivate
 	sqlite3			*db;
 	guint			 job_count;
 	guint			 database_save_id;
+	sqlite3_stmt		*statements[PK_TRANSACTION_DB_STATEMENT_LAST];
 };
 
 G_DEFINE_TYPE (PkTransactionDb, pk_transaction_db, G_TYPE_OBJECT)
 
-typedef struct {
-	gchar		*proxy_http;
-	gchar		*proxy_https;
-	gchar		*proxy_ftp;
-	gchar		*proxy_socks;
-	gchar		*no_proxy;
-	gchar		*pac;
-	gboolean	set;
-} PkTransactionDbProxyItem;
-
-static gint
-pk_transaction_db_add_transaction_cb (void *data,
-				      gint argc,
-				      gchar **argv,
-				      gchar **col_name)
+static PkTransactionPast *
+pk_transaction_db_past_from_row (sqlite3_stmt *statement)
 {
 	PkTransactionPast *item;
-	GList **list = (GList **) data;
-	gint i;
-	gchar *col;
-	gchar *value;
-	guint temp;
+	const gchar *value;
 
 	item = pk_transaction_past_new ();
-	for (i = 0; i < argc; i++) {
-		col = col_name[i];
-		value = argv[i];
-		if (g_strcmp0 (col, "succeeded") == 0) {
-			if (!pk_strtouint (value, &temp)) {
-				g_warning ("failed to parse succeeded: %s", value);
-				continue;
-			}
-			if (temp == 1)
-				g_object_set (item, "succeeded", TRUE, NULL);
-			else
-				g_object_set (item, "succeeded", FALSE, NULL);
-		} else if (g_strcmp0 (col, "role") == 0) {
-			if (value != NULL)
-				g_object_set (item, "role", pk_role_enum_from_string (value), NULL);
-		} else if (g_strcmp0 (col, "transaction_id") == 0) {
-			if (value != NULL)
-				g_object_set (item, "tid", value, NULL);
-		} else if (g_strcmp0 (col, "timespec") == 0) {
-			if (value != NULL)
-				g_object_set (item, "timespec", value, NULL);
-		} else if (g_strcmp0 (col, "cmdline") == 0) {
-			if (value != NULL)
-				g_object_set (item, "cmdline", value, NULL);
-		} else if (g_strcmp0 (col, "data") == 0) {
-			if (value != NULL)
-				g_object_set (item, "data", value, NULL);
-		} else if (g_strcmp0 (col, "uid") == 0) {
-			if (pk_strtouint (value, &temp))
-				g_object_set (item, "uid", temp, NULL);
-		} else if (g_strcmp0 (col, "duration") == 0) {
-			if (pk_strtouint (value, &temp))
-				g_object_set (item, "duration", temp, NULL);
-		} else {
-			g_warning ("%s = %s", col, value);
-		}
-	}
-
-	/* add to start of the list */
-	*list = g_list_prepend (*list, item);
-
-	return 0;
+	g_object_set (item,
+		      "tid", sqlite3_column_text (statement, 0),
+		      "timespec", sqlite3_column_text (statement, 1),
+		      "succeeded", sqlite3_column_int (statement, 2) == 1,
+		      "duration", (guint) sqlite3_column_int (statement, 3),
+		      "uid", (guint) sqlite3_column_int (statement, 6),
+		      "cmdline", sqlite3_column_text (statement, 7),
+		      "queue-time", (guint) sqlite3_column_int (statement, 8),
+		      "first-result-time", (guint) sqlite3_column_int (statement, 9),
+		      NULL);
+	value = (const gchar *) sqlite3_column_text (statement, 4);
+	if (value != NULL)
+		g_object_set (item, "role", pk_role_enum_from_string (value), NULL);
+	value = (const gchar *) sqlite3_column_text (statement, 5);
+	if (value != NULL)
+		g_object_set (item, "data", value, NULL);
+	return item;
 }
 
 static gboolean
@@ -147,25 +172,6 @@ pk_transaction_db_sql_statement (PkTransactionDb *tdb, const gchar *sql)
 	return TRUE;
 }
 
-static gint
-pk_time_action_sqlite_callback (void *data, gint argc, gchar **argv, gchar **col_name)
-{
-	gint i;
-	gchar *col;
-	gchar *value;
-	gchar **timespec = (gchar**) data;
-
-	for (i = 0; i < argc; i++) {
-		col = col_name[i];
-		value = argv[i];
-		if (g_strcmp0 (col, "timespec") == 0)
-			*timespec = g_strdup (value);
-		else
-			g_warning ("%s = %s", col, value);
-	}
-	return 0;
-}
-
 /**
  * pk_transaction_db_iso8601_difference:
  * @isodate: The ISO8601 date to compare
@@ -196,111 +202,14 @@ pk_transaction_db_iso8601_difference (const gchar *isodate)
 	return time_s;
 }
 
-guint
-pk_transaction_db_action_time_since (PkTransactionDb *tdb, PkRoleEnum role)
-{
-	gchar *error_msg = NULL;
-	gint rc;
-	const gchar *role_text;
-	g_autofree gchar *statement = NULL;
-	g_autofree gchar *timespec = NULL;
-
-	g_return_val_if_fail (PK_IS_TRANSACTION_DB (tdb), 0);
-	g_return_val_if_fail (tdb->priv->db != NULL, 0);
-
-	role_text = pk_role_enum_to_string (role);
-
-	statement = g_strdup_printf ("SELECT timespec FROM last_action WHERE role = '%s'", role_text);
-	rc = sqlite3_exec (tdb->priv->db, statement,
-			   pk_time_action_sqlite_callback, &timespec, &error_msg);
-	if (rc != SQLITE_OK) {
-		g_warning ("SQL error: %s", error_msg);
-		sqlite3_free (error_msg);
-		return G_MAXUINT;
-	}
-	if (timespec == NULL)
-		return G_MAXUINT;
-
-	/* work out the difference */
-	return pk_transaction_db_iso8601_difference (timespec);
-}
-
-gboolean
-pk_transaction_db_action_time_reset (PkTransactionDb *tdb, PkRoleEnum role)
-{
-	gchar *error_msg = NULL;
-	gint rc;
-	const gchar *role_text;
-	guint since;
-	g_autofree gchar *statement = NULL;
-	g_autofree gchar *timespec = NULL;
-
-	g_return_val_if_fail (PK_IS_TRANSACTION_DB (tdb), FALSE);
-	g_return_val_if_fail (tdb->priv->db != NULL, FALSE);
-
-	timespec = pk_iso8601_present ();
-	role_text = pk_role_enum_to_string (role);
-
-	/* get the previous entry */
-	since = pk_transaction_db_action_time_since (tdb, role);
-	if (since == G_MAXUINT) {
-		statement = g_strdup_printf ("INSERT INTO last_action (role, timespec) VALUES ('%s', '%s')", role_text, timespec);
-	} else {
-		statement = g_strdup_printf ("UPDATE last_action SET timespec = '%s' WHERE role = '%s'", timespec, role_text);
-	}
-
-	/* update or insert the entry */
-	rc = sqlite3_exec (tdb->priv->db, statement, NULL, NULL, &error_msg);
-	if (rc != SQLITE_OK) {
-		g_warning ("SQL error: %s", error_msg);
-		sqlite3_free (error_msg);
-		return FALSE;
-	}
-	return TRUE;
-}
-
-GList *
-pk_transaction_db_get_list (PkTransactionDb *tdb, guint limit)
-{
-	gchar *error_msg = NULL;
-	gint rc;
-	GList *list = NULL;
-	g_autofree gchar *statement = NULL;
-
-	g_return_val_if_fail (PK_IS_TRANSACTION_DB (tdb), NULL);
-
-	if (limit == 0) {
-		statement = g_strdup ("SELECT transaction_id, timespec, succeeded, duration, role, data, uid, cmdline "
-				      "FROM transactions ORDER BY timespec DESC");
-	} else {
-		statement = g_strdup_printf ("SELECT transaction_id, timespec, succeeded, duration, role, data, uid, cmdline "
-					     "FROM transactions ORDER BY timespec DESC LIMIT %i", limit);
-	}
-	rc = sqlite3_exec (tdb->priv->db,
-			   statement,
-			   pk_transaction_db_add_transaction_cb,
-			   &list,
-			   &error_msg);
-	if (rc != SQLITE_OK) {
-		g_warning ("SQL error: %s", error_msg);
-		sqlite3_free (error_msg);
-		goto out;
-	}
-out:
-	return list;
-}
-
 static gboolean
 pk_transaction_db_prepare (PkTransactionDb *tdb, const gchar *sql, sqlite3_stmt **statement)
 {
 	gint rc = 0;
 	*statement = NULL;
 
-	if ((rc = sqlite3_prepare_v2 (tdb->priv->db,
-				      sql,
-				      -1,
-				      statement,
-				      NULL) != SQLITE_OK)) {
+	rc = sqlite3_prepare_v2 (tdb->priv->db, sql, -1, statement, NULL);
+	if (rc != SQLITE_OK) {
 		g_warning ("(%s) prepare error: %d: %s", sql, rc, sqlite3_errmsg (tdb->priv->db));
 		return FALSE;
 	}
@@ -308,6 +217,23 @@ pk_transaction_db_prepare (PkTransactionDb *tdb, const gchar *sql, sqlite3_stmt
 	return TRUE;
 }
 
+/**
+ * pk_transaction_db_get_statement:
+ *
+ * Return value: the cached statement @id, prepared on first use, which has
+ * to be reset after use with g_autoptr(PkTransactionDbStatement)
+ **/
+static PkTransactionDbStatement *
+pk_transaction_db_get_statement (PkTransactionDb *tdb, PkTransactionDbStatementId id)
+{
+	sqlite3_stmt **statement = &tdb->priv->statements[id];
+
+	if (*statement == NULL &&
+	    !pk_transaction_db_prepare (tdb, pk_transaction_db_statements[id], statement))
+		return NULL;
+	return *statement;
+}
+
 static gboolean
 pk_transaction_db_step (sqlite3 *db, sqlite3_stmt *statement)
 {
@@ -323,132 +249,244 @@ pk_transaction_db_step (sqlite3 *db, sqlite3_stmt *statement)
 	return TRUE;
 }
 
-static gboolean
-pk_transaction_db_set_strings (PkTransactionDb *tdb, const gchar *sql, const gchar *first, const gchar *second)
+guint
+pk_transaction_db_action_time_since (PkTransactionDb *tdb, PkRoleEnum role)
 {
-	g_autoptr (sqlite3_stmt) statement = NULL;
-	gint rc = 0;
-
-	g_return_val_if_fail (PK_IS_TRANSACTION_DB (tdb), FALSE);
-	g_return_val_if_fail (tdb->priv->db != NULL, FALSE);
-	g_return_val_if_fail (sql != NULL, FALSE);
-	g_return_val_if_fail (first != NULL, FALSE);
-	g_return_val_if_fail (second != NULL, FALSE);
-
-	if (!pk_transaction_db_prepare (tdb, sql, &statement))
-		return FALSE;
+	gint rc;
+	g_autoptr(PkTransactionDbStatement) statement = NULL;
 
-	if ((rc = sqlite3_bind_text (statement, 1, first, -1, SQLITE_STATIC)) != SQLITE_OK) {
-		g_warning ("bind text1 error: %d: %s", rc, sqlite3_errmsg (tdb->priv->db));
-		return FALSE;
-	}
+	g_return_val_if_fail (PK_IS_TRANSACTION_DB (tdb), 0);
+	g_return_val_if_fail (tdb->priv->db != NULL, 0);
 
-	if ((rc = sqlite3_bind_text (statement, 2, second, -1, SQLITE_STATIC)) != SQLITE_OK) {
-		g_warning ("bind text2 error: %d: %s", rc, sqlite3_errmsg (tdb->priv->db));
-		return FALSE;
+	statement = pk_transaction_db_get_statement (tdb, PK_TRANSACTION_DB_STATEMENT_ACTION_TIME_SINCE);
+	if (statement == NULL)
+		return G_MAXUINT;
+	sqlite3_bind_text (statement, 1, pk_role_enum_to_string (role), -1, SQLITE_STATIC);
+	rc = sqlite3_step (statement);
+	if (rc == SQLITE_DONE)
+		return G_MAXUINT;
+	if (rc != SQLITE_ROW) {
+		g_warning ("SQL error: %s", sqlite3_errmsg (tdb->priv->db));
+		return G_MAXUINT;
 	}
+	if (sqlite3_column_text (statement, 0) == NULL)
+		return G_MAXUINT;
 
-	return pk_transaction_db_step (tdb->priv->db, statement);
+	/* work out the difference */
+	return pk_transaction_db_iso8601_difference ((const gchar *) sqlite3_column_text (statement, 0));
 }
 
 gboolean
-pk_transaction_db_add (PkTransactionDb *tdb, const gchar *tid)
+pk_transaction_db_action_time_reset (PkTransactionDb *tdb, PkRoleEnum role)
 {
+	g_autoptr(PkTransactionDbStatement) statement = NULL;
 	g_autofree gchar *timespec = NULL;
+
+	g_return_val_if_fail (PK_IS_TRANSACTION_DB (tdb), FALSE);
+	g_return_val_if_fail (tdb->priv->db != NULL, FALSE);
+
 	timespec = pk_iso8601_present ();
 
-	return pk_transaction_db_set_strings (tdb,
-					      "INSERT INTO transactions (transaction_id, timespec) VALUES (?1, ?2)",
-					      tid,
-					      timespec);
+	/* update or insert the entry */
+	statement = pk_transaction_db_get_statement (tdb, PK_TRANSACTION_DB_STATEMENT_ACTION_TIME_RESET);
+	if (statement == NULL)
+		return FALSE;
+	sqlite3_bind_text (statement, 1, pk_role_enum_to_string (role), -1, SQLITE_STATIC);
+	sqlite3_bind_text (statement, 2, timespec, -1, SQLITE_STATIC);
+	return pk_transaction_db_step (tdb->priv->db, statement);
 }
 
-gboolean
-pk_transaction_db_set_role (PkTransactionDb *tdb, const gchar *tid, PkRoleEnum role)
+GList *
+pk_transaction_db_get_list (PkTransactionDb *tdb, guint limit)
 {
-	const gchar *role_text;
-	role_text = pk_role_enum_to_string (role);
+	gint rc;
+	GList *list = NULL;
+	g_autoptr(PkTransactionDbStatement) statement = NULL;
+
+	g_return_val_if_fail (PK_IS_TRANSACTION_DB (tdb), NULL);
 
-	return pk_transaction_db_set_strings (tdb,
-					      "UPDATE transactions SET role=?1 WHERE transaction_id=?2",
-					      role_text,
-					      tid);
+	statement = pk_transaction_db_get_statement (tdb, PK_TRANSACTION_DB_STATEMENT_GET_LIST);
+	if (statement == NULL)
+		return NULL;
+	sqlite3_bind_int64 (statement, 1, limit == 0 ? -1 : (sqlite3_int64) limit);
+
+	/* add to start of the list, so the oldest comes first */
+	while ((rc = sqlite3_step (statement)) == SQLITE_ROW)
+		list = g_list_prepend (list, pk_transaction_db_past_from_row (statement));
+	if (rc != SQLITE_DONE)
+		g_warning ("SQL error: %s", sqlite3_errmsg (tdb->priv->db));
+	return list;
 }
 
-gboolean
-pk_transaction_db_set_uid (PkTransactionDb *tdb, const gchar *tid, guint uid)
+/**
+ * pk_transaction_db_add_package_events:
+ *
+ * Splits the package list saved with a successful transaction into rows
+ * keyed by package name, so GetPackageHistory does not have to parse every
+ * transaction ever run.
+ **/
+static gboolean
+pk_transaction_db_add_package_events (PkTransactionDb *tdb, PkTransactionPast *item)
 {
-	g_autoptr (sqlite3_stmt) statement = NULL;
-	gint rc = 0;
+	const gchar *data;
+	gint64 timestamp;
+	guint i;
+	g_auto(GStrv) lines = NULL;
 
-	g_return_val_if_fail (PK_IS_TRANSACTION_DB (tdb), FALSE);
-	g_return_val_if_fail (tdb->priv->db != NULL, FALSE);
-	g_return_val_if_fail (tid != NULL, FALSE);
+	/* transactions without a timestamp are not interesting */
+	data = pk_transaction_past_get_data (item);
+	if (data == NULL)
+		return TRUE;
+	timestamp = pk_transaction_past_get_timestamp (item);
+	if (timestamp == 0)
+		return TRUE;
 
-	if (!pk_transaction_db_prepare (tdb, "UPDATE transactions SET uid=?1 WHERE transaction_id=?2", &statement))
-		return FALSE;
+	lines = g_strsplit (data, "\n", -1);
+	for (i = 0; lines[i] != NULL; i++) {
+		PkInfoEnum info;
+		g_auto(GStrv) sections = NULL;
+		g_auto(GStrv) split = NULL;
+		g_autoptr(PkTransactionDbStatement) statement = NULL;
+
+		sections = g_strsplit (lines[i], "\t", 3);
+		if (g_strv_length (sections) != 3) {
+			g_warning ("failed to parse package: '%s'", lines[i]);
+			continue;
+		}
+		split = pk_package_id_split (sections[1]);
+		if (split == NULL) {
+			g_warning ("failed to parse package: '%s'", lines[i]);
+			continue;
+		}
 
-	if ((rc = sqlite3_bind_int (statement, 1, uid)) != SQLITE_OK) {
-		g_warning ("bind int error: %d: %s", rc, sqlite3_errmsg (tdb->priv->db));
-		return FALSE;
-	}
+		/* not a state we care about */
+		info = pk_info_enum_from_string (sections[0]);
+		if (info != PK_INFO_ENUM_INSTALLING &&
+		    info != PK_INFO_ENUM_REMOVING &&
+		    info != PK_INFO_ENUM_UPDATING)
+			continue;
 
-	if ((rc = sqlite3_bind_text (statement, 2, tid, -1, SQLITE_STATIC)) != SQLITE_OK) {
-		g_warning ("bind text error: %d: %s", rc, sqlite3_errmsg (tdb->priv->db));
-		return FALSE;
+		statement = pk_transaction_db_get_statement (tdb, PK_TRANSACTION_DB_STATEMENT_ADD_PACKAGE_EVENT);
+		if (statement == NULL)
+			return FALSE;
+		sqlite3_bind_text (statement, 1, split[PK_PACKAGE_ID_NAME], -1, SQLITE_STATIC);
+		sqlite3_bind_text (statement, 2, pk_transaction_past_get_id (item), -1, SQLITE_STATIC);
+		sqlite3_bind_int (statement, 3, info);
+		sqlite3_bind_int64 (statement, 4, timestamp);
+		sqlite3_bind_text (statement, 5, sections[1], -1, SQLITE_STATIC);
+		if (!pk_transaction_db_step (tdb->priv->db, statement))
+			return FALSE;
 	}
-
-	return pk_transaction_db_step (tdb->priv->db, statement);
-}
-
-gboolean
-pk_transaction_db_set_cmdline (PkTransactionDb *tdb, const gchar *tid, const gchar *cmdline)
-{
-	return pk_transaction_db_set_strings (tdb,
-					      "UPDATE transactions SET cmdline=?1 WHERE transaction_id=?2",
-					      cmdline,
-					      tid);
-}
-
-gboolean
-pk_transaction_db_set_data (PkTransactionDb *tdb, const gchar *tid, const gchar *data)
-{
-	return pk_transaction_db_set_strings (tdb,
-					      "UPDATE transactions SET data=?1 WHERE transaction_id=?2",
-					      data,
-					      tid);
+	return TRUE;
 }
 
+/**
+ * pk_transaction_db_add:
+ * @tdb: the #PkTransactionDb instance
+ * @item: a finished transaction
+ *
+ * Saves everything about the transaction with a single write.
+ *
+ * Return value: %TRUE for success
+ **/
 gboolean
-pk_transaction_db_set_finished (PkTransactionDb *tdb, const gchar *tid, gboolean success, guint runtime)
+pk_transaction_db_add (PkTransactionDb *tdb, PkTransactionPast *item)
 {
-	g_autoptr (sqlite3_stmt) statement = NULL;
-	gint rc = 0;
+	gboolean ret;
+	g_autoptr(PkTransactionDbStatement) statement = NULL;
 
 	g_return_val_if_fail (PK_IS_TRANSACTION_DB (tdb), FALSE);
 	g_return_val_if_fail (tdb->priv->db != NULL, FALSE);
-	g_return_val_if_fail (tid != NULL, FALSE);
+	g_return_val_if_fail (pk_transaction_past_get_id (item) != NULL, FALSE);
 
-	if (!pk_transaction_db_prepare (tdb, "UPDATE transactions SET succeeded=?1, duration=?2 WHERE transaction_id=?3",
-					&statement))
+	statement = pk_transaction_db_get_statement (tdb, PK_TRANSACTION_DB_STATEMENT_ADD);
+	if (statement == NULL)
 		return FALSE;
-
-	if ((rc = sqlite3_bind_int (statement, 1, success)) != SQLITE_OK) {
-		g_warning ("bind int1 error: %d: %s", rc, sqlite3_errmsg (tdb->priv->db));
+	sqlite3_bind_text (statement, 1, pk_transaction_past_get_id (item), -1, SQLITE_STATIC);
+	sqlite3_bind_text (statement, 2, pk_transaction_past_get_timespec (item), -1, SQLITE_STATIC);
+	sqlite3_bind_int (statement, 3, pk_transaction_past_get_succeeded (item));
+	sqlite3_bind_int (statement, 4, pk_transaction_past_get_duration (item));
+	sqlite3_bind_text (statement, 5, pk_role_enum_to_string (pk_transaction_past_get_role (item)), -1, SQLITE_STATIC);
+	sqlite3_bind_text (statement, 6, pk_transaction_past_get_data (item), -1, SQLITE_STATIC);
+	sqlite3_bind_int (statement, 7, pk_transaction_past_get_uid (item));
+	sqlite3_bind_text (statement, 8, pk_transaction_past_get_cmdline (item), -1, SQLITE_STATIC);
+	sqlite3_bind_int (statement, 9, pk_transaction_past_get_queue_time (item));
+	sqlite3_bind_int (statement, 10, pk_transaction_past_get_first_result_time (item));
+
+	/* the history only includes what actually happened */
+	if (!pk_transaction_db_sql_statement (tdb, "BEGIN"))
 		return FALSE;
-	}
+	ret = pk_transaction_db_step (tdb->priv->db, statement);
+	if (ret && pk_transaction_past_get_succeeded (item))
+		ret = pk_transaction_db_add_package_events (tdb, item);
+	if (ret)
+		ret = pk_transaction_db_sql_statement (tdb, "COMMIT");
+	if (!ret)
+		pk_transaction_db_sql_statement (tdb, "ROLLBACK");
+	return ret;
+}
 
-	if ((rc = sqlite3_bind_int (statement, 2, runtime)) != SQLITE_OK) {
-		g_warning ("bind int2 error: %d: %s", rc, sqlite3_errmsg (tdb->priv->db));
-		return FALSE;
-	}
+/**
+ * pk_transaction_db_get_package_history:
+ * @tdb: the #PkTransactionDb instance
+ * @name: a package name, e.g. "colord"
+ * @limit: only look at this many of the latest transactions, or 0 for all
+ *
+ * Gets the history of a package, oldest first.
+ *
+ * Return value: a floating #GVariant of type aa{sv}, or %NULL if the
+ * package has no history
+ **/
+GVariant *
+pk_transaction_db_get_package_history (PkTransactionDb *tdb, const gchar *name, guint limit)
+{
+	gint rc;
+	gboolean found = FALSE;
+	GVariantBuilder builder;
+	g_autoptr(PkTransactionDbStatement) statement = NULL;
 
-	if ((rc = sqlite3_bind_text (statement, 3, tid, -1, SQLITE_STATIC)) != SQLITE_OK) {
-		g_warning ("bind text error: %d: %s", rc, sqlite3_errmsg (tdb->priv->db));
-		return FALSE;
-	}
+	g_return_val_if_fail (PK_IS_TRANSACTION_DB (tdb), NULL);
+	g_return_val_if_fail (tdb->priv->db != NULL, NULL);
 
-	return pk_transaction_db_step (tdb->priv->db, statement);
+	if (limit == 0) {
+		statement = pk_transaction_db_get_statement (tdb, PK_TRANSACTION_DB_STATEMENT_GET_PACKAGE_EVENTS);
+	} else {
+		statement = pk_transaction_db_get_statement (tdb, PK_TRANSACTION_DB_STATEMENT_GET_PACKAGE_EVENTS_RECENT);
+		if (statement != NULL)
+			sqlite3_bind_int64 (statement, 2, limit);
+	}
+	if (statement == NULL)
+		return NULL;
+	sqlite3_bind_text (statement, 1, name, -1, SQLITE_STATIC);
+
+	g_variant_builder_init (&builder, G_VARIANT_TYPE ("aa{sv}"));
+	while ((rc = sqlite3_step (statement)) == SQLITE_ROW) {
+		g_auto(GStrv) split = NULL;
+
+		split = pk_package_id_split ((const gchar *) sqlite3_column_text (statement, 0));
+		if (split == NULL)
+			continue;
+		g_variant_builder_open (&builder, G_VARIANT_TYPE ("a{sv}"));
+		g_variant_builder_add (&builder, "{sv}", "info",
+				       g_variant_new_uint32 (sqlite3_column_int (statement, 1)));
+		g_variant_builder_add (&builder, "{sv}", "source",
+				       g_variant_new_string (split[PK_PACKAGE_ID_DATA]));
+		g_variant_builder_add (&builder, "{sv}", "version",
+				       g_variant_new_string (split[PK_PACKAGE_ID_VERSION]));
+		g_variant_builder_add (&builder, "{sv}", "timestamp",
+				       g_variant_new_uint64 (sqlite3_column_int64 (statement, 2)));
+		g_variant_builder_add (&builder, "{sv}", "user-id",
+				       g_variant_new_uint32 (sqlite3_column_int (statement, 3)));
+		g_variant_builder_close (&builder);
+		found = TRUE;
+	}
+	if (rc != SQLITE_DONE)
+		g_warning ("SQL error: %s", sqlite3_errmsg (tdb->priv->db));
+	if (!found) {
+		g_variant_builder_clear (&builder);
+		return NULL;
+	}
+	return g_variant_builder_end (&builder);
 }
 
 gboolean
@@ -513,9 +551,8 @@ pk_transaction_db_get_random_hex_string (guint length)
 static gboolean
 pk_transaction_db_defer_write_job_count_cb (PkTransactionDb *tdb)
 {
-	gchar *error_msg = NULL;
 	gint rc;
-	g_autofree gchar *statement = NULL;
+	g_autoptr(PkTransactionDbStatement) statement = NULL;
 
 	/* not loaded! */
 	if (tdb->priv->db == NULL) {
@@ -523,21 +560,22 @@ pk_transaction_db_defer_write_job_count_cb (PkTransactionDb *tdb)
 		goto out;
 	}
 
-	/* force fsync as we don't want to repeat this number */
-	sqlite3_exec (tdb->priv->db, "PRAGMA synchronous=ON", NULL, NULL, NULL);
-
 	/* save the job count */
-	statement = g_strdup_printf ("UPDATE config SET value = '%i' WHERE key = 'job_count'",
-				     tdb->priv->job_count);
-	rc = sqlite3_exec (tdb->priv->db, statement, NULL, NULL, &error_msg);
-	if (rc != SQLITE_OK) {
-		g_warning ("failed to set job id: %s", error_msg);
-		sqlite3_free (error_msg);
+	statement = pk_transaction_db_get_statement (tdb, PK_TRANSACTION_DB_STATEMENT_SET_JOB_COUNT);
+	if (statement == NULL)
+		goto out;
+	sqlite3_bind_int (statement, 1, tdb->priv->job_count);
+	if (!pk_transaction_db_step (tdb->priv->db, statement)) {
+		g_warning ("failed to set job id");
 		goto out;
 	}
 
-	/* turn off fsync */
-	sqlite3_exec (tdb->priv->db, "PRAGMA synchronous=OFF", NULL, NULL, NULL);
+	/* force fsync as we don't want to repeat this number, commits to
+	 * the write-ahead log are not synced on their own */
+	rc = sqlite3_wal_checkpoint_v2 (tdb->priv->db, NULL,
+					SQLITE_CHECKPOINT_PASSIVE, NULL, NULL);
+	if (rc != SQLITE_OK)
+		g_warning ("failed to checkpoint: %s", sqlite3_errmsg (tdb->priv->db));
 out:
 	tdb->priv->database_save_id = 0;
 	return FALSE;
@@ -568,87 +606,6 @@ pk_transaction_db_generate_id (PkTransactionDb *tdb)
 	return tid;
 }
 
-static gint
-pk_transaction_sqlite_proxy_cb (void *data, gint argc, gchar **argv, gchar **col_name)
-{
-	PkTransactionDbProxyItem *item = (PkTransactionDbProxyItem *) data;
-	gint i;
-
-	g_return_val_if_fail (item != NULL, 0);
-
-	for (i = 0; i < argc; i++) {
-		if (g_strcmp0 (col_name[i], "proxy_http") == 0) {
-			item->proxy_http = g_strdup (argv[i]);
-			item->set = TRUE;
-		} else if (g_strcmp0 (col_name[i], "proxy_https") == 0) {
-			item->proxy_https = g_strdup (argv[i]);
-			item->set = TRUE;
-		} else if (g_strcmp0 (col_name[i], "proxy_ftp") == 0) {
-			item->proxy_ftp = g_strdup (argv[i]);
-			item->set = TRUE;
-		} else if (g_strcmp0 (col_name[i], "proxy_socks") == 0) {
-			item->proxy_socks = g_strdup (argv[i]);
-			item->set = TRUE;
-		} else if (g_strcmp0 (col_name[i], "no_proxy") == 0) {
-			item->no_proxy = g_strdup (argv[i]);
-			item->set = TRUE;
-		} else if (g_strcmp0 (col_name[i], "pac") == 0) {
-			item->pac = g_strdup (argv[i]);
-			item->set = TRUE;
-		} else {
-			g_warning ("%s = %s", col_name[i], argv[i]);
-		}
-	}
-	return 0;
-}
-
-static void
-pk_transaction_db_proxy_item_free (PkTransactionDbProxyItem *item)
-{
-	if (item == NULL)
-		return;
-	g_free (item->proxy_http);
-	g_free (item->proxy_https);
-	g_free (item->proxy_ftp);
-	g_free (item->proxy_socks);
-	g_free (item->no_proxy);
-	g_free (item->pac);
-	g_free (item);
-}
-
-static gboolean
-pk_transaction_db_is_proxy_set (PkTransactionDb *tdb, guint uid, const gchar *session)
-{
-	gchar *error_msg = NULL;
-	gboolean ret = FALSE;
-	gint rc;
-	PkTransactionDbProxyItem *item;
-	g_autofree gchar *statement = NULL;
-
-	g_return_val_if_fail (PK_IS_TRANSACTION_DB (tdb), FALSE);
-	g_return_val_if_fail (uid != G_MAXUINT, FALSE);
-
-	/* get existing data */
-	item = g_new0 (PkTransactionDbProxyItem, 1);
-	statement = g_strdup_printf ("SELECT proxy_http, proxy_https, proxy_ftp, proxy_socks, no_proxy, pac FROM proxy WHERE uid = '%i' AND session = '%s' LIMIT 1",
-				     uid, session);
-	rc = sqlite3_exec (tdb->priv->db, statement,
-			   pk_transaction_sqlite_proxy_cb,
-			   item,
-			   &error_msg);
-	if (rc != SQLITE_OK) {
-		g_warning ("SQL error: %s", error_msg);
-		sqlite3_free (error_msg);
-		goto out;
-	}
-
-	ret = item->set;
-
-out:
-	pk_transaction_db_proxy_item_free (item);
-	return ret;
-}
-
 /**
  * pk_transaction_db_get_proxy:
  * @tdb: the #PkTransactionDb instance
@@ -670,53 +627,42 @@ pk_transaction_db_get_proxy (PkTransactionDb *tdb, guint uid, const gchar *sessi
 			     gchar **no_proxy,
 			     gchar **pac)
 {
-	gchar *error_msg = NULL;
-	gboolean ret = FALSE;
 	gint rc;
-	PkTransactionDbProxyItem *item;
-	g_autofree gchar *statement = NULL;
+	g_autoptr(PkTransactionDbStatement) statement = NULL;
 
 	g_return_val_if_fail (PK_IS_TRANSACTION_DB (tdb), FALSE);
 	g_return_val_if_fail (uid != G_MAXUINT, FALSE);
 
 	/* get existing data */
-	item = g_new0 (PkTransactionDbProxyItem, 1);
-	statement = g_strdup_printf ("SELECT proxy_http, proxy_https, proxy_ftp, proxy_socks, no_proxy, pac FROM proxy WHERE uid = '%i' AND session = '%s' LIMIT 1",
-				     uid, session);
-	rc = sqlite3_exec (tdb->priv->db, statement,
-			   pk_transaction_sqlite_proxy_cb,
-			   item,
-			   &error_msg);
-	if (rc != SQLITE_OK) {
-		g_warning ("SQL error: %s", error_msg);
-		sqlite3_free (error_msg);
-		goto out;
-	}
+	statement = pk_transaction_db_get_statement (tdb, PK_TRANSACTION_DB_STATEMENT_GET_PROXY);
+	if (statement == NULL)
+		return FALSE;
+	sqlite3_bind_int (statement, 1, uid);
+	sqlite3_bind_text (statement, 2, session, -1, SQLITE_STATIC);
+	rc = sqlite3_step (statement);
 
 	/* success, even if we got no data */
-	ret = TRUE;
-
-	/* nothing matched */
-	if (!item->set)
-		goto out;
+	if (rc == SQLITE_DONE)
+		return TRUE;
+	if (rc != SQLITE_ROW) {
+		g_warning ("SQL error: %s", sqlite3_errmsg (tdb->priv->db));
+		return FALSE;
+	}
 
 	/* copy data */
 	if (proxy_http != NULL)
-		*proxy_http = g_strdup (item->proxy_http);
+		*proxy_http = g_strdup ((const gchar *) sqlite3_column_text (statement, 0));
 	if (proxy_https != NULL)
-		*proxy_https = g_strdup (item->proxy_https);
+		*proxy_https = g_strdup ((const gchar *) sqlite3_column_text (statement, 1));
 	if (proxy_ftp != NULL)
-		*proxy_ftp = g_strdup (item->proxy_ftp);
+		*proxy_ftp = g_strdup ((const gchar *) sqlite3_column_text (statement, 2));
 	if (proxy_socks != NULL)
-		*proxy_socks = g_strdup (item->proxy_socks);
+		*proxy_socks = g_strdup ((const gchar *) sqlite3_column_text (statement, 3));
 	if (no_proxy != NULL)
-		*no_proxy = g_strdup (item->no_proxy);
+		*no_proxy = g_strdup ((const gchar *) sqlite3_column_text (statement, 4));
 	if (pac != NULL)
-		*pac = g_strdup (item->pac);
-
-out:
-	pk_transaction_db_proxy_item_free (item);
-	return ret;
+		*pac = g_strdup ((const gchar *) sqlite3_column_text (statement, 5));
+	return TRUE;
 }
 
 /**
@@ -741,77 +687,42 @@ pk_transaction_db_set_proxy (PkTransactionDb *tdb, guint uid,
 			     const gchar *no_proxy,
 			     const gchar *pac)
 {
-	gboolean ret = FALSE;
-	gint rc;
-	sqlite3_stmt *statement = NULL;
+	gboolean ret;
+	g_autoptr(PkTransactionDbStatement) statement = NULL;
 	g_autofree gchar *timespec = NULL;
-	g_autofree gchar *proxy_http_tmp = NULL;
 
 	g_return_val_if_fail (PK_IS_TRANSACTION_DB (tdb), FALSE);
 	g_return_val_if_fail (uid != G_MAXUINT, FALSE);
 
-	/* check for previous entries */
-	ret = pk_transaction_db_is_proxy_set (tdb, uid, session);
-	if (ret) {
+	/* update any previous entry */
+	statement = pk_transaction_db_get_statement (tdb, PK_TRANSACTION_DB_STATEMENT_UPDATE_PROXY);
+	if (statement == NULL)
+		return FALSE;
+
+	/* bind data, so that the freeform proxy text cannot be used to inject SQL */
+	sqlite3_bind_text (statement, 1, proxy_http, -1, SQLITE_STATIC);
+	sqlite3_bind_text (statement, 2, proxy_https, -1, SQLITE_STATIC);
+	sqlite3_bind_text (statement, 3, proxy_ftp, -1, SQLITE_STATIC);
+	sqlite3_bind_text (statement, 4, proxy_socks, -1, SQLITE_STATIC);
+	sqlite3_bind_text (statement, 5, no_proxy, -1, SQLITE_STATIC);
+	sqlite3_bind_text (statement, 6, pac, -1, SQLITE_STATIC);
+	sqlite3_bind_int (statement, 7, uid);
+	sqlite3_bind_text (statement, 8, session, -1, SQLITE_STATIC);
+	if (!pk_transaction_db_step (tdb->priv->db, statement))
+		return FALSE;
+	if (sqlite3_changes (tdb->priv->db) > 0) {
 		g_debug ("updated proxy %s, %s for uid:%i and session:%s",
 			 proxy_http, proxy_ftp, uid, session);
-
-		/* prepare statement */
-		rc = sqlite3_prepare_v2 (tdb->priv->db,
-					 "UPDATE proxy SET "
-					 "proxy_http = ?, "
-					 "proxy_https = ?, "
-					 "proxy_ftp = ?, "
-					 "proxy_socks = ?, "
-					 "no_proxy = ?, "
-					 "pac = ? "
-					 "WHERE uid = ? AND session = ?",
-					 -1, &statement, NULL);
-		if (rc != SQLITE_OK) {
-			g_warning ("failed to prepare statement: %s", sqlite3_errmsg (tdb->priv->db));
-			goto out;
-		}
-
-		/* bind data, so that the freeform proxy text cannot be used to inject SQL */
-		sqlite3_bind_text (statement, 1, proxy_http, -1, SQLITE_STATIC);
-		sqlite3_bind_text (statement, 2, proxy_https, -1, SQLITE_STATIC);
-		sqlite3_bind_text (statement, 3, proxy_ftp, -1, SQLITE_STATIC);
-		sqlite3_bind_text (statement, 4, proxy_socks, -1, SQLITE_STATIC);
-		sqlite3_bind_text (statement, 5, no_proxy, -1, SQLITE_STATIC);
-		sqlite3_bind_text (statement, 6, pac, -1, SQLITE_STATIC);
-		sqlite3_bind_int (statement, 7, uid);
-		sqlite3_bind_text (statement, 8, session, -1, SQLITE_STATIC);
-
-		/* execute statement */
-		rc = sqlite3_step (statement);
-		if (rc != SQLITE_DONE) {
-			g_warning ("failed to execute statement: %s", sqlite3_errmsg (tdb->priv->db));
-			goto out;
-		}
-		goto out;
+		return TRUE;
 	}
+	pk_transaction_db_statement_reset (statement);
 
 	/* insert new entry */
 	timespec = pk_iso8601_present ();
 	g_debug ("set proxy %s, %s for uid:%i and session:%s", proxy_http, proxy_ftp, uid, session);
-
-	/* prepare statement */
-	rc = sqlite3_prepare_v2 (tdb->priv->db,
-				 "INSERT INTO proxy (created, uid, session, "
-				 "proxy_http, "
-				 "proxy_https, "
-				 "proxy_ftp, "
-				 "proxy_socks, "
-				 "no_proxy, "
-				 "pac) "
-				 "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?)",
-				 -1, &statement, NULL);
-	if (rc != SQLITE_OK) {
-		g_warning ("failed to prepare statement: %s", sqlite3_errmsg (tdb->priv->db));
-		goto out;
-	}
-
-	/* bind data, so that the freeform proxy text cannot be used to inject SQL */
+	statement = pk_transaction_db_get_statement (tdb, PK_TRANSACTION_DB_STATEMENT_INSERT_PROXY);
+	if (statement == NULL)
+		return FALSE;
 	sqlite3_bind_text (statement, 1, timespec, -1, SQLITE_STATIC);
 	sqlite3_bind_int (statement, 2, uid);
 	sqlite3_bind_text (statement, 3, session, -1, SQLITE_STATIC);
@@ -821,18 +732,7 @@ pk_transaction_db_set_proxy (PkTransactionDb *tdb, guint uid,
 	sqlite3_bind_text (statement, 7, proxy_socks, -1, SQLITE_STATIC);
 	sqlite3_bind_text (statement, 8, no_proxy, -1, SQLITE_STATIC);
 	sqlite3_bind_text (statement, 9, pac, -1, SQLITE_STATIC);
-
-	/* execute statement */
-	rc = sqlite3_step (statement);
-	if (rc != SQLITE_DONE) {
-		g_warning ("failed to execute statement: %s", sqlite3_errmsg (tdb->priv->db));
-		goto out;
-	}
-
-	ret = TRUE;
-out:
-	if (statement != NULL)
-		sqlite3_finalize (statement);
+	ret = pk_transaction_db_step (tdb->priv->db, statement);
 	return ret;
 }
 
@@ -874,6 +774,54 @@ pk_transaction_db_execute (PkTransactionDb *tdb,
 	return ret;
 }
 
+static gboolean
+pk_transaction_db_migrate_package_events (PkTransactionDb *tdb, GError **error)
+{
+	const gchar *statement;
+	gint rc;
+	guint cnt = 0;
+	g_autoptr(PkTransactionDbStatement) list = NULL;
+
+	statement = "CREATE TABLE package_events (name TEXT, tid TEXT, info INTEGER, timestamp INTEGER, package_id TEXT);";
+	if (!pk_transaction_db_execute (tdb, statement, error))
+		return FALSE;
+	statement = "CREATE UNIQUE INDEX package_events_name ON package_events (name, timestamp);";
+	if (!pk_transaction_db_execute (tdb, statement, error))
+		return FALSE;
+
+	/* index the history saved before the table existed */
+	list = pk_transaction_db_get_statement (tdb, PK_TRANSACTION_DB_STATEMENT_GET_LIST);
+	if (list == NULL) {
+		g_set_error (error, 1, 0,
+			     "failed to read transactions: %s",
+			     sqlite3_errmsg (tdb->priv->db));
+		return FALSE;
+	}
+	sqlite3_bind_int64 (list, 1, -1);
+	while ((rc = sqlite3_step (list)) == SQLITE_ROW) {
+		g_autoptr(PkTransactionPast) item = NULL;
+		item = pk_transaction_db_past_from_row (list);
+		if (!pk_transaction_past_get_succeeded (item))
+			continue;
+		if (!pk_transaction_db_add_package_events (tdb, item)) {
+			g_set_error (error, 1, 0,
+				     "failed to migrate package history for %s: %s",
+				     pk_transaction_past_get_id (item),
+				     sqlite3_errmsg (tdb->priv->db));
+			return FALSE;
+		}
+		cnt++;
+	}
+	if (rc != SQLITE_DONE) {
+		g_set_error (error, 1, 0,
+			     "failed to read transactions: %s",
+			     sqlite3_errmsg (tdb->priv->db));
+		return FALSE;
+	}
+	g_debug ("migrated package history for %u transactions", cnt);
+	return TRUE;
+}
+
 gboolean
 pk_transaction_db_load (PkTransactionDb *tdb, GError **error)
 {
@@ -902,8 +850,13 @@ pk_transaction_db_load (PkTransactionDb *tdb, GError **error)
 		return FALSE;
 	}
 
-	/* we don't need to keep doing fsync */
-	if (!pk_transaction_db_execute (tdb, "PRAGMA synchronous=OFF", error))
+	/* readers never block the writer, and commits only append to the
+	 * log so we don't need a fsync for each one */
+	if (!pk_transaction_db_execute (tdb, "PRAGMA journal_mode=WAL", &error_local)) {
+		g_warning ("failed to use write-ahead log: %s", error_local->message);
+		g_clear_error (&error_local);
+	}
+	if (!pk_transaction_db_execute (tdb, "PRAGMA synchronous=NORMAL", error))
 		return FALSE;
 
 	/* check transactions */
@@ -919,7 +872,21 @@ pk_transaction_db_load (PkTransactionDb *tdb, GError **error)
 			    "data TEXT,"
 			    "description TEXT,"
 			    "uid INTEGER DEFAULT 0,"
-			    "cmdline TEXT);";
+			    "cmdline TEXT,"
+			    "queue_time INTEGER DEFAULT 0,"
+			    "first_result_time INTEGER DEFAULT 0);";
+		if (!pk_transaction_db_execute (tdb, statement, error))
+			return FALSE;
+	}
+
+	/* check transaction latency (since 1.3.2) */
+	if (!pk_transaction_db_execute (tdb, "SELECT queue_time FROM transactions LIMIT 1", &error_local)) {
+		g_debug ("adding transaction latency: %s", error_local->message);
+		g_clear_error (&error_local);
+		statement = "ALTER TABLE transactions ADD COLUMN queue_time INTEGER DEFAULT 0;";
+		if (!pk_transaction_db_execute (tdb, statement, error))
+			return FALSE;
+		statement = "ALTER TABLE transactions ADD COLUMN first_result_time INTEGER DEFAULT 0;";
 		if (!pk_transaction_db_execute (tdb, statement, error))
 			return FALSE;
 	}
@@ -969,6 +936,33 @@ pk_transaction_db_load (PkTransactionDb *tdb, GError **error)
 			return FALSE;
 	}
 
+	/* package history (since 1.3.2) */
+	if (!pk_transaction_db_execute (tdb, "SELECT * FROM package_events LIMIT 1", &error_local)) {
+		g_debug ("adding table package_events: %s", error_local->message);
+		g_clear_error (&error_local);
+
+		/* a half-done backfill would never be retried, so the table
+		 * only appears once every old transaction is in it */
+		if (!pk_transaction_db_execute (tdb, "BEGIN", error))
+			return FALSE;
+		if (!pk_transaction_db_migrate_package_events (tdb, error)) {
+			pk_transaction_db_execute (tdb, "ROLLBACK", NULL);
+			return FALSE;
+		}
+		if (!pk_transaction_db_execute (tdb, "COMMIT", error)) {
+			pk_transaction_db_execute (tdb, "ROLLBACK", NULL);
+			return FALSE;
+		}
+	}
+
+	/* GetOldTransactions sorts by date */
+	statement = "CREATE INDEX IF NOT EXISTS transactions_timespec ON transactions (timespec);";
+	if (!pk_transaction_db_execute (tdb, statement, error))
+		return FALSE;
+	statement = "CREATE INDEX IF NOT EXISTS proxy_uid_session ON proxy (uid, session);";
+	if (!pk_transaction_db_execute (tdb, statement, error))
+		return FALSE;
+
 	/* try to set correct permissions */
 	g_chmod (PK_DB_DIR "/transactions.db", 0644);
 
@@ -987,6 +981,7 @@ static void
 pk_transaction_db_finalize (GObject *object)
 {
 	PkTransactionDb *tdb;
+	guint i;
 	g_return_if_fail (PK_IS_TRANSACTION_DB (object));
 	tdb = PK_TRANSACTION_DB (object);
 	g_return_if_fail (tdb->priv != NULL);
@@ -998,6 +993,8 @@ pk_transaction_db_finalize (GObject *object)
 	}
 
 	/* close the database */
+	for (i = 0; i < PK_TRANSACTION_DB_STATEMENT_LAST; i++)
+		sqlite3_finalize (tdb->priv->statements[i]);
 	sqlite3_close (tdb->priv->db);
 
 	G_OBJECT_CLASS (pk_transaction_db_parent_class)->finalize (object);
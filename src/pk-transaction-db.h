@@ -24,6 +24,7 @@
 
 #include <glib-object.h>
 #include <packagekit-glib2/pk-enum.h>
+#include <packagekit-glib2/pk-transaction-past.h>
 
 G_BEGIN_DECLS
 
@@ -57,26 +58,13 @@ gboolean	 pk_transaction_db_load			(PkTransactionDb	*tdb,
 							 GError			**error);
 gboolean	 pk_transaction_db_empty		(PkTransactionDb	*tdb);
 gboolean	 pk_transaction_db_add			(PkTransactionDb	*tdb,
-							 const gchar		*tid);
+							 PkTransactionPast	*item);
 gboolean	 pk_transaction_db_print		(PkTransactionDb	*tdb);
-gboolean	 pk_transaction_db_set_role		(PkTransactionDb	*tdb,
-							 const gchar		*tid,
-							 PkRoleEnum		 role);
-gboolean	 pk_transaction_db_set_uid		(PkTransactionDb	*tdb,
-							 const gchar		*tid,
-							 guint			 uid);
-gboolean	 pk_transaction_db_set_cmdline		(PkTransactionDb	*tdb,
-							 const gchar		*tid,
-							 const gchar		*cmdline);
-gboolean	 pk_transaction_db_set_finished		(PkTransactionDb	*tdb,
-							 const gchar		*tid,
-							 gboolean		 success,
-							 guint			 runtime);
-gboolean	 pk_transaction_db_set_data		(PkTransactionDb	*tdb,
-							 const gchar		*tid,
-							 const gchar		*data);
 GList		*pk_transaction_db_get_list		(PkTransactionDb	*tdb,
 							 guint			 limit);
+GVariant	*pk_transaction_db_get_package_history	(PkTransactionDb	*tdb,
+							 const gchar		*name,
+							 guint			 limit);
 gboolean	 pk_transaction_db_action_time_reset	(PkTransactionDb	*tdb,
 							 PkRoleEnum		 role);
 guint		 pk_transaction_db_action_time_since	(PkTransactionDb	*tdb,
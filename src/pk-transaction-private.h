@@ -40,6 +40,9 @@ void	pk_transaction_search_names	(PkTransaction	*transaction,
 void	pk_transaction_install_packages (PkTransaction *transaction,
 					 GVariant *params,
 					 GDBusMethodInvocation *context);
+void	pk_transaction_refresh_cache	(PkTransaction	*transaction,
+					 GVariant	*params,
+					 GDBusMethodInvocation *context);
 gboolean	 pk_transaction_set_sender			(PkTransaction	*transaction,
 								 const gchar	*sender);
 gboolean	 pk_transaction_filter_check			(const gchar	*filter,
@@ -48,6 +51,8 @@ gboolean	 pk_transaction_strvalidate			(const gchar	*textr,
 								 GError		**error);
 gboolean	 pk_transaction_set_tid				(PkTransaction	*transaction,
 								 const gchar	*tid);
+void		 pk_transaction_set_uid				(PkTransaction	*transaction,
+								 guint		 uid);
 
 
 G_END_DECLS
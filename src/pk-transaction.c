@@ -40,15 +40,18 @@
 #include <glib/gstdio.h>
 #include <glib/gi18n.h>
 #include <gio/gio.h>
+#include <gio/gunixfdlist.h>
 #include <packagekit-glib2/pk-common.h>
 #include <packagekit-glib2/pk-common-private.h>
 #include <packagekit-glib2/pk-enum.h>
 #include <packagekit-glib2/pk-offline-private.h>
 #include <packagekit-glib2/pk-package-id.h>
 #include <packagekit-glib2/pk-package-ids.h>
+#include <packagekit-glib2/pk-packages-fd-private.h>
 #include <packagekit-glib2/pk-results.h>
 #include <polkit/polkit.h>
 
+#include "pk-auth-cache.h"
 #include "pk-backend.h"
 #include "pk-dbus.h"
 #include "pk-shared.h"
@@ -61,6 +64,7 @@ static void     pk_transaction_dispose		(GObject	    *object);
 
 static gchar *pk_transaction_get_content_type_for_file (const gchar *filename, GError **error);
 static gboolean pk_transaction_is_supported_content_type (PkTransaction *transaction, const gchar *content_type);
+static void pk_transaction_set_signals_paused_internal (PkTransaction *transaction, gboolean paused);
 
 #define PK_TRANSACTION_GET_PRIVATE(o) (G_TYPE_INSTANCE_GET_PRIVATE ((o), PK_TYPE_TRANSACTION, PkTransactionPrivate))
 #define PK_TRANSACTION_UPDATES_CHANGED_TIMEOUT	100 /* ms */
@@ -74,6 +78,9 @@ static gboolean pk_transaction_is_supported_content_type (PkTransaction *transac
 /* maximum number of items that can be resolved in one go */
 #define PK_TRANSACTION_MAX_ITEMS_TO_RESOLVE	10000
 
+/* signals held back for a paused client before they are sent anyway */
+#define PK_TRANSACTION_MAX_HELD_SIGNALS		1000
+
 struct PkTransactionPrivate
 {
 	PkRoleEnum		 role;
@@ -101,10 +108,27 @@ struct PkTransactionPrivate
 	GKeyFile		*conf;
 	PkDbus			*dbus;
 	PolkitAuthority		*authority;
+	PkAuthCache		*auth_cache;	/* (nullable) */
 	PolkitSubject		*subject;
 	GCancellable		*cancellable;
 	gboolean		 skip_auth_check;
 	gboolean		 client_supports_plural_signals;
+	gboolean		 client_supports_packages_fd;
+	gboolean		 client_supports_list_signals;
+
+	/* Signals held back while the client has paused emission */
+	gboolean		 signals_paused;
+	GQueue			 held_signals;
+
+	/* Phase timestamps from g_get_monotonic_time(), or 0 if not reached */
+	gint64			 time_created;
+	gint64			 time_ready;
+	gint64			 time_running;
+	gint64			 time_backend_started;
+	gint64			 time_first_result;
+	gint64			 time_finished;
+	gint64			 time_emitting;	/* µs spent inside emit_signal() */
+	guint			 n_signals_emitted;
 
 	/* Rate limiting of progress reporting */
 	gboolean		 progress_changed;
@@ -117,6 +141,7 @@ struct PkTransactionPrivate
 	gchar			*cmdline;
 	PkResults		*results;
 	PkTransactionDb		*transaction_db;
+	PkTransactionPast	*past;
 
 	/* cached */
 	gboolean		 cached_force;
@@ -264,6 +289,64 @@ pk_transaction_get_runtime (PkTransaction *transaction)
 	return pk_backend_job_get_runtime (transaction->priv->job);
 }
 
+/* returns 0 unless both phases have been reached, in order */
+static guint64
+pk_transaction_phase_delta (gint64 start, gint64 end)
+{
+	if (start == 0 || end < start)
+		return 0;
+	return end - start;
+}
+
+/**
+ * pk_transaction_get_stats:
+ *
+ * Gets the per-phase timings of the transaction, all in µs:
+ *
+ *  - queue-time: from creation until the scheduler started it
+ *  - auth-time: from creation until it was authorized and ready to run
+ *  - wait-time: from being ready until the scheduler started it
+ *  - backend-start-time: from being started until the backend thread ran
+ *  - first-result-time: from being started until the first result signal
+ *  - run-time: from being started until the backend finished
+ *  - total-time: from creation until the backend finished
+ *  - emit-time: spent emitting transaction signals on the bus
+ *  - signals: the number of transaction signals emitted
+ *
+ * Phases that have not been reached yet are reported as 0.
+ *
+ * Return value: (transfer floating): a new #GVariant of type a{st}
+ **/
+GVariant *
+pk_transaction_get_stats (PkTransaction *transaction)
+{
+	PkTransactionPrivate *priv = transaction->priv;
+	GVariantBuilder builder;
+
+	g_return_val_if_fail (PK_IS_TRANSACTION (transaction), NULL);
+
+	g_variant_builder_init (&builder, G_VARIANT_TYPE ("a{st}"));
+	g_variant_builder_add (&builder, "{st}", "queue-time",
+			       pk_transaction_phase_delta (priv->time_created, priv->time_running));
+	g_variant_builder_add (&builder, "{st}", "auth-time",
+			       pk_transaction_phase_delta (priv->time_created, priv->time_ready));
+	g_variant_builder_add (&builder, "{st}", "wait-time",
+			       pk_transaction_phase_delta (priv->time_ready, priv->time_running));
+	g_variant_builder_add (&builder, "{st}", "backend-start-time",
+			       pk_transaction_phase_delta (priv->time_running, priv->time_backend_started));
+	g_variant_builder_add (&builder, "{st}", "first-result-time",
+			       pk_transaction_phase_delta (priv->time_running, priv->time_first_result));
+	g_variant_builder_add (&builder, "{st}", "run-time",
+			       pk_transaction_phase_delta (priv->time_running, priv->time_finished));
+	g_variant_builder_add (&builder, "{st}", "total-time",
+			       pk_transaction_phase_delta (priv->time_created, priv->time_finished));
+	g_variant_builder_add (&builder, "{st}", "emit-time",
+			       (guint64) priv->time_emitting);
+	g_variant_builder_add (&builder, "{st}", "signals",
+			       (guint64) priv->n_signals_emitted);
+	return g_variant_builder_end (&builder);
+}
+
 gboolean
 pk_transaction_get_background (PkTransaction *transaction)
 {
@@ -271,8 +354,36 @@ pk_transaction_get_background (PkTransaction *transaction)
 	return pk_backend_job_get_background (transaction->priv->job);
 }
 
+/* roles that only ever read the package database */
+static gboolean
+pk_transaction_role_is_query (PkRoleEnum role)
+{
+	switch (role) {
+	case PK_ROLE_ENUM_DEPENDS_ON:
+	case PK_ROLE_ENUM_GET_CATEGORIES:
+	case PK_ROLE_ENUM_GET_DETAILS:
+	case PK_ROLE_ENUM_GET_DISTRO_UPGRADES:
+	case PK_ROLE_ENUM_GET_FILES:
+	case PK_ROLE_ENUM_GET_PACKAGES:
+	case PK_ROLE_ENUM_GET_REPO_LIST:
+	case PK_ROLE_ENUM_GET_UPDATE_DETAIL:
+	case PK_ROLE_ENUM_GET_UPDATES:
+	case PK_ROLE_ENUM_REQUIRED_BY:
+	case PK_ROLE_ENUM_RESOLVE:
+	case PK_ROLE_ENUM_SEARCH_DETAILS:
+	case PK_ROLE_ENUM_SEARCH_FILE:
+	case PK_ROLE_ENUM_SEARCH_GROUP:
+	case PK_ROLE_ENUM_SEARCH_NAME:
+	case PK_ROLE_ENUM_WHAT_PROVIDES:
+		return TRUE;
+	default:
+		return FALSE;
+	}
+}
+
 static gboolean
-pk_transaction_finish_invalidate_caches (PkTransaction *transaction)
+pk_transaction_finish_invalidate_caches (PkTransaction *transaction,
+					 PkExitEnum exit_enum)
 {
 	PkTransactionPrivate *priv = transaction->priv;
 
@@ -285,6 +396,14 @@ pk_transaction_finish_invalidate_caches (PkTransaction *transaction)
 	if (pk_bitfield_contain (transaction->priv->cached_transaction_flags,
 				  PK_TRANSACTION_FLAG_ENUM_ONLY_DOWNLOAD))
 		goto out;
+
+	/* forget cached query results, even a failed transaction may have
+	 * changed some packages */
+	if (!pk_transaction_role_is_query (priv->role))
+		pk_backend_cache_invalidate (priv->backend);
+	if (exit_enum != PK_EXIT_ENUM_SUCCESS)
+		goto out;
+
 	if (priv->role == PK_ROLE_ENUM_UPDATE_PACKAGES ||
 	    priv->role == PK_ROLE_ENUM_INSTALL_PACKAGES ||
 	    priv->role == PK_ROLE_ENUM_REMOVE_PACKAGES ||
@@ -347,6 +466,159 @@ pk_transaction_emit_properties_changed (PkTransaction *transaction,
 				       NULL);
 }
 
+typedef struct {
+	gchar			*signal_name;
+	GVariant		*parameters;
+} PkTransactionHeldSignal;
+
+static void
+pk_transaction_held_signal_free (PkTransactionHeldSignal *held)
+{
+	g_free (held->signal_name);
+	g_variant_unref (held->parameters);
+	g_free (held);
+}
+
+/* the signals carrying what the transaction was asked for, rather than
+ * progress, questions for the user or the outcome */
+static gboolean
+pk_transaction_signal_is_result (const gchar *signal_name)
+{
+	const gchar *names[] = { "Category",
+				 "Details",
+				 "DetailsList",
+				 "DistroUpgrade",
+				 "Files",
+				 "FilesList",
+				 "Package",
+				 "Packages",
+				 "RepoDetail",
+				 "Transaction",
+				 "UpdateDetail",
+				 "UpdateDetails",
+				 NULL };
+	return g_strv_contains (names, signal_name);
+}
+
+/**
+ * pk_transaction_emit_signal:
+ *
+ * Emits a signal on the transaction interface, or holds it back in order
+ * if the client has asked us to pause emission. The floating reference
+ * of @parameters is consumed, as with g_dbus_connection_emit_signal().
+ **/
+static gboolean
+pk_transaction_emit_signal (PkTransaction *transaction,
+			    const gchar *signal_name,
+			    GVariant *parameters)
+{
+	PkTransactionPrivate *priv = transaction->priv;
+	PkTransactionHeldSignal *held;
+	gboolean ret;
+	gint64 now = g_get_monotonic_time ();
+	g_autoptr(GVariant) parameters_sunk = g_variant_ref_sink (parameters);
+
+	priv->n_signals_emitted++;
+	if (priv->time_first_result == 0 &&
+	    pk_transaction_signal_is_result (signal_name))
+		priv->time_first_result = now;
+
+	/* a client that never resumes must not make us keep everything */
+	if (priv->signals_paused &&
+	    g_queue_get_length (&priv->held_signals) >= PK_TRANSACTION_MAX_HELD_SIGNALS) {
+		g_debug ("too many held signals, resuming emission");
+		pk_transaction_set_signals_paused_internal (transaction, FALSE);
+	}
+	if (priv->signals_paused) {
+		held = g_new0 (PkTransactionHeldSignal, 1);
+		held->signal_name = g_strdup (signal_name);
+		held->parameters = g_steal_pointer (&parameters_sunk);
+		g_queue_push_tail (&priv->held_signals, held);
+		return TRUE;
+	}
+	ret = g_dbus_connection_emit_signal (priv->connection,
+					     NULL,
+					     priv->tid,
+					     PK_DBUS_INTERFACE_TRANSACTION,
+					     signal_name,
+					     parameters_sunk,
+					     NULL);
+	priv->time_emitting += g_get_monotonic_time () - now;
+	return ret;
+}
+
+/**
+ * pk_transaction_emit_held_signal:
+ *
+ * The plural signals can hit the D-Bus message size limit, in which case
+ * the items are sent one by one, as they would have been when not held.
+ **/
+static void
+pk_transaction_emit_held_signal (PkTransaction *transaction, PkTransactionHeldSignal *held)
+{
+	PkTransactionPrivate *priv = transaction->priv;
+	const gchar *fallback = NULL;
+	GVariant *child;
+	GVariantIter iter;
+	g_autoptr(GVariant) items = NULL;
+
+	if (g_dbus_connection_emit_signal (priv->connection,
+					   NULL,
+					   priv->tid,
+					   PK_DBUS_INTERFACE_TRANSACTION,
+					   held->signal_name,
+					   held->parameters,
+					   NULL))
+		return;
+	if (g_strcmp0 (held->signal_name, "Packages") == 0)
+		fallback = "Package";
+	else if (g_strcmp0 (held->signal_name, "UpdateDetails") == 0)
+		fallback = "UpdateDetail";
+	if (fallback == NULL)
+		return;
+
+	items = g_variant_get_child_value (held->parameters, 0);
+	g_variant_iter_init (&iter, items);
+	while ((child = g_variant_iter_next_value (&iter)) != NULL) {
+		g_dbus_connection_emit_signal (priv->connection,
+					       NULL,
+					       priv->tid,
+					       PK_DBUS_INTERFACE_TRANSACTION,
+					       fallback,
+					       child,
+					       NULL);
+		g_variant_unref (child);
+	}
+}
+
+/**
+ * pk_transaction_set_signals_paused_internal:
+ *
+ * Resuming sends everything that was held back, in the original order.
+ **/
+static void
+pk_transaction_set_signals_paused_internal (PkTransaction *transaction, gboolean paused)
+{
+	PkTransactionPrivate *priv = transaction->priv;
+	PkTransactionHeldSignal *held;
+	gint64 now;
+
+	if (priv->signals_paused == paused)
+		return;
+	priv->signals_paused = paused;
+	if (paused)
+		return;
+	g_debug ("resuming emission of %u held signals",
+		 g_queue_get_length (&priv->held_signals));
+	now = g_get_monotonic_time ();
+	while ((held = g_queue_pop_head (&priv->held_signals)) != NULL) {
+		if (priv->connection != NULL)
+			pk_transaction_emit_held_signal (transaction, held);
+		pk_transaction_held_signal_free (held);
+	}
+	priv->time_emitting += g_get_monotonic_time () - now;
+}
+
 static void
 pk_transaction_emit_property_changed (PkTransaction *transaction,
                                       const gchar   *property_name,
@@ -506,21 +778,27 @@ pk_transaction_finished_emit (PkTransaction *transaction,
 			      PkExitEnum exit_enum,
 			      guint time_ms)
 {
+	g_autoptr(GVariant) stats = NULL;
+
 	g_assert (!transaction->priv->emitted_finished);
 	transaction->priv->emitted_finished = TRUE;
 
+	/* cancelled or failed before the backend finished */
+	if (transaction->priv->time_finished == 0)
+		transaction->priv->time_finished = g_get_monotonic_time ();
+
+	/* let clients pick up the final numbers without another round trip */
+	stats = g_variant_ref_sink (pk_transaction_get_stats (transaction));
+	pk_transaction_emit_property_changed (transaction, "Stats", stats);
+
 	g_debug ("emitting finished '%s', %i",
 		 pk_exit_enum_to_string (exit_enum),
 		 time_ms);
-	g_dbus_connection_emit_signal (transaction->priv->connection,
-				       NULL,
-				       transaction->priv->tid,
-				       PK_DBUS_INTERFACE_TRANSACTION,
-				       "Finished",
-				       g_variant_new ("(uu)",
-						      exit_enum,
-						      time_ms),
-				       NULL);
+	pk_transaction_emit_signal (transaction,
+				    "Finished",
+				    g_variant_new ("(uu)",
+						   exit_enum,
+						   time_ms));
 
 	/* For the transaction list */
 	g_signal_emit (transaction, signals[SIGNAL_FINISHED], 0);
@@ -534,15 +812,11 @@ pk_transaction_error_code_emit (PkTransaction *transaction,
 	g_debug ("emitting error-code %s, '%s'",
 		 pk_error_enum_to_string (error_enum),
 		 details);
-	g_dbus_connection_emit_signal (transaction->priv->connection,
-				       NULL,
-				       transaction->priv->tid,
-				       PK_DBUS_INTERFACE_TRANSACTION,
-				       "ErrorCode",
-				       g_variant_new ("(us)",
-						      error_enum,
-						      details),
-				       NULL);
+	pk_transaction_emit_signal (transaction,
+				    "ErrorCode",
+				    g_variant_new ("(us)",
+						   error_enum,
+						   details));
 }
 
 static void
@@ -577,10 +851,7 @@ pk_transaction_details_cb (PkBackendJob *job,
 			   PkDetails *item,
 			   PkTransaction *transaction)
 {
-	GVariantBuilder builder;
-	PkGroupEnum group;
-	const gchar *tmp;
-	guint64 size;
+	g_autoptr(GVariant) value = NULL;
 
 	g_return_if_fail (PK_IS_TRANSACTION (transaction));
 	g_return_if_fail (transaction->priv->tid != NULL);
@@ -588,47 +859,49 @@ pk_transaction_details_cb (PkBackendJob *job,
 	/* add to results */
 	pk_results_add_details (transaction->priv->results, item);
 
-	/* emit */
+	/* emit what the backend thread serialized */
 	g_debug ("emitting details");
-	g_variant_builder_init (&builder, G_VARIANT_TYPE("a{sv}"));
-	g_variant_builder_add (&builder, "{sv}", "package-id",
-			       g_variant_new_string (pk_details_get_package_id (item)));
-	group = pk_details_get_group (item);
-	if (group != PK_GROUP_ENUM_UNKNOWN)
-		g_variant_builder_add (&builder, "{sv}", "group",
-				       g_variant_new_uint32 (group));
-	tmp = pk_details_get_summary (item);
-	if (tmp != NULL)
-		g_variant_builder_add (&builder, "{sv}", "summary",
-				       g_variant_new_string (tmp));
-	tmp = pk_details_get_description (item);
-	if (tmp != NULL)
-		g_variant_builder_add (&builder, "{sv}", "description",
-				       g_variant_new_string (tmp));
-	tmp = pk_details_get_url (item);
-	if (tmp != NULL)
-		g_variant_builder_add (&builder, "{sv}", "url",
-				       g_variant_new_string (tmp));
-	tmp = pk_details_get_license (item);
-	if (tmp != NULL)
-		g_variant_builder_add (&builder, "{sv}", "license",
-				       g_variant_new_string (tmp));
-	size = pk_details_get_size (item);
-	if (size != 0)
-		g_variant_builder_add (&builder, "{sv}", "size",
-				       g_variant_new_uint64 (size));
-	size = pk_details_get_download_size (item);
-	if (size != G_MAXUINT64)
-		g_variant_builder_add (&builder, "{sv}", "download-size",
-				       g_variant_new_uint64 (size));
+	value = pk_backend_job_get_details_variant (item);
+	pk_transaction_emit_signal (transaction,
+				    "Details",
+				    g_variant_new ("(@a{sv})", value));
+}
 
-	g_dbus_connection_emit_signal (transaction->priv->connection,
-				       NULL,
-				       transaction->priv->tid,
-				       PK_DBUS_INTERFACE_TRANSACTION,
-				       "Details",
-				       g_variant_new ("(a{sv})", &builder),
-				       NULL);
+static void
+pk_transaction_details_list_cb (PkBackendJob *job,
+				GPtrArray *details_array,  /* (element-type PkDetails) */
+				PkTransaction *transaction)
+{
+	g_autoptr(GPtrArray) children = NULL;
+
+	g_return_if_fail (PK_IS_TRANSACTION (transaction));
+	g_return_if_fail (transaction->priv->tid != NULL);
+
+	children = g_ptr_array_new_with_free_func ((GDestroyNotify) g_variant_unref);
+	for (guint i = 0; i < details_array->len; i++) {
+		PkDetails *item = g_ptr_array_index (details_array, i);
+		pk_results_add_details (transaction->priv->results, item);
+		g_ptr_array_add (children, pk_backend_job_get_details_variant (item));
+	}
+
+	/* group them like Packages, if it fails we fall back below */
+	g_debug ("emitting %u details", children->len);
+	if (transaction->priv->client_supports_list_signals &&
+	    pk_transaction_emit_signal (transaction,
+					"DetailsList",
+					g_variant_new ("(@aa{sv})",
+						       g_variant_new_array (G_VARIANT_TYPE ("a{sv}"),
+									    (GVariant **) children->pdata,
+									    children->len))))
+		return;
+
+	/* Fall back to one signal per item. */
+	for (guint i = 0; i < children->len; i++) {
+		pk_transaction_emit_signal (transaction,
+					    "Details",
+					    g_variant_new ("(@a{sv})",
+							   g_ptr_array_index (children, i)));
+	}
 }
 
 static void
@@ -666,50 +939,81 @@ pk_transaction_error_code_cb (PkBackendJob *job,
 	}
 }
 
+static void
+pk_transaction_files_check_prefix (PkTransaction *transaction, PkFiles *item)
+{
+	gchar **files = pk_files_get_files (item);
+
+	/* ensure the files have the correct prefix */
+	if (transaction->priv->role != PK_ROLE_ENUM_DOWNLOAD_PACKAGES ||
+	    transaction->priv->cached_directory == NULL ||
+	    files == NULL)
+		return;
+	for (guint i = 0; files[i] != NULL; i++) {
+		if (!g_str_has_prefix (files[i], transaction->priv->cached_directory)) {
+			g_warning ("%s does not have the correct prefix (%s)",
+				   files[i],
+				   transaction->priv->cached_directory);
+		}
+	}
+}
+
 static void
 pk_transaction_files_cb (PkBackendJob *job,
 			 PkFiles *item,
 			 PkTransaction *transaction)
 {
-	guint i;
-	g_autofree gchar *package_id = NULL;
-	g_auto(GStrv) files = NULL;
+	g_autoptr(GVariant) value = NULL;
 
 	g_return_if_fail (PK_IS_TRANSACTION (transaction));
 	g_return_if_fail (transaction->priv->tid != NULL);
 
-	/* get data */
-	g_object_get (item,
-		      "package-id", &package_id,
-		      "files", &files,
-		      NULL);
-
-	/* ensure the files have the correct prefix */
-	if (transaction->priv->role == PK_ROLE_ENUM_DOWNLOAD_PACKAGES &&
-	    transaction->priv->cached_directory != NULL) {
-		for (i = 0; files[i] != NULL; i++) {
-			if (!g_str_has_prefix (files[i], transaction->priv->cached_directory)) {
-				g_warning ("%s does not have the correct prefix (%s)",
-					   files[i],
-					   transaction->priv->cached_directory);
-			}
-		}
-	}
+	pk_transaction_files_check_prefix (transaction, item);
 
 	/* add to results */
 	pk_results_add_files (transaction->priv->results, item);
 
-	/* emit */
-	g_debug ("emitting files %s", package_id);
-	g_dbus_connection_emit_signal (transaction->priv->connection,
-				       NULL,
-				       transaction->priv->tid,
-				       PK_DBUS_INTERFACE_TRANSACTION,
-				       "Files",
-				       g_variant_new ("(s^as)",
-						      package_id != NULL ? package_id : "",
-						      files),
-				       NULL);
+	/* emit what the backend thread serialized */
+	g_debug ("emitting files %s", pk_files_get_package_id (item));
+	value = pk_backend_job_get_files_variant (item);
+	pk_transaction_emit_signal (transaction, "Files", value);
+}
+
+static void
+pk_transaction_files_list_cb (PkBackendJob *job,
+			      GPtrArray *files_array,  /* (element-type PkFiles) */
+			      PkTransaction *transaction)
+{
+	g_autoptr(GPtrArray) children = NULL;
+
+	g_return_if_fail (PK_IS_TRANSACTION (transaction));
+	g_return_if_fail (transaction->priv->tid != NULL);
+
+	children = g_ptr_array_new_with_free_func ((GDestroyNotify) g_variant_unref);
+	for (guint i = 0; i < files_array->len; i++) {
+		PkFiles *item = g_ptr_array_index (files_array, i);
+		pk_transaction_files_check_prefix (transaction, item);
+		pk_results_add_files (transaction->priv->results, item);
+		g_ptr_array_add (children, pk_backend_job_get_files_variant (item));
+	}
+
+	/* group them like Packages, if it fails we fall back below */
+	g_debug ("emitting files for %u packages", children->len);
+	if (transaction->priv->client_supports_list_signals &&
+	    pk_transaction_emit_signal (transaction,
+					"FilesList",
+					g_variant_new ("(@a(sas))",
+						       g_variant_new_array (G_VARIANT_TYPE ("(sas)"),
+									    (GVariant **) children->pdata,
+									    children->len))))
+		return;
+
+	/* Fall back to one signal per item. */
+	for (guint i = 0; i < children->len; i++) {
+		pk_transaction_emit_signal (transaction,
+					    "Files",
+					    g_ptr_array_index (children, i));
+	}
 }
 
 static void
@@ -740,18 +1044,14 @@ pk_transaction_category_cb (PkBackendJob *job,
 
 	/* emit */
 	g_debug ("emitting category %s, %s, %s, %s, %s ", parent_id, cat_id, name, summary, icon);
-	g_dbus_connection_emit_signal (transaction->priv->connection,
-				       NULL,
-				       transaction->priv->tid,
-				       PK_DBUS_INTERFACE_TRANSACTION,
-				       "Category",
-				       g_variant_new ("(sssss)",
-						      parent_id != NULL ? parent_id : "",
-						      cat_id,
-						      name,
-						      summary,
-						      icon != NULL ? icon : ""),
-				       NULL);
+	pk_transaction_emit_signal (transaction,
+				    "Category",
+				    g_variant_new ("(sssss)",
+						   parent_id != NULL ? parent_id : "",
+						   cat_id,
+						   name,
+						   summary,
+						   icon != NULL ? icon : ""));
 }
 
 static void
@@ -805,16 +1105,12 @@ pk_transaction_distro_upgrade_cb (PkBackendJob *job,
 	g_debug ("emitting distro-upgrade %s, %s, %s",
 		 pk_update_state_enum_to_string (state),
 		 name, summary);
-	g_dbus_connection_emit_signal (transaction->priv->connection,
-				       NULL,
-				       transaction->priv->tid,
-				       PK_DBUS_INTERFACE_TRANSACTION,
-				       "DistroUpgrade",
-				       g_variant_new ("(uss)",
-						      state,
-						      name,
-						      summary != NULL ? summary : ""),
-				       NULL);
+	pk_transaction_emit_signal (transaction,
+				    "DistroUpgrade",
+				    g_variant_new ("(uss)",
+						   state,
+						   name,
+						   summary != NULL ? summary : ""));
 }
 
 static gchar *
@@ -893,6 +1189,10 @@ pk_transaction_set_state (PkTransaction *transaction, PkTransactionState state)
 
 	g_debug ("transaction now %s", pk_transaction_state_to_string (state));
 	priv->state = state;
+	if (state == PK_TRANSACTION_STATE_READY)
+		priv->time_ready = g_get_monotonic_time ();
+	else if (state == PK_TRANSACTION_STATE_RUNNING)
+		priv->time_running = g_get_monotonic_time ();
 	g_signal_emit (transaction, signals[SIGNAL_STATE_CHANGED], 0, state);
 
 	/* only get cmdline when it's going to be saved into the database */
@@ -909,18 +1209,18 @@ pk_transaction_set_state (PkTransaction *transaction, PkTransactionState state)
 	     priv->role == PK_ROLE_ENUM_INSTALL_PACKAGES ||
 	     priv->role == PK_ROLE_ENUM_UPDATE_PACKAGES)) {
 
-		/* add to database */
-		pk_transaction_db_add (priv->transaction_db, priv->tid);
-
-		/* save role in the database */
-		pk_transaction_db_set_role (priv->transaction_db, priv->tid, priv->role);
-
-		/* save uid */
-		pk_transaction_db_set_uid (priv->transaction_db, priv->tid, priv->client_uid);
-
-		/* save cmdline in db */
-		if (priv->cmdline != NULL)
-			pk_transaction_db_set_cmdline (priv->transaction_db, priv->tid, priv->cmdline);
+		/* the database row is written in one go when finished */
+		if (priv->past == NULL) {
+			g_autofree gchar *timespec = pk_iso8601_present ();
+			priv->past = pk_transaction_past_new ();
+			g_object_set (priv->past,
+				      "tid", priv->tid,
+				      "timespec", timespec,
+				      "role", priv->role,
+				      "uid", priv->client_uid,
+				      "cmdline", priv->cmdline,
+				      NULL);
+		}
 
 		/* report to syslog */
 		syslog (LOG_DAEMON | LOG_DEBUG,
@@ -960,6 +1260,21 @@ pk_transaction_get_uid (PkTransaction *transaction)
 	return transaction->priv->client_uid;
 }
 
+/**
+ * pk_transaction_set_uid:
+ *
+ * Pretend the transaction was started by another user.
+ * NOTE: This is *only* for testing, do never
+ * use it somewhere else!
+ **/
+void
+pk_transaction_set_uid (PkTransaction *transaction, guint uid)
+{
+	g_return_if_fail (PK_IS_TRANSACTION (transaction));
+
+	transaction->priv->client_uid = uid;
+}
+
 static void
 pk_transaction_setup_mime_types (PkTransaction *transaction)
 {
@@ -987,6 +1302,44 @@ pk_transaction_set_backend (PkTransaction *transaction,
 	pk_transaction_setup_mime_types (transaction);
 }
 
+/**
+ * pk_transaction_set_auth_cache:
+ *
+ * Note: this is the engine's cache of recent polkit answers, shared by
+ * all the transactions so a caller is not asked again for every one.
+ **/
+void
+pk_transaction_set_auth_cache (PkTransaction *transaction,
+			       PkAuthCache *auth_cache)
+{
+	g_return_if_fail (PK_IS_TRANSACTION (transaction));
+	g_return_if_fail (PK_IS_AUTH_CACHE (auth_cache));
+
+	/* save a reference */
+	if (transaction->priv->auth_cache != NULL)
+		g_object_unref (transaction->priv->auth_cache);
+	transaction->priv->auth_cache = g_object_ref (auth_cache);
+}
+
+/**
+ * pk_transaction_set_transaction_db:
+ *
+ * Note: this is the database the engine has already loaded, shared by
+ * all the transactions rather than each one opening its own.
+ */
+void
+pk_transaction_set_transaction_db (PkTransaction *transaction,
+				   PkTransactionDb *transaction_db)
+{
+	g_return_if_fail (PK_IS_TRANSACTION (transaction));
+	g_return_if_fail (PK_IS_TRANSACTION_DB (transaction_db));
+
+	/* save a reference */
+	if (transaction->priv->transaction_db != NULL)
+		g_object_unref (transaction->priv->transaction_db);
+	transaction->priv->transaction_db = g_object_ref (transaction_db);
+}
+
 /**
 * pk_transaction_get_backend_job:
 *
@@ -1194,13 +1547,14 @@ pk_transaction_finished_cb (PkBackendJob *job, PkExitEnum exit_enum, PkTransacti
 	else if (transaction->priv->emit_media_change_required)
 		exit_enum = PK_EXIT_ENUM_MEDIA_CHANGE_REQUIRED;
 
-	/* invalidate some caches if we succeeded */
-	if (exit_enum == PK_EXIT_ENUM_SUCCESS)
-		pk_transaction_finish_invalidate_caches (transaction);
+	/* invalidate some caches */
+	pk_transaction_finish_invalidate_caches (transaction, exit_enum);
 
 	/* find the length of time we have been running */
 	time_ms = pk_transaction_get_runtime (transaction);
 	g_debug ("backend was running for %i ms", time_ms);
+	transaction->priv->time_finished = g_get_monotonic_time ();
+	transaction->priv->time_backend_started = pk_backend_job_get_thread_start_time (job);
 
 	/* add to the database if we are going to log it */
 	if (transaction->priv->role == PK_ROLE_ENUM_UPDATE_PACKAGES ||
@@ -1213,8 +1567,8 @@ pk_transaction_finished_cb (PkBackendJob *job, PkExitEnum exit_enum, PkTransacti
 
 		/* save to database */
 		packages = pk_transaction_package_list_to_string (array);
-		if (!pk_strzero (packages))
-			pk_transaction_db_set_data (transaction->priv->transaction_db, transaction->priv->tid, packages);
+		if (!pk_strzero (packages) && transaction->priv->past != NULL)
+			g_object_set (transaction->priv->past, "data", packages, NULL);
 
 		/* report to syslog */
 		for (i = 0; i < array->len; i++) {
@@ -1242,14 +1596,21 @@ pk_transaction_finished_cb (PkBackendJob *job, PkExitEnum exit_enum, PkTransacti
 	}
 
 	/* only reset the time if we succeeded */
-	if (exit_enum == PK_EXIT_ENUM_SUCCESS)
+	if (exit_enum == PK_EXIT_ENUM_SUCCESS && transaction->priv->transaction_db != NULL)
 		pk_transaction_db_action_time_reset (transaction->priv->transaction_db, transaction->priv->role);
 
 	/* did we finish okay? */
-	if (exit_enum == PK_EXIT_ENUM_SUCCESS)
-		pk_transaction_db_set_finished (transaction->priv->transaction_db, transaction->priv->tid, TRUE, time_ms);
-	else
-		pk_transaction_db_set_finished (transaction->priv->transaction_db, transaction->priv->tid, FALSE, time_ms);
+	if (transaction->priv->past != NULL) {
+		PkTransactionPrivate *priv = transaction->priv;
+		g_object_set (priv->past,
+			      "succeeded", exit_enum == PK_EXIT_ENUM_SUCCESS,
+			      "duration", time_ms,
+			      "queue-time", (guint) (pk_transaction_phase_delta (priv->time_created, priv->time_running) / 1000),
+			      "first-result-time", (guint) (pk_transaction_phase_delta (priv->time_running, priv->time_first_result) / 1000),
+			      NULL);
+		if (priv->transaction_db != NULL)
+			pk_transaction_db_add (priv->transaction_db, priv->past);
+	}
 
 	/* remove any inhibit */
 	//TODO: on main interface
@@ -1275,8 +1636,9 @@ pk_transaction_finished_cb (PkBackendJob *job, PkExitEnum exit_enum, PkTransacti
 	/* this disconnects any pending signals */
 	pk_backend_job_disconnect_vfuncs (transaction->priv->job);
 
-	/* destroy the job */
-	pk_backend_stop_job (transaction->priv->backend, transaction->priv->job);
+	/* destroy the job, replayed results never started it */
+	if (pk_backend_job_get_started (transaction->priv->job))
+		pk_backend_stop_job (transaction->priv->backend, transaction->priv->job);
 
 	/* we emit last, as other backends will be running very soon after us, and we don't want to be notified */
 	pk_transaction_finished_emit (transaction, exit_enum, time_ms);
@@ -1359,16 +1721,54 @@ pk_transaction_package_cb (PkBackend *backend,
 	update_severity = pk_package_get_update_severity (item);
 	encoded_value = info | (((guint32) update_severity) << 16);
 
-	g_dbus_connection_emit_signal (transaction->priv->connection,
-				       NULL,
-				       transaction->priv->tid,
-				       PK_DBUS_INTERFACE_TRANSACTION,
-				       "Package",
-				       g_variant_new ("(uss)",
-						      encoded_value,
-						      package_id,
-						      summary ? summary : ""),
-				       NULL);
+	pk_transaction_emit_signal (transaction,
+				    "Package",
+				    g_variant_new ("(uss)",
+						   encoded_value,
+						   package_id,
+						   summary ? summary : ""));
+}
+
+/**
+ * pk_transaction_emit_packages_fd:
+ *
+ * Sends the packages to the client as a sealed memfd, so that neither the
+ * bus daemon nor the client has to copy the whole list.
+ **/
+static gboolean
+pk_transaction_emit_packages_fd (PkTransaction *transaction, GPtrArray *package_array)
+{
+	PkTransactionPrivate *priv = transaction->priv;
+	gint fd;
+	g_autoptr(GDBusMessage) message = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GUnixFDList) fd_list = NULL;
+
+	fd = pk_packages_fd_new (package_array, &error);
+	if (fd < 0) {
+		g_warning ("failed to create package list: %s", error->message);
+		return FALSE;
+	}
+	fd_list = g_unix_fd_list_new_from_array (&fd, 1);
+
+	/* only the client asked for this, so don't broadcast it */
+	message = g_dbus_message_new_signal (priv->tid,
+					     PK_DBUS_INTERFACE_TRANSACTION,
+					     "PackagesFd");
+	g_dbus_message_set_destination (message, priv->sender);
+	g_dbus_message_set_body (message, g_variant_new ("(h)", 0));
+	g_dbus_message_set_unix_fd_list (message, fd_list);
+	if (!g_dbus_connection_send_message (priv->connection, message,
+					     G_DBUS_SEND_MESSAGE_FLAGS_NONE,
+					     NULL, &error)) {
+		g_warning ("failed to send package list: %s", error->message);
+		return FALSE;
+	}
+	g_debug ("sent %u packages as a file descriptor", package_array->len);
+	priv->n_signals_emitted++;
+	if (priv->time_first_result == 0)
+		priv->time_first_result = g_get_monotonic_time ();
+	return TRUE;
 }
 
 static void
@@ -1378,7 +1778,7 @@ pk_transaction_packages_cb (PkBackend *backend,
 {
 	g_auto(GVariantBuilder) builder = G_VARIANT_BUILDER_INIT (G_VARIANT_TYPE ("a(uss)"));
 	g_autoptr(GVariant) package_array_variant = NULL;
-	guint n_added_packages = 0;
+	g_autoptr(GPtrArray) added = NULL;
 	gboolean emitted = FALSE;
 
 	g_return_if_fail (PK_IS_TRANSACTION (transaction));
@@ -1390,15 +1790,13 @@ pk_transaction_packages_cb (PkBackend *backend,
 		return;
 	}
 
-	/* Loop through the packages and build a signal emission. */
+	/* Loop through the packages and check what to emit. */
+	added = g_ptr_array_sized_new (package_array->len);
 	for (guint i = 0; i < package_array->len; i++) {
 		PkPackage *item = g_ptr_array_index (package_array, i);
 		const gchar *role_text;
 		PkInfoEnum info;
-		PkInfoEnum update_severity;
 		const gchar *package_id;
-		const gchar *summary = NULL;
-		guint encoded_value;
 
 		/* check the backend is doing the right thing */
 		info = pk_package_get_info (item);
@@ -1442,31 +1840,45 @@ pk_transaction_packages_cb (PkBackend *backend,
 		package_id = pk_package_get_id (item);
 		g_free (transaction->priv->last_package_id);
 		transaction->priv->last_package_id = g_strdup (package_id);
-		summary = pk_package_get_summary (item);
 		if (transaction->priv->role != PK_ROLE_ENUM_GET_PACKAGES) {
 			g_debug ("emit package %s, %s, %s",
 				 pk_info_enum_to_string (info),
 				 package_id,
-				 summary);
+				 pk_package_get_summary (item));
 		}
+		g_ptr_array_add (added, item);
+	}
+
+	if (added->len == 0) {
+		g_debug ("Empty package array");
+		return;
+	}
 
-		/* Safety checks, that the two values do not interleave, neither overflow */
-		g_assert ((PK_INFO_ENUM_LAST & (~0xFFFF)) == 0);
+	/* Very large query results go to the client as a file descriptor
+	 * if it asked for that. Packages from a modifying transaction are
+	 * still signalled as they are used to show progress. */
+	if (transaction->priv->client_supports_packages_fd &&
+	    !transaction->priv->signals_paused &&
+	    added->len >= PK_PACKAGES_FD_THRESHOLD &&
+	    pk_transaction_role_is_query (transaction->priv->role) &&
+	    pk_transaction_emit_packages_fd (transaction, added))
+		return;
 
-		update_severity = pk_package_get_update_severity (item);
-		encoded_value = info | (((guint32) update_severity) << 16);
+	/* Safety checks, that the two values do not interleave, neither overflow */
+	g_assert ((PK_INFO_ENUM_LAST & (~0xFFFF)) == 0);
 
+	for (guint i = 0; i < added->len; i++) {
+		PkPackage *item = g_ptr_array_index (added, i);
+		const gchar *summary = pk_package_get_summary (item);
+		guint encoded_value;
+
+		encoded_value = pk_package_get_info (item) |
+				(((guint32) pk_package_get_update_severity (item)) << 16);
 		g_variant_builder_add (&builder,
 				       "(uss)",
 				       encoded_value,
-				       package_id,
+				       pk_package_get_id (item),
 				       summary ? summary : "");
-		n_added_packages++;
-	}
-
-	if (n_added_packages == 0) {
-		g_debug ("Empty package array");
-		return;
 	}
 
 	package_array_variant = g_variant_ref_sink (g_variant_builder_end (&builder));
@@ -1481,14 +1893,10 @@ pk_transaction_packages_cb (PkBackend *backend,
 	 * maximum message size of 128MB) until it’s listing on the order of
 	 * 100000 packages. If it does, we fall back below. */
 	if (transaction->priv->client_supports_plural_signals &&
-	    g_dbus_connection_emit_signal (transaction->priv->connection,
-					   NULL,
-					   transaction->priv->tid,
-					   PK_DBUS_INTERFACE_TRANSACTION,
-					   "Packages",
-					   g_variant_new ("(@a(uss))",
-					                  package_array_variant),
-					   NULL))
+	    pk_transaction_emit_signal (transaction,
+					"Packages",
+					g_variant_new ("(@a(uss))",
+						       package_array_variant)))
 		emitted = TRUE;
 
 	if (!emitted) {
@@ -1499,13 +1907,9 @@ pk_transaction_packages_cb (PkBackend *backend,
 		g_variant_iter_init (&iter, package_array_variant);
 
 		while ((child = g_variant_iter_next_value (&iter))) {
-			g_dbus_connection_emit_signal (transaction->priv->connection,
-						       NULL,
-						       transaction->priv->tid,
-						       PK_DBUS_INTERFACE_TRANSACTION,
-						       "Package",
-						       child,
-						       NULL);
+			pk_transaction_emit_signal (transaction,
+						    "Package",
+						    child);
 			g_clear_pointer (&child, g_variant_unref);
 		}
 	}
@@ -1531,16 +1935,12 @@ pk_transaction_repo_detail_cb (PkBackend *backend,
 	description = pk_repo_detail_get_description (item);
 	enabled = pk_repo_detail_get_enabled (item);
 	g_debug ("emitting repo-detail %s, %s, %i", repo_id, description, enabled);
-	g_dbus_connection_emit_signal (transaction->priv->connection,
-				       NULL,
-				       transaction->priv->tid,
-				       PK_DBUS_INTERFACE_TRANSACTION,
-				       "RepoDetail",
-				       g_variant_new ("(ssb)",
-						      repo_id,
-						      description != NULL ? description : "",
-						      enabled),
-				       NULL);
+	pk_transaction_emit_signal (transaction,
+				    "RepoDetail",
+				    g_variant_new ("(ssb)",
+						   repo_id,
+						   description != NULL ? description : "",
+						   enabled));
 }
 
 static void
@@ -1580,21 +1980,17 @@ pk_transaction_repo_signature_required_cb (PkBackend *backend,
 		 package_id, repository_name, key_url, key_userid, key_id,
 		 key_fingerprint, key_timestamp,
 		 pk_sig_type_enum_to_string (type));
-	g_dbus_connection_emit_signal (transaction->priv->connection,
-				       NULL,
-				       transaction->priv->tid,
-				       PK_DBUS_INTERFACE_TRANSACTION,
-				       "RepoSignatureRequired",
-				       g_variant_new ("(sssssssu)",
-						      package_id,
-						      repository_name,
-						      key_url != NULL ? key_url : "",
-						      key_userid != NULL ? key_userid : "",
-						      key_id != NULL ? key_id : "",
-						      key_fingerprint != NULL ? key_fingerprint : "",
-						      key_timestamp != NULL ? key_timestamp : "",
-						      type),
-				       NULL);
+	pk_transaction_emit_signal (transaction,
+				    "RepoSignatureRequired",
+				    g_variant_new ("(sssssssu)",
+						   package_id,
+						   repository_name,
+						   key_url != NULL ? key_url : "",
+						   key_userid != NULL ? key_userid : "",
+						   key_id != NULL ? key_id : "",
+						   key_fingerprint != NULL ? key_fingerprint : "",
+						   key_timestamp != NULL ? key_timestamp : "",
+						   type));
 
 	/* we should mark this transaction so that we finish with a special code */
 	transaction->priv->emit_signature_required = TRUE;
@@ -1625,17 +2021,13 @@ pk_transaction_eula_required_cb (PkBackend *backend,
 	/* emit */
 	g_debug ("emitting eula-required %s, %s, %s, %s",
 		   eula_id, package_id, vendor_name, license_agreement);
-	g_dbus_connection_emit_signal (transaction->priv->connection,
-				       NULL,
-				       transaction->priv->tid,
-				       PK_DBUS_INTERFACE_TRANSACTION,
-				       "EulaRequired",
-				       g_variant_new ("(ssss)",
-						      eula_id,
-						      package_id,
-						      vendor_name != NULL ? vendor_name : "",
-						      license_agreement != NULL ? license_agreement : ""),
-				       NULL);
+	pk_transaction_emit_signal (transaction,
+				    "EulaRequired",
+				    g_variant_new ("(ssss)",
+						   eula_id,
+						   package_id,
+						   vendor_name != NULL ? vendor_name : "",
+						   license_agreement != NULL ? license_agreement : ""));
 
 	/* we should mark this transaction so that we finish with a special code */
 	transaction->priv->emit_eula_required = TRUE;
@@ -1668,16 +2060,12 @@ pk_transaction_media_change_required_cb (PkBackend *backend,
 		 pk_media_type_enum_to_string (media_type),
 		 media_id,
 		 media_text);
-	g_dbus_connection_emit_signal (transaction->priv->connection,
-				       NULL,
-				       transaction->priv->tid,
-				       PK_DBUS_INTERFACE_TRANSACTION,
-				       "MediaChangeRequired",
-				       g_variant_new ("(uss)",
-						      media_type,
-						      media_id,
-						      media_text != NULL ? media_text : ""),
-				       NULL);
+	pk_transaction_emit_signal (transaction,
+				    "MediaChangeRequired",
+				    g_variant_new ("(uss)",
+						   media_type,
+						   media_id,
+						   media_text != NULL ? media_text : ""));
 
 	/* we should mark this transaction so that we finish with a special code */
 	transaction->priv->emit_media_change_required = TRUE;
@@ -1733,15 +2121,11 @@ pk_transaction_require_restart_cb (PkBackend *backend,
 	g_debug ("emitting require-restart %s, '%s'",
 		 pk_restart_enum_to_string (restart),
 		 package_id);
-	g_dbus_connection_emit_signal (transaction->priv->connection,
-				       NULL,
-				       transaction->priv->tid,
-				       PK_DBUS_INTERFACE_TRANSACTION,
-				       "RequireRestart",
-				       g_variant_new ("(us)",
-						      restart,
-						      package_id),
-				       NULL);
+	pk_transaction_emit_signal (transaction,
+				    "RequireRestart",
+				    g_variant_new ("(us)",
+						   restart,
+						   package_id));
 }
 
 static void
@@ -1771,17 +2155,7 @@ pk_transaction_update_detail_cb (PkBackend *backend,
 				 PkUpdateDetail *item,
 				 PkTransaction *transaction)
 {
-	const gchar *changelog;
-	const gchar *issued;
-	const gchar *package_id;
-	const gchar *updated;
-	const gchar *update_text;
-	gchar **bugzilla_urls;
-	gchar **cve_urls;
-	gchar *empty[] = { NULL };
-	gchar **obsoletes;
-	gchar **updates;
-	gchar **vendor_urls;
+	g_autoptr(GVariant) value = NULL;
 
 	g_return_if_fail (PK_IS_TRANSACTION (transaction));
 	g_return_if_fail (transaction->priv->tid != NULL);
@@ -1789,37 +2163,10 @@ pk_transaction_update_detail_cb (PkBackend *backend,
 	/* add to results */
 	pk_results_add_update_detail (transaction->priv->results, item);
 
-	/* emit */
-	package_id = pk_update_detail_get_package_id (item);
-	updates = pk_update_detail_get_updates (item);
-	obsoletes = pk_update_detail_get_obsoletes (item);
-	vendor_urls = pk_update_detail_get_vendor_urls (item);
-	bugzilla_urls = pk_update_detail_get_bugzilla_urls (item);
-	cve_urls = pk_update_detail_get_cve_urls (item);
-	update_text = pk_update_detail_get_update_text (item);
-	changelog = pk_update_detail_get_changelog (item);
-	issued = pk_update_detail_get_issued (item);
-	updated = pk_update_detail_get_updated (item);
-	g_debug ("emitting update-detail for %s", package_id);
-	g_dbus_connection_emit_signal (transaction->priv->connection,
-				       NULL,
-				       transaction->priv->tid,
-				       PK_DBUS_INTERFACE_TRANSACTION,
-				       "UpdateDetail",
-				       g_variant_new ("(s^as^as^as^as^asussuss)",
-						      package_id,
-						      updates != NULL ? updates : empty,
-						      obsoletes != NULL ? obsoletes : empty,
-						      vendor_urls != NULL ? vendor_urls : empty,
-						      bugzilla_urls != NULL ? bugzilla_urls : empty,
-						      cve_urls != NULL ? cve_urls : empty,
-						      pk_update_detail_get_restart (item),
-						      update_text != NULL ? update_text : "",
-						      changelog != NULL ? changelog : "",
-						      pk_update_detail_get_state (item),
-						      issued != NULL ? issued : "",
-						      updated != NULL ? updated : ""),
-				       NULL);
+	/* emit what the backend thread serialized */
+	g_debug ("emitting update-detail for %s", pk_update_detail_get_package_id (item));
+	value = pk_backend_job_get_update_detail_variant (item);
+	pk_transaction_emit_signal (transaction, "UpdateDetail", value);
 }
 
 static void
@@ -1827,68 +2174,34 @@ pk_transaction_update_details_cb (PkBackend *backend,
 				  GPtrArray *update_details_array,  /* (element-type PkUpdateDetail) */
 				  PkTransaction *transaction)
 {
-	g_auto(GVariantBuilder) builder = G_VARIANT_BUILDER_INIT (G_VARIANT_TYPE ("a(sasasasasasussuss)"));
+	g_autoptr(GPtrArray) children = NULL;
 	g_autoptr(GVariant) update_details_array_variant = NULL;
-	guint n_update_details = 0;
 	gboolean emitted = FALSE;
 
 	g_return_if_fail (PK_IS_TRANSACTION (transaction));
 	g_return_if_fail (transaction->priv->tid != NULL);
 
-	/* Loop through the packages and build a signal emission. */
+	/* Loop through the packages and collect what the backend thread
+	 * serialized for the signal emission. */
+	children = g_ptr_array_new_with_free_func ((GDestroyNotify) g_variant_unref);
 	for (guint i = 0; i < update_details_array->len; i++) {
 		PkUpdateDetail *item = g_ptr_array_index (update_details_array, i);
-		const gchar *changelog;
-		const gchar *issued;
-		const gchar *package_id;
-		const gchar *updated;
-		const gchar *update_text;
-		const gchar * const *bugzilla_urls;
-		const gchar * const *cve_urls;
-		const gchar * const empty[] = { NULL };
-		const gchar * const *obsoletes;
-		const gchar * const *updates;
-		const gchar * const *vendor_urls;
 
 		/* add to results */
 		pk_results_add_update_detail (transaction->priv->results, item);
 
-		/* emit */
-		package_id = pk_update_detail_get_package_id (item);
-		updates = (const gchar * const *) pk_update_detail_get_updates (item);
-		obsoletes = (const gchar * const *) pk_update_detail_get_obsoletes (item);
-		vendor_urls = (const gchar * const *) pk_update_detail_get_vendor_urls (item);
-		bugzilla_urls = (const gchar * const *) pk_update_detail_get_bugzilla_urls (item);
-		cve_urls = (const gchar * const *) pk_update_detail_get_cve_urls (item);
-		update_text = pk_update_detail_get_update_text (item);
-		changelog = pk_update_detail_get_changelog (item);
-		issued = pk_update_detail_get_issued (item);
-		updated = pk_update_detail_get_updated (item);
-		g_debug ("emitting update-detail for %s", package_id);
+		g_debug ("emitting update-detail for %s", pk_update_detail_get_package_id (item));
+		g_ptr_array_add (children, pk_backend_job_get_update_detail_variant (item));
+	}
 
-		g_variant_builder_add (&builder,
-				       "(s^as^as^as^as^asussuss)",
-				       package_id,
-				       updates != NULL ? updates : empty,
-				       obsoletes != NULL ? obsoletes : empty,
-				       vendor_urls != NULL ? vendor_urls : empty,
-				       bugzilla_urls != NULL ? bugzilla_urls : empty,
-				       cve_urls != NULL ? cve_urls : empty,
-				       pk_update_detail_get_restart (item),
-				       update_text != NULL ? update_text : "",
-				       changelog != NULL ? changelog : "",
-				       pk_update_detail_get_state (item),
-				       issued != NULL ? issued : "",
-				       updated != NULL ? updated : "");
-		n_update_details++;
-	}
-
-	if (n_update_details == 0) {
+	if (children->len == 0) {
 		g_debug ("Empty update details array");
 		return;
 	}
 
-	update_details_array_variant = g_variant_ref_sink (g_variant_builder_end (&builder));
+	update_details_array_variant = g_variant_ref_sink (g_variant_new_array (G_VARIANT_TYPE ("(sasasasasasussuss)"),
+										 (GVariant **) children->pdata,
+										 children->len));
 
 	/* Emit the signal. Grouping multiple update details into a single
 	 * signal reduces the number of signals and hence the amount of context
@@ -1901,32 +2214,18 @@ pk_transaction_update_details_cb (PkBackend *backend,
 	 * 6400 updates, if we assume 10KB of changelog/details per update.
 	 * If it does hit the limits, we fall back to the old code below. */
 	if (transaction->priv->client_supports_plural_signals &&
-	    g_dbus_connection_emit_signal (transaction->priv->connection,
-					   NULL,
-					   transaction->priv->tid,
-					   PK_DBUS_INTERFACE_TRANSACTION,
-					   "UpdateDetails",
-					   g_variant_new ("(@a(sasasasasasussuss))",
-					                  update_details_array_variant),
-					   NULL))
+	    pk_transaction_emit_signal (transaction,
+					"UpdateDetails",
+					g_variant_new ("(@a(sasasasasasussuss))",
+						       update_details_array_variant)))
 		emitted = TRUE;
 
 	if (!emitted) {
-		GVariantIter iter;
-		g_autoptr(GVariant) child = NULL;
-
 		/* Fall back to one signal per update details. */
-		g_variant_iter_init (&iter, update_details_array_variant);
-
-		while ((child = g_variant_iter_next_value (&iter))) {
-			g_dbus_connection_emit_signal (transaction->priv->connection,
-						       NULL,
-						       transaction->priv->tid,
-						       PK_DBUS_INTERFACE_TRANSACTION,
-						       "UpdateDetail",
-						       child,
-						       NULL);
-			g_clear_pointer (&child, g_variant_unref);
+		for (guint i = 0; i < children->len; i++) {
+			pk_transaction_emit_signal (transaction,
+						    "UpdateDetail",
+						    g_ptr_array_index (children, i));
 		}
 	}
 }
@@ -1955,20 +2254,22 @@ pk_transaction_set_session_state (PkTransaction *transaction,
 		return FALSE;
 	}
 
-	/* get from database */
-	ret = pk_transaction_db_get_proxy (priv->transaction_db,
-					   priv->client_uid,
-					   session,
-					   &proxy_http,
-					   &proxy_https,
-					   &proxy_ftp,
-					   &proxy_socks,
-					   &no_proxy,
-					   &pac);
-	if (!ret) {
-		g_set_error_literal (error, 1, 0,
-				     "failed to get the proxy from the database");
-		return FALSE;
+	/* get from database, without one no proxy can have been set */
+	if (priv->transaction_db != NULL) {
+		ret = pk_transaction_db_get_proxy (priv->transaction_db,
+						   priv->client_uid,
+						   session,
+						   &proxy_http,
+						   &proxy_https,
+						   &proxy_ftp,
+						   &proxy_socks,
+						   &no_proxy,
+						   &pac);
+		if (!ret) {
+			g_set_error_literal (error, 1, 0,
+					     "failed to get the proxy from the database");
+			return FALSE;
+		}
 	}
 
 	/* try to set the new proxy */
@@ -2027,148 +2328,163 @@ pk_transaction_percentage_cb (PkBackendJob *job,
 	schedule_progress_changed (transaction);
 }
 
-gboolean
-pk_transaction_run (PkTransaction *transaction)
+static void
+pk_transaction_connect_job_vfuncs (PkTransaction *transaction)
 {
-	GError *error = NULL;
-	PkExitEnum exit_status;
-	PkTransactionPrivate *priv = PK_TRANSACTION_GET_PRIVATE (transaction);
-
-	g_return_val_if_fail (PK_IS_TRANSACTION (transaction), FALSE);
-	g_return_val_if_fail (priv->tid != NULL, FALSE);
-	g_return_val_if_fail (transaction->priv->backend != NULL, FALSE);
-
-	/* we are no longer waiting, we are setting up */
-	pk_transaction_status_changed_emit (transaction, PK_STATUS_ENUM_SETUP);
-
-	/* set proxy */
-	if (!pk_transaction_set_session_state (transaction, &error)) {
-		g_debug ("failed to set the session state (non-fatal): %s",
-			 error->message);
-		g_clear_error (&error);
-	}
-
-	/* already cancelled? */
-	if (pk_backend_job_get_exit_code (priv->job) == PK_EXIT_ENUM_CANCELLED) {
-		exit_status = pk_backend_job_get_exit_code (priv->job);
-		pk_transaction_finished_emit (transaction, exit_status, 0);
-		return TRUE;
-	}
-
-	/* run the job */
-	pk_backend_start_job (priv->backend, priv->job);
-
-	/* is an error code set? */
-	if (pk_backend_job_get_is_error_set (priv->job)) {
-		exit_status = pk_backend_job_get_exit_code (priv->job);
-		pk_transaction_finished_emit (transaction, exit_status, 0);
-		/* do not fail the transaction */
-	}
-
-	/* check if we should skip this transaction */
-	if (pk_backend_job_get_exit_code (priv->job) == PK_EXIT_ENUM_SKIP_TRANSACTION) {
-		pk_transaction_finished_emit (transaction, PK_EXIT_ENUM_SUCCESS, 0);
-		/* do not fail the transaction */
-	}
-
-	/* set the role */
-	pk_backend_job_set_role (priv->job, priv->role);
-	g_debug ("setting role for %s to %s",
-		 priv->tid,
-		 pk_role_enum_to_string (priv->role));
-
-	/* reset after the pre-transaction checks */
-	pk_backend_job_set_percentage (priv->job, PK_BACKEND_PERCENTAGE_INVALID);
-
 	/* connect signal to receive backend lock changes */
-	pk_backend_job_set_vfunc (priv->job,
+	pk_backend_job_set_vfunc (transaction->priv->job,
 				  PK_BACKEND_SIGNAL_LOCKED_CHANGED,
 				  PK_BACKEND_JOB_VFUNC (pk_transaction_locked_changed_cb),
 				  transaction);
-	pk_backend_job_set_vfunc (priv->job,
+	pk_backend_job_set_vfunc (transaction->priv->job,
 				  PK_BACKEND_SIGNAL_ALLOW_CANCEL,
 				  PK_BACKEND_JOB_VFUNC (pk_transaction_allow_cancel_cb),
 				  transaction);
-	pk_backend_job_set_vfunc (priv->job,
+	pk_backend_job_set_vfunc (transaction->priv->job,
 				  PK_BACKEND_SIGNAL_DETAILS,
 				  PK_BACKEND_JOB_VFUNC (pk_transaction_details_cb),
 				  transaction);
-	pk_backend_job_set_vfunc (priv->job,
+	pk_backend_job_set_vfunc (transaction->priv->job,
+				  PK_BACKEND_SIGNAL_DETAILS_LIST,
+				  PK_BACKEND_JOB_VFUNC (pk_transaction_details_list_cb),
+				  transaction);
+	pk_backend_job_set_vfunc (transaction->priv->job,
 				  PK_BACKEND_SIGNAL_ERROR_CODE,
 				  PK_BACKEND_JOB_VFUNC (pk_transaction_error_code_cb),
 				  transaction);
-	pk_backend_job_set_vfunc (priv->job,
+	pk_backend_job_set_vfunc (transaction->priv->job,
 				  PK_BACKEND_SIGNAL_FILES,
 				  PK_BACKEND_JOB_VFUNC (pk_transaction_files_cb),
 				  transaction);
-	pk_backend_job_set_vfunc (priv->job,
+	pk_backend_job_set_vfunc (transaction->priv->job,
+				  PK_BACKEND_SIGNAL_FILES_LIST,
+				  PK_BACKEND_JOB_VFUNC (pk_transaction_files_list_cb),
+				  transaction);
+	pk_backend_job_set_vfunc (transaction->priv->job,
 				  PK_BACKEND_SIGNAL_DISTRO_UPGRADE,
 				  PK_BACKEND_JOB_VFUNC (pk_transaction_distro_upgrade_cb),
 				  transaction);
-	pk_backend_job_set_vfunc (priv->job,
+	pk_backend_job_set_vfunc (transaction->priv->job,
 				  PK_BACKEND_SIGNAL_FINISHED,
 				  PK_BACKEND_JOB_VFUNC (pk_transaction_finished_cb),
 				  transaction);
-	pk_backend_job_set_vfunc (priv->job,
+	pk_backend_job_set_vfunc (transaction->priv->job,
 				  PK_BACKEND_SIGNAL_PACKAGE,
 				  PK_BACKEND_JOB_VFUNC (pk_transaction_package_cb),
 				  transaction);
-	pk_backend_job_set_vfunc (priv->job,
+	pk_backend_job_set_vfunc (transaction->priv->job,
 				  PK_BACKEND_SIGNAL_PACKAGES,
 				  PK_BACKEND_JOB_VFUNC (pk_transaction_packages_cb),
 				  transaction);
-	pk_backend_job_set_vfunc (priv->job,
+	pk_backend_job_set_vfunc (transaction->priv->job,
 				  PK_BACKEND_SIGNAL_ITEM_PROGRESS,
 				  PK_BACKEND_JOB_VFUNC (pk_transaction_item_progress_cb),
 				  transaction);
-	pk_backend_job_set_vfunc (priv->job,
+	pk_backend_job_set_vfunc (transaction->priv->job,
 				  PK_BACKEND_SIGNAL_PERCENTAGE,
 				  PK_BACKEND_JOB_VFUNC (pk_transaction_percentage_cb),
 				  transaction);
-	pk_backend_job_set_vfunc (priv->job,
+	pk_backend_job_set_vfunc (transaction->priv->job,
 				  PK_BACKEND_SIGNAL_SPEED,
 				  PK_BACKEND_JOB_VFUNC (pk_transaction_speed_cb),
 				  transaction);
-	pk_backend_job_set_vfunc (priv->job,
+	pk_backend_job_set_vfunc (transaction->priv->job,
 				  PK_BACKEND_SIGNAL_DOWNLOAD_SIZE_REMAINING,
 				  PK_BACKEND_JOB_VFUNC (pk_transaction_download_size_remaining_cb),
 				  transaction);
-	pk_backend_job_set_vfunc (priv->job,
+	pk_backend_job_set_vfunc (transaction->priv->job,
 				  PK_BACKEND_SIGNAL_REPO_DETAIL,
 				  PK_BACKEND_JOB_VFUNC (pk_transaction_repo_detail_cb),
 				  transaction);
-	pk_backend_job_set_vfunc (priv->job,
+	pk_backend_job_set_vfunc (transaction->priv->job,
 				  PK_BACKEND_SIGNAL_REPO_SIGNATURE_REQUIRED,
 				  PK_BACKEND_JOB_VFUNC (pk_transaction_repo_signature_required_cb),
 				  transaction);
-	pk_backend_job_set_vfunc (priv->job,
+	pk_backend_job_set_vfunc (transaction->priv->job,
 				  PK_BACKEND_SIGNAL_EULA_REQUIRED,
 				  PK_BACKEND_JOB_VFUNC (pk_transaction_eula_required_cb),
 				  transaction);
-	pk_backend_job_set_vfunc (priv->job,
+	pk_backend_job_set_vfunc (transaction->priv->job,
 				  PK_BACKEND_SIGNAL_MEDIA_CHANGE_REQUIRED,
 				  PK_BACKEND_JOB_VFUNC (pk_transaction_media_change_required_cb),
 				  transaction);
-	pk_backend_job_set_vfunc (priv->job,
+	pk_backend_job_set_vfunc (transaction->priv->job,
 				  PK_BACKEND_SIGNAL_REQUIRE_RESTART,
 				  PK_BACKEND_JOB_VFUNC (pk_transaction_require_restart_cb),
 				  transaction);
-	pk_backend_job_set_vfunc (priv->job,
+	pk_backend_job_set_vfunc (transaction->priv->job,
 				  PK_BACKEND_SIGNAL_STATUS_CHANGED,
 				  PK_BACKEND_JOB_VFUNC (pk_transaction_status_changed_cb),
 				  transaction);
-	pk_backend_job_set_vfunc (priv->job,
+	pk_backend_job_set_vfunc (transaction->priv->job,
 				  PK_BACKEND_SIGNAL_UPDATE_DETAIL,
 				  PK_BACKEND_JOB_VFUNC (pk_transaction_update_detail_cb),
 				  transaction);
-	pk_backend_job_set_vfunc (priv->job,
+	pk_backend_job_set_vfunc (transaction->priv->job,
 				  PK_BACKEND_SIGNAL_UPDATE_DETAILS,
 				  PK_BACKEND_JOB_VFUNC (pk_transaction_update_details_cb),
 				  transaction);
-	pk_backend_job_set_vfunc (priv->job,
+	pk_backend_job_set_vfunc (transaction->priv->job,
 				  PK_BACKEND_SIGNAL_CATEGORY,
 				  PK_BACKEND_JOB_VFUNC (pk_transaction_category_cb),
 				  transaction);
+}
+
+gboolean
+pk_transaction_run (PkTransaction *transaction)
+{
+	GError *error = NULL;
+	PkExitEnum exit_status;
+	PkTransactionPrivate *priv = PK_TRANSACTION_GET_PRIVATE (transaction);
+
+	g_return_val_if_fail (PK_IS_TRANSACTION (transaction), FALSE);
+	g_return_val_if_fail (priv->tid != NULL, FALSE);
+	g_return_val_if_fail (transaction->priv->backend != NULL, FALSE);
+
+	/* we are no longer waiting, we are setting up */
+	pk_transaction_status_changed_emit (transaction, PK_STATUS_ENUM_SETUP);
+
+	/* set proxy */
+	if (!pk_transaction_set_session_state (transaction, &error)) {
+		g_debug ("failed to set the session state (non-fatal): %s",
+			 error->message);
+		g_clear_error (&error);
+	}
+
+	/* already cancelled? */
+	if (pk_backend_job_get_exit_code (priv->job) == PK_EXIT_ENUM_CANCELLED) {
+		exit_status = pk_backend_job_get_exit_code (priv->job);
+		pk_transaction_finished_emit (transaction, exit_status, 0);
+		return TRUE;
+	}
+
+	/* run the job */
+	pk_backend_start_job (priv->backend, priv->job);
+
+	/* is an error code set? */
+	if (pk_backend_job_get_is_error_set (priv->job)) {
+		exit_status = pk_backend_job_get_exit_code (priv->job);
+		pk_transaction_finished_emit (transaction, exit_status, 0);
+		/* do not fail the transaction */
+	}
+
+	/* check if we should skip this transaction */
+	if (pk_backend_job_get_exit_code (priv->job) == PK_EXIT_ENUM_SKIP_TRANSACTION) {
+		pk_transaction_finished_emit (transaction, PK_EXIT_ENUM_SUCCESS, 0);
+		/* do not fail the transaction */
+	}
+
+	/* set the role */
+	pk_backend_job_set_role (priv->job, priv->role);
+	g_debug ("setting role for %s to %s",
+		 priv->tid,
+		 pk_role_enum_to_string (priv->role));
+
+	/* reset after the pre-transaction checks */
+	pk_backend_job_set_percentage (priv->job, PK_BACKEND_PERCENTAGE_INVALID);
+
+	/* connect signals to receive the backend results */
+	pk_transaction_connect_job_vfuncs (transaction);
 
 	/* do the correct action with the cached parameters */
 	switch (priv->role) {
@@ -2361,6 +2677,96 @@ pk_transaction_run (PkTransaction *transaction)
 	return TRUE;
 }
 
+/**
+ * pk_transaction_replay:
+ *
+ * Finishes the transaction with the results of another transaction
+ * that did the same query, without running the backend again.
+ **/
+gboolean
+pk_transaction_replay (PkTransaction *transaction, PkResults *results)
+{
+	GError *error = NULL;
+	PkTransactionPrivate *priv = PK_TRANSACTION_GET_PRIVATE (transaction);
+
+	g_return_val_if_fail (PK_IS_TRANSACTION (transaction), FALSE);
+	g_return_val_if_fail (PK_IS_RESULTS (results), FALSE);
+	g_return_val_if_fail (priv->tid != NULL, FALSE);
+	g_return_val_if_fail (transaction->priv->backend != NULL, FALSE);
+
+	/* we are no longer waiting, we are setting up */
+	pk_transaction_status_changed_emit (transaction, PK_STATUS_ENUM_SETUP);
+
+	/* set proxy and uid, so the job looks like it has been run */
+	if (!pk_transaction_set_session_state (transaction, &error)) {
+		g_debug ("failed to set the session state (non-fatal): %s",
+			 error->message);
+		g_clear_error (&error);
+	}
+
+	/* already cancelled? */
+	if (pk_backend_job_get_exit_code (priv->job) == PK_EXIT_ENUM_CANCELLED) {
+		pk_transaction_finished_emit (transaction, PK_EXIT_ENUM_CANCELLED, 0);
+		return TRUE;
+	}
+
+	/* the results are only passed through the job to reach the client,
+	 * the backend itself is not started, so nothing is locked or set up */
+	pk_backend_job_set_backend (priv->job, priv->backend);
+	pk_backend_job_set_role (priv->job, priv->role);
+	pk_backend_job_set_percentage (priv->job, PK_BACKEND_PERCENTAGE_INVALID);
+	pk_transaction_connect_job_vfuncs (transaction);
+
+	g_debug ("replaying results for %s", priv->tid);
+	pk_backend_job_set_status (priv->job, PK_STATUS_ENUM_QUERY);
+	pk_backend_job_replay_results (priv->job, results);
+	pk_backend_job_finished (priv->job);
+	return TRUE;
+}
+
+/**
+ * pk_transaction_get_coalesce_key:
+ *
+ * Return value: a string identifying the query done by the transaction,
+ * or %NULL if the transaction does more than just querying
+ **/
+gchar *
+pk_transaction_get_coalesce_key (PkTransaction *transaction)
+{
+	PkTransactionPrivate *priv = transaction->priv;
+	GString *key;
+
+	g_return_val_if_fail (PK_IS_TRANSACTION (transaction), NULL);
+
+	if (!pk_transaction_role_is_query (priv->role))
+		return NULL;
+
+	/* everything the backend gets to see, the summaries are translated */
+	key = g_string_new (pk_role_enum_to_string (priv->role));
+	g_string_append_printf (key, "\t%" G_GUINT64_FORMAT "\t%" G_GUINT64_FORMAT "\t%i\t%s",
+				priv->cached_filters,
+				priv->cached_transaction_flags,
+				priv->cached_force,
+				pk_backend_job_get_locale (priv->job) != NULL ?
+					pk_backend_job_get_locale (priv->job) : "");
+	if (priv->cached_package_ids != NULL) {
+		g_autofree gchar *tmp = g_strjoinv ("\t", priv->cached_package_ids);
+		g_string_append_printf (key, "\tids:%s", tmp);
+	}
+	if (priv->cached_values != NULL) {
+		g_autofree gchar *tmp = g_strjoinv ("\t", priv->cached_values);
+		g_string_append_printf (key, "\tvalues:%s", tmp);
+	}
+	return g_string_free (key, FALSE);
+}
+
+PkResults *
+pk_transaction_get_results (PkTransaction *transaction)
+{
+	g_return_val_if_fail (PK_IS_TRANSACTION (transaction), NULL);
+	return transaction->priv->results;
+}
+
 const gchar *
 pk_transaction_get_tid (PkTransaction *transaction)
 {
@@ -2378,6 +2784,14 @@ pk_transaction_is_exclusive (PkTransaction *transaction)
 	return transaction->priv->exclusive;
 }
 
+gboolean
+pk_transaction_is_query (PkTransaction *transaction)
+{
+	g_return_val_if_fail (PK_IS_TRANSACTION (transaction), FALSE);
+
+	return pk_transaction_role_is_query (transaction->priv->role);
+}
+
 void
 pk_transaction_make_exclusive (PkTransaction *transaction)
 {
@@ -2389,7 +2803,7 @@ pk_transaction_make_exclusive (PkTransaction *transaction)
 }
 
 static void
-pk_transaction_vanished_cb (GDBusConnection *connection,
+pk_transaction_vanished_cb (PkDbus *dbus,
 			    const gchar *name,
 			    gpointer user_data)
 {
@@ -2418,15 +2832,6 @@ pk_transaction_set_sender (PkTransaction *transaction, const gchar *sender)
 	g_debug ("setting sender to %s", sender);
 	priv->sender = g_strdup (sender);
 
-	priv->watch_id =
-		g_bus_watch_name (G_BUS_TYPE_SYSTEM,
-				  sender,
-				  G_BUS_NAME_WATCHER_FLAGS_NONE,
-				  NULL,
-				  pk_transaction_vanished_cb,
-				  transaction,
-				  NULL);
-
 	/* we get the UID for all callers as we need to know when to cancel */
 	priv->subject = polkit_system_bus_name_new (sender);
 	if (!pk_dbus_connect (priv->dbus, &error)) {
@@ -2434,7 +2839,14 @@ pk_transaction_set_sender (PkTransaction *transaction, const gchar *sender)
 		return FALSE;
 	}
 
-	/* get uid and pid of the caller */
+	/* shared with the other transactions of the same caller */
+	priv->watch_id = pk_dbus_watch_sender (priv->dbus,
+					       sender,
+					       pk_transaction_vanished_cb,
+					       transaction);
+
+	/* get uid and pid of the caller, which is usually cached already
+	 * as the engine resolves it asynchronously before creating us */
 	if (!pk_dbus_get_uid_pid (priv->dbus, sender, &priv->client_uid, &priv->client_pid)) {
 		/* fallback in case our D-Bus does not support GetConnectionCredentials */
 		priv->client_uid = pk_dbus_get_uid (priv->dbus, sender);
@@ -2557,6 +2969,7 @@ pk_transaction_search_check (gchar **values, GError **error)
 struct AuthorizeActionsData {
 	PkTransaction *transaction;
 	PkRoleEnum role;
+	PolkitCheckAuthorizationFlags flags;
 	/** Array of policy actions to authorize. They will are processed sequentially,
 	 * which can result in several chained callbacks. */
 	GPtrArray *actions;
@@ -2631,6 +3044,13 @@ pk_transaction_authorize_actions_finished_cb (GObject *source_object,
 		goto out;
 	}
 
+	/* polkit would say yes again without asking anyone */
+	if ((data->flags & POLKIT_CHECK_AUTHORIZATION_FLAGS_ALLOW_USER_INTERACTION) == 0 ||
+	    polkit_authorization_result_get_temporary_authorization_id (result) != NULL) {
+		if (priv->auth_cache != NULL)
+			pk_auth_cache_add (priv->auth_cache, priv->sender, action_id);
+	}
+
 	if (data->actions->len <= 1) {
 		/* authentication finished successfully */
 		priv->waiting_for_auth = FALSE;
@@ -2676,8 +3096,20 @@ pk_transaction_authorize_actions (PkTransaction *transaction,
 	struct AuthorizeActionsData *data = NULL;
 	PolkitCheckAuthorizationFlags flags;
 
+	/* save a round trip for what the caller was just allowed to do */
+	while (priv->auth_cache != NULL && actions->len > 0) {
+		action_id = g_ptr_array_index (actions, 0);
+		if (!pk_auth_cache_lookup (priv->auth_cache, priv->sender, action_id))
+			break;
+		syslog (LOG_AUTH | LOG_INFO,
+			"uid %i obtained cached auth for %s",
+			priv->client_uid, action_id);
+		g_ptr_array_remove_index (actions, 0);
+	}
+
 	if (actions->len <= 0) {
 		g_debug ("No authentication required");
+		priv->waiting_for_auth = FALSE;
 		pk_transaction_set_state (transaction, PK_TRANSACTION_STATE_READY);
 		return TRUE;
 	}
@@ -2774,6 +3206,7 @@ pk_transaction_authorize_actions (PkTransaction *transaction,
 	flags = POLKIT_CHECK_AUTHORIZATION_FLAGS_NONE;
 	if (pk_backend_job_get_interactive (priv->job))
 		flags |= POLKIT_CHECK_AUTHORIZATION_FLAGS_ALLOW_USER_INTERACTION;
+	data->flags = flags;
 
 	g_debug ("authorizing action %s", action_id);
 	/* do authorization async */
@@ -3073,6 +3506,9 @@ pk_transaction_cancel (PkTransaction *transaction,
 
 	g_debug ("Cancel method called on %s", transaction->priv->tid);
 
+	/* a client that is cancelling does not want anything held back */
+	pk_transaction_set_signals_paused_internal (transaction, FALSE);
+
 	/* transaction is already finished */
 	if (transaction->priv->state == PK_TRANSACTION_STATE_FINISHED) {
 		g_set_error (&error,
@@ -3702,7 +4138,8 @@ pk_transaction_get_old_transactions (PkTransaction *transaction,
 	g_debug ("GetOldTransactions method called");
 
 	pk_transaction_set_role (transaction, PK_ROLE_ENUM_GET_OLD_TRANSACTIONS);
-	transactions = pk_transaction_db_get_list (transaction->priv->transaction_db, number);
+	if (transaction->priv->transaction_db != NULL)
+		transactions = pk_transaction_db_get_list (transaction->priv->transaction_db, number);
 	for (l = transactions; l != NULL; l = l->next) {
 		item = PK_TRANSACTION_PAST (l->data);
 
@@ -3724,21 +4161,17 @@ pk_transaction_get_old_transactions (PkTransaction *transaction,
 			 tid, modified, succeeded,
 			 pk_role_enum_to_string (role),
 			 duration, data, uid, cmdline);
-		g_dbus_connection_emit_signal (transaction->priv->connection,
-					       NULL,
-					       transaction->priv->tid,
-					       PK_DBUS_INTERFACE_TRANSACTION,
-					       "Transaction",
-					       g_variant_new ("(osbuusus)",
-							      tid,
-							      modified,
-							      succeeded,
-							      role,
-							      duration,
-							      data != NULL ? data : "",
-							      uid,
-							      cmdline != NULL ? cmdline : ""),
-					       NULL);
+		pk_transaction_emit_signal (transaction,
+					    "Transaction",
+					    g_variant_new ("(osbuusus)",
+							   tid,
+							   modified,
+							   succeeded,
+							   role,
+							   duration,
+							   data != NULL ? data : "",
+							   uid,
+							   cmdline != NULL ? cmdline : ""));
 	}
 	g_list_free_full (transactions, (GDestroyNotify) g_object_unref);
 
@@ -4198,7 +4631,7 @@ out:
 	pk_transaction_dbus_return (context, error);
 }
 
-static void
+void
 pk_transaction_refresh_cache (PkTransaction *transaction,
 			      GVariant *params,
 			      GDBusMethodInvocation *context)
@@ -4909,6 +5342,37 @@ pk_transaction_set_hint (PkTransaction *transaction,
 		return TRUE;
 	}
 
+	/* can the client map packages sent as a file descriptor? */
+	if (g_strcmp0 (key, "supports-packages-fd") == 0) {
+		if (g_strcmp0 (value, "true") != 0) {
+			g_set_error (error,
+				     PK_TRANSACTION_ERROR,
+				     PK_TRANSACTION_ERROR_NOT_SUPPORTED,
+				      "supports-packages-fd hint expects true only, not %s", value);
+			return FALSE;
+		}
+		if ((g_dbus_connection_get_capabilities (priv->connection) &
+		     G_DBUS_CAPABILITY_FLAGS_UNIX_FD_PASSING) == 0) {
+			g_debug ("ignoring supports-packages-fd as the bus cannot pass fds");
+			return TRUE;
+		}
+		priv->client_supports_packages_fd = TRUE;
+		return TRUE;
+	}
+
+	/* are the plural DetailsList and FilesList signals supported? */
+	if (g_strcmp0 (key, "supports-list-signals") == 0) {
+		if (g_strcmp0 (value, "true") != 0) {
+			g_set_error (error,
+				     PK_TRANSACTION_ERROR,
+				     PK_TRANSACTION_ERROR_NOT_SUPPORTED,
+				      "supports-list-signals hint expects true only, not %s", value);
+			return FALSE;
+		}
+		priv->client_supports_list_signals = TRUE;
+		return TRUE;
+	}
+
 	/* to preserve forwards and backwards compatibility, we ignore
 	 * extra options here */
 	g_warning ("unknown option: %s with value %s", key, value);
@@ -4955,6 +5419,37 @@ out:
 	pk_transaction_dbus_return (context, error);
 }
 
+static void
+pk_transaction_set_signals_paused (PkTransaction *transaction,
+				   GVariant *params,
+				   GDBusMethodInvocation *context)
+{
+	gboolean paused;
+	const gchar *sender;
+	g_autoptr(GError) error = NULL;
+
+	g_return_if_fail (PK_IS_TRANSACTION (transaction));
+	g_return_if_fail (transaction->priv->tid != NULL);
+
+	g_variant_get (params, "(b)", &paused);
+	g_debug ("SetSignalsPaused method called: %i", paused);
+
+	/* only the client receiving the signals may hold them back */
+	sender = g_dbus_method_invocation_get_sender (context);
+	if (g_strcmp0 (transaction->priv->sender, sender) != 0) {
+		g_set_error (&error,
+			     PK_TRANSACTION_ERROR,
+			     PK_TRANSACTION_ERROR_REFUSED_BY_POLICY,
+			     "only %s can pause the signals of %s",
+			     transaction->priv->sender,
+			     transaction->priv->tid);
+		goto out;
+	}
+	pk_transaction_set_signals_paused_internal (transaction, paused);
+out:
+	pk_transaction_dbus_return (context, error);
+}
+
 static void
 pk_transaction_update_packages (PkTransaction *transaction,
 				GVariant *params,
@@ -5229,6 +5724,8 @@ pk_transaction_get_property (GDBusConnection *connection_, const gchar *sender,
 		return g_variant_new_uint64 (priv->cached_transaction_flags);
 	if (g_strcmp0 (property_name, "RemainingTime") == 0)
 		return g_variant_new_uint32 (priv->remaining_time);
+	if (g_strcmp0 (property_name, "Stats") == 0)
+		return pk_transaction_get_stats (transaction);
 
 	g_set_error (error, G_DBUS_ERROR, G_DBUS_ERROR_UNKNOWN_PROPERTY,
 		     "Unknown transaction property ‘%s’", property_name);
@@ -5259,6 +5756,10 @@ pk_transaction_method_call (GDBusConnection *connection_, const gchar *sender,
 		pk_transaction_set_hints (transaction, parameters, invocation);
 		return;
 	}
+	if (g_strcmp0 (method_name, "SetSignalsPaused") == 0) {
+		pk_transaction_set_signals_paused (transaction, parameters, invocation);
+		return;
+	}
 	if (g_strcmp0 (method_name, "AcceptEula") == 0) {
 		pk_transaction_accept_eula (transaction, parameters, invocation);
 		return;
@@ -5440,6 +5941,11 @@ pk_transaction_reset_after_lock_error (PkTransaction *transaction)
 	g_object_unref (priv->results);
 	priv->results = pk_results_new ();
 
+	/* the job is started again when the transaction is run next */
+	pk_backend_job_disconnect_vfuncs (priv->job);
+	pk_backend_stop_job (priv->backend, priv->job);
+	pk_backend_job_reset (priv->job);
+
 	/* reset transaction state */
 	/* first set state manually, otherwise set_state will refuse to switch to an earlier stage */
 	priv->state = PK_TRANSACTION_STATE_READY;
@@ -5477,8 +5983,6 @@ pk_transaction_class_init (PkTransactionClass *klass)
 static void
 pk_transaction_init (PkTransaction *transaction)
 {
-	gboolean ret;
-	g_autoptr(GError) error = NULL;
 	transaction->priv = PK_TRANSACTION_GET_PRIVATE (transaction);
 	transaction->priv->allow_cancel = TRUE;
 	transaction->priv->caller_active = TRUE;
@@ -5494,11 +5998,8 @@ pk_transaction_init (PkTransaction *transaction)
 	transaction->priv->results = pk_results_new ();
 	transaction->priv->supported_content_types = g_ptr_array_new_with_free_func (g_free);
 	transaction->priv->cancellable = g_cancellable_new ();
-
-	transaction->priv->transaction_db = pk_transaction_db_new ();
-	ret = pk_transaction_db_load (transaction->priv->transaction_db, &error);
-	if (!ret)
-		g_error ("PkEngine: failed to load transaction db: %s", error->message);
+	g_queue_init (&transaction->priv->held_signals);
+	transaction->priv->time_created = g_get_monotonic_time ();
 }
 
 static void
@@ -5532,6 +6033,9 @@ pk_transaction_dispose (GObject *object)
 
 	unschedule_progress_changed (transaction);
 
+	/* never leave a paused client without its Finished signal */
+	pk_transaction_set_signals_paused_internal (transaction, FALSE);
+
 	/* send signal to clients that we are about to be destroyed */
 	if (transaction->priv->connection != NULL) {
 		g_debug ("emitting destroy %s", transaction->priv->tid);
@@ -5559,7 +6063,7 @@ pk_transaction_finalize (GObject *object)
 	if (transaction->priv->subject != NULL)
 		g_object_unref (transaction->priv->subject);
 	if (transaction->priv->watch_id > 0)
-		g_bus_unwatch_name (transaction->priv->watch_id);
+		pk_dbus_unwatch_sender (transaction->priv->dbus, transaction->priv->watch_id);
 	g_free (transaction->priv->last_package_id);
 	g_free (transaction->priv->cached_package_id);
 	g_free (transaction->priv->cached_key_id);
@@ -5573,7 +6077,11 @@ pk_transaction_finalize (GObject *object)
 	g_free (transaction->priv->tid);
 	g_free (transaction->priv->sender);
 	g_free (transaction->priv->cmdline);
+	if (transaction->priv->past != NULL)
+		g_object_unref (transaction->priv->past);
 	g_ptr_array_unref (transaction->priv->supported_content_types);
+	g_queue_clear_full (&transaction->priv->held_signals,
+			    (GDestroyNotify) pk_transaction_held_signal_free);
 
 	if (transaction->priv->connection != NULL)
 		g_object_unref (transaction->priv->connection);
@@ -5585,10 +6093,13 @@ pk_transaction_finalize (GObject *object)
 	if (transaction->priv->backend != NULL)
 		g_object_unref (transaction->priv->backend);
 	g_object_unref (transaction->priv->job);
-	g_object_unref (transaction->priv->transaction_db);
+	if (transaction->priv->transaction_db != NULL)
+		g_object_unref (transaction->priv->transaction_db);
 	g_object_unref (transaction->priv->results);
 	if (transaction->priv->authority != NULL)
 		g_object_unref (transaction->priv->authority);
+	if (transaction->priv->auth_cache != NULL)
+		g_object_unref (transaction->priv->auth_cache);
 	g_object_unref (transaction->priv->cancellable);
 
 	G_OBJECT_CLASS (pk_transaction_parent_class)->finalize (object);
@@ -26,7 +26,9 @@
 #include <packagekit-glib2/pk-enum.h>
 #include <packagekit-glib2/pk-results.h>
 
+#include "pk-auth-cache.h"
 #include "pk-backend.h"
+#include "pk-transaction-db.h"
 
 G_BEGIN_DECLS
 
@@ -71,6 +73,11 @@ PkTransaction	*pk_transaction_new				(GKeyFile		*conf,
 /* go go go! */
 gboolean	 pk_transaction_run				(PkTransaction	*transaction)
 								 G_GNUC_WARN_UNUSED_RESULT;
+gboolean	 pk_transaction_replay				(PkTransaction	*transaction,
+								 PkResults	*results)
+								 G_GNUC_WARN_UNUSED_RESULT;
+gchar		*pk_transaction_get_coalesce_key		(PkTransaction	*transaction);
+PkResults	*pk_transaction_get_results			(PkTransaction	*transaction);
 /* internal status */
 void		 pk_transaction_cancel_bg			(PkTransaction	*transaction);
 gboolean	 pk_transaction_get_background			(PkTransaction	*transaction);
@@ -78,13 +85,19 @@ PkRoleEnum	 pk_transaction_get_role			(PkTransaction	*transaction);
 guint		 pk_transaction_get_uid				(PkTransaction	*transaction);
 void		 pk_transaction_set_backend			(PkTransaction	*transaction,
 								 PkBackend	*backend);
+void		 pk_transaction_set_transaction_db		(PkTransaction	*transaction,
+								 PkTransactionDb *transaction_db);
+void		 pk_transaction_set_auth_cache			(PkTransaction	*transaction,
+								 PkAuthCache	*auth_cache);
 PkBackendJob	*pk_transaction_get_backend_job 		(PkTransaction	*transaction);
+GVariant	*pk_transaction_get_stats			(PkTransaction	*transaction);
 PkTransactionState pk_transaction_get_state			(PkTransaction	*transaction);
 void		 pk_transaction_set_state			(PkTransaction	*transaction,
 								 PkTransactionState state);
 const gchar	*pk_transaction_state_to_string			(PkTransactionState state);
 const gchar	*pk_transaction_get_tid				(PkTransaction	*transaction);
 gboolean	 pk_transaction_is_exclusive			(PkTransaction	*transaction);
+gboolean	 pk_transaction_is_query			(PkTransaction	*transaction);
 gboolean	 pk_transaction_is_finished_with_lock_required	(PkTransaction *transaction);
 void		 pk_transaction_reset_after_lock_error		(PkTransaction *transaction);
 void		 pk_transaction_make_exclusive			(PkTransaction *transaction);
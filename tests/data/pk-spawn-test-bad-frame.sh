@@ -0,0 +1,10 @@
+#!/bin/sh
+# Licensed under the GNU General Public License Version 2
+# This program is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation; either version 2 of the License, or
+# (at your option) any later version.
+
+# a frame header claiming a payload far bigger than allowed
+printf '\036\377\377\377\377'
+sleep 10